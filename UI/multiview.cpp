@@ -374,71 +374,106 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 		gs_matrix_pop();
 	};
 
+	auto batchBox = [&](float tx, float ty, float cx, float cy, uint32_t colorVal) {
+		gs_matrix_push();
+		gs_matrix_translate3f(tx, ty, 0.0f);
+		gs_batch_quad((uint32_t)cx, (uint32_t)cy, colorVal);
+		gs_matrix_pop();
+	};
+
+	auto translateLabel = [&](obs_source_t *label) {
+		offset = labelOffset(multiviewLayout, label, scenesCX);
+		gs_matrix_translate3f(sourceX + offset,
+				      sourceY + scenesCY - (obs_source_get_height(label) * ppiScaleY) - (thickness * 3),
+				      0.0f);
+		gs_matrix_scale3f(ppiScaleX, ppiScaleY, 1.0f);
+	};
+
 	// Define the whole usable region for the multiview
 	startRegion(x, y, targetCX * scale, targetCY * scale, 0.0f, fw, 0.0f, fh);
 
-	// Change the background color to highlight all sources
-	drawBox(fw, fh, outerColor);
-
 	/* ----------------------------- */
 	/* draw sources                  */
 
-	for (size_t i = 0; i < maxSrcs; i++) {
-		// Handle all the offsets
-		calcBaseSource(i);
+	// The scene boxes don't overlap, so all the colored backgrounds are
+	// batched into a single draw before any of the sources are rendered
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	gs_eparam_t *solidColor = gs_effect_get_param_by_name(solid, "color");
+
+	gs_effect_set_color(solidColor, 0xFFFFFFFF);
+	while (gs_effect_loop(solid, "SolidColored")) {
+		// Change the background color to highlight all sources
+		gs_batch_quad((uint32_t)fw, (uint32_t)fh, outerColor);
+
+		for (size_t i = 0; i < maxSrcs; i++) {
+			// Handle all the offsets
+			calcBaseSource(i);
+
+			// Chose the proper highlight color
+			uint32_t colorVal = outerColor;
+			if (i < numSrcs) {
+				OBSSource src = OBSGetStrongRef(multiviewScenes[i]);
+				if (src == programSrc)
+					colorVal = programColor;
+				else if (src == previewSrc)
+					colorVal = studioMode ? previewColor : programColor;
+			}
 
-		if (i >= numSrcs) {
-			// Just paint the background and continue
-			paintAreaWithColor(sourceX, sourceY, scenesCX, scenesCY, outerColor);
-			paintAreaWithColor(siX, siY, siCX, siCY, backgroundColor);
-			continue;
+			// Paint the background
+			batchBox(sourceX, sourceY, scenesCX, scenesCY, colorVal);
+			batchBox(siX, siY, siCX, siCY, backgroundColor);
 		}
+	}
 
-		OBSSource src = OBSGetStrongRef(multiviewScenes[i]);
-
-		// We have a source. Now chose the proper highlight color
-		uint32_t colorVal = outerColor;
-		if (src == programSrc)
-			colorVal = programColor;
-		else if (src == previewSrc)
-			colorVal = studioMode ? previewColor : programColor;
-
-		// Paint the background
-		paintAreaWithColor(sourceX, sourceY, scenesCX, scenesCY, colorVal);
-		paintAreaWithColor(siX, siY, siCX, siCY, backgroundColor);
+	for (size_t i = 0; i < numSrcs && i < maxSrcs; i++) {
+		calcBaseSource(i);
 
-		/* ----------- */
+		OBSSource src = OBSGetStrongRef(multiviewScenes[i]);
 
 		// Render the source
 		gs_matrix_push();
 		gs_matrix_translate3f(siX, siY, 0.0f);
 		gs_matrix_scale3f(siScaleX, siScaleY, 1.0f);
 		setRegion(siX, siY, siCX, siCY);
-		obs_source_video_render(src);
+		obs_source_video_render_cached(src);
 		endRegion();
 		gs_matrix_pop();
+	}
 
-		/* ----------- */
+	/* ----------- */
 
-		// Render the label
-		if (!drawLabel)
-			continue;
+	// Render the labels, again with all the label boxes in one draw
+	if (drawLabel) {
+		gs_effect_set_color(solidColor, 0xFFFFFFFF);
+		while (gs_effect_loop(solid, "SolidColored")) {
+			for (size_t i = 0; i < numSrcs && i < maxSrcs; i++) {
+				obs_source *label = multiviewLabels[i + 2];
+				if (!label)
+					continue;
+
+				calcBaseSource(i);
+
+				gs_matrix_push();
+				translateLabel(label);
+				gs_batch_quad(obs_source_get_width(label),
+					      (uint32_t)(obs_source_get_height(label) + thicknessx2), labelColor);
+				gs_matrix_pop();
+			}
+		}
 
-		obs_source *label = multiviewLabels[i + 2];
-		if (!label)
-			continue;
+		for (size_t i = 0; i < numSrcs && i < maxSrcs; i++) {
+			obs_source *label = multiviewLabels[i + 2];
+			if (!label)
+				continue;
 
-		offset = labelOffset(multiviewLayout, label, scenesCX);
+			calcBaseSource(i);
 
-		gs_matrix_push();
-		gs_matrix_translate3f(sourceX + offset,
-				      sourceY + scenesCY - (obs_source_get_height(label) * ppiScaleY) - (thickness * 3),
-				      0.0f);
-		gs_matrix_scale3f(ppiScaleX, ppiScaleY, 1.0f);
-		drawBox(obs_source_get_width(label), obs_source_get_height(label) + thicknessx2, labelColor);
-		gs_matrix_translate3f(0, thickness, 0.0f);
-		obs_source_video_render(label);
-		gs_matrix_pop();
+			gs_matrix_push();
+			translateLabel(label);
+			gs_matrix_translate3f(0, thickness, 0.0f);
+			obs_source_video_render(label);
+			gs_matrix_pop();
+		}
 	}
 
 	if (multiviewLayout == MultiviewLayout::SCENES_ONLY_4_SCENES ||
@@ -465,7 +500,7 @@ void Multiview::Render(uint32_t cx, uint32_t cy)
 	gs_matrix_scale3f(ppiScaleX, ppiScaleY, 1.0f);
 	setRegion(sourceX, sourceY, ppiCX, ppiCY);
 	if (studioMode)
-		obs_source_video_render(previewSrc);
+		obs_source_video_render_cached(previewSrc);
 	else
 		obs_render_main_texture();
 
@@ -2059,6 +2059,10 @@ void OBSBasic::OBSInit()
 	if (!ResetAudio())
 		throw "Failed to initialize audio";
 
+	char shaderCachePath[512];
+	if (GetAppConfigPath(shaderCachePath, sizeof(shaderCachePath), "obs-studio/shader-cache") > 0)
+		obs_set_shader_cache_path(shaderCachePath);
+
 	int ret = 0;
 
 	ret = ResetVideo();
@@ -4305,7 +4309,7 @@ void OBSBasic::RenderMain(void *data, uint32_t, uint32_t)
 		OBSScene scene = window->GetCurrentScene();
 		obs_source_t *source = obs_scene_get_source(scene);
 		if (source)
-			obs_source_video_render(source);
+			obs_source_video_render_cached(source);
 	} else {
 		obs_render_main_texture_src_color_only();
 	}
@@ -0,0 +1,102 @@
+#[=======================================================================[.rst
+FindLiburing
+------------
+
+FindModule for Liburing and associated libraries
+
+Imported Targets
+^^^^^^^^^^^^^^^^
+
+.. versionadded:: 3.0
+
+This module defines the :prop_tgt:`IMPORTED` target ``Liburing::Liburing``.
+
+Result Variables
+^^^^^^^^^^^^^^^^
+
+This module sets the following variables:
+
+``Liburing_FOUND``
+  True, if all required components and the core library were found.
+``Liburing_VERSION``
+  Detected version of found Liburing libraries.
+
+Cache variables
+^^^^^^^^^^^^^^^
+
+The following cache variables may also be set:
+
+``Liburing_LIBRARY``
+  Path to the library component of Liburing.
+``Liburing_INCLUDE_DIR``
+  Directory containing ``liburing.h``.
+
+#]=======================================================================]
+
+include(FindPackageHandleStandardArgs)
+
+find_package(PkgConfig QUIET)
+if(PKG_CONFIG_FOUND)
+  pkg_search_module(PC_Liburing QUIET liburing)
+endif()
+
+find_path(
+  Liburing_INCLUDE_DIR
+  NAMES liburing.h
+  HINTS ${PC_Liburing_INCLUDE_DIRS}
+  PATHS /usr/include /usr/local/include
+  DOC "Liburing include directory"
+)
+
+find_library(
+  Liburing_LIBRARY
+  NAMES uring liburing
+  HINTS ${PC_Liburing_LIBRARY_DIRS}
+  PATHS /usr/lib /usr/local/lib
+  DOC "Liburing location"
+)
+
+if(PC_Liburing_VERSION VERSION_GREATER 0)
+  set(Liburing_VERSION ${PC_Liburing_VERSION})
+else()
+  if(NOT Liburing_FIND_QUIETLY)
+    message(AUTHOR_WARNING "Failed to find Liburing version.")
+  endif()
+  set(Liburing_VERSION 0.0.0)
+endif()
+
+find_package_handle_standard_args(
+  Liburing
+  REQUIRED_VARS Liburing_LIBRARY Liburing_INCLUDE_DIR
+  VERSION_VAR Liburing_VERSION
+  REASON_FAILURE_MESSAGE "Ensure that Liburing is installed on the system."
+)
+mark_as_advanced(Liburing_INCLUDE_DIR Liburing_LIBRARY)
+
+if(Liburing_FOUND)
+  if(NOT TARGET Liburing::Liburing)
+    if(IS_ABSOLUTE "${Liburing_LIBRARY}")
+      add_library(Liburing::Liburing UNKNOWN IMPORTED)
+      set_property(TARGET Liburing::Liburing PROPERTY IMPORTED_LOCATION "${Liburing_LIBRARY}")
+    else()
+      add_library(Liburing::Liburing INTERFACE IMPORTED)
+      set_property(TARGET Liburing::Liburing PROPERTY IMPORTED_LIBNAME "${Liburing_LIBRARY}")
+    endif()
+
+    set_target_properties(
+      Liburing::Liburing
+      PROPERTIES
+        INTERFACE_COMPILE_OPTIONS "${PC_Liburing_CFLAGS_OTHER}"
+        INTERFACE_INCLUDE_DIRECTORIES "${Liburing_INCLUDE_DIR}"
+        VERSION ${Liburing_VERSION}
+    )
+  endif()
+endif()
+
+include(FeatureSummary)
+set_package_properties(
+  Liburing
+  PROPERTIES
+    URL "https://github.com/axboe/liburing"
+    DESCRIPTION "Helper library for the Linux io_uring asynchronous I/O interface."
+)
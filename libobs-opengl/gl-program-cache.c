@@ -0,0 +1,349 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include "gl-subsystem.h"
+
+/*
+ * On-disk cache of linked program binaries (glGetProgramBinary).
+ *
+ * Every cache key is seeded with the driver vendor, renderer and version
+ * and with GL_PROGRAM_CACHE_VERSION, so a driver update or a change to the
+ * GLSL translation invalidates the whole cache.  Shaders are keyed by their
+ * translated GLSL, programs by the keys of their two shaders.  The files
+ * live in a subdirectory named after the driver key, any other entries of
+ * the cache directory are stale and removed on init.
+ *
+ * Shaders that have compiled before with the same driver are marked with an
+ * empty file, which lets shader creation skip compiling them; they are only
+ * compiled if their program binary turns out to be missing or rejected.
+ */
+
+/* Increment if the GLSL translation or the on-disk format changes */
+#define GL_PROGRAM_CACHE_VERSION 1
+
+static uint64_t fnv1a_hash(uint64_t hash, const void *data, size_t len)
+{
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint64_t)bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static inline uint64_t fnv1a_hash_str(uint64_t hash, const char *str)
+{
+	return fnv1a_hash(hash, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+static void remove_dir(const char *path)
+{
+	struct dstr file = {0};
+	os_dir_t *dir = os_opendir(path);
+	struct os_dirent *ent;
+
+	if (!dir)
+		return;
+
+	while ((ent = os_readdir(dir)) != NULL) {
+		if (ent->directory)
+			continue;
+
+		dstr_printf(&file, "%s/%s", path, ent->d_name);
+		os_unlink(file.array);
+	}
+
+	os_closedir(dir);
+	dstr_free(&file);
+	os_rmdir(path);
+}
+
+/* removes everything left behind by other drivers or cache versions */
+static void prune_cache(const char *path, const char *current)
+{
+	struct dstr entry = {0};
+	os_dir_t *dir = os_opendir(path);
+	struct os_dirent *ent;
+	long pruned = 0;
+
+	if (!dir)
+		return;
+
+	while ((ent = os_readdir(dir)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+		if (ent->directory && strcmp(ent->d_name, current) == 0)
+			continue;
+
+		dstr_printf(&entry, "%s/%s", path, ent->d_name);
+		if (ent->directory)
+			remove_dir(entry.array);
+		else
+			os_unlink(entry.array);
+		pruned++;
+	}
+
+	os_closedir(dir);
+	dstr_free(&entry);
+
+	if (pruned)
+		blog(LOG_DEBUG, "Shader program cache: removed %ld stale entries", pruned);
+}
+
+void gl_program_cache_init(struct gs_device *device, const char *cache_path)
+{
+	GLint num_formats = 0;
+	uint64_t key = 14695981039346656037ULL;
+	int version = GL_PROGRAM_CACHE_VERSION;
+	struct dstr path = {0};
+	char name[17];
+
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+		return;
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	if (!gl_success("glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS)") || num_formats <= 0) {
+		blog(LOG_INFO, "Shader program cache disabled: no program binary formats supported");
+		return;
+	}
+
+	key = fnv1a_hash_str(key, (const char *)glGetString(GL_VENDOR));
+	key = fnv1a_hash_str(key, (const char *)glGetString(GL_RENDERER));
+	key = fnv1a_hash_str(key, (const char *)glGetString(GL_VERSION));
+	key = fnv1a_hash(key, &version, sizeof(version));
+
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+	prune_cache(cache_path, name);
+
+	dstr_printf(&path, "%s/%s", cache_path, name);
+	if (os_mkdirs(path.array) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "Shader program cache disabled: could not create '%s'", path.array);
+		dstr_free(&path);
+		return;
+	}
+
+	device->program_cache_path = path.array;
+	device->program_cache_key = key;
+	device->program_cache = true;
+}
+
+void gl_program_cache_free(struct gs_device *device)
+{
+	if (device->program_cache_hits || device->program_cache_misses)
+		blog(LOG_INFO,
+		     "Shader program cache: %ld hits, %ld misses, "
+		     "%.1f ms spent compiling and linking",
+		     device->program_cache_hits, device->program_cache_misses,
+		     (double)device->program_compile_ns / 1000000.0);
+
+	bfree(device->program_cache_path);
+	device->program_cache_path = NULL;
+	device->program_cache = false;
+}
+
+uint64_t gl_program_cache_shader_hash(struct gs_device *device, const char *gl_string)
+{
+	return fnv1a_hash_str(device->program_cache_key, gl_string);
+}
+
+static inline uint64_t program_hash(const struct gs_program *program)
+{
+	uint64_t hashes[2] = {program->vertex_shader->hash, program->pixel_shader->hash};
+	return fnv1a_hash(program->device->program_cache_key, hashes, sizeof(hashes));
+}
+
+static void cache_file_path(struct dstr *path, struct gs_device *device, uint64_t hash, const char *ext)
+{
+	dstr_printf(path, "%s/%016llx.%s%d", device->program_cache_path, (unsigned long long)hash, ext,
+		    GL_PROGRAM_CACHE_VERSION);
+}
+
+bool gl_program_cache_has_shader(struct gs_device *device, uint64_t hash)
+{
+	struct dstr path = {0};
+	bool exists;
+
+	if (!device->program_cache)
+		return false;
+
+	cache_file_path(&path, device, hash, "gls");
+	exists = os_file_exists(path.array);
+	dstr_free(&path);
+	return exists;
+}
+
+void gl_program_cache_add_shader(struct gs_device *device, uint64_t hash)
+{
+	struct dstr path = {0};
+	FILE *file;
+
+	if (!device->program_cache)
+		return;
+
+	cache_file_path(&path, device, hash, "gls");
+	file = os_fopen(path.array, "wb");
+	if (file)
+		fclose(file);
+	dstr_free(&path);
+}
+
+void gl_program_cache_remove_shader(struct gs_device *device, uint64_t hash)
+{
+	struct dstr path = {0};
+
+	if (!device->program_cache)
+		return;
+
+	cache_file_path(&path, device, hash, "gls");
+	os_unlink(path.array);
+	dstr_free(&path);
+}
+
+/* file layout: binary format, binary, checksum of the two */
+bool gl_program_cache_load(struct gs_program *program)
+{
+	struct gs_device *device = program->device;
+	struct dstr path = {0};
+	uint8_t *data = NULL;
+	uint64_t checksum;
+	GLenum format;
+	int64_t size;
+	bool success = false;
+	GLint linked = GL_FALSE;
+	FILE *file;
+
+	if (!device->program_cache)
+		return false;
+
+	cache_file_path(&path, device, program_hash(program), "glp");
+	file = os_fopen(path.array, "rb");
+	if (!file)
+		goto miss;
+
+	size = os_fgetsize(file);
+	if (size <= (int64_t)(sizeof(format) + sizeof(checksum)))
+		goto invalid;
+
+	size -= sizeof(checksum);
+	data = bmalloc((size_t)size);
+	if (fread(data, 1, (size_t)size, file) != (size_t)size)
+		goto invalid;
+	if (fread(&checksum, 1, sizeof(checksum), file) != sizeof(checksum))
+		goto invalid;
+	if (fnv1a_hash(14695981039346656037ULL, data, (size_t)size) != checksum)
+		goto invalid;
+
+	memcpy(&format, data, sizeof(format));
+	glProgramBinary(program->obj, format, data + sizeof(format), (GLsizei)(size - sizeof(format)));
+	if (!gl_success("glProgramBinary"))
+		goto rejected;
+
+	/* drivers are free to reject binaries, e.g. after an update that
+	 * didn't change the version string */
+	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+	if (!gl_success("glGetProgramiv") || linked == GL_FALSE)
+		goto rejected;
+
+	blog(LOG_DEBUG, "Shader program cache: hit '%s'", path.array);
+	device->program_cache_hits++;
+	success = true;
+	goto done;
+
+rejected:
+	/* the program gets compiled and linked normally instead, start over
+	 * with a program object that hasn't seen the binary */
+	blog(LOG_DEBUG, "Shader program cache: driver rejected '%s'", path.array);
+	glDeleteProgram(program->obj);
+	gl_success("glDeleteProgram");
+	program->obj = glCreateProgram();
+	gl_success("glCreateProgram");
+
+invalid:
+	if (file) {
+		fclose(file);
+		file = NULL;
+	}
+	os_unlink(path.array);
+
+miss:
+	device->program_cache_misses++;
+
+done:
+	if (file)
+		fclose(file);
+	bfree(data);
+	dstr_free(&path);
+	return success;
+}
+
+void gl_program_cache_save(struct gs_program *program)
+{
+	struct gs_device *device = program->device;
+	struct dstr path = {0};
+	struct dstr tmp_path = {0};
+	uint8_t *data = NULL;
+	GLint length = 0;
+	GLsizei written = 0;
+	GLenum format = 0;
+	uint64_t checksum;
+	bool success = false;
+	FILE *file;
+
+	if (!device->program_cache)
+		return;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (!gl_success("glGetProgramiv(GL_PROGRAM_BINARY_LENGTH)") || length <= 0)
+		return;
+
+	data = bmalloc(sizeof(format) + length);
+	glGetProgramBinary(program->obj, length, &written, &format, data + sizeof(format));
+	if (!gl_success("glGetProgramBinary") || written <= 0)
+		goto done;
+
+	memcpy(data, &format, sizeof(format));
+	checksum = fnv1a_hash(14695981039346656037ULL, data, sizeof(format) + written);
+
+	/* write to a temporary file first so that a crash can't leave a
+	 * truncated binary behind */
+	cache_file_path(&path, device, program_hash(program), "glp");
+	dstr_copy_dstr(&tmp_path, &path);
+	dstr_cat(&tmp_path, ".tmp");
+
+	file = os_fopen(tmp_path.array, "wb");
+	if (!file)
+		goto done;
+
+	success = fwrite(data, 1, sizeof(format) + written, file) == sizeof(format) + written &&
+		  fwrite(&checksum, 1, sizeof(checksum), file) == sizeof(checksum);
+	fclose(file);
+
+	if (success)
+		success = os_safe_replace(path.array, tmp_path.array, NULL) == 0;
+	if (!success) {
+		blog(LOG_DEBUG, "Shader program cache: failed to write '%s'", path.array);
+		os_unlink(tmp_path.array);
+	}
+
+done:
+	bfree(data);
+	dstr_free(&tmp_path);
+	dstr_free(&path);
+}
@@ -17,6 +17,7 @@
 
 #include <assert.h>
 
+#include <util/platform.h>
 #include <graphics/vec2.h>
 #include <graphics/vec3.h>
 #include <graphics/vec4.h>
@@ -174,18 +175,22 @@ static inline bool gl_process_attribs(struct gs_shader *shader, struct gl_shader
 	return true;
 }
 
-static bool gl_shader_init(struct gs_shader *shader, struct gl_shader_parser *glsp, const char *file,
-			   char **error_string)
+static bool gl_shader_compile(struct gs_shader *shader, char **error_string)
 {
 	GLenum type = convert_shader_type(shader->type);
+	uint64_t start = os_gettime_ns();
 	int compiled = 0;
 	bool success = true;
 
+	/* the GLSL is only freed once it has compiled */
+	if (shader->obj)
+		return !shader->gl_string;
+
 	shader->obj = glCreateShader(type);
 	if (!gl_success("glCreateShader") || !shader->obj)
 		return false;
 
-	glShaderSource(shader->obj, 1, (const GLchar **)&glsp->gl_string.array, 0);
+	glShaderSource(shader->obj, 1, (const GLchar **)&shader->gl_string, 0);
 	if (!gl_success("glShaderSource"))
 		return false;
 
@@ -195,9 +200,9 @@ static bool gl_shader_init(struct gs_shader *shader, struct gl_shader_parser *gl
 
 #if 0
 	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
-	blog(LOG_DEBUG, "  GL shader string for: %s", file);
+	blog(LOG_DEBUG, "  GL shader string for: %s", shader->file);
 	blog(LOG_DEBUG, "-----------------------------------");
-	blog(LOG_DEBUG, "%s", glsp->gl_string.array);
+	blog(LOG_DEBUG, "%s", shader->gl_string);
 	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
 #endif
 
@@ -222,7 +227,32 @@ static bool gl_shader_init(struct gs_shader *shader, struct gl_shader_parser *gl
 		success = false;
 	}
 
-	gl_get_shader_info(shader->obj, file, error_string);
+	gl_get_shader_info(shader->obj, shader->file, error_string);
+
+	shader->device->program_compile_ns += os_gettime_ns() - start;
+
+	if (success) {
+		gl_program_cache_add_shader(shader->device, shader->hash);
+		bfree(shader->gl_string);
+		shader->gl_string = NULL;
+	}
+
+	return success;
+}
+
+static bool gl_shader_init(struct gs_shader *shader, struct gl_shader_parser *glsp, const char *file,
+			   char **error_string)
+{
+	bool success = true;
+
+	shader->gl_string = bstrdup(glsp->gl_string.array);
+	shader->file = bstrdup(file);
+	shader->hash = gl_program_cache_shader_hash(shader->device, shader->gl_string);
+
+	/* shaders that have compiled before are only compiled if their
+	 * program can't be loaded from the cache */
+	if (!gl_program_cache_has_shader(shader->device, shader->hash))
+		success = gl_shader_compile(shader, error_string);
 
 	if (success)
 		success = gl_add_params(shader, glsp);
@@ -322,6 +352,8 @@ void gs_shader_destroy(gs_shader_t *shader)
 		gl_success("glDeleteShader");
 	}
 
+	bfree(shader->gl_string);
+	bfree(shader->file);
 	da_free(shader->samplers);
 	da_free(shader->params);
 	da_free(shader->attribs);
@@ -598,51 +630,101 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
-struct gs_program *gs_program_create(struct gs_device *device)
+/* Compiles a shader whose compile gl_shader_init skipped because it had
+ * compiled before.  There is no effect to report errors to at this point, so
+ * they are logged, and the shader is compiled up front again next time. */
+static bool gl_shader_compile_deferred(struct gs_shader *shader)
 {
-	struct gs_program *program = bzalloc(sizeof(*program));
+	char *errors = NULL;
+	bool success;
+
+	if (shader->obj)
+		return gl_shader_compile(shader, NULL);
+
+	success = gl_shader_compile(shader, &errors);
+	if (!success) {
+		blog(LOG_ERROR, "Shader '%s' from the program cache failed to compile:\n%s", shader->file,
+		     errors ? errors : "");
+		gl_program_cache_remove_shader(shader->device, shader->hash);
+	}
+
+	bfree(errors);
+	return success;
+}
+
+static bool program_link(struct gs_program *program)
+{
+	struct gs_device *device = program->device;
+	uint64_t start;
 	int linked = false;
 
-	program->device = device;
-	program->vertex_shader = device->cur_vertex_shader;
-	program->pixel_shader = device->cur_pixel_shader;
+	if (!gl_shader_compile_deferred(program->vertex_shader))
+		return false;
+	if (!gl_shader_compile_deferred(program->pixel_shader))
+		return false;
 
-	program->obj = glCreateProgram();
-	if (!gl_success("glCreateProgram"))
-		goto error_detach_neither;
+	start = os_gettime_ns();
+
+	if (device->program_cache) {
+		glProgramParameteri(program->obj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		gl_success("glProgramParameteri");
+	}
 
 	glAttachShader(program->obj, program->vertex_shader->obj);
 	if (!gl_success("glAttachShader (vertex)"))
-		goto error_detach_neither;
+		return false;
 
 	glAttachShader(program->obj, program->pixel_shader->obj);
 	if (!gl_success("glAttachShader (pixel)"))
-		goto error_detach_vertex;
+		goto detach_vertex;
 
 	glLinkProgram(program->obj);
 	if (!gl_success("glLinkProgram"))
-		goto error;
+		goto detach;
 
 	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
 	if (!gl_success("glGetProgramiv"))
-		goto error;
+		linked = GL_FALSE;
 
-	if (linked == GL_FALSE) {
+	if (linked == GL_FALSE)
 		print_link_errors(program->obj);
+
+detach:
+	glDetachShader(program->obj, program->pixel_shader->obj);
+	gl_success("glDetachShader (pixel)");
+
+detach_vertex:
+	glDetachShader(program->obj, program->vertex_shader->obj);
+	gl_success("glDetachShader (vertex)");
+
+	if (linked == GL_FALSE)
+		return false;
+
+	device->program_compile_ns += os_gettime_ns() - start;
+	gl_program_cache_save(program);
+	return true;
+}
+
+struct gs_program *gs_program_create(struct gs_device *device)
+{
+	struct gs_program *program = bzalloc(sizeof(*program));
+
+	program->device = device;
+	program->vertex_shader = device->cur_vertex_shader;
+	program->pixel_shader = device->cur_pixel_shader;
+
+	program->obj = glCreateProgram();
+	if (!gl_success("glCreateProgram"))
+		goto error;
+
+	if (!gl_program_cache_load(program) && !program_link(program))
 		goto error;
-	}
 
 	if (!assign_program_attribs(program))
 		goto error;
 	if (!assign_program_params(program))
 		goto error;
 
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
 	program->next = device->first_program;
 	program->prev_next = &device->first_program;
 	device->first_program = program;
@@ -652,14 +734,6 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	return program;
 
 error:
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
-error_detach_vertex:
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-error_detach_neither:
 	gs_program_destroy(program);
 	return NULL;
 }
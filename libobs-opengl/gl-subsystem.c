@@ -283,6 +283,7 @@ void device_destroy(gs_device_t *device)
 	if (device) {
 		while (device->first_program)
 			gs_program_destroy(device->first_program);
+		gl_program_cache_free(device);
 
 		samplerstate_release(device->raw_load_sampler);
 		gl_delete_vertex_arrays(1, &device->empty_vao);
@@ -1457,6 +1458,14 @@ void gs_swapchain_destroy(gs_swapchain_t *swapchain)
 	bfree(swapchain);
 }
 
+void device_set_shader_cache_path(gs_device_t *device, const char *path)
+{
+	gl_program_cache_free(device);
+
+	if (path)
+		gl_program_cache_init(device, path);
+}
+
 bool device_nv12_available(gs_device_t *device)
 {
 	UNUSED_PARAMETER(device);
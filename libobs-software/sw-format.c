@@ -0,0 +1,441 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include "sw-subsystem.h"
+#include <graphics/half.h>
+
+/* 8-bit texels are converted through lookup tables, one for unorm values and
+ * one that also applies the sRGB transfer function */
+#define SRGB_ENCODE_SIZE 16384
+
+static float unorm_lut[256];
+static float srgb_lut[256];
+static uint8_t srgb_encode_lut[SRGB_ENCODE_SIZE + 1];
+static pthread_once_t format_tables_once = PTHREAD_ONCE_INIT;
+
+float sw_srgb_nonlinear_to_linear(float u)
+{
+	return (u <= 0.04045f) ? (u / 12.92f) : powf((u + 0.055f) / 1.055f, 2.4f);
+}
+
+float sw_srgb_linear_to_nonlinear(float u)
+{
+	return (u <= 0.0031308f) ? (12.92f * u) : ((1.055f * powf(u, 1.0f / 2.4f)) - 0.055f);
+}
+
+static void init_format_tables(void)
+{
+	for (int i = 0; i < 256; i++) {
+		unorm_lut[i] = (float)i / 255.0f;
+		srgb_lut[i] = sw_srgb_nonlinear_to_linear(unorm_lut[i]);
+	}
+
+	for (int i = 0; i <= SRGB_ENCODE_SIZE; i++) {
+		float f = sw_srgb_linear_to_nonlinear((float)i / (float)SRGB_ENCODE_SIZE);
+		srgb_encode_lut[i] = (uint8_t)(f * 255.0f + 0.5f);
+	}
+}
+
+void sw_init_format_tables(void)
+{
+	pthread_once(&format_tables_once, init_format_tables);
+}
+
+const float *sw_get_texel_lut(bool srgb)
+{
+	return srgb ? srgb_lut : unorm_lut;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline float saturate(float f)
+{
+	return f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+}
+
+static inline uint8_t to_unorm8(float f)
+{
+	return (uint8_t)(saturate(f) * 255.0f + 0.5f);
+}
+
+static inline uint16_t to_unorm16(float f)
+{
+	return (uint16_t)(saturate(f) * 65535.0f + 0.5f);
+}
+
+static inline uint8_t to_unorm8_srgb(float f, bool srgb)
+{
+	if (srgb)
+		return srgb_encode_lut[(int)(saturate(f) * (float)SRGB_ENCODE_SIZE + 0.5f)];
+	return to_unorm8(f);
+}
+
+/* adapted from DirectXMath XMConvertHalfToFloat */
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t mantissa = (uint32_t)(h & 0x03FF);
+	uint32_t exponent = (uint32_t)(h & 0x7C00);
+	uint32_t result;
+
+	if (exponent == 0x7C00) {
+		exponent = 0x8f;
+	} else if (exponent != 0) {
+		exponent = (uint32_t)((h >> 10) & 0x1F);
+	} else if (mantissa != 0) {
+		/* denormalized, normalize it */
+		exponent = 1;
+		do {
+			exponent--;
+			mantissa <<= 1;
+		} while ((mantissa & 0x0400) == 0);
+		mantissa &= 0x03FF;
+	} else {
+		exponent = (uint32_t)-112;
+	}
+
+	result = (((uint32_t)h & 0x8000) << 16) | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float f;
+	memcpy(&f, &result, sizeof(f));
+	return f;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void load_a8(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	vec4_set(out, 0.0f, 0.0f, 0.0f, unorm_lut[p[0]]);
+}
+
+static void load_r8(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	vec4_set(out, unorm_lut[p[0]], 0.0f, 0.0f, 1.0f);
+}
+
+static void load_r8g8(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	vec4_set(out, unorm_lut[p[0]], unorm_lut[p[1]], 0.0f, 1.0f);
+}
+
+static void load_rgba(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	vec4_set(out, lut[p[0]], lut[p[1]], lut[p[2]], unorm_lut[p[3]]);
+}
+
+static void load_bgrx(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	vec4_set(out, lut[p[2]], lut[p[1]], lut[p[0]], 1.0f);
+}
+
+static void load_bgra(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	vec4_set(out, lut[p[2]], lut[p[1]], lut[p[0]], unorm_lut[p[3]]);
+}
+
+static void load_r10g10b10a2(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	vec4_set(out, (float)(v & 0x3FF) / 1023.0f, (float)((v >> 10) & 0x3FF) / 1023.0f,
+		 (float)((v >> 20) & 0x3FF) / 1023.0f, (float)(v >> 30) / 3.0f);
+}
+
+static void load_r16(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	vec4_set(out, (float)v / 65535.0f, 0.0f, 0.0f, 1.0f);
+}
+
+static void load_rg16(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v[2];
+	memcpy(v, p, sizeof(v));
+	vec4_set(out, (float)v[0] / 65535.0f, (float)v[1] / 65535.0f, 0.0f, 1.0f);
+}
+
+static void load_rgba16(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v[4];
+	memcpy(v, p, sizeof(v));
+	vec4_set(out, (float)v[0] / 65535.0f, (float)v[1] / 65535.0f, (float)v[2] / 65535.0f, (float)v[3] / 65535.0f);
+}
+
+static void load_r16f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	vec4_set(out, half_to_float(v), 0.0f, 0.0f, 1.0f);
+}
+
+static void load_rg16f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v[2];
+	memcpy(v, p, sizeof(v));
+	vec4_set(out, half_to_float(v[0]), half_to_float(v[1]), 0.0f, 1.0f);
+}
+
+static void load_rgba16f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	uint16_t v[4];
+	memcpy(v, p, sizeof(v));
+	vec4_set(out, half_to_float(v[0]), half_to_float(v[1]), half_to_float(v[2]), half_to_float(v[3]));
+}
+
+static void load_r32f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	float v;
+	memcpy(&v, p, sizeof(v));
+	vec4_set(out, v, 0.0f, 0.0f, 1.0f);
+}
+
+static void load_rg32f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	float v[2];
+	memcpy(v, p, sizeof(v));
+	vec4_set(out, v[0], v[1], 0.0f, 1.0f);
+}
+
+static void load_rgba32f(const uint8_t *p, const float *lut, struct vec4 *out)
+{
+	UNUSED_PARAMETER(lut);
+	memcpy(out->ptr, p, sizeof(float) * 4);
+}
+
+sw_texel_load_t sw_get_texel_load(enum gs_color_format format)
+{
+	switch (format) {
+	case GS_A8:
+		return load_a8;
+	case GS_R8:
+		return load_r8;
+	case GS_R8G8:
+		return load_r8g8;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		return load_rgba;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		return load_bgrx;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		return load_bgra;
+	case GS_R10G10B10A2:
+		return load_r10g10b10a2;
+	case GS_R16:
+		return load_r16;
+	case GS_RG16:
+		return load_rg16;
+	case GS_RGBA16:
+		return load_rgba16;
+	case GS_R16F:
+		return load_r16f;
+	case GS_RG16F:
+		return load_rg16f;
+	case GS_RGBA16F:
+		return load_rgba16f;
+	case GS_R32F:
+		return load_r32f;
+	case GS_RG32F:
+		return load_rg32f;
+	case GS_RGBA32F:
+		return load_rgba32f;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		break;
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void store_a8(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	p[0] = to_unorm8(c->w);
+}
+
+static void store_r8(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	p[0] = to_unorm8(c->x);
+}
+
+static void store_r8g8(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	p[0] = to_unorm8(c->x);
+	p[1] = to_unorm8(c->y);
+}
+
+static void store_rgba(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	p[0] = to_unorm8_srgb(c->x, srgb);
+	p[1] = to_unorm8_srgb(c->y, srgb);
+	p[2] = to_unorm8_srgb(c->z, srgb);
+	p[3] = to_unorm8(c->w);
+}
+
+static void store_bgrx(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	p[0] = to_unorm8_srgb(c->z, srgb);
+	p[1] = to_unorm8_srgb(c->y, srgb);
+	p[2] = to_unorm8_srgb(c->x, srgb);
+	p[3] = 255;
+}
+
+static void store_bgra(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	p[0] = to_unorm8_srgb(c->z, srgb);
+	p[1] = to_unorm8_srgb(c->y, srgb);
+	p[2] = to_unorm8_srgb(c->x, srgb);
+	p[3] = to_unorm8(c->w);
+}
+
+static void store_r10g10b10a2(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint32_t r = (uint32_t)(saturate(c->x) * 1023.0f + 0.5f);
+	uint32_t g = (uint32_t)(saturate(c->y) * 1023.0f + 0.5f);
+	uint32_t b = (uint32_t)(saturate(c->z) * 1023.0f + 0.5f);
+	uint32_t a = (uint32_t)(saturate(c->w) * 3.0f + 0.5f);
+	uint32_t v = r | (g << 10) | (b << 20) | (a << 30);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void store_r16(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v = to_unorm16(c->x);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void store_rg16(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v[2] = {to_unorm16(c->x), to_unorm16(c->y)};
+	memcpy(p, v, sizeof(v));
+}
+
+static void store_rgba16(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v[4] = {to_unorm16(c->x), to_unorm16(c->y), to_unorm16(c->z), to_unorm16(c->w)};
+	memcpy(p, v, sizeof(v));
+}
+
+static void store_r16f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v = half_from_float(c->x).u;
+	memcpy(p, &v, sizeof(v));
+}
+
+static void store_rg16f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v[2] = {half_from_float(c->x).u, half_from_float(c->y).u};
+	memcpy(p, v, sizeof(v));
+}
+
+static void store_rgba16f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	uint16_t v[4] = {half_from_float(c->x).u, half_from_float(c->y).u, half_from_float(c->z).u,
+			 half_from_float(c->w).u};
+	memcpy(p, v, sizeof(v));
+}
+
+static void store_r32f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	memcpy(p, &c->x, sizeof(float));
+}
+
+static void store_rg32f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	memcpy(p, c->ptr, sizeof(float) * 2);
+}
+
+static void store_rgba32f(uint8_t *p, const struct vec4 *c, bool srgb)
+{
+	UNUSED_PARAMETER(srgb);
+	memcpy(p, c->ptr, sizeof(float) * 4);
+}
+
+sw_texel_store_t sw_get_texel_store(enum gs_color_format format)
+{
+	switch (format) {
+	case GS_A8:
+		return store_a8;
+	case GS_R8:
+		return store_r8;
+	case GS_R8G8:
+		return store_r8g8;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		return store_rgba;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		return store_bgrx;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		return store_bgra;
+	case GS_R10G10B10A2:
+		return store_r10g10b10a2;
+	case GS_R16:
+		return store_r16;
+	case GS_RG16:
+		return store_rg16;
+	case GS_RGBA16:
+		return store_rgba16;
+	case GS_R16F:
+		return store_r16f;
+	case GS_RG16F:
+		return store_rg16f;
+	case GS_RGBA16F:
+		return store_rgba16f;
+	case GS_R32F:
+		return store_r32f;
+	case GS_RG32F:
+		return store_rg32f;
+	case GS_RGBA32F:
+		return store_rgba32f;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		break;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,1021 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * CPU implementations of the pixel and vertex shaders of the stock libobs
+ * effects.  Each one mirrors the HLSL in libobs/data line by line, so when an
+ * effect changes the matching function here has to be updated as well.
+ */
+
+#include <math.h>
+#include "sw-subsystem.h"
+
+static inline float saturate(float f)
+{
+	return f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+}
+
+static inline float dot3(const float *a, const struct vec4 *b)
+{
+	return a[0] * b->x + a[1] * b->y + a[2] * b->z;
+}
+
+static inline void madd(struct vec4 *dst, const struct vec4 *v, float f)
+{
+	dst->x += v->x * f;
+	dst->y += v->y * f;
+	dst->z += v->z * f;
+	dst->w += v->w * f;
+}
+
+static inline float span_x(const struct sw_span *span, int i)
+{
+	return (float)(span->x + i) + 0.5f;
+}
+
+static inline float span_var(const struct sw_span *span, int var, int i)
+{
+	return span->v[var] + span->dvdx[var] * (float)i;
+}
+
+/* ------------------------------------------------------------------------- */
+/* color.effect                                                              */
+
+static inline void srgb_linear_to_nonlinear(struct vec4 *c)
+{
+	c->x = sw_srgb_linear_to_nonlinear(c->x);
+	c->y = sw_srgb_linear_to_nonlinear(c->y);
+	c->z = sw_srgb_linear_to_nonlinear(c->z);
+}
+
+static inline void srgb_nonlinear_to_linear(struct vec4 *c)
+{
+	c->x = sw_srgb_nonlinear_to_linear(c->x);
+	c->y = sw_srgb_nonlinear_to_linear(c->y);
+	c->z = sw_srgb_nonlinear_to_linear(c->z);
+}
+
+static inline void rec709_to_rec2020(struct vec4 *c)
+{
+	float r = c->x * 0.62740389593469903f + c->y * 0.32928303837788370f + c->z * 0.043313065687417225f;
+	float g = c->x * 0.069097289358232075f + c->y * 0.91954039507545871f + c->z * 0.011362315566309178f;
+	float b = c->x * 0.016391438875150280f + c->y * 0.088013307877225749f + c->z * 0.89559525324762401f;
+	c->x = r;
+	c->y = g;
+	c->z = b;
+}
+
+static inline void rec2020_to_rec709(struct vec4 *c)
+{
+	float r = c->x * 1.6604910021084345f + c->y * -0.58764113878854951f + c->z * -0.072849863319884883f;
+	float g = c->x * -0.12455047452159074f + c->y * 1.1328998971259603f + c->z * -0.0083494226043694768f;
+	float b = c->x * -0.018150763354905303f + c->y * -0.10057889800800739f + c->z * 1.1187296613629127f;
+	c->x = r;
+	c->y = g;
+	c->z = b;
+}
+
+static inline float reinhard_channel(float f)
+{
+	f = saturate(f / (f + 1.0f));
+	return sw_srgb_nonlinear_to_linear(powf(f, 1.0f / 2.4f));
+}
+
+static inline void tonemap(struct vec4 *c)
+{
+	rec709_to_rec2020(c);
+	c->x = reinhard_channel(c->x);
+	c->y = reinhard_channel(c->y);
+	c->z = reinhard_channel(c->z);
+	rec2020_to_rec709(c);
+}
+
+/* ------------------------------------------------------------------------- */
+/* post-processing shared by the draw and scale techniques, applied in the
+ * order listed here, which is the order the effects apply them in           */
+
+#define OP_ALPHA_DIVIDE (1 << 0)
+#define OP_UNPREMULTIPLY (1 << 1)
+#define OP_NONLINEAR_ALPHA (1 << 2)
+#define OP_SRGB_DECOMPRESS (1 << 3)
+#define OP_MULTIPLY (1 << 4)
+#define OP_TONEMAP (1 << 5)
+#define OP_OPAQUE (1 << 6)
+
+#define C_MULTIPLIER 0
+#define C_BASE_DIM 1
+#define C_BASE_DIM_I 3
+
+static inline void apply_ops(uint32_t ops, const float *consts, struct vec4 *c)
+{
+	if (ops & OP_ALPHA_DIVIDE) {
+		float f = (c->w > 0.0f) ? (1.0f / c->w) : 0.0f;
+		c->x *= f;
+		c->y *= f;
+		c->z *= f;
+	}
+	if (ops & OP_UNPREMULTIPLY) {
+		if (c->w > 0.0f) {
+			c->x /= c->w;
+			c->y /= c->w;
+			c->z /= c->w;
+		}
+		c->x = saturate(c->x);
+		c->y = saturate(c->y);
+		c->z = saturate(c->z);
+		c->w = saturate(c->w);
+	}
+	if (ops & OP_NONLINEAR_ALPHA) {
+		srgb_linear_to_nonlinear(c);
+		c->x *= c->w;
+		c->y *= c->w;
+		c->z *= c->w;
+		srgb_nonlinear_to_linear(c);
+	}
+	if (ops & OP_SRGB_DECOMPRESS)
+		srgb_nonlinear_to_linear(c);
+	if (ops & OP_MULTIPLY) {
+		c->x *= consts[C_MULTIPLIER];
+		c->y *= consts[C_MULTIPLIER];
+		c->z *= consts[C_MULTIPLIER];
+	}
+	if (ops & OP_TONEMAP)
+		tonemap(c);
+	if (ops & OP_OPAQUE)
+		c->w = 1.0f;
+}
+
+static bool setup_image(struct sw_draw *draw)
+{
+	if (!sw_draw_bind_texture(draw, 0, "image"))
+		return false;
+
+	if (!sw_draw_get_floats(draw, "multiplier", &draw->consts[C_MULTIPLIER], 1))
+		draw->consts[C_MULTIPLIER] = 1.0f;
+	return true;
+}
+
+static bool setup_scale(struct sw_draw *draw)
+{
+	if (!setup_image(draw))
+		return false;
+
+	if (!sw_draw_get_floats(draw, "base_dimension", &draw->consts[C_BASE_DIM], 2))
+		return false;
+	if (!sw_draw_get_floats(draw, "base_dimension_i", &draw->consts[C_BASE_DIM_I], 2))
+		return false;
+	return true;
+}
+
+/* default.effect, opaque.effect, premultiplied_alpha.effect, repeat.effect */
+static void shade_draw(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const struct sw_texture_binding *image = &draw->bindings[0];
+	const uint32_t ops = draw->program->variant;
+
+	for (int i = 0; i < span->count; i++) {
+		float u = span_var(span, SW_VARYING_UV, i);
+		float v = span_var(span, SW_VARYING_UV + 1, i);
+
+		sw_sample(image, u, v, &out[i]);
+		apply_ops(ops, draw->consts, &out[i]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* bicubic_scale.effect                                                      */
+
+static inline void bicubic_weights(float x, float *w)
+{
+	w[0] = ((-0.75f * x + 1.5f) * x - 0.75f) * x;
+	w[1] = (1.25f * x - 2.25f) * x * x + 1.0f;
+	w[2] = ((-1.25f * x + 1.5f) * x + 0.75f) * x;
+	w[3] = (0.75f * x - 0.75f) * x * x;
+}
+
+static void draw_bicubic(const struct sw_texture_binding *image, const float *consts, float pos_x, float pos_y,
+			 struct vec4 *total)
+{
+	const float dim_x = consts[C_BASE_DIM];
+	const float dim_y = consts[C_BASE_DIM + 1];
+	const float dim_i_x = consts[C_BASE_DIM_I];
+	const float dim_i_y = consts[C_BASE_DIM_I + 1];
+
+	float pos1_x = floorf(pos_x - 0.5f) + 0.5f;
+	float pos1_y = floorf(pos_y - 0.5f) + 0.5f;
+
+	float rowtaps[4], coltaps[4];
+	bicubic_weights(pos_x - pos1_x, rowtaps);
+	bicubic_weights(pos_y - pos1_y, coltaps);
+
+	float uv1_x = pos1_x * dim_i_x;
+	float uv1_y = pos1_y * dim_i_y;
+	float uv0_x = uv1_x - dim_i_x;
+	float uv0_y = uv1_y - dim_i_y;
+	float uv3_x = uv1_x + dim_i_x * 2.0f;
+	float uv3_y = uv1_y + dim_i_y * 2.0f;
+
+	float u_weight_sum = rowtaps[1] + rowtaps[2];
+	float u_middle = uv1_x + rowtaps[2] * dim_i_x / u_weight_sum;
+	float v_weight_sum = coltaps[1] + coltaps[2];
+	float v_middle = uv1_y + coltaps[2] * dim_i_y / v_weight_sum;
+
+	int left = (int)fmaxf(uv0_x * dim_x, 0.5f);
+	int top = (int)fmaxf(uv0_y * dim_y, 0.5f);
+	int right = (int)fminf(uv3_x * dim_x, dim_x - 0.5f);
+	int bottom = (int)fminf(uv3_y * dim_y, dim_y - 0.5f);
+
+	struct vec4 c, row;
+
+	vec4_zero(total);
+
+	vec4_zero(&row);
+	sw_load(image, left, top, &c);
+	madd(&row, &c, rowtaps[0]);
+	sw_sample(image, u_middle, uv0_y, &c);
+	madd(&row, &c, u_weight_sum);
+	sw_load(image, right, top, &c);
+	madd(&row, &c, rowtaps[3]);
+	madd(total, &row, coltaps[0]);
+
+	vec4_zero(&row);
+	sw_sample(image, uv0_x, v_middle, &c);
+	madd(&row, &c, rowtaps[0]);
+	sw_sample(image, u_middle, v_middle, &c);
+	madd(&row, &c, u_weight_sum);
+	sw_sample(image, uv3_x, v_middle, &c);
+	madd(&row, &c, rowtaps[3]);
+	madd(total, &row, v_weight_sum);
+
+	vec4_zero(&row);
+	sw_load(image, left, bottom, &c);
+	madd(&row, &c, rowtaps[0]);
+	sw_sample(image, u_middle, uv3_y, &c);
+	madd(&row, &c, u_weight_sum);
+	sw_load(image, right, bottom, &c);
+	madd(&row, &c, rowtaps[3]);
+	madd(total, &row, coltaps[3]);
+}
+
+static void shade_bicubic(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const uint32_t ops = draw->program->variant;
+
+	for (int i = 0; i < span->count; i++) {
+		float pos_x = span_var(span, SW_VARYING_UV, i);
+		float pos_y = span_var(span, SW_VARYING_UV + 1, i);
+
+		draw_bicubic(&draw->bindings[0], draw->consts, pos_x, pos_y, &out[i]);
+		apply_ops(ops, draw->consts, &out[i]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* lanczos_scale.effect                                                      */
+
+static inline float lanczos_weight(float x)
+{
+	float x_pi = x * 3.141592654f;
+	return 3.0f * sinf(x_pi) * sinf(x_pi * (1.0f / 3.0f)) / (x_pi * x_pi);
+}
+
+static inline void lanczos_weights(float f_neg, float *w)
+{
+	w[0] = lanczos_weight(f_neg - 2.0f);
+	w[1] = lanczos_weight(f_neg - 1.0f);
+	w[2] = fminf(1.0f, lanczos_weight(f_neg));
+	w[3] = lanczos_weight(f_neg + 1.0f);
+	w[4] = lanczos_weight(f_neg + 2.0f);
+	w[5] = lanczos_weight(f_neg + 3.0f);
+
+	/* x == 0 produces NaN, which fminf() above replaces with 1 */
+	float sum = w[0] + w[1] + w[2] + w[3] + w[4] + w[5];
+	float sum_i = 1.0f / sum;
+	for (int i = 0; i < 6; i++)
+		w[i] *= sum_i;
+}
+
+static void draw_lanczos(const struct sw_texture_binding *image, const float *consts, float pos_x, float pos_y,
+			 struct vec4 *total)
+{
+	const float dim_x = consts[C_BASE_DIM];
+	const float dim_y = consts[C_BASE_DIM + 1];
+	const float dim_i_x = consts[C_BASE_DIM_I];
+	const float dim_i_y = consts[C_BASE_DIM_I + 1];
+
+	float pos2_x = floorf(pos_x - 0.5f) + 0.5f;
+	float pos2_y = floorf(pos_y - 0.5f) + 0.5f;
+
+	float rowtaps[6], coltaps[6];
+	lanczos_weights(pos2_x - pos_x, rowtaps);
+	lanczos_weights(pos2_y - pos_y, coltaps);
+
+	float uv_x[6], uv_y[6];
+	uv_x[2] = pos2_x * dim_i_x;
+	uv_y[2] = pos2_y * dim_i_y;
+	uv_x[1] = uv_x[2] - dim_i_x;
+	uv_y[1] = uv_y[2] - dim_i_y;
+	uv_x[0] = uv_x[1] - dim_i_x;
+	uv_y[0] = uv_y[1] - dim_i_y;
+	uv_x[3] = uv_x[2] + dim_i_x;
+	uv_y[3] = uv_y[2] + dim_i_y;
+	uv_x[4] = uv_x[3] + dim_i_x;
+	uv_y[4] = uv_y[3] + dim_i_y;
+	uv_x[5] = uv_x[4] + dim_i_x;
+	uv_y[5] = uv_y[4] + dim_i_y;
+
+	float u_weight_sum = rowtaps[2] + rowtaps[3];
+	float u_middle = uv_x[2] + rowtaps[3] * dim_i_x / u_weight_sum;
+	float v_weight_sum = coltaps[2] + coltaps[3];
+	float v_middle = uv_y[2] + coltaps[3] * dim_i_y / v_weight_sum;
+
+	int coord_x[6], coord_y[6];
+	coord_x[0] = (int)fmaxf(uv_x[0] * dim_x, 0.5f);
+	coord_y[0] = (int)fmaxf(uv_y[0] * dim_y, 0.5f);
+	coord_x[1] = (int)fmaxf(uv_x[1] * dim_x, 0.5f);
+	coord_y[1] = (int)fmaxf(uv_y[1] * dim_y, 0.5f);
+	coord_x[4] = (int)fminf(uv_x[4] * dim_x, dim_x - 0.5f);
+	coord_y[4] = (int)fminf(uv_y[4] * dim_y, dim_y - 0.5f);
+	coord_x[5] = (int)fminf(uv_x[5] * dim_x, dim_x - 0.5f);
+	coord_y[5] = (int)fminf(uv_y[5] * dim_y, dim_y - 0.5f);
+
+	static const int rows[] = {0, 1, 4, 5};
+	struct vec4 c, row;
+
+	vec4_zero(total);
+
+	for (int r = 0; r < 4; r++) {
+		int y = rows[r];
+
+		vec4_zero(&row);
+		sw_load(image, coord_x[0], coord_y[y], &c);
+		madd(&row, &c, rowtaps[0]);
+		sw_load(image, coord_x[1], coord_y[y], &c);
+		madd(&row, &c, rowtaps[1]);
+		sw_sample(image, u_middle, uv_y[y], &c);
+		madd(&row, &c, u_weight_sum);
+		sw_load(image, coord_x[4], coord_y[y], &c);
+		madd(&row, &c, rowtaps[4]);
+		sw_load(image, coord_x[5], coord_y[y], &c);
+		madd(&row, &c, rowtaps[5]);
+		madd(total, &row, coltaps[y]);
+	}
+
+	vec4_zero(&row);
+	sw_sample(image, uv_x[0], v_middle, &c);
+	madd(&row, &c, rowtaps[0]);
+	sw_sample(image, uv_x[1], v_middle, &c);
+	madd(&row, &c, rowtaps[1]);
+	sw_sample(image, u_middle, v_middle, &c);
+	madd(&row, &c, u_weight_sum);
+	sw_sample(image, uv_x[4], v_middle, &c);
+	madd(&row, &c, rowtaps[4]);
+	sw_sample(image, uv_x[5], v_middle, &c);
+	madd(&row, &c, rowtaps[5]);
+	madd(total, &row, v_weight_sum);
+}
+
+static void shade_lanczos(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const uint32_t ops = draw->program->variant;
+
+	for (int i = 0; i < span->count; i++) {
+		float pos_x = span_var(span, SW_VARYING_UV, i);
+		float pos_y = span_var(span, SW_VARYING_UV + 1, i);
+
+		draw_lanczos(&draw->bindings[0], draw->consts, pos_x, pos_y, &out[i]);
+		apply_ops(ops, draw->consts, &out[i]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* area.effect                                                               */
+
+static void draw_area(const struct sw_texture_binding *image, const float *consts, float uv_x, float uv_y,
+		      float delta_x, float delta_y, struct vec4 *total)
+{
+	const float dim_x = consts[C_BASE_DIM];
+	const float dim_y = consts[C_BASE_DIM + 1];
+
+	float uv_min_x = uv_x - 0.5f * delta_x;
+	float uv_min_y = uv_y - 0.5f * delta_y;
+	float uv_max_x = uv_min_x + delta_x;
+	float uv_max_y = uv_min_y + delta_y;
+
+	float begin_x = floorf(uv_min_x * dim_x);
+	float begin_y = floorf(uv_min_y * dim_y);
+	float end_x = ceilf(uv_max_x * dim_x);
+	float end_y = ceilf(uv_max_y * dim_y);
+
+	float target_dim_x = 1.0f / delta_x;
+	float target_dim_y = 1.0f / delta_y;
+	float target_pos_x = uv_x * target_dim_x;
+	float target_pos_y = uv_y * target_dim_y;
+	float scale_x = consts[C_BASE_DIM_I] * target_dim_x;
+	float scale_y = consts[C_BASE_DIM_I + 1] * target_dim_y;
+
+	vec4_zero(total);
+
+	float load_y = begin_y;
+	do {
+		float y_min = fmaxf(load_y * scale_y, target_pos_y - 0.5f);
+		float y_max = fminf(load_y * scale_y + scale_y, target_pos_y + 0.5f);
+		float height = y_max - y_min;
+
+		float load_x = begin_x;
+		do {
+			float x_min = fmaxf(load_x * scale_x, target_pos_x - 0.5f);
+			float x_max = fminf(load_x * scale_x + scale_x, target_pos_x + 0.5f);
+			struct vec4 c;
+
+			sw_load(image, (int)load_x, (int)load_y, &c);
+			madd(total, &c, (x_max - x_min) * height);
+			++load_x;
+		} while (load_x < end_x);
+
+		++load_y;
+	} while (load_y < end_y);
+}
+
+static void shade_area(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const uint32_t ops = draw->program->variant;
+	const float delta_x = span->dvdx[SW_VARYING_UV];
+	const float delta_y = span->dvdy[SW_VARYING_UV + 1];
+
+	for (int i = 0; i < span->count; i++) {
+		float u = span_var(span, SW_VARYING_UV, i);
+		float v = span_var(span, SW_VARYING_UV + 1, i);
+
+		draw_area(&draw->bindings[0], draw->consts, u, v, delta_x, delta_y, &out[i]);
+		apply_ops(ops, draw->consts, &out[i]);
+	}
+}
+
+static inline float area_upscale_coord(float uv, float delta, float dim, float dim_i)
+{
+	float first = floorf((uv - 0.5f * delta) * dim);
+	float last = ceilf((uv + 0.5f * delta) * dim) - 1.0f;
+
+	if (first < last) {
+		float boundary = last * dim_i;
+		return ((uv - boundary) / delta) * dim_i + boundary;
+	}
+
+	return (first + 0.5f) * dim_i;
+}
+
+static void shade_area_upscale(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const uint32_t ops = draw->program->variant;
+	const float *consts = draw->consts;
+	const float delta_x = span->dvdx[SW_VARYING_UV];
+	const float delta_y = span->dvdy[SW_VARYING_UV + 1];
+
+	for (int i = 0; i < span->count; i++) {
+		float u = span_var(span, SW_VARYING_UV, i);
+		float v = span_var(span, SW_VARYING_UV + 1, i);
+
+		u = area_upscale_coord(u, delta_x, consts[C_BASE_DIM], consts[C_BASE_DIM_I]);
+		v = area_upscale_coord(v, delta_y, consts[C_BASE_DIM + 1], consts[C_BASE_DIM_I + 1]);
+
+		sw_sample(&draw->bindings[0], u, v, &out[i]);
+		apply_ops(ops, consts, &out[i]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* bilinear_lowres_scale.effect                                              */
+
+static void shade_lowres_bilinear(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	/* Direct3D 8-sample pattern, in sixteenths of a pixel */
+	static const float offsets[8][2] = {
+		{1.0f, -3.0f}, {-1.0f, 3.0f}, {5.0f, 1.0f},   {-3.0f, -5.0f},
+		{-5.0f, 5.0f}, {-7.0f, -1.0f}, {3.0f, 7.0f}, {7.0f, -7.0f},
+	};
+
+	const struct sw_texture_binding *image = &draw->bindings[0];
+	const uint32_t ops = draw->program->variant;
+	const float step_x = span->dvdx[SW_VARYING_UV] * 0.0625f;
+	const float step_y = span->dvdy[SW_VARYING_UV + 1] * 0.0625f;
+
+	for (int i = 0; i < span->count; i++) {
+		float u = span_var(span, SW_VARYING_UV, i);
+		float v = span_var(span, SW_VARYING_UV + 1, i);
+		struct vec4 c;
+
+		vec4_zero(&out[i]);
+		for (int s = 0; s < 8; s++) {
+			sw_sample(image, u + offsets[s][0] * step_x, v + offsets[s][1] * step_y, &c);
+			madd(&out[i], &c, 0.125f);
+		}
+
+		apply_ops(ops, draw->consts, &out[i]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* solid.effect                                                              */
+
+#define C_COLOR 0
+#define C_RANDOM 4
+
+static bool setup_solid(struct sw_draw *draw)
+{
+	if (!sw_draw_get_floats(draw, "color", &draw->consts[C_COLOR], 4))
+		vec4_set((struct vec4 *)&draw->consts[C_COLOR], 1.0f, 1.0f, 1.0f, 1.0f);
+	return true;
+}
+
+static void shade_solid(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const float *color = &draw->consts[C_COLOR];
+
+	for (int i = 0; i < span->count; i++)
+		vec4_set(&out[i], color[0], color[1], color[2], color[3]);
+}
+
+static void shade_solid_colored(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const float *color = &draw->consts[C_COLOR];
+
+	for (int i = 0; i < span->count; i++) {
+		vec4_set(&out[i], span_var(span, SW_VARYING_COLOR, i) * color[0],
+			 span_var(span, SW_VARYING_COLOR + 1, i) * color[1],
+			 span_var(span, SW_VARYING_COLOR + 2, i) * color[2],
+			 span_var(span, SW_VARYING_COLOR + 3, i) * color[3]);
+	}
+}
+
+static bool setup_random(struct sw_draw *draw)
+{
+	return sw_draw_get_floats(draw, "randomvals1", &draw->consts[C_RANDOM], 4) &&
+	       sw_draw_get_floats(draw, "randomvals2", &draw->consts[C_RANDOM + 4], 4) &&
+	       sw_draw_get_floats(draw, "randomvals3", &draw->consts[C_RANDOM + 8], 4);
+}
+
+static inline float solid_rand(float x, float y, const float *vals)
+{
+	float f = sinf(x * vals[0] + y * vals[1]) * vals[2];
+	return 0.5f + 0.5f * (f - floorf(f));
+}
+
+static void shade_random(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const float *vals = &draw->consts[C_RANDOM];
+	const float y = (float)span->y + 0.5f;
+
+	for (int i = 0; i < span->count; i++) {
+		float x = span_x(span, i);
+		vec4_set(&out[i], solid_rand(x, y, vals), solid_rand(x, y, vals + 4), solid_rand(x, y, vals + 8), 1.0f);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* format_conversion.effect                                                  */
+
+/* The SSE kernels in media-io/format-conversion.c are not used here. They
+ * take packed UYVX input that is already in YUV and average chroma over 2x2
+ * blocks, while the effect converts from RGB and samples chroma at the left
+ * edge. Using them would shift chroma by half a pixel compared to the GPU
+ * modules and need an extra full size UYVX pass. */
+
+#define C_COLOR_VEC0 0
+#define C_COLOR_VEC1 4
+#define C_COLOR_VEC2 8
+#define C_RANGE_MIN 12
+#define C_RANGE_MAX 15
+
+static bool setup_color_matrix(struct sw_draw *draw)
+{
+	float *c = draw->consts;
+
+	memset(c, 0, sizeof(float) * 12);
+	sw_draw_get_floats(draw, "color_vec0", c + C_COLOR_VEC0, 4);
+	sw_draw_get_floats(draw, "color_vec1", c + C_COLOR_VEC1, 4);
+	sw_draw_get_floats(draw, "color_vec2", c + C_COLOR_VEC2, 4);
+
+	if (!sw_draw_get_floats(draw, "color_range_min", c + C_RANGE_MIN, 3))
+		c[C_RANGE_MIN] = c[C_RANGE_MIN + 1] = c[C_RANGE_MIN + 2] = 0.0f;
+	if (!sw_draw_get_floats(draw, "color_range_max", c + C_RANGE_MAX, 3))
+		c[C_RANGE_MAX] = c[C_RANGE_MAX + 1] = c[C_RANGE_MAX + 2] = 1.0f;
+	return true;
+}
+
+static bool setup_convert(struct sw_draw *draw)
+{
+	return sw_draw_bind_texture(draw, 0, "image") && setup_color_matrix(draw);
+}
+
+static bool setup_convert_planar(struct sw_draw *draw)
+{
+	return sw_draw_bind_texture(draw, 0, "image") && sw_draw_bind_texture(draw, 1, "image1") &&
+	       sw_draw_bind_texture(draw, 2, "image2") && setup_color_matrix(draw);
+}
+
+static bool setup_convert_nv12(struct sw_draw *draw)
+{
+	return sw_draw_bind_texture(draw, 0, "image") && sw_draw_bind_texture(draw, 1, "image1") &&
+	       setup_color_matrix(draw);
+}
+
+static inline float color_dot(const float *vec, const struct vec4 *c)
+{
+	return dot3(vec, c) + vec[3];
+}
+
+static inline void yuv_to_rgb(const float *consts, struct vec4 *c)
+{
+	c->x = fminf(fmaxf(c->x, consts[C_RANGE_MIN]), consts[C_RANGE_MAX]);
+	c->y = fminf(fmaxf(c->y, consts[C_RANGE_MIN + 1]), consts[C_RANGE_MAX + 1]);
+	c->z = fminf(fmaxf(c->z, consts[C_RANGE_MIN + 2]), consts[C_RANGE_MAX + 2]);
+
+	struct vec4 yuv = *c;
+	c->x = color_dot(consts + C_COLOR_VEC0, &yuv);
+	c->y = color_dot(consts + C_COLOR_VEC1, &yuv);
+	c->z = color_dot(consts + C_COLOR_VEC2, &yuv);
+}
+
+/* PS_Y, PS_U and PS_V, the variant selects the color_vec to use */
+static void shade_rgb_to_plane(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const float *vec = draw->consts + draw->program->variant * 4;
+	struct vec4 rgb;
+
+	for (int i = 0; i < span->count; i++) {
+		sw_load(&draw->bindings[0], span->x + i, span->y, &rgb);
+		vec4_set(&out[i], color_dot(vec, &rgb), 0.0f, 0.0f, 1.0f);
+	}
+}
+
+static inline void sample_wide(const struct sw_draw *draw, const struct sw_span *span, int i, struct vec4 *rgb)
+{
+	struct vec4 left, right;
+	float v = span_var(span, 2, i);
+
+	sw_sample(&draw->bindings[0], span_var(span, 0, i), v, &left);
+	sw_sample(&draw->bindings[0], span_var(span, 1, i), v, &right);
+	vec4_add(rgb, &left, &right);
+	vec4_mulf(rgb, rgb, 0.5f);
+}
+
+static void shade_uv_wide(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	struct vec4 rgb;
+
+	for (int i = 0; i < span->count; i++) {
+		sample_wide(draw, span, i, &rgb);
+		vec4_set(&out[i], color_dot(draw->consts + C_COLOR_VEC1, &rgb),
+			 color_dot(draw->consts + C_COLOR_VEC2, &rgb), 0.0f, 1.0f);
+	}
+}
+
+/* PS_U_Wide and PS_V_Wide */
+static void shade_plane_wide(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const float *vec = draw->consts + draw->program->variant * 4;
+	struct vec4 rgb;
+
+	for (int i = 0; i < span->count; i++) {
+		sample_wide(draw, span, i, &rgb);
+		vec4_set(&out[i], color_dot(vec, &rgb), 0.0f, 0.0f, 1.0f);
+	}
+}
+
+/* packed 4:2:2, the variant holds the component indices of y0, y1, cb and cr
+ * within the BGRA texel, one per byte */
+#define PACKED_422(y0, y1, cb, cr) ((y0) | ((y1) << 8) | ((cb) << 16) | ((cr) << 24))
+
+static void shade_packed422(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const uint32_t order = draw->program->variant;
+	const int y0 = order & 0xFF;
+	const int y1 = (order >> 8) & 0xFF;
+	const int cb = (order >> 16) & 0xFF;
+	const int cr = (order >> 24) & 0xFF;
+
+	for (int i = 0; i < span->count; i++) {
+		float x = span_var(span, 0, i);
+		float y = span_var(span, 1, i);
+		struct vec4 packed, chroma;
+
+		sw_load(&draw->bindings[0], (int)x, (int)y, &packed);
+		sw_sample(&draw->bindings[0], span_var(span, 2, i), span_var(span, 3, i), &chroma);
+
+		float leftover = x - floorf(x);
+		vec4_set(&out[i], leftover < 0.5f ? packed.ptr[y0] : packed.ptr[y1], chroma.ptr[cb], chroma.ptr[cr],
+			 1.0f);
+		yuv_to_rgb(draw->consts, &out[i]);
+	}
+}
+
+static void shade_planar_subsampled(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	struct vec4 c;
+
+	for (int i = 0; i < span->count; i++) {
+		float u = span_var(span, 0, i);
+		float v = span_var(span, 1, i);
+
+		sw_load(&draw->bindings[0], span->x + i, span->y, &out[i]);
+		sw_sample(&draw->bindings[1], u, v, &c);
+		out[i].y = c.x;
+		sw_sample(&draw->bindings[2], u, v, &c);
+		out[i].z = c.x;
+		out[i].w = 1.0f;
+		yuv_to_rgb(draw->consts, &out[i]);
+	}
+}
+
+static void shade_planar444(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	struct vec4 c;
+
+	for (int i = 0; i < span->count; i++) {
+		int x = span->x + i;
+
+		sw_load(&draw->bindings[0], x, span->y, &out[i]);
+		sw_load(&draw->bindings[1], x, span->y, &c);
+		out[i].y = c.x;
+		sw_load(&draw->bindings[2], x, span->y, &c);
+		out[i].z = c.x;
+		out[i].w = 1.0f;
+		yuv_to_rgb(draw->consts, &out[i]);
+	}
+}
+
+static void shade_ayuv(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	for (int i = 0; i < span->count; i++) {
+		sw_load(&draw->bindings[0], span->x + i, span->y, &out[i]);
+		yuv_to_rgb(draw->consts, &out[i]);
+	}
+}
+
+static void shade_nv12(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	struct vec4 c;
+
+	for (int i = 0; i < span->count; i++) {
+		sw_load(&draw->bindings[0], span->x + i, span->y, &out[i]);
+		sw_sample(&draw->bindings[1], span_var(span, 0, i), span_var(span, 1, i), &c);
+		out[i].y = c.x;
+		out[i].z = c.y;
+		out[i].w = 1.0f;
+		yuv_to_rgb(draw->consts, &out[i]);
+	}
+}
+
+static inline float limited_to_full(float f)
+{
+	return (255.0f / 219.0f) * f - (16.0f / 219.0f);
+}
+
+/* PSY800_Limited and PSY800_Full */
+static void shade_y800(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const bool limited = draw->program->variant != 0;
+	struct vec4 c;
+
+	for (int i = 0; i < span->count; i++) {
+		sw_load(&draw->bindings[0], span->x + i, span->y, &c);
+		float f = limited ? limited_to_full(c.x) : c.x;
+		vec4_set(&out[i], f, f, f, 1.0f);
+	}
+}
+
+static void shade_rgb_limited(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	for (int i = 0; i < span->count; i++) {
+		sw_load(&draw->bindings[0], span->x + i, span->y, &out[i]);
+		out[i].x = limited_to_full(out[i].x);
+		out[i].y = limited_to_full(out[i].y);
+		out[i].z = limited_to_full(out[i].z);
+	}
+}
+
+/* PSBGR3_Limited and PSBGR3_Full */
+static void shade_bgr3(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out)
+{
+	const bool limited = draw->program->variant != 0;
+	struct vec4 b, g, r;
+
+	for (int i = 0; i < span->count; i++) {
+		int x = (span->x + i) * 3;
+
+		sw_load(&draw->bindings[0], x, span->y, &b);
+		sw_load(&draw->bindings[0], x + 1, span->y, &g);
+		sw_load(&draw->bindings[0], x + 2, span->y, &r);
+
+		if (limited)
+			vec4_set(&out[i], limited_to_full(r.x), limited_to_full(g.x), limited_to_full(b.x), 1.0f);
+		else
+			vec4_set(&out[i], r.x, g.x, b.x, 1.0f);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+#define DRAW_PROGRAM(effect, func, flags, ops) {effect, func, flags, ops, setup_image, shade_draw}
+#define SCALE_PROGRAM(effect, func, ops, shade) {effect, func, 0, ops, setup_scale, shade}
+
+static const struct sw_program programs[] = {
+	DRAW_PROGRAM("default.effect", "PSDrawBare", SW_PROGRAM_COPY, 0),
+	DRAW_PROGRAM("default.effect", "PSDrawAlphaDivide", 0, OP_ALPHA_DIVIDE),
+	DRAW_PROGRAM("default.effect", "PSDrawAlphaDivideTonemap", 0, OP_ALPHA_DIVIDE | OP_TONEMAP),
+	DRAW_PROGRAM("default.effect", "PSDrawNonlinearAlpha", 0, OP_NONLINEAR_ALPHA),
+	DRAW_PROGRAM("default.effect", "PSDrawNonlinearAlphaMultiply", 0, OP_NONLINEAR_ALPHA | OP_MULTIPLY),
+	DRAW_PROGRAM("default.effect", "PSDrawSrgbDecompress", 0, OP_SRGB_DECOMPRESS),
+	DRAW_PROGRAM("default.effect", "PSDrawSrgbDecompressMultiply", 0, OP_SRGB_DECOMPRESS | OP_MULTIPLY),
+	DRAW_PROGRAM("default.effect", "PSDrawMultiply", 0, OP_MULTIPLY),
+	DRAW_PROGRAM("default.effect", "PSDrawTonemap", 0, OP_TONEMAP),
+	DRAW_PROGRAM("default.effect", "PSDrawMultiplyTonemap", 0, OP_MULTIPLY | OP_TONEMAP),
+
+	DRAW_PROGRAM("opaque.effect", "PSDraw", 0, OP_OPAQUE),
+	DRAW_PROGRAM("opaque.effect", "PSDrawSrgbDecompress", 0, OP_SRGB_DECOMPRESS | OP_OPAQUE),
+	DRAW_PROGRAM("opaque.effect", "PSDrawSrgbDecompressMultiply", 0, OP_SRGB_DECOMPRESS | OP_MULTIPLY | OP_OPAQUE),
+	DRAW_PROGRAM("opaque.effect", "PSDrawMultiply", 0, OP_MULTIPLY | OP_OPAQUE),
+	DRAW_PROGRAM("opaque.effect", "PSDrawTonemap", 0, OP_TONEMAP | OP_OPAQUE),
+	DRAW_PROGRAM("opaque.effect", "PSDrawMultiplyTonemap", 0, OP_MULTIPLY | OP_TONEMAP | OP_OPAQUE),
+
+	DRAW_PROGRAM("premultiplied_alpha.effect", "PSDraw", 0, OP_UNPREMULTIPLY),
+	DRAW_PROGRAM("repeat.effect", "PSDrawBare", 0, 0),
+
+	SCALE_PROGRAM("bicubic_scale.effect", "PSDrawBicubicRGBA", 0, shade_bicubic),
+	SCALE_PROGRAM("bicubic_scale.effect", "PSDrawBicubicRGBAMultiply", OP_MULTIPLY, shade_bicubic),
+	SCALE_PROGRAM("bicubic_scale.effect", "PSDrawBicubicRGBATonemap", OP_TONEMAP, shade_bicubic),
+	SCALE_PROGRAM("bicubic_scale.effect", "PSDrawBicubicRGBAMultiplyTonemap", OP_MULTIPLY | OP_TONEMAP,
+		      shade_bicubic),
+
+	SCALE_PROGRAM("lanczos_scale.effect", "PSDrawLanczosRGBA", 0, shade_lanczos),
+	SCALE_PROGRAM("lanczos_scale.effect", "PSDrawLanczosRGBAMultiply", OP_MULTIPLY, shade_lanczos),
+	SCALE_PROGRAM("lanczos_scale.effect", "PSDrawLanczosRGBATonemap", OP_TONEMAP, shade_lanczos),
+	SCALE_PROGRAM("lanczos_scale.effect", "PSDrawLanczosRGBAMultiplyTonemap", OP_MULTIPLY | OP_TONEMAP,
+		      shade_lanczos),
+
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBA", 0, shade_area),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAMultiply", OP_MULTIPLY, shade_area),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBATonemap", OP_TONEMAP, shade_area),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAMultiplyTonemap", OP_MULTIPLY | OP_TONEMAP, shade_area),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAUpscale", 0, shade_area_upscale),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAUpscaleMultiply", OP_MULTIPLY, shade_area_upscale),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAUpscaleTonemap", OP_TONEMAP, shade_area_upscale),
+	SCALE_PROGRAM("area.effect", "PSDrawAreaRGBAUpscaleMultiplyTonemap", OP_MULTIPLY | OP_TONEMAP,
+		      shade_area_upscale),
+
+	{"bilinear_lowres_scale.effect", "PSDrawLowresBilinearRGBA", 0, 0, setup_image, shade_lowres_bilinear},
+	{"bilinear_lowres_scale.effect", "PSDrawLowresBilinearRGBAMultiply", 0, OP_MULTIPLY, setup_image,
+	 shade_lowres_bilinear},
+	{"bilinear_lowres_scale.effect", "PSDrawLowresBilinearRGBATonemap", 0, OP_TONEMAP, setup_image,
+	 shade_lowres_bilinear},
+	{"bilinear_lowres_scale.effect", "PSDrawLowresBilinearRGBAMultiplyTonemap", 0, OP_MULTIPLY | OP_TONEMAP,
+	 setup_image, shade_lowres_bilinear},
+
+	{"solid.effect", "PSSolid", 0, 0, setup_solid, shade_solid},
+	{"solid.effect", "PSSolidColored", 0, 0, setup_solid, shade_solid_colored},
+	{"solid.effect", "PSRandom", 0, 0, setup_random, shade_random},
+
+	{"format_conversion.effect", "PS_Y", 0, 0, setup_convert, shade_rgb_to_plane},
+	{"format_conversion.effect", "PS_U", 0, 1, setup_convert, shade_rgb_to_plane},
+	{"format_conversion.effect", "PS_V", 0, 2, setup_convert, shade_rgb_to_plane},
+	{"format_conversion.effect", "PS_UV_Wide", 0, 0, setup_convert, shade_uv_wide},
+	{"format_conversion.effect", "PS_U_Wide", 0, 1, setup_convert, shade_plane_wide},
+	{"format_conversion.effect", "PS_V_Wide", 0, 2, setup_convert, shade_plane_wide},
+	{"format_conversion.effect", "PSUYVY_Reverse", 0, PACKED_422(1, 3, 2, 0), setup_convert, shade_packed422},
+	{"format_conversion.effect", "PSYUY2_Reverse", 0, PACKED_422(2, 0, 1, 3), setup_convert, shade_packed422},
+	{"format_conversion.effect", "PSYVYU_Reverse", 0, PACKED_422(2, 0, 3, 1), setup_convert, shade_packed422},
+	{"format_conversion.effect", "PSPlanar420_Reverse", 0, 0, setup_convert_planar, shade_planar_subsampled},
+	{"format_conversion.effect", "PSPlanar422_Reverse", 0, 0, setup_convert_planar, shade_planar_subsampled},
+	{"format_conversion.effect", "PSPlanar444_Reverse", 0, 0, setup_convert_planar, shade_planar444},
+	{"format_conversion.effect", "PSAYUV_Reverse", 0, 0, setup_convert, shade_ayuv},
+	{"format_conversion.effect", "PSNV12_Reverse", 0, 0, setup_convert_nv12, shade_nv12},
+	{"format_conversion.effect", "PSY800_Limited", 0, 1, setup_convert, shade_y800},
+	{"format_conversion.effect", "PSY800_Full", 0, 0, setup_convert, shade_y800},
+	{"format_conversion.effect", "PSRGB_Limited", 0, 0, setup_convert, shade_rgb_limited},
+	{"format_conversion.effect", "PSBGR3_Limited", 0, 1, setup_convert, shade_bgr3},
+	{"format_conversion.effect", "PSBGR3_Full", 0, 0, setup_convert, shade_bgr3},
+};
+
+const struct sw_program *sw_find_program(const char *effect, const char *func)
+{
+	for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+		const struct sw_program *program = programs + i;
+
+		if (strcmp(program->func, func) == 0 && strcmp(program->effect, effect) == 0)
+			return program;
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* fullscreen vertex shaders of format_conversion.effect, these run with
+ * obs_glsl_compile == false since render targets are stored top-down       */
+
+static float get_vs_float(gs_shader_t *shader, const char *name)
+{
+	struct gs_shader_param *param = gs_shader_get_param_by_name(shader, name);
+	float val = 0.0f;
+
+	if (param && param->cur_value.num >= sizeof(float))
+		memcpy(&val, param->cur_value.array, sizeof(float));
+	return val;
+}
+
+static inline void fullscreen_pos(uint32_t id, struct vec4 *pos, float *id_high, float *id_low)
+{
+	*id_high = (float)(id >> 1);
+	*id_low = (float)(id & 1);
+	vec4_set(pos, *id_high * 4.0f - 1.0f, *id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+}
+
+static void vs_pos(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *v)
+{
+	float id_high, id_low;
+	UNUSED_PARAMETER(shader);
+	UNUSED_PARAMETER(v);
+	fullscreen_pos(id, pos, &id_high, &id_low);
+}
+
+static void vs_tex_pos_left(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *v)
+{
+	float id_high, id_low;
+	fullscreen_pos(id, pos, &id_high, &id_low);
+
+	float u_right = id_high * 2.0f;
+	v[0] = u_right - get_vs_float(shader, "width_i");
+	v[1] = u_right;
+	v[2] = 1.0f - id_low * 2.0f;
+}
+
+static void vs_packed422_left_reverse(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *v)
+{
+	float id_high, id_low;
+	fullscreen_pos(id, pos, &id_high, &id_low);
+
+	float u = id_high * 2.0f;
+	float vv = 1.0f - id_low * 2.0f;
+	v[0] = get_vs_float(shader, "width_d2") * u;
+	v[1] = get_vs_float(shader, "height") * vv;
+	v[2] = u + get_vs_float(shader, "width_x2_i");
+	v[3] = vv;
+}
+
+static void vs_420_left_reverse(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *v)
+{
+	float id_high, id_low;
+	fullscreen_pos(id, pos, &id_high, &id_low);
+
+	v[0] = id_high * 2.0f + get_vs_float(shader, "width_x2_i");
+	v[1] = 1.0f - id_low * 2.0f;
+}
+
+static void vs_420_top_left_reverse(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *v)
+{
+	float id_high, id_low;
+	fullscreen_pos(id, pos, &id_high, &id_low);
+
+	v[0] = id_high * 2.0f + get_vs_float(shader, "width_x2_i");
+	v[1] = 1.0f - (id_low * 2.0f - get_vs_float(shader, "height_x2_i"));
+}
+
+static const struct sw_vertex_program vertex_programs[] = {
+	{"format_conversion.effect", "VSPos", NULL, vs_pos},
+	{"format_conversion.effect", "VSTexPos_Left", NULL, vs_tex_pos_left},
+	{"format_conversion.effect", "VSPacked422Left_Reverse", NULL, vs_packed422_left_reverse},
+	{"format_conversion.effect", "VS420Left_Reverse", NULL, vs_420_left_reverse},
+	{"format_conversion.effect", "VS420TopLeft_Reverse", NULL, vs_420_top_left_reverse},
+	{"format_conversion.effect", "VS422Left_Reverse", NULL, vs_420_left_reverse},
+
+	{"bicubic_scale.effect", "VSDefault", "base_dimension", NULL},
+	{"lanczos_scale.effect", "VSDefault", "base_dimension", NULL},
+	{"repeat.effect", "VSDefault", "scale", NULL},
+};
+
+/* every other vertex shader is assumed to be "pos * ViewProj" */
+static const struct sw_vertex_program default_vertex_program = {NULL, NULL, NULL, NULL};
+
+const struct sw_vertex_program *sw_find_vertex_program(const char *effect, const char *func, bool vertex_id)
+{
+	for (size_t i = 0; i < sizeof(vertex_programs) / sizeof(vertex_programs[0]); i++) {
+		const struct sw_vertex_program *program = vertex_programs + i;
+
+		if (strcmp(program->func, func) == 0 && strcmp(program->effect, effect) == 0)
+			return program;
+	}
+
+	return vertex_id ? NULL : &default_vertex_program;
+}
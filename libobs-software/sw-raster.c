@@ -0,0 +1,501 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <util/bmem.h>
+#include "sw-subsystem.h"
+
+/* draws covering fewer pixels than this are not worth waking the workers */
+#define SW_INLINE_PIXELS (64 * 64)
+
+/* ------------------------------------------------------------------------- */
+/* worker pool                                                               */
+
+static void *worker_thread(void *data)
+{
+	struct sw_worker_pool *pool = data;
+
+	os_set_thread_name("libobs-software: raster worker");
+
+	for (;;) {
+		if (os_sem_wait(pool->start) != 0 || pool->stop)
+			break;
+
+		long idx;
+		while ((idx = os_atomic_inc_long(&pool->next) - 1) < pool->count)
+			pool->job(pool->param, idx);
+
+		if (os_atomic_dec_long(&pool->active) == 0)
+			os_event_signal(pool->done);
+	}
+
+	return NULL;
+}
+
+bool sw_pool_init(struct sw_worker_pool *pool, int threads)
+{
+	memset(pool, 0, sizeof(*pool));
+
+	if (os_sem_init(&pool->start, 0) != 0)
+		return false;
+	if (os_event_init(&pool->done, OS_EVENT_TYPE_AUTO) != 0) {
+		os_sem_destroy(pool->start);
+		pool->start = NULL;
+		return false;
+	}
+
+	for (int i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, worker_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	return true;
+}
+
+void sw_pool_free(struct sw_worker_pool *pool)
+{
+	if (!pool->start)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->start);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_free(pool->threads);
+	os_sem_destroy(pool->start);
+	os_event_destroy(pool->done);
+	memset(pool, 0, sizeof(*pool));
+}
+
+/* runs job(param, 0..count-1) on the workers and the calling thread, and
+ * returns once all of them have completed */
+void sw_pool_run(struct sw_worker_pool *pool, long count, void (*job)(void *param, long idx), void *param)
+{
+	long wake = (long)pool->threads.num;
+	if (wake > count - 1)
+		wake = count - 1;
+
+	if (wake <= 0) {
+		for (long i = 0; i < count; i++)
+			job(param, i);
+		return;
+	}
+
+	pool->job = job;
+	pool->param = param;
+	pool->count = count;
+	pool->next = 0;
+	pool->active = wake;
+
+	for (long i = 0; i < wake; i++)
+		os_sem_post(pool->start);
+
+	long idx;
+	while ((idx = os_atomic_inc_long(&pool->next) - 1) < count)
+		job(param, idx);
+
+	os_event_wait(pool->done);
+}
+
+/* ------------------------------------------------------------------------- */
+/* triangle setup                                                            */
+
+static inline float minf3(float a, float b, float c)
+{
+	return fminf(a, fminf(b, c));
+}
+
+static inline float maxf3(float a, float b, float c)
+{
+	return fmaxf(a, fmaxf(b, c));
+}
+
+static inline void rect_intersect(struct sw_rect *r, const struct sw_rect *clip)
+{
+	if (r->x0 < clip->x0)
+		r->x0 = clip->x0;
+	if (r->y0 < clip->y0)
+		r->y0 = clip->y0;
+	if (r->x1 > clip->x1)
+		r->x1 = clip->x1;
+	if (r->y1 > clip->y1)
+		r->y1 = clip->y1;
+}
+
+static inline bool rect_empty(const struct sw_rect *r)
+{
+	return r->x0 >= r->x1 || r->y0 >= r->y1;
+}
+
+/* Edge functions are computed so that the shared edge of two neighbouring
+ * triangles produces exactly negated coefficients, which together with the
+ * inclusive/exclusive split in get_span() guarantees that every pixel along
+ * the edge is drawn exactly once. */
+bool sw_triangle_setup(struct sw_triangle *tri, const struct sw_vertex *v0, const struct sw_vertex *v1,
+		       const struct sw_vertex *v2, const struct sw_rect *clip, enum gs_cull_mode cull)
+{
+	const struct sw_vertex *v[3] = {v0, v1, v2};
+	float area = (v1->x - v0->x) * (v2->y - v0->y) - (v2->x - v0->x) * (v1->y - v0->y);
+
+	if (area == 0.0f || !isfinite(area))
+		return false;
+
+	/* render target space has y pointing down, and counter-clockwise
+	 * triangles are front facing, same as the D3D11 renderer */
+	if ((cull == GS_BACK && area > 0.0f) || (cull == GS_FRONT && area < 0.0f))
+		return false;
+
+	for (int i = 0; i < 3; i++) {
+		const struct sw_vertex *a = v[i];
+		const struct sw_vertex *b = v[(i + 1) % 3];
+
+		tri->a[i] = a->y - b->y;
+		tri->b[i] = b->x - a->x;
+		tri->c[i] = a->x * b->y - b->x * a->y;
+
+		if (area < 0.0f) {
+			tri->a[i] = -tri->a[i];
+			tri->b[i] = -tri->b[i];
+			tri->c[i] = -tri->c[i];
+		}
+	}
+
+	tri->bounds.x0 = (int)floorf(minf3(v0->x, v1->x, v2->x));
+	tri->bounds.y0 = (int)floorf(minf3(v0->y, v1->y, v2->y));
+	tri->bounds.x1 = (int)ceilf(maxf3(v0->x, v1->x, v2->x));
+	tri->bounds.y1 = (int)ceilf(maxf3(v0->y, v1->y, v2->y));
+	rect_intersect(&tri->bounds, clip);
+
+	if (rect_empty(&tri->bounds))
+		return false;
+
+	double x10 = (double)v1->x - (double)v0->x;
+	double y10 = (double)v1->y - (double)v0->y;
+	double x20 = (double)v2->x - (double)v0->x;
+	double y20 = (double)v2->y - (double)v0->y;
+	double area_i = 1.0 / (x10 * y20 - x20 * y10);
+
+	for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+		double d10 = (double)v1->v[i] - (double)v0->v[i];
+		double d20 = (double)v2->v[i] - (double)v0->v[i];
+		double dx = (d10 * y20 - d20 * y10) * area_i;
+		double dy = (d20 * x10 - d10 * x20) * area_i;
+
+		tri->dx[i] = (float)dx;
+		tri->dy[i] = (float)dy;
+		tri->base[i] = (float)((double)v0->v[i] - dx * (double)v0->x - dy * (double)v0->y);
+	}
+
+	return true;
+}
+
+/* pixel x is covered when lo <= x + 0.5 < hi */
+static inline bool get_span(const struct sw_triangle *tri, int y, int *start, int *end)
+{
+	float yc = (float)y + 0.5f;
+	float lo = -INFINITY;
+	float hi = INFINITY;
+
+	for (int i = 0; i < 3; i++) {
+		float a = tri->a[i];
+		float r = tri->b[i] * yc + tri->c[i];
+
+		if (a > 0.0f) {
+			float x = -r / a;
+			if (x > lo)
+				lo = x;
+		} else if (a < 0.0f) {
+			float x = -r / a;
+			if (x < hi)
+				hi = x;
+		} else if (r < 0.0f || (r == 0.0f && tri->b[i] < 0.0f)) {
+			return false;
+		}
+	}
+
+	/* clamp before converting, fullscreen triangles extend far outside of
+	 * the render target */
+	int x0 = (int)ceilf(fmaxf(lo, (float)tri->bounds.x0) - 0.5f);
+	int x1 = (int)ceilf(fminf(hi, (float)tri->bounds.x1) - 0.5f);
+
+	*start = x0;
+	*end = x1;
+	return x0 < x1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pixel output                                                              */
+
+static inline void blend_factor(enum gs_blend_type type, const struct vec4 *s, const struct vec4 *d, struct vec4 *f)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:
+		vec4_zero(f);
+		break;
+	case GS_BLEND_ONE:
+		vec4_set(f, 1.0f, 1.0f, 1.0f, 1.0f);
+		break;
+	case GS_BLEND_SRCCOLOR:
+		*f = *s;
+		break;
+	case GS_BLEND_INVSRCCOLOR:
+		vec4_set(f, 1.0f - s->x, 1.0f - s->y, 1.0f - s->z, 1.0f - s->w);
+		break;
+	case GS_BLEND_SRCALPHA:
+		vec4_set(f, s->w, s->w, s->w, s->w);
+		break;
+	case GS_BLEND_INVSRCALPHA:
+		vec4_set(f, 1.0f - s->w, 1.0f - s->w, 1.0f - s->w, 1.0f - s->w);
+		break;
+	case GS_BLEND_DSTCOLOR:
+		*f = *d;
+		break;
+	case GS_BLEND_INVDSTCOLOR:
+		vec4_set(f, 1.0f - d->x, 1.0f - d->y, 1.0f - d->z, 1.0f - d->w);
+		break;
+	case GS_BLEND_DSTALPHA:
+		vec4_set(f, d->w, d->w, d->w, d->w);
+		break;
+	case GS_BLEND_INVDSTALPHA:
+		vec4_set(f, 1.0f - d->w, 1.0f - d->w, 1.0f - d->w, 1.0f - d->w);
+		break;
+	case GS_BLEND_SRCALPHASAT: {
+		float sat = fminf(s->w, 1.0f - d->w);
+		vec4_set(f, sat, sat, sat, 1.0f);
+		break;
+	}
+	}
+}
+
+static inline float blend_op(enum gs_blend_op_type op, float s, float d)
+{
+	switch (op) {
+	case GS_BLEND_OP_ADD:
+		return s + d;
+	case GS_BLEND_OP_SUBTRACT:
+		return s - d;
+	case GS_BLEND_OP_REVERSE_SUBTRACT:
+		return d - s;
+	case GS_BLEND_OP_MIN:
+		return fminf(s, d);
+	case GS_BLEND_OP_MAX:
+		return fmaxf(s, d);
+	}
+
+	return s + d;
+}
+
+static void blend_pixel(const struct sw_blend_state *blend, const struct vec4 *s, struct vec4 *d)
+{
+	struct vec4 fsc, fdc, fsa, fda;
+	struct vec4 result;
+
+	blend_factor(blend->src_c, s, d, &fsc);
+	blend_factor(blend->dest_c, s, d, &fdc);
+	blend_factor(blend->src_a, s, d, &fsa);
+	blend_factor(blend->dest_a, s, d, &fda);
+
+	/* min and max ignore the blend factors */
+	if (blend->op == GS_BLEND_OP_MIN || blend->op == GS_BLEND_OP_MAX) {
+		vec4_set(&fsc, 1.0f, 1.0f, 1.0f, 1.0f);
+		fdc = fsa = fda = fsc;
+	}
+
+	result.x = blend_op(blend->op, s->x * fsc.x, d->x * fdc.x);
+	result.y = blend_op(blend->op, s->y * fsc.y, d->y * fdc.y);
+	result.z = blend_op(blend->op, s->z * fsc.z, d->z * fdc.z);
+	result.w = blend_op(blend->op, s->w * fsa.w, d->w * fda.w);
+
+	for (int i = 0; i < 4; i++) {
+		if (blend->write[i])
+			d->ptr[i] = result.ptr[i];
+	}
+}
+
+static void write_pixels(const struct sw_draw *draw, int x, int y, int count, const struct vec4 *colors)
+{
+	const struct gs_texture *target = draw->target;
+	const uint32_t bpp = target->bytes_per_pixel;
+	uint8_t *dst = target->data + (size_t)y * target->linesize + (size_t)x * bpp;
+	const struct sw_blend_state *blend = &draw->blend;
+	const bool write_all = blend->write[0] && blend->write[1] && blend->write[2] && blend->write[3];
+
+	if (!blend->enabled && write_all) {
+		for (int i = 0; i < count; i++, dst += bpp)
+			draw->dst_store(dst, &colors[i], draw->srgb);
+		return;
+	}
+
+	const float *lut = sw_get_texel_lut(draw->srgb);
+
+	for (int i = 0; i < count; i++, dst += bpp) {
+		struct vec4 d;
+		draw->dst_load(dst, lut, &d);
+
+		if (blend->enabled) {
+			blend_pixel(blend, &colors[i], &d);
+		} else {
+			for (int c = 0; c < 4; c++) {
+				if (blend->write[c])
+					d.ptr[c] = colors[i].ptr[c];
+			}
+		}
+
+		draw->dst_store(dst, &d, draw->srgb);
+	}
+}
+
+static void copy_pixels(const struct sw_draw *draw, int x, int y, int count)
+{
+	const struct gs_texture *src = draw->blit_src;
+	const struct gs_texture *dst = draw->target;
+	const uint32_t bpp = dst->bytes_per_pixel;
+
+	memcpy(dst->data + (size_t)y * dst->linesize + (size_t)x * bpp,
+	       src->data + (size_t)(y + draw->blit_offset_y) * src->linesize + (size_t)(x + draw->blit_offset_x) * bpp,
+	       (size_t)count * bpp);
+}
+
+static void shade_span(const struct sw_draw *draw, const struct sw_triangle *tri, int x0, int x1, int y)
+{
+	struct vec4 colors[SW_TILE_WIDTH];
+	struct sw_span span;
+
+	if (draw->blit) {
+		copy_pixels(draw, x0, y, x1 - x0);
+		return;
+	}
+
+	span.y = y;
+
+	for (int x = x0; x < x1; x += SW_TILE_WIDTH) {
+		span.x = x;
+		span.count = x1 - x < SW_TILE_WIDTH ? x1 - x : SW_TILE_WIDTH;
+
+		float xc = (float)x + 0.5f;
+		float yc = (float)y + 0.5f;
+
+		for (int i = 0; i < SW_MAX_VARYINGS; i++) {
+			span.v[i] = tri->base[i] + tri->dx[i] * xc + tri->dy[i] * yc;
+			span.dvdx[i] = tri->dx[i];
+			span.dvdy[i] = tri->dy[i];
+		}
+
+		draw->program->shade(draw, &span, colors);
+		write_pixels(draw, span.x, y, span.count, colors);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* tiles                                                                     */
+
+static void rasterize_rect(const struct sw_draw *draw, const struct sw_rect *rect)
+{
+	for (int y = rect->y0; y < rect->y1; y++) {
+		for (size_t i = 0; i < draw->num_tris; i++) {
+			const struct sw_triangle *tri = draw->tris + i;
+			int x0, x1;
+
+			if (y < tri->bounds.y0 || y >= tri->bounds.y1)
+				continue;
+			if (!get_span(tri, y, &x0, &x1))
+				continue;
+
+			if (x0 < rect->x0)
+				x0 = rect->x0;
+			if (x1 > rect->x1)
+				x1 = rect->x1;
+			if (x0 < x1)
+				shade_span(draw, tri, x0, x1, y);
+		}
+	}
+}
+
+static void rasterize_tile(void *param, long idx)
+{
+	const struct sw_draw *draw = param;
+	struct sw_rect rect;
+
+	rect.x0 = draw->bounds.x0 + (int)((uint32_t)idx % draw->tiles_x) * SW_TILE_WIDTH;
+	rect.y0 = draw->bounds.y0 + (int)((uint32_t)idx / draw->tiles_x) * SW_TILE_HEIGHT;
+	rect.x1 = rect.x0 + SW_TILE_WIDTH;
+	rect.y1 = rect.y0 + SW_TILE_HEIGHT;
+	rect_intersect(&rect, &draw->bounds);
+
+	rasterize_rect(draw, &rect);
+}
+
+void sw_draw_execute(struct sw_draw *draw)
+{
+	if (!draw->num_tris)
+		return;
+
+	draw->bounds = draw->tris[0].bounds;
+	for (size_t i = 1; i < draw->num_tris; i++) {
+		const struct sw_rect *b = &draw->tris[i].bounds;
+		if (b->x0 < draw->bounds.x0)
+			draw->bounds.x0 = b->x0;
+		if (b->y0 < draw->bounds.y0)
+			draw->bounds.y0 = b->y0;
+		if (b->x1 > draw->bounds.x1)
+			draw->bounds.x1 = b->x1;
+		if (b->y1 > draw->bounds.y1)
+			draw->bounds.y1 = b->y1;
+	}
+
+	if (rect_empty(&draw->bounds))
+		return;
+
+	int width = draw->bounds.x1 - draw->bounds.x0;
+	int height = draw->bounds.y1 - draw->bounds.y0;
+
+	if (width * height <= SW_INLINE_PIXELS) {
+		rasterize_rect(draw, &draw->bounds);
+		return;
+	}
+
+	draw->tiles_x = (uint32_t)(width + SW_TILE_WIDTH - 1) / SW_TILE_WIDTH;
+	draw->tiles_y = (uint32_t)(height + SW_TILE_HEIGHT - 1) / SW_TILE_HEIGHT;
+
+	sw_pool_run(&draw->device->pool, (long)(draw->tiles_x * draw->tiles_y), rasterize_tile, draw);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void sw_clear_texture(gs_device_t *device, gs_texture_t *tex, const struct vec4 *color, bool srgb)
+{
+	sw_texel_store_t store = sw_get_texel_store(tex->format);
+	const uint32_t bpp = tex->bytes_per_pixel;
+	const size_t row_size = (size_t)tex->width * bpp;
+	uint8_t pixel[16];
+
+	UNUSED_PARAMETER(device);
+
+	if (!store || !tex->data)
+		return;
+
+	store(pixel, color, srgb);
+
+	uint8_t *row = tex->data;
+	for (uint32_t x = 0; x < tex->width; x++)
+		memcpy(row + x * bpp, pixel, bpp);
+
+	for (uint32_t y = 1; y < tex->height; y++)
+		memcpy(tex->data + (size_t)y * tex->linesize, row, row_size);
+}
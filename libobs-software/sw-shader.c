@@ -0,0 +1,449 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <graphics/shader-parser.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/matrix3.h>
+#include "sw-subsystem.h"
+
+static inline void shader_param_free(struct gs_shader_param *param)
+{
+	bfree(param->name);
+	da_free(param->cur_value);
+	da_free(param->def_value);
+}
+
+static void sw_add_params(struct gs_shader *shader, struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->params.num; i++) {
+		struct shader_var *var = parser->params.array + i;
+		struct gs_shader_param param = {0};
+
+		param.array_count = var->array_count;
+		param.name = bstrdup(var->name);
+		param.shader = shader;
+		param.type = get_shader_param_type(var->type);
+
+		da_move(param.def_value, var->default_val);
+		da_copy(param.cur_value, param.def_value);
+
+		da_push_back(shader->params, &param);
+	}
+
+	shader->viewproj = gs_shader_get_param_by_name(shader, "ViewProj");
+	shader->world = gs_shader_get_param_by_name(shader, "World");
+}
+
+static void sw_add_samplers(struct gs_shader *shader, struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->samplers.num; i++) {
+		struct shader_sampler *sampler = parser->samplers.array + i;
+		struct gs_sampler_info info;
+		gs_samplerstate_t *new_sampler;
+
+		shader_sampler_convert(sampler, &info);
+		new_sampler = device_samplerstate_create(shader->device, &info);
+
+		da_push_back(shader->samplers, &new_sampler);
+	}
+}
+
+/* The effect system wraps the technique's function in a main() that simply
+ * forwards to it ("return PSDrawBare(vert_in);"), which is how shaders are
+ * matched with their CPU implementation. */
+static char *get_entry_func(const char *shader_str)
+{
+	const char *main_func = strstr(shader_str, " main(");
+	if (!main_func)
+		return NULL;
+
+	const char *ret = strstr(main_func, "return ");
+	if (!ret)
+		return NULL;
+
+	ret += 7;
+	const char *end = strchr(ret, '(');
+	if (!end)
+		return NULL;
+
+	return bstrdup_n(ret, end - ret);
+}
+
+/* "<path>/default.effect (Pixel shader, technique Draw, pass 0)" */
+static char *get_effect_name(const char *file)
+{
+	if (!file)
+		return bstrdup("");
+
+	const char *end = strstr(file, " (");
+	if (!end)
+		end = file + strlen(file);
+
+	const char *start = end;
+	while (start > file && start[-1] != '/' && start[-1] != '\\')
+		start--;
+
+	return bstrdup_n(start, end - start);
+}
+
+static struct gs_shader *shader_create(gs_device_t *device, enum gs_shader_type type, const char *shader_str,
+				       const char *file, char **error_string)
+{
+	struct gs_shader *shader = bzalloc(sizeof(struct gs_shader));
+	struct shader_parser parser;
+	bool success;
+
+	shader->device = device;
+	shader->type = type;
+
+	shader_parser_init(&parser);
+	success = shader_parse(&parser, shader_str, file);
+
+	char *errors = shader_parser_geterrors(&parser);
+	if (errors && *errors)
+		blog(LOG_DEBUG, "Parser warnings/errors for %s:\n%s", file, errors);
+	if (error_string)
+		*error_string = errors;
+	else
+		bfree(errors);
+
+	if (success) {
+		sw_add_params(shader, &parser);
+		sw_add_samplers(shader, &parser);
+
+		shader->func = get_entry_func(shader_str);
+		shader->effect = get_effect_name(file);
+		success = shader->func != NULL;
+	}
+
+	shader_parser_free(&parser);
+
+	if (!success) {
+		gs_shader_destroy(shader);
+		return NULL;
+	}
+
+	if (type == GS_SHADER_VERTEX) {
+		bool vertex_id = strstr(shader_str, "VERTEXID") != NULL;
+		shader->vertex_program = sw_find_vertex_program(shader->effect, shader->func, vertex_id);
+	} else {
+		shader->program = sw_find_program(shader->effect, shader->func);
+	}
+
+	if (!shader->vertex_program && !shader->program)
+		blog(LOG_WARNING,
+		     "%s: '%s' has no software implementation, "
+		     "draws using it will be skipped",
+		     file, shader->func);
+
+	return shader;
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device, const char *shader, const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_VERTEX, shader, file, error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_vertexshader_create (software) failed");
+	return ptr;
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device, const char *shader, const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_PIXEL, shader, file, error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_pixelshader_create (software) failed");
+	return ptr;
+}
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	size_t i;
+
+	if (!shader)
+		return;
+
+	if (shader->device->cur_vertex_shader == shader)
+		shader->device->cur_vertex_shader = NULL;
+	if (shader->device->cur_pixel_shader == shader)
+		shader->device->cur_pixel_shader = NULL;
+
+	for (i = 0; i < shader->samplers.num; i++)
+		gs_samplerstate_destroy(shader->samplers.array[i]);
+
+	for (i = 0; i < shader->params.num; i++)
+		shader_param_free(shader->params.array + i);
+
+	da_free(shader->samplers);
+	da_free(shader->params);
+	bfree(shader->func);
+	bfree(shader->effect);
+	bfree(shader);
+}
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	return (int)shader->params.num;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	assert(param < shader->params.num);
+	return shader->params.array + param;
+}
+
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader, const char *name)
+{
+	size_t i;
+	for (i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (strcmp(param->name, name) == 0)
+			return param;
+	}
+
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	return shader->viewproj;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	return shader->world;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param, struct gs_shader_param_info *info)
+{
+	info->type = param->type;
+	info->name = param->name;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	int int_val = val;
+	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	struct matrix4 mat;
+	matrix4_from_matrix3(&mat, val);
+
+	da_copy_array(param->cur_value, &mat, sizeof(mat));
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	da_copy_array(param->cur_value, val, sizeof(*val));
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	param->texture = val;
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	int count = param->array_count;
+	size_t expected_size = 0;
+	if (!count)
+		count = 1;
+
+	switch (param->type) {
+	case GS_SHADER_PARAM_FLOAT:
+		expected_size = sizeof(float);
+		break;
+	case GS_SHADER_PARAM_BOOL:
+	case GS_SHADER_PARAM_INT:
+		expected_size = sizeof(int);
+		break;
+	case GS_SHADER_PARAM_INT2:
+		expected_size = sizeof(int) * 2;
+		break;
+	case GS_SHADER_PARAM_INT3:
+		expected_size = sizeof(int) * 3;
+		break;
+	case GS_SHADER_PARAM_INT4:
+		expected_size = sizeof(int) * 4;
+		break;
+	case GS_SHADER_PARAM_VEC2:
+		expected_size = sizeof(float) * 2;
+		break;
+	case GS_SHADER_PARAM_VEC3:
+		expected_size = sizeof(float) * 3;
+		break;
+	case GS_SHADER_PARAM_VEC4:
+		expected_size = sizeof(float) * 4;
+		break;
+	case GS_SHADER_PARAM_MATRIX4X4:
+		expected_size = sizeof(float) * 4 * 4;
+		break;
+	case GS_SHADER_PARAM_TEXTURE:
+		expected_size = sizeof(struct gs_shader_texture);
+		break;
+	default:
+		expected_size = 0;
+	}
+
+	expected_size *= count;
+	if (!expected_size)
+		return;
+
+	if (expected_size != size) {
+		blog(LOG_ERROR, "gs_shader_set_val (software): Size of shader "
+				"param does not match the size of the input");
+		return;
+	}
+
+	if (param->type == GS_SHADER_PARAM_TEXTURE) {
+		struct gs_shader_texture shader_tex;
+		memcpy(&shader_tex, val, sizeof(shader_tex));
+		gs_shader_set_texture(param, shader_tex.tex);
+		param->srgb = shader_tex.srgb;
+	} else {
+		da_copy_array(param->cur_value, val, size);
+	}
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	gs_shader_set_val(param, param->def_value.array, param->def_value.num);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
+{
+	param->next_sampler = sampler;
+}
+
+/* ------------------------------------------------------------------------- */
+/* parameter access for programs                                             */
+
+struct gs_shader_param *sw_draw_get_param(const struct sw_draw *draw, const char *name)
+{
+	gs_shader_t *shaders[2] = {draw->pixel_shader, draw->device->cur_vertex_shader};
+
+	for (size_t i = 0; i < 2; i++) {
+		if (!shaders[i])
+			continue;
+
+		struct gs_shader_param *param = gs_shader_get_param_by_name(shaders[i], name);
+		if (param)
+			return param;
+	}
+
+	return NULL;
+}
+
+bool sw_draw_get_floats(const struct sw_draw *draw, const char *name, float *val, size_t count)
+{
+	struct gs_shader_param *param = sw_draw_get_param(draw, name);
+
+	if (!param || param->cur_value.num < count * sizeof(float))
+		return false;
+
+	memcpy(val, param->cur_value.array, count * sizeof(float));
+	return true;
+}
+
+/* textures have no mipmaps, so only the magnification filter matters */
+static bool is_linear_filter(enum gs_sample_filter filter)
+{
+	switch (filter) {
+	case GS_FILTER_LINEAR:
+	case GS_FILTER_ANISOTROPIC:
+	case GS_FILTER_MIN_POINT_MAG_LINEAR_MIP_POINT:
+	case GS_FILTER_MIN_POINT_MAG_MIP_LINEAR:
+	case GS_FILTER_MIN_MAG_LINEAR_MIP_POINT:
+		return true;
+	case GS_FILTER_POINT:
+	case GS_FILTER_MIN_MAG_POINT_MIP_LINEAR:
+	case GS_FILTER_MIN_LINEAR_MAG_MIP_POINT:
+	case GS_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR:
+		break;
+	}
+
+	return false;
+}
+
+static gs_samplerstate_t *get_sampler(const struct sw_draw *draw, const struct gs_shader_param *param)
+{
+	if (param->next_sampler)
+		return param->next_sampler;
+	if (draw->pixel_shader->samplers.num)
+		return draw->pixel_shader->samplers.array[0];
+	return draw->device->default_sampler;
+}
+
+bool sw_draw_bind_texture(struct sw_draw *draw, int slot, const char *name)
+{
+	struct sw_texture_binding *b = &draw->bindings[slot];
+	struct gs_shader_param *param = sw_draw_get_param(draw, name);
+
+	if (!param || param->type != GS_SHADER_PARAM_TEXTURE || !param->texture)
+		return false;
+
+	const struct gs_texture *tex = param->texture;
+	if (tex->type != GS_TEXTURE_2D || !tex->data)
+		return false;
+
+	b->load = sw_get_texel_load(tex->format);
+	if (!b->load)
+		return false;
+
+	const gs_samplerstate_t *sampler = get_sampler(draw, param);
+
+	b->tex = tex;
+	b->lut = sw_get_texel_lut(param->srgb && gs_is_srgb_format(tex->format));
+	b->linear = is_linear_filter(sampler->info.filter);
+	b->address_u = sampler->info.address_u;
+	b->address_v = sampler->info.address_v;
+	b->border_color = sampler->border_color;
+	b->width = (float)tex->width;
+	b->height = (float)tex->height;
+	return true;
+}
@@ -0,0 +1,1188 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include <math.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "sw-subsystem.h"
+
+const char *device_get_name(void)
+{
+	return "Software";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_SOFTWARE;
+}
+
+bool device_enum_adapters(gs_device_t *device, bool (*callback)(void *param, const char *name, uint32_t id),
+			  void *param)
+{
+	UNUSED_PARAMETER(device);
+	callback(param, "Software", 0);
+	return true;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_SOFTWARE";
+}
+
+static inline void reset_blend_state(struct sw_blend_state *blend)
+{
+	blend->enabled = true;
+	blend->src_c = GS_BLEND_SRCALPHA;
+	blend->dest_c = GS_BLEND_INVSRCALPHA;
+	blend->src_a = GS_BLEND_ONE;
+	blend->dest_a = GS_BLEND_INVSRCALPHA;
+	blend->op = GS_BLEND_OP_ADD;
+	for (size_t i = 0; i < 4; i++)
+		blend->write[i] = true;
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+	int threads = os_get_logical_cores() - 1;
+
+	UNUSED_PARAMETER(adapter);
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing software renderer...");
+
+	sw_init_format_tables();
+
+	if (threads < 0)
+		threads = 0;
+	if (!sw_pool_init(&device->pool, threads)) {
+		blog(LOG_ERROR, "device_create (software) failed");
+		bfree(device);
+		*p_device = NULL;
+		return GS_ERROR_FAIL;
+	}
+
+	struct gs_sampler_info info = {0};
+	info.filter = GS_FILTER_LINEAR;
+	info.address_u = GS_ADDRESS_CLAMP;
+	info.address_v = GS_ADDRESS_CLAMP;
+	info.address_w = GS_ADDRESS_CLAMP;
+	info.max_anisotropy = 1;
+	device->default_sampler = device_samplerstate_create(device, &info);
+
+	device->cur_color_space = GS_CS_SRGB;
+	device->cur_cull_mode = GS_NEITHER;
+	reset_blend_state(&device->blend);
+	matrix4_identity(&device->cur_proj);
+
+	blog(LOG_INFO, "Software renderer loaded successfully, %d raster worker thread(s)", threads);
+
+	*p_device = device;
+	return GS_SUCCESS;
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (device) {
+		blog(LOG_DEBUG, "Software renderer: %" PRIu64 " draw calls", device->draw_calls);
+
+		sw_pool_free(&device->pool);
+		gs_samplerstate_destroy(device->default_sampler);
+
+		da_free(device->verts);
+		da_free(device->tris);
+		da_free(device->proj_stack);
+		bfree(device);
+	}
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void *device_get_device_obj(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* there is no window system integration, swap chains render offscreen      */
+
+static bool swapchain_init_target(struct gs_swap_chain *swap)
+{
+	uint32_t cx = swap->info.cx ? swap->info.cx : 1;
+	uint32_t cy = swap->info.cy ? swap->info.cy : 1;
+	enum gs_color_format format = swap->info.format;
+
+	if (!sw_get_texel_store(format))
+		format = GS_BGRA;
+
+	gs_texture_destroy(swap->target);
+	swap->target = device_texture_create(swap->device, cx, cy, format, 1, NULL, GS_RENDER_TARGET);
+	return swap->target != NULL;
+}
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device, const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+
+	swap->device = device;
+	swap->info = *info;
+
+	if (!swapchain_init_target(swap)) {
+		blog(LOG_ERROR, "device_swapchain_create (software) failed");
+		bfree(swap);
+		return NULL;
+	}
+
+	return swap;
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	gs_device_t *device = swapchain->device;
+
+	if (device->cur_swap == swapchain)
+		device->cur_swap = NULL;
+
+	gs_texture_destroy(swapchain->target);
+	bfree(swapchain);
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	struct gs_swap_chain *swap = device->cur_swap;
+
+	if (!swap) {
+		blog(LOG_WARNING, "device_resize (software): No active swap");
+		return;
+	}
+
+	swap->info.cx = cx;
+	swap->info.cy = cy;
+
+	if (!swapchain_init_target(swap))
+		blog(LOG_ERROR, "device_resize (software) failed");
+}
+
+enum gs_color_space device_get_color_space(gs_device_t *device)
+{
+	return device->cur_color_space;
+}
+
+void device_update_color_space(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap && device->cur_swap->target) {
+		*cx = device->cur_swap->target->width;
+		*cy = device->cur_swap->target->height;
+	} else {
+		blog(LOG_ERROR, "device_get_size (software): No active swap");
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	uint32_t cx, cy;
+	device_get_size(device, &cx, &cy);
+	return cx;
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	uint32_t cx, cy;
+	device_get_size(device, &cx, &cy);
+	return cy;
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+	device->cur_render_target = swapchain ? swapchain->target : NULL;
+}
+
+bool device_is_present_ready(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return true;
+}
+
+void device_present(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_timer_t *device_timer_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return bzalloc(sizeof(struct gs_timer));
+}
+
+gs_timer_range_t *device_timer_range_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return bzalloc(sizeof(struct gs_timer_range));
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	bfree(timer);
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	timer->begin = os_gettime_ns();
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	timer->end = os_gettime_ns();
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	if (timer->end < timer->begin)
+		return false;
+
+	*ticks = timer->end - timer->begin;
+	return true;
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	bfree(range);
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	range->begin = os_gettime_ns();
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	range->end = os_gettime_ns();
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint, uint64_t *frequency)
+{
+	UNUSED_PARAMETER(range);
+	*disjoint = false;
+	*frequency = 1000000000;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vertbuffer)
+{
+	device->cur_vertex_buffer = vertbuffer;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *indexbuffer)
+{
+	device->cur_index_buffer = indexbuffer;
+}
+
+static struct gs_shader_param *get_texture_param(gs_device_t *device, int unit)
+{
+	struct gs_shader *shader = device->cur_pixel_shader;
+	int texture_id = 0;
+
+	if (!shader)
+		return NULL;
+
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (param->type != GS_SHADER_PARAM_TEXTURE)
+			continue;
+		if (texture_id++ == unit)
+			return param;
+	}
+
+	return NULL;
+}
+
+static void load_texture(gs_device_t *device, gs_texture_t *tex, int unit, bool srgb)
+{
+	struct gs_shader_param *param;
+
+	device->cur_textures[unit] = tex;
+
+	param = get_texture_param(device, unit);
+	if (param) {
+		param->texture = tex;
+		param->srgb = srgb;
+	}
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	load_texture(device, tex, unit, false);
+}
+
+void device_load_texture_srgb(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	load_texture(device, tex, unit, true);
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *samplerstate, int unit)
+{
+	device->cur_samplers[unit] = samplerstate;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	if (vertshader && vertshader->type != GS_SHADER_VERTEX) {
+		blog(LOG_ERROR, "Specified shader is not a vertex shader");
+		blog(LOG_ERROR, "device_load_vertexshader (software) failed");
+		return;
+	}
+
+	device->cur_vertex_shader = vertshader;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	if (pixelshader && pixelshader->type != GS_SHADER_PIXEL) {
+		blog(LOG_ERROR, "Specified shader is not a pixel shader");
+		blog(LOG_ERROR, "device_load_pixelshader (software) failed");
+		return;
+	}
+
+	device->cur_pixel_shader = pixelshader;
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		device->cur_textures[i] = NULL;
+		device->cur_samplers[i] = NULL;
+	}
+	if (pixelshader) {
+		for (size_t i = 0; i < pixelshader->samplers.num && i < GS_MAX_TEXTURES; i++)
+			device->cur_samplers[i] = pixelshader->samplers.array[i];
+	}
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	UNUSED_PARAMETER(b_3d);
+	device->cur_samplers[unit] = device->default_sampler;
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	if (device->cur_swap && device->cur_render_target == device->cur_swap->target)
+		return NULL;
+
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex, gs_zstencil_t *zstencil)
+{
+	device_set_render_target_with_color_space(device, tex, zstencil, GS_CS_SRGB);
+}
+
+void device_set_render_target_with_color_space(gs_device_t *device, gs_texture_t *tex, gs_zstencil_t *zstencil,
+					       enum gs_color_space space)
+{
+	if (tex && tex->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_set_render_target (software): texture is not a 2D texture");
+		return;
+	}
+	if (tex && !tex->is_render_target) {
+		blog(LOG_ERROR, "device_set_render_target (software): texture is not a render target");
+		return;
+	}
+
+	if (!tex && device->cur_swap)
+		tex = device->cur_swap->target;
+
+	device->cur_render_target = tex;
+	device->cur_zstencil_buffer = zstencil;
+	device->cur_color_space = space;
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex, int side, gs_zstencil_t *zstencil)
+{
+	UNUSED_PARAMETER(side);
+
+	if (cubetex) {
+		blog(LOG_ERROR, "device_set_cube_render_target (software): cube textures are not supported");
+		return;
+	}
+
+	device_set_render_target(device, NULL, zstencil);
+}
+
+void device_enable_framebuffer_srgb(gs_device_t *device, bool enable)
+{
+	device->framebuffer_srgb = enable;
+}
+
+bool device_framebuffer_srgb_enabled(gs_device_t *device)
+{
+	return device->framebuffer_srgb;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool formats_compatible(enum gs_color_format a, enum gs_color_format b)
+{
+	return gs_generalize_format(a) == gs_generalize_format(b);
+}
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || !dst) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): %s texture is NULL",
+		     src ? "Destination" : "Source");
+		return;
+	}
+	if (src->type != GS_TEXTURE_2D || dst->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): Source and destination must be 2D textures");
+		return;
+	}
+	if (!formats_compatible(src->format, dst->format)) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): Source and destination formats do not match");
+		return;
+	}
+
+	uint32_t copy_w = src_w ? src_w : (src->width - src_x);
+	uint32_t copy_h = src_h ? src_h : (src->height - src_y);
+
+	if (src_x + copy_w > src->width || src_y + copy_h > src->height || dst_x + copy_w > dst->width ||
+	    dst_y + copy_h > dst->height) {
+		blog(LOG_ERROR, "device_copy_texture_region (software): Region is out of bounds");
+		return;
+	}
+
+	const size_t row_size = (size_t)copy_w * src->bytes_per_pixel;
+
+	const uint8_t *s = src->data + (size_t)src_y * src->linesize + (size_t)src_x * src->bytes_per_pixel;
+	uint8_t *d = dst->data + (size_t)dst_y * dst->linesize + (size_t)dst_x * dst->bytes_per_pixel;
+
+	for (uint32_t y = 0; y < copy_h; y++)
+		memmove(d + (size_t)y * dst->linesize, s + (size_t)y * src->linesize, row_size);
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst, gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst, gs_texture_t *src)
+{
+	UNUSED_PARAMETER(device);
+
+	if (!src || src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source is not a 2D texture");
+		return;
+	}
+	if (!formats_compatible(src->format, dst->format)) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source and destination formats do not match");
+		return;
+	}
+	if (src->width != dst->width || src->height != dst->height) {
+		blog(LOG_ERROR, "device_stage_texture (software): Source and destination sizes do not match");
+		return;
+	}
+
+	if (src->linesize == dst->linesize) {
+		memcpy(dst->data, src->data, (size_t)src->linesize * src->height);
+		return;
+	}
+
+	for (uint32_t y = 0; y < src->height; y++)
+		memcpy(dst->data + (size_t)y * dst->linesize, src->data + (size_t)y * src->linesize, src->linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_begin_frame(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+static void update_viewproj_matrix(struct gs_device *device)
+{
+	gs_matrix_get(&device->cur_view);
+
+	/* negate Z col of the view matrix for right-handed coordinate system */
+	device->cur_view.x.z = -device->cur_view.x.z;
+	device->cur_view.y.z = -device->cur_view.y.z;
+	device->cur_view.z.z = -device->cur_view.z.z;
+	device->cur_view.t.z = -device->cur_view.t.z;
+
+	matrix4_mul(&device->cur_viewproj, &device->cur_view, &device->cur_proj);
+}
+
+static inline void rect_intersect(struct sw_rect *r, int x0, int y0, int x1, int y1)
+{
+	if (r->x0 < x0)
+		r->x0 = x0;
+	if (r->y0 < y0)
+		r->y0 = y0;
+	if (r->x1 > x1)
+		r->x1 = x1;
+	if (r->y1 > y1)
+		r->y1 = y1;
+}
+
+static void get_clip_rect(const gs_device_t *device, const gs_texture_t *target, struct sw_rect *clip)
+{
+	const struct gs_rect *vp = &device->cur_viewport;
+
+	clip->x0 = 0;
+	clip->y0 = 0;
+	clip->x1 = (int)target->width;
+	clip->y1 = (int)target->height;
+
+	rect_intersect(clip, vp->x, vp->y, vp->x + vp->cx, vp->y + vp->cy);
+
+	if (device->scissor_enabled) {
+		const struct gs_rect *sc = &device->cur_scissor;
+		rect_intersect(clip, sc->x, sc->y, sc->x + sc->cx, sc->y + sc->cy);
+	}
+}
+
+/* clip space to window coordinates, vertices behind the eye get a NaN
+ * position so that triangle setup rejects them */
+static inline void to_window(const gs_device_t *device, const struct vec4 *pos, struct sw_vertex *vert)
+{
+	const struct gs_rect *vp = &device->cur_viewport;
+
+	if (pos->w <= 0.0f) {
+		vert->x = vert->y = NAN;
+		return;
+	}
+
+	float w_i = 1.0f / pos->w;
+	vert->x = (float)vp->x + (pos->x * w_i + 1.0f) * 0.5f * (float)vp->cx;
+	vert->y = (float)vp->y + (1.0f - pos->y * w_i) * 0.5f * (float)vp->cy;
+}
+
+static inline uint32_t get_index(const gs_indexbuffer_t *ib, uint32_t i)
+{
+	if (!ib)
+		return i;
+
+	return ib->type == GS_UNSIGNED_LONG ? ((const uint32_t *)ib->indices)[i]
+					    : ((const uint16_t *)ib->indices)[i];
+}
+
+static bool transform_vertices(gs_device_t *device, uint32_t start_vert, uint32_t num_verts)
+{
+	const gs_vertbuffer_t *vb = device->cur_vertex_buffer;
+	const gs_indexbuffer_t *ib = device->cur_index_buffer;
+	gs_shader_t *vs = device->cur_vertex_shader;
+	const struct sw_vertex_program *program = vs->vertex_program;
+	float uv_scale[2] = {1.0f, 1.0f};
+
+	if (program->uv_scale) {
+		struct gs_shader_param *param = gs_shader_get_param_by_name(vs, program->uv_scale);
+		if (param && param->cur_value.num >= sizeof(uv_scale))
+			memcpy(uv_scale, param->cur_value.array, sizeof(uv_scale));
+	}
+
+	da_resize(device->verts, num_verts);
+
+	for (uint32_t i = 0; i < num_verts; i++) {
+		struct sw_vertex *vert = device->verts.array + i;
+		uint32_t idx = get_index(ib, start_vert + i);
+		struct vec4 pos;
+
+		memset(vert->v, 0, sizeof(vert->v));
+
+		if (program->generate) {
+			program->generate(vs, idx, &pos, vert->v);
+			to_window(device, &pos, vert);
+			continue;
+		}
+
+		if (idx >= vb->num) {
+			blog(LOG_ERROR, "device_draw (software): vertex index %u out of range", idx);
+			return false;
+		}
+
+		vec4_from_vec3(&pos, &vb->points[idx]);
+		pos.w = 1.0f;
+		vec4_transform(&pos, &pos, &device->cur_viewproj);
+		to_window(device, &pos, vert);
+
+		if (vb->uvs) {
+			const float *uv = vb->uvs + idx * vb->uv_width;
+			vert->v[SW_VARYING_UV] = uv[0] * uv_scale[0];
+			if (vb->uv_width > 1)
+				vert->v[SW_VARYING_UV + 1] = uv[1] * uv_scale[1];
+		}
+
+		if (vb->colors) {
+			struct vec4 color;
+			vec4_from_rgba(&color, vb->colors[idx]);
+			memcpy(&vert->v[SW_VARYING_COLOR], color.ptr, sizeof(float) * 4);
+		}
+	}
+
+	return true;
+}
+
+static void build_triangles(gs_device_t *device, enum gs_draw_mode draw_mode, const struct sw_rect *clip)
+{
+	const struct sw_vertex *verts = device->verts.array;
+	const size_t num = device->verts.num;
+	struct sw_triangle tri;
+
+	da_resize(device->tris, 0);
+
+	if (draw_mode == GS_TRIS) {
+		for (size_t i = 0; i + 2 < num; i += 3) {
+			if (sw_triangle_setup(&tri, &verts[i], &verts[i + 1], &verts[i + 2], clip,
+					      device->cur_cull_mode))
+				da_push_back(device->tris, &tri);
+		}
+	} else {
+		/* every other triangle of a strip has its winding reversed */
+		for (size_t i = 0; i + 2 < num; i++) {
+			const struct sw_vertex *v0 = &verts[(i & 1) ? i + 1 : i];
+			const struct sw_vertex *v1 = &verts[(i & 1) ? i : i + 1];
+
+			if (sw_triangle_setup(&tri, v0, v1, &verts[i + 2], clip, device->cur_cull_mode))
+				da_push_back(device->tris, &tri);
+		}
+	}
+}
+
+static inline bool near_f(float a, float b)
+{
+	return fabsf(a - b) < 1e-3f;
+}
+
+/* texel coordinate sampled by the center of pixel x, y */
+static inline float texel_coord(const struct sw_triangle *tri, int var, int x, int y, float size)
+{
+	float xc = (float)x + 0.5f;
+	float yc = (float)y + 0.5f;
+	return (tri->base[var] + tri->dx[var] * xc + tri->dy[var] * yc) * size - 0.5f;
+}
+
+/* A draw whose pixels map to texel centers by an integer offset, without
+ * anything changing the texel on its way to the target, can be done as a
+ * row copy.  This is the common case of sources drawn at their own size. */
+static void detect_blit(struct sw_draw *draw)
+{
+	const struct sw_texture_binding *image = &draw->bindings[0];
+	const struct gs_texture *src = image->tex;
+	const struct gs_texture *dst = draw->target;
+	const struct sw_blend_state *blend = &draw->blend;
+
+	if (!(draw->program->flags & SW_PROGRAM_COPY) || !src)
+		return;
+	if (src->format != dst->format && !formats_compatible(src->format, dst->format))
+		return;
+	if (image->lut != sw_get_texel_lut(draw->srgb))
+		return;
+	if (!blend->write[0] || !blend->write[1] || !blend->write[2] || !blend->write[3])
+		return;
+	if (blend->enabled && (blend->src_c != GS_BLEND_ONE || blend->dest_c != GS_BLEND_ZERO ||
+			       blend->src_a != GS_BLEND_ONE || blend->dest_a != GS_BLEND_ZERO ||
+			       blend->op != GS_BLEND_OP_ADD))
+		return;
+
+	int offset_x = 0, offset_y = 0;
+
+	for (size_t i = 0; i < draw->num_tris; i++) {
+		const struct sw_triangle *tri = draw->tris + i;
+		const struct sw_rect *b = &tri->bounds;
+		const int xs[2] = {b->x0, b->x1 - 1};
+		const int ys[2] = {b->y0, b->y1 - 1};
+
+		/* the mapping is affine, so if it is a whole texel translation
+		 * at the corners of the bounds it is one everywhere inside */
+		for (size_t c = 0; c < 4; c++) {
+			int x = xs[c & 1];
+			int y = ys[c >> 1];
+			float tu = texel_coord(tri, SW_VARYING_UV, x, y, image->width) - (float)x;
+			float tv = texel_coord(tri, SW_VARYING_UV + 1, x, y, image->height) - (float)y;
+			int ox = (int)floorf(tu + 0.5f);
+			int oy = (int)floorf(tv + 0.5f);
+
+			if (!near_f(tu, (float)ox) || !near_f(tv, (float)oy))
+				return;
+			if ((i > 0 || c > 0) && (ox != offset_x || oy != offset_y))
+				return;
+
+			offset_x = ox;
+			offset_y = oy;
+		}
+
+		/* every covered pixel has to read inside the texture,
+		 * otherwise the sampler address mode would matter */
+		if (b->x0 + offset_x < 0 || b->y0 + offset_y < 0 || b->x1 + offset_x > (int)src->width ||
+		    b->y1 + offset_y > (int)src->height)
+			return;
+	}
+
+	draw->blit = true;
+	draw->blit_src = src;
+	draw->blit_offset_x = offset_x;
+	draw->blit_offset_y = offset_y;
+}
+
+static inline bool can_render(const gs_device_t *device, enum gs_draw_mode draw_mode, uint32_t num_verts)
+{
+	static bool warned_mode = false;
+	const gs_shader_t *vs = device->cur_vertex_shader;
+	const gs_shader_t *ps = device->cur_pixel_shader;
+
+	if (!vs || !ps) {
+		blog(LOG_ERROR, "No %s shader specified", vs ? "pixel" : "vertex");
+		return false;
+	}
+	if (!device->cur_render_target) {
+		blog(LOG_ERROR, "No render target specified");
+		return false;
+	}
+
+	/* missing implementations are reported when the shader is created */
+	if (!vs->vertex_program || !ps->program)
+		return false;
+
+	if (draw_mode != GS_TRIS && draw_mode != GS_TRISTRIP) {
+		if (!warned_mode) {
+			blog(LOG_WARNING, "device_draw (software): point and line primitives are not supported");
+			warned_mode = true;
+		}
+		return false;
+	}
+
+	if (!vs->vertex_program->generate && !device->cur_vertex_buffer) {
+		blog(LOG_ERROR, "No vertex buffer specified");
+		return false;
+	}
+	if (!num_verts && !device->cur_index_buffer && !device->cur_vertex_buffer)
+		return false;
+
+	return true;
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+	gs_effect_t *effect = gs_get_effect();
+	gs_texture_t *target = device->cur_render_target;
+	struct sw_draw draw = {0};
+
+	if (!can_render(device, draw_mode, num_verts))
+		return;
+
+	if (effect)
+		gs_effect_update_params(effect);
+
+	update_viewproj_matrix(device);
+
+	if (num_verts == 0) {
+		if (device->cur_index_buffer)
+			num_verts = (uint32_t)device->cur_index_buffer->num;
+		else
+			num_verts = (uint32_t)device->cur_vertex_buffer->num;
+	}
+
+	draw.device = device;
+	draw.program = device->cur_pixel_shader->program;
+	draw.pixel_shader = device->cur_pixel_shader;
+	draw.target = target;
+	draw.blend = device->blend;
+	draw.srgb = device->framebuffer_srgb && gs_is_srgb_format(target->format);
+	draw.dst_load = sw_get_texel_load(target->format);
+	draw.dst_store = sw_get_texel_store(target->format);
+
+	if (!draw.dst_load || !draw.dst_store)
+		return;
+
+	get_clip_rect(device, target, &draw.clip);
+	if (draw.clip.x0 >= draw.clip.x1 || draw.clip.y0 >= draw.clip.y1)
+		return;
+
+	if (!draw.program->setup(&draw))
+		return;
+
+	if (!transform_vertices(device, start_vert, num_verts))
+		return;
+
+	build_triangles(device, draw_mode, &draw.clip);
+	draw.tris = device->tris.array;
+	draw.num_tris = device->tris.num;
+	if (!draw.num_tris)
+		return;
+
+	detect_blit(&draw);
+
+	device->draw_calls++;
+	sw_draw_execute(&draw);
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags, const struct vec4 *color, float depth, uint8_t stencil)
+{
+	gs_texture_t *target = device->cur_render_target;
+
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+
+	if ((clear_flags & GS_CLEAR_COLOR) && target) {
+		bool srgb = device->framebuffer_srgb && gs_is_srgb_format(target->format);
+		sw_clear_texture(device, target, color, srgb);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	device->blend.enabled = enable;
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green, bool blue, bool alpha)
+{
+	device->blend.write[0] = red;
+	device->blend.write[1] = green;
+	device->blend.write[2] = blue;
+	device->blend.write[3] = alpha;
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src, enum gs_blend_type dest)
+{
+	device_blend_function_separate(device, src, dest, src, dest);
+}
+
+void device_blend_function_separate(gs_device_t *device, enum gs_blend_type src_c, enum gs_blend_type dest_c,
+				    enum gs_blend_type src_a, enum gs_blend_type dest_a)
+{
+	device->blend.src_c = src_c;
+	device->blend.dest_c = dest_c;
+	device->blend.src_a = src_a;
+	device->blend.dest_a = dest_a;
+}
+
+void device_blend_op(gs_device_t *device, enum gs_blend_op_type op)
+{
+	device->blend.op = op;
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side, enum gs_stencil_op_type fail,
+		       enum gs_stencil_op_type zfail, enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width, int height)
+{
+	device->cur_viewport.x = x;
+	device->cur_viewport.y = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	device->scissor_enabled = rect != NULL;
+	if (rect)
+		device->cur_scissor = *rect;
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top, float bottom, float zNear, float zFar)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = zFar - zNear;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = 2.0f / rml;
+	dst->t.x = (left + right) / -rml;
+
+	dst->y.y = 2.0f / -bmt;
+	dst->t.y = (bottom + top) / bmt;
+
+	dst->z.z = 1.0f / fmn;
+	dst->t.z = zNear / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top, float bottom, float zNear, float zFar)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = zFar - zNear;
+	float nearx2 = 2.0f * zNear;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = nearx2 / rml;
+	dst->z.x = (left + right) / -rml;
+
+	dst->y.y = nearx2 / -bmt;
+	dst->z.y = (bottom + top) / bmt;
+
+	dst->z.z = zFar / fmn;
+	dst->t.z = (zNear * zFar) / -fmn;
+
+	dst->z.w = 1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	if (!device->proj_stack.num)
+		return;
+
+	matrix4_copy(&device->cur_proj, da_end(device->proj_stack));
+	da_pop_back(device->proj_stack);
+}
+
+void device_debug_marker_begin(gs_device_t *device, const char *markername, const float color[4])
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(markername);
+	UNUSED_PARAMETER(color);
+}
+
+void device_debug_marker_end(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+bool device_is_monitor_hdr(gs_device_t *device, void *monitor)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(monitor);
+	return false;
+}
+
+bool device_shared_texture_available(void)
+{
+	return false;
+}
+
+bool device_nv12_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+bool device_p010_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* platform texture sharing has no CPU equivalent                            */
+
+#ifdef _WIN32
+EXPORT bool device_gdi_texture_available(void)
+{
+	return false;
+}
+#endif
+
+#ifdef __APPLE__
+gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device, void *iosurf)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(iosurf);
+	return NULL;
+}
+
+gs_texture_t *device_texture_open_shared(gs_device_t *device, uint32_t handle)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(handle);
+	return NULL;
+}
+
+EXPORT bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
+{
+	UNUSED_PARAMETER(texture);
+	UNUSED_PARAMETER(iosurf);
+	return false;
+}
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
+gs_texture_t *device_texture_create_from_dmabuf(gs_device_t *device, unsigned int width, unsigned int height,
+						uint32_t drm_format, enum gs_color_format color_format,
+						uint32_t n_planes, const int *fds, const uint32_t *strides,
+						const uint32_t *offsets, const uint64_t *modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(drm_format);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(n_planes);
+	UNUSED_PARAMETER(fds);
+	UNUSED_PARAMETER(strides);
+	UNUSED_PARAMETER(offsets);
+	UNUSED_PARAMETER(modifiers);
+	return NULL;
+}
+
+bool device_query_dmabuf_capabilities(gs_device_t *device, enum gs_dmabuf_flags *dmabuf_flags, uint32_t **drm_formats,
+				      size_t *n_formats)
+{
+	UNUSED_PARAMETER(device);
+	*dmabuf_flags = GS_DMABUF_FLAG_NONE;
+	*drm_formats = NULL;
+	*n_formats = 0;
+	return false;
+}
+
+bool device_query_dmabuf_modifiers_for_format(gs_device_t *device, uint32_t drm_format, uint64_t **modifiers,
+					      size_t *n_modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(drm_format);
+	*modifiers = NULL;
+	*n_modifiers = 0;
+	return false;
+}
+
+gs_texture_t *device_texture_create_from_pixmap(gs_device_t *device, uint32_t width, uint32_t height,
+						enum gs_color_format color_format, uint32_t target, void *pixmap)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(target);
+	UNUSED_PARAMETER(pixmap);
+	return NULL;
+}
+#endif
@@ -0,0 +1,447 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+#include <graphics/vec4.h>
+
+/*
+ * CPU renderer.
+ *
+ * Resources live in system memory and every draw is executed synchronously
+ * by a pool of worker threads, each rasterizing a subset of screen tiles.
+ * There is no shader compiler: shaders are matched against a table of known
+ * effect functions (see sw-programs.c) and draws with a shader that has no
+ * CPU implementation are skipped.
+ */
+
+#define SW_TILE_WIDTH 128
+#define SW_TILE_HEIGHT 32
+#define SW_MAX_VARYINGS 6
+#define SW_MAX_BINDINGS 4
+#define SW_MAX_CONSTS 32
+
+/* varying layout of the transforming vertex programs, fullscreen programs
+ * use the varyings in the order their shader outputs them */
+#define SW_VARYING_UV 0
+#define SW_VARYING_COLOR 2
+
+struct sw_draw;
+struct sw_span;
+struct sw_texture_binding;
+
+typedef void (*sw_texel_load_t)(const uint8_t *p, const float *lut, struct vec4 *out);
+typedef void (*sw_texel_store_t)(uint8_t *p, const struct vec4 *color, bool srgb);
+
+/* ------------------------------------------------------------------------- */
+
+/* Vertex shaders either transform the vertex buffer by ViewProj and pass the
+ * texture coordinates and colors through (optionally scaling the texture
+ * coordinates by a parameter), or generate a fullscreen triangle from
+ * SV_VertexID, in which case generate() evaluates the shader for one vertex. */
+struct sw_vertex_program {
+	const char *effect;
+	const char *func;
+	const char *uv_scale;
+	void (*generate)(gs_shader_t *shader, uint32_t id, struct vec4 *pos, float *varyings);
+};
+
+extern const struct sw_vertex_program *sw_find_vertex_program(const char *effect, const char *func, bool vertex_id);
+
+/* program output is the unmodified "image" texel, allows 1:1 draws to copy */
+#define SW_PROGRAM_COPY (1 << 0)
+
+struct sw_program {
+	const char *effect;
+	const char *func;
+	uint32_t flags;
+	uint32_t variant;
+
+	/* resolves textures and constants, returns false to skip the draw */
+	bool (*setup)(struct sw_draw *draw);
+	void (*shade)(const struct sw_draw *draw, const struct sw_span *span, struct vec4 *out);
+};
+
+extern const struct sw_program *sw_find_program(const char *effect, const char *func);
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	struct gs_sampler_info info;
+	struct vec4 border_color;
+};
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char *name;
+	gs_shader_t *shader;
+	gs_samplerstate_t *next_sampler;
+	int array_count;
+
+	struct gs_texture *texture;
+	bool srgb;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t *) samplers;
+
+	const struct sw_vertex_program *vertex_program;
+	const struct sw_program *program;
+	char *func;
+	char *effect;
+};
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	struct gs_vb_data *data;
+	bool dynamic;
+	size_t num;
+
+	struct vec3 *points;
+	uint32_t *colors;
+	float *uvs;
+	size_t uv_width;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	void *data;
+	void *indices;
+	size_t num;
+	size_t width;
+	enum gs_index_type type;
+	bool dynamic;
+};
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	bool is_render_target;
+	bool is_dynamic;
+
+	uint32_t bytes_per_pixel;
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+	gs_texture_t *target;
+};
+
+struct gs_timer {
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gs_timer_range {
+	uint64_t begin;
+	uint64_t end;
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct sw_blend_state {
+	bool enabled;
+	enum gs_blend_type src_c;
+	enum gs_blend_type dest_c;
+	enum gs_blend_type src_a;
+	enum gs_blend_type dest_a;
+	enum gs_blend_op_type op;
+	bool write[4];
+};
+
+struct sw_rect {
+	int x0, y0, x1, y1;
+};
+
+struct sw_vertex {
+	float x, y;
+	float v[SW_MAX_VARYINGS];
+};
+
+struct sw_triangle {
+	struct sw_rect bounds;
+
+	/* inside when a * x + b * y + c >= 0 for all three edges */
+	float a[3], b[3], c[3];
+
+	/* varying = base + dx * x + dy * y */
+	float base[SW_MAX_VARYINGS];
+	float dx[SW_MAX_VARYINGS];
+	float dy[SW_MAX_VARYINGS];
+};
+
+struct sw_span {
+	int x, y;
+	int count;
+	float v[SW_MAX_VARYINGS];
+	float dvdx[SW_MAX_VARYINGS];
+	float dvdy[SW_MAX_VARYINGS];
+};
+
+struct sw_texture_binding {
+	const struct gs_texture *tex;
+	sw_texel_load_t load;
+	const float *lut;
+	bool linear;
+	enum gs_address_mode address_u;
+	enum gs_address_mode address_v;
+	struct vec4 border_color;
+	float width;
+	float height;
+};
+
+struct sw_draw {
+	gs_device_t *device;
+	const struct sw_program *program;
+	gs_shader_t *pixel_shader;
+
+	gs_texture_t *target;
+	struct sw_rect clip;
+	struct sw_rect bounds;
+
+	struct sw_triangle *tris;
+	size_t num_tris;
+
+	struct sw_blend_state blend;
+	bool srgb;
+	sw_texel_load_t dst_load;
+	sw_texel_store_t dst_store;
+
+	struct sw_texture_binding bindings[SW_MAX_BINDINGS];
+	float consts[SW_MAX_CONSTS];
+
+	/* set when the draw is a 1:1 copy of texels, dst = src - offset */
+	bool blit;
+	const struct gs_texture *blit_src;
+	int blit_offset_x;
+	int blit_offset_y;
+
+	uint32_t tiles_x;
+	uint32_t tiles_y;
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct sw_worker_pool {
+	DARRAY(pthread_t) threads;
+	os_sem_t *start;
+	os_event_t *done;
+	volatile bool stop;
+	volatile long active;
+
+	void (*job)(void *param, long idx);
+	void *param;
+	long count;
+	volatile long next;
+};
+
+extern bool sw_pool_init(struct sw_worker_pool *pool, int threads);
+extern void sw_pool_free(struct sw_worker_pool *pool);
+extern void sw_pool_run(struct sw_worker_pool *pool, long count, void (*job)(void *param, long idx), void *param);
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_device {
+	struct sw_worker_pool pool;
+
+	gs_texture_t *cur_render_target;
+	gs_zstencil_t *cur_zstencil_buffer;
+	gs_texture_t *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t *cur_vertex_buffer;
+	gs_indexbuffer_t *cur_index_buffer;
+	gs_shader_t *cur_vertex_shader;
+	gs_shader_t *cur_pixel_shader;
+	gs_swapchain_t *cur_swap;
+	enum gs_color_space cur_color_space;
+	gs_samplerstate_t *default_sampler;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+	struct gs_rect cur_scissor;
+	bool scissor_enabled;
+	bool framebuffer_srgb;
+	struct sw_blend_state blend;
+
+	struct matrix4 cur_proj;
+	struct matrix4 cur_view;
+	struct matrix4 cur_viewproj;
+
+	DARRAY(struct matrix4) proj_stack;
+
+	DARRAY(struct sw_vertex) verts;
+	DARRAY(struct sw_triangle) tris;
+	uint64_t draw_calls;
+};
+
+/* sw-format.c */
+extern void sw_init_format_tables(void);
+extern sw_texel_load_t sw_get_texel_load(enum gs_color_format format);
+extern sw_texel_store_t sw_get_texel_store(enum gs_color_format format);
+extern const float *sw_get_texel_lut(bool srgb);
+extern float sw_srgb_nonlinear_to_linear(float u);
+extern float sw_srgb_linear_to_nonlinear(float u);
+
+/* sw-raster.c */
+extern bool sw_triangle_setup(struct sw_triangle *tri, const struct sw_vertex *v0, const struct sw_vertex *v1,
+			      const struct sw_vertex *v2, const struct sw_rect *clip, enum gs_cull_mode cull);
+extern void sw_draw_execute(struct sw_draw *draw);
+extern void sw_clear_texture(gs_device_t *device, gs_texture_t *tex, const struct vec4 *color, bool srgb);
+
+/* helpers used by programs */
+extern struct gs_shader_param *sw_draw_get_param(const struct sw_draw *draw, const char *name);
+extern bool sw_draw_bind_texture(struct sw_draw *draw, int slot, const char *name);
+extern bool sw_draw_get_floats(const struct sw_draw *draw, const char *name, float *val, size_t count);
+
+static inline int sw_address(int c, int size, enum gs_address_mode mode, bool *border)
+{
+	if (c >= 0 && c < size)
+		return c;
+
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		c %= size;
+		return c < 0 ? c + size : c;
+	case GS_ADDRESS_MIRROR: {
+		int period = size * 2;
+		c %= period;
+		if (c < 0)
+			c += period;
+		return c < size ? c : period - 1 - c;
+	}
+	case GS_ADDRESS_MIRRORONCE:
+		if (c < 0)
+			c = -c - 1;
+		return c < size ? c : size - 1;
+	case GS_ADDRESS_BORDER:
+		*border = true;
+		return 0;
+	case GS_ADDRESS_CLAMP:
+		break;
+	}
+
+	return c < 0 ? 0 : size - 1;
+}
+
+static inline void sw_texel(const struct sw_texture_binding *b, int x, int y, struct vec4 *out)
+{
+	const struct gs_texture *tex = b->tex;
+	bool border = false;
+
+	x = sw_address(x, (int)tex->width, b->address_u, &border);
+	y = sw_address(y, (int)tex->height, b->address_v, &border);
+
+	if (border) {
+		*out = b->border_color;
+		return;
+	}
+
+	b->load(tex->data + (size_t)y * tex->linesize + (size_t)x * tex->bytes_per_pixel, b->lut, out);
+}
+
+/* equivalent of Texture.Load(), coordinates are clamped */
+static inline void sw_load(const struct sw_texture_binding *b, int x, int y, struct vec4 *out)
+{
+	const struct gs_texture *tex = b->tex;
+
+	if (x < 0)
+		x = 0;
+	else if (x >= (int)tex->width)
+		x = (int)tex->width - 1;
+	if (y < 0)
+		y = 0;
+	else if (y >= (int)tex->height)
+		y = (int)tex->height - 1;
+
+	b->load(tex->data + (size_t)y * tex->linesize + (size_t)x * tex->bytes_per_pixel, b->lut, out);
+}
+
+/* equivalent of Texture.Sample() with normalized coordinates */
+static inline void sw_sample(const struct sw_texture_binding *b, float u, float v, struct vec4 *out)
+{
+	float fx = u * b->width - 0.5f;
+	float fy = v * b->height - 0.5f;
+
+	if (!b->linear) {
+		sw_texel(b, (int)floorf(fx + 0.5f), (int)floorf(fy + 0.5f), out);
+		return;
+	}
+
+	float x0f = floorf(fx);
+	float y0f = floorf(fy);
+	float wx = fx - x0f;
+	float wy = fy - y0f;
+	int x0 = (int)x0f;
+	int y0 = (int)y0f;
+
+	struct vec4 c00, c10, c01, c11;
+	sw_texel(b, x0, y0, &c00);
+	sw_texel(b, x0 + 1, y0, &c10);
+	sw_texel(b, x0, y0 + 1, &c01);
+	sw_texel(b, x0 + 1, y0 + 1, &c11);
+
+	struct vec4 top, bottom;
+	vec4_mulf(&c00, &c00, 1.0f - wx);
+	vec4_mulf(&c10, &c10, wx);
+	vec4_add(&top, &c00, &c10);
+	vec4_mulf(&c01, &c01, 1.0f - wx);
+	vec4_mulf(&c11, &c11, wx);
+	vec4_add(&bottom, &c01, &c11);
+
+	vec4_mulf(&top, &top, 1.0f - wy);
+	vec4_mulf(&bottom, &bottom, wy);
+	vec4_add(out, &top, &bottom);
+}
@@ -0,0 +1,454 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include "sw-subsystem.h"
+
+/* ------------------------------------------------------------------------- */
+/* textures, only the top level is stored since sampling never minifies
+ * through mipmaps in the software renderer                                  */
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width, uint32_t height,
+				    enum gs_color_format color_format, uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	struct gs_texture *tex;
+
+	if (gs_is_compressed_format(color_format) || !sw_get_texel_load(color_format)) {
+		blog(LOG_WARNING, "device_texture_create (software): unsupported format %d", (int)color_format);
+		return NULL;
+	}
+	if (!width || !height) {
+		blog(LOG_ERROR, "device_texture_create (software): invalid size %ux%u", width, height);
+		return NULL;
+	}
+
+	tex = bzalloc(sizeof(struct gs_texture));
+	tex->device = device;
+	tex->type = GS_TEXTURE_2D;
+	tex->format = color_format;
+	tex->width = width;
+	tex->height = height;
+	tex->levels = levels;
+	tex->is_dynamic = (flags & GS_DYNAMIC) != 0;
+	tex->is_render_target = (flags & GS_RENDER_TARGET) != 0;
+	tex->bytes_per_pixel = gs_get_format_bpp(color_format) / 8;
+	tex->linesize = width * tex->bytes_per_pixel;
+	tex->data = bzalloc((size_t)tex->linesize * height);
+
+	if (data && data[0])
+		memcpy(tex->data, data[0], (size_t)tex->linesize * height);
+
+	return tex;
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size, enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(size);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+
+	blog(LOG_WARNING, "device_cubetexture_create (software): cube textures are not supported");
+	return NULL;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width, uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format, uint32_t levels,
+				       const uint8_t *const *data, uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+
+	blog(LOG_WARNING, "device_voltexture_create (software): volume textures are not supported");
+	return NULL;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	if (!tex)
+		return;
+
+	gs_device_t *device = tex->device;
+
+	if (device->cur_render_target == tex)
+		device->cur_render_target = NULL;
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_textures[i] == tex)
+			device->cur_textures[i] = NULL;
+	}
+
+	bfree(tex->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	if (!tex->is_dynamic) {
+		blog(LOG_ERROR, "gs_texture_map (software): texture is not dynamic");
+		return false;
+	}
+
+	*ptr = tex->data;
+	*linesize = tex->linesize;
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	return tex->data;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	gs_texture_destroy(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	return cubetex->width;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	gs_texture_destroy(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	return voltex->width;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	return voltex->height;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 1;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	return voltex->format;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width, uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	if (gs_is_compressed_format(color_format)) {
+		blog(LOG_ERROR, "device_stagesurface_create (software): compressed formats are not supported");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = width * gs_get_format_bpp(color_format) / 8;
+	surf->data = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data, uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+/* ------------------------------------------------------------------------- */
+/* depth/stencil is not implemented, the buffer only exists so render target
+ * setup code paths behave the same as with the other renderers              */
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width, uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zs)
+{
+	if (!zs)
+		return;
+
+	if (zs->device->cur_zstencil_buffer == zs)
+		zs->device->cur_zstencil_buffer = NULL;
+	bfree(zs);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_samplerstate_t *device_samplerstate_create(gs_device_t *device, const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler = bzalloc(sizeof(struct gs_sampler_state));
+
+	sampler->device = device;
+	sampler->info = *info;
+	vec4_from_rgba(&sampler->border_color, info->border_color);
+	return sampler;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	gs_device_t *device = samplerstate->device;
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_samplers[i] == samplerstate)
+			device->cur_samplers[i] = NULL;
+	}
+
+	bfree(samplerstate);
+}
+
+/* ------------------------------------------------------------------------- */
+/* vertex and index buffers keep their own copy of what the rasterizer reads,
+ * the gs_vb_data is only retained for dynamic buffers, as with OpenGL       */
+
+static inline void *dup_array(const void *src, size_t size)
+{
+	void *dst = bmalloc(size);
+	memcpy(dst, src, size);
+	return dst;
+}
+
+static void vertexbuffer_update(gs_vertbuffer_t *vb, const struct gs_vb_data *data)
+{
+	size_t num = data->num < vb->num ? data->num : vb->num;
+
+	if (data->points && vb->points)
+		memcpy(vb->points, data->points, num * sizeof(struct vec3));
+	if (data->colors && vb->colors)
+		memcpy(vb->colors, data->colors, num * sizeof(uint32_t));
+	if (data->num_tex && data->tvarray[0].array && vb->uvs && data->tvarray[0].width == vb->uv_width)
+		memcpy(vb->uvs, data->tvarray[0].array, num * vb->uv_width * sizeof(float));
+}
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device, struct gs_vb_data *data, uint32_t flags)
+{
+	struct gs_vertex_buffer *vb;
+
+	if (!data->points) {
+		blog(LOG_ERROR, "device_vertexbuffer_create (software) failed: no points");
+		return NULL;
+	}
+
+	vb = bzalloc(sizeof(struct gs_vertex_buffer));
+	vb->device = device;
+	vb->data = data;
+	vb->num = data->num;
+	vb->dynamic = (flags & GS_DYNAMIC) != 0;
+
+	vb->points = dup_array(data->points, data->num * sizeof(struct vec3));
+	if (data->colors)
+		vb->colors = dup_array(data->colors, data->num * sizeof(uint32_t));
+	if (data->num_tex && data->tvarray[0].array) {
+		vb->uv_width = data->tvarray[0].width;
+		vb->uvs = dup_array(data->tvarray[0].array, data->num * vb->uv_width * sizeof(float));
+	}
+
+	if (!vb->dynamic) {
+		gs_vbdata_destroy(vb->data);
+		vb->data = NULL;
+	}
+
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
+{
+	if (!vb)
+		return;
+
+	if (vb->device->cur_vertex_buffer == vb)
+		vb->device->cur_vertex_buffer = NULL;
+
+	bfree(vb->points);
+	bfree(vb->colors);
+	bfree(vb->uvs);
+	gs_vbdata_destroy(vb->data);
+	bfree(vb);
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vb)
+{
+	gs_vertexbuffer_flush_direct(vb, vb->data);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vb, const struct gs_vb_data *data)
+{
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "gs_vertexbuffer_flush (software): vertex buffer is not dynamic");
+		return;
+	}
+
+	vertexbuffer_update(vb, data);
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
+{
+	return vb->data;
+}
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device, enum gs_index_type type, void *indices, size_t num,
+					    uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(struct gs_index_buffer));
+
+	ib->device = device;
+	ib->type = type;
+	ib->num = num;
+	ib->width = type == GS_UNSIGNED_LONG ? 4 : 2;
+	ib->dynamic = (flags & GS_DYNAMIC) != 0;
+	ib->indices = dup_array(indices, ib->width * num);
+
+	if (ib->dynamic)
+		ib->data = indices;
+	else
+		bfree(indices);
+
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *ib)
+{
+	if (!ib)
+		return;
+
+	if (ib->device->cur_index_buffer == ib)
+		ib->device->cur_index_buffer = NULL;
+
+	bfree(ib->indices);
+	bfree(ib->data);
+	bfree(ib);
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *ib)
+{
+	gs_indexbuffer_flush_direct(ib, ib->data);
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *ib, const void *data)
+{
+	if (!ib->dynamic) {
+		blog(LOG_ERROR, "gs_indexbuffer_flush (software): index buffer is not dynamic");
+		return;
+	}
+
+	memcpy(ib->indices, data, ib->width * ib->num);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *ib)
+{
+	return ib->data;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *ib)
+{
+	return ib->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *ib)
+{
+	return ib->type;
+}
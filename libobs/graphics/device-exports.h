@@ -128,6 +128,7 @@ EXPORT bool device_is_monitor_hdr(gs_device_t *device, void *monitor);
 EXPORT bool device_shared_texture_available(void);
 EXPORT bool device_nv12_available(gs_device_t *device);
 EXPORT bool device_p010_available(gs_device_t *device);
+EXPORT void device_set_shader_cache_path(gs_device_t *device, const char *path);
 
 #ifdef __APPLE__
 EXPORT gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device, void *iosurf);
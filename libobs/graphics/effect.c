@@ -250,6 +250,9 @@ void gs_technique_end_pass(gs_technique_t *tech)
 	if (!pass)
 		return;
 
+	/* quads queued during the pass are drawn with its state */
+	gs_batch_flush();
+
 	clear_tex_params(&pass->vertshader_params);
 	clear_tex_params(&pass->pixelshader_params);
 	tech->effect->cur_pass = NULL;
@@ -381,13 +384,17 @@ static inline void effect_setval_inline(gs_eparam_t *param, const void *data, si
 
 	size_changed = param->cur_val.num != size;
 
+	if (!size_changed && memcmp(param->cur_val.array, data, size) == 0)
+		return;
+
+	/* quads queued so far are drawn with the old value */
+	gs_batch_flush();
+
 	if (size_changed)
 		da_resize(param->cur_val, size);
 
-	if (size_changed || memcmp(param->cur_val.array, data, size) != 0) {
-		memcpy(param->cur_val.array, data, size);
-		param->changed = true;
-	}
+	memcpy(param->cur_val.array, data, size);
+	param->changed = true;
 }
 
 #ifndef min
@@ -198,6 +198,7 @@ struct gs_exports {
 
 	bool (*device_nv12_available)(gs_device_t *device);
 	bool (*device_p010_available)(gs_device_t *device);
+	void (*device_set_shader_cache_path)(gs_device_t *device, const char *path);
 	bool (*device_texture_create_nv12)(gs_device_t *device, gs_texture_t **tex_y, gs_texture_t **tex_uv,
 					   uint32_t width, uint32_t height, uint32_t flags);
 	bool (*device_texture_create_p010)(gs_device_t *device, gs_texture_t **tex_y, gs_texture_t **tex_uv,
@@ -291,6 +292,13 @@ struct graphics_subsystem {
 
 	gs_vertbuffer_t *sprite_buffer;
 
+	gs_vertbuffer_t *batch_buffer;
+	gs_texture_t *batch_texture;
+	size_t batch_count;
+
+	/* draw calls since gs_begin_frame */
+	uint32_t draw_count;
+
 	bool using_immediate;
 	struct gs_vb_data *vbd;
 	gs_vertbuffer_t *immediate_vertbuffer;
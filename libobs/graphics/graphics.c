@@ -68,6 +68,10 @@ static inline bool gs_valid(const char *f)
 
 #define IMMEDIATE_COUNT 512
 
+/* quads per batched draw, each drawn as two triangles */
+#define BATCH_QUADS 256
+#define BATCH_VERTS (BATCH_QUADS * 6)
+
 void gs_enum_adapters(bool (*callback)(void *param, const char *name, uint32_t id), void *param)
 {
 	graphics_t *graphics = thread_graphics;
@@ -136,6 +140,26 @@ static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
 	return true;
 }
 
+static bool graphics_init_batch_vb(struct graphics_subsystem *graphics)
+{
+	struct gs_vb_data *vbd;
+
+	vbd = gs_vbdata_create();
+	vbd->num = BATCH_VERTS;
+	vbd->points = bzalloc(sizeof(struct vec3) * BATCH_VERTS);
+	vbd->colors = bzalloc(sizeof(uint32_t) * BATCH_VERTS);
+	vbd->num_tex = 1;
+	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array = bzalloc(sizeof(struct vec2) * BATCH_VERTS);
+
+	graphics->batch_buffer = graphics->exports.device_vertexbuffer_create(graphics->device, vbd, GS_DYNAMIC);
+	if (!graphics->batch_buffer)
+		return false;
+
+	return true;
+}
+
 static bool graphics_init(struct graphics_subsystem *graphics)
 {
 	struct matrix4 top_mat;
@@ -149,6 +173,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (!graphics_init_sprite_vb(graphics))
 		return false;
+	if (!graphics_init_batch_vb(graphics))
+		return false;
 	if (pthread_mutex_init(&graphics->mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
@@ -228,6 +254,7 @@ void gs_destroy(graphics_t *graphics)
 		}
 
 		graphics->exports.gs_vertexbuffer_destroy(graphics->sprite_buffer);
+		graphics->exports.gs_vertexbuffer_destroy(graphics->batch_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
 
@@ -1040,6 +1067,137 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+/* the quad is transformed here so quads queued under different matrices can
+ * still be drawn together */
+static void batch_push_quad(graphics_t *graphics, const struct gs_vb_data *quad, uint32_t color)
+{
+	static const size_t order[6] = {0, 1, 2, 2, 1, 3};
+	struct gs_vb_data *data;
+	struct vec2 *tvarray;
+	struct matrix4 mat;
+	struct vec3 points[4];
+	size_t start;
+
+	if (graphics->batch_count == BATCH_QUADS)
+		gs_batch_flush();
+
+	gs_matrix_get(&mat);
+	for (size_t i = 0; i < 4; i++)
+		vec3_transform(&points[i], &quad->points[i], &mat);
+
+	/* ARGB, as with gs_effect_set_color, to the RGBA vertex layout */
+	color = (color & 0xFF00FF00) | ((color & 0xFF) << 16) | ((color >> 16) & 0xFF);
+
+	data = gs_vertexbuffer_get_data(graphics->batch_buffer);
+	tvarray = data->tvarray[0].array;
+	start = graphics->batch_count * 6;
+
+	for (size_t i = 0; i < 6; i++) {
+		vec3_copy(&data->points[start + i], &points[order[i]]);
+		vec2_copy(&tvarray[start + i], &((struct vec2 *)quad->tvarray[0].array)[order[i]]);
+		data->colors[start + i] = color;
+	}
+
+	graphics->batch_count++;
+}
+
+static inline void init_quad(struct gs_vb_data *quad, struct vec3 *points, struct gs_tvertarray *tv,
+			     struct vec2 *uvs)
+{
+	memset(quad, 0, sizeof(*quad));
+	quad->num = 4;
+	quad->points = points;
+	quad->num_tex = 1;
+	quad->tvarray = tv;
+	tv->width = 2;
+	tv->array = uvs;
+}
+
+void gs_batch_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_vb_data quad;
+	struct gs_tvertarray tv;
+	struct vec3 points[4];
+	struct vec2 uvs[4];
+	float fcx, fcy;
+
+	if (!gs_valid("gs_batch_sprite"))
+		return;
+
+	if (tex) {
+		if (gs_get_texture_type(tex) != GS_TEXTURE_2D) {
+			blog(LOG_ERROR, "A sprite must be a 2D texture");
+			return;
+		}
+	} else {
+		if (!width || !height) {
+			blog(LOG_ERROR, "A sprite cannot be drawn without "
+					"a width/height");
+			return;
+		}
+	}
+
+	/* the queued quads were sized for the previous texture */
+	if (graphics->batch_count && tex != graphics->batch_texture)
+		gs_batch_flush();
+	graphics->batch_texture = tex;
+
+	fcx = width ? (float)width : (float)gs_texture_get_width(tex);
+	fcy = height ? (float)height : (float)gs_texture_get_height(tex);
+
+	init_quad(&quad, points, &tv, uvs);
+	if (tex && gs_texture_is_rect(tex))
+		build_sprite_rect(&quad, tex, fcx, fcy, flip);
+	else
+		build_sprite_norm(&quad, fcx, fcy, flip);
+
+	batch_push_quad(graphics, &quad, 0xFFFFFFFF);
+}
+
+void gs_batch_quad(uint32_t width, uint32_t height, uint32_t color)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_vb_data quad;
+	struct gs_tvertarray tv;
+	struct vec3 points[4];
+	struct vec2 uvs[4];
+
+	if (!gs_valid("gs_batch_quad"))
+		return;
+
+	if (graphics->batch_count && graphics->batch_texture)
+		gs_batch_flush();
+	graphics->batch_texture = NULL;
+
+	init_quad(&quad, points, &tv, uvs);
+	build_sprite_norm(&quad, (float)width, (float)height, 0);
+	batch_push_quad(graphics, &quad, color);
+}
+
+void gs_batch_flush(void)
+{
+	graphics_t *graphics = thread_graphics;
+	size_t count;
+
+	if (!graphics || !graphics->batch_count)
+		return;
+
+	/* cleared first, drawing may change effect parameters */
+	count = graphics->batch_count;
+	graphics->batch_count = 0;
+
+	gs_vertexbuffer_flush(graphics->batch_buffer);
+	gs_load_vertexbuffer(graphics->batch_buffer);
+	gs_load_indexbuffer(NULL);
+
+	/* the vertices are already transformed */
+	gs_matrix_push();
+	gs_matrix_identity();
+	gs_draw(GS_TRIS, 0, (uint32_t)(count * 6));
+	gs_matrix_pop();
+}
+
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot, float left, float right, float top,
 			   float bottom, float znear)
 {
@@ -1786,6 +1944,7 @@ void gs_begin_frame(void)
 	if (!gs_valid("gs_begin_frame"))
 		return;
 
+	graphics->draw_count = 0;
 	graphics->exports.device_begin_frame(graphics->device);
 }
 
@@ -1806,9 +1965,20 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_vert
 	if (!gs_valid("gs_draw"))
 		return;
 
+	graphics->draw_count++;
 	graphics->exports.device_draw(graphics->device, draw_mode, start_vert, num_verts);
 }
 
+uint32_t gs_get_draw_count(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_get_draw_count"))
+		return 0;
+
+	return graphics->draw_count;
+}
+
 void gs_end_scene(void)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2712,6 +2882,17 @@ bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint, uint64_t *
 	return thread_graphics->exports.gs_timer_range_get_data(range, disjoint, frequency);
 }
 
+void gs_set_shader_cache_path(const char *path)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_set_shader_cache_path"))
+		return;
+
+	if (graphics->exports.device_set_shader_cache_path)
+		graphics->exports.device_set_shader_cache_path(graphics->device, path);
+}
+
 bool gs_nv12_available(void)
 {
 	if (!gs_valid("gs_nv12_available"))
@@ -499,6 +499,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL 1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_SOFTWARE 3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -580,6 +581,28 @@ EXPORT void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uin
 EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+/**
+ * Queues a 2D sprite (same parameters as gs_draw_sprite) to be drawn along
+ * with other queued quads in a single draw call.
+ *
+ *   Quads are transformed by the current matrix when queued and drawn by
+ * gs_batch_flush(), which is also called when the current technique pass
+ * ends, when an effect parameter changes, or when a sprite is queued for a
+ * different texture.  They are drawn with whatever effect, technique pass,
+ * textures and sampler are current at that point.
+ */
+EXPORT void gs_batch_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height);
+
+/**
+ * Queues an untextured quad with its own color (0xAARRGGBB, as with
+ * gs_effect_set_color), for use with techniques that use vertex colors such as
+ * the "SolidColored" technique of the solid effect.
+ */
+EXPORT void gs_batch_quad(uint32_t width, uint32_t height, uint32_t color);
+
+/** Draws all queued quads in a single draw call */
+EXPORT void gs_batch_flush(void);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot, float left, float right, float top,
 				  float bottom, float znear);
 
@@ -675,6 +698,8 @@ EXPORT void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src);
 EXPORT void gs_begin_frame(void);
 EXPORT void gs_begin_scene(void);
 EXPORT void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts);
+/** Returns the number of draw calls since the last gs_begin_frame() */
+EXPORT uint32_t gs_get_draw_count(void);
 EXPORT void gs_end_scene(void);
 
 #define GS_CLEAR_COLOR (1 << 0)
@@ -777,6 +802,10 @@ EXPORT void gs_timer_range_begin(gs_timer_range_t *range);
 EXPORT void gs_timer_range_end(gs_timer_range_t *range);
 EXPORT bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint, uint64_t *frequency);
 
+/** Sets the directory compiled shaders may be cached in, NULL disables the
+ * cache.  Only affects shaders created afterwards. */
+EXPORT void gs_set_shader_cache_path(const char *path);
+
 EXPORT bool gs_nv12_available(void);
 EXPORT bool gs_p010_available(void);
 EXPORT bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv, uint32_t width, uint32_t height,
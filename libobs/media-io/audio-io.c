@@ -76,6 +76,7 @@ struct audio_output {
 	audio_input_callback_t input_cb;
 	void *input_param;
 	pthread_mutex_t input_mutex;
+	bool extra_tick;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
 };
 
@@ -190,6 +191,7 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time, ui
 	}
 
 	/* get new audio data */
+	audio->extra_tick = false;
 	success = audio->input_cb(audio->input_param, prev_time, audio_time, &new_ts, active_mixes, data);
 	if (!success)
 		return;
@@ -228,7 +230,11 @@ static void *audio_thread(void *param)
 
 		profile_start(audio_thread_name);
 
-		input_and_output(audio, audio_time, prev_time);
+		/* the input callback may ask for a tick that's already buffered
+		 * to be output right away */
+		do {
+			input_and_output(audio, audio_time, prev_time);
+		} while (audio->extra_tick);
 		prev_time = audio_time;
 
 		profile_end(audio_thread_name);
@@ -414,6 +420,12 @@ void audio_output_close(audio_t *audio)
 	bfree(audio);
 }
 
+void audio_output_request_extra_tick(audio_t *audio)
+{
+	if (audio)
+		audio->extra_tick = true;
+}
+
 const struct audio_output_info *audio_output_get_info(const audio_t *audio)
 {
 	return audio ? &audio->info : NULL;
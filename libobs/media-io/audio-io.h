@@ -223,6 +223,11 @@ EXPORT size_t audio_output_get_channels(const audio_t *audio);
 EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(const audio_t *audio);
 
+/* Only valid from within the input callback.  Calls the input callback once
+ * more right after the current tick has been output, with the same start and
+ * end times, instead of waiting for the next tick. */
+EXPORT void audio_output_request_extra_tick(audio_t *audio);
+
 #ifdef __cplusplus
 }
 #endif
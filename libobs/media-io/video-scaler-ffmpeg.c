@@ -16,18 +16,35 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/platform.h"
 #include "video-scaler.h"
 
+#include <libavutil/frame.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswscale/swscale.h>
 
+/* sws_scale always runs on a single thread, slice threading is only used
+ * through the frame API that was added along with the threads option */
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define USE_SWS_THREADS
+#endif
+
+/* smaller frames aren't worth the synchronization */
+#define THREADED_MIN_PIXELS (1280 * 720)
+#define MAX_THREADS 4
+
 struct video_scaler {
 	struct SwsContext *swscale;
 	int src_height;
 	int dst_heights[4];
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+
+#ifdef USE_SWS_THREADS
+	AVFrame *src_frame;
+	AVFrame *dst_frame;
+#endif
 };
 
 static inline enum AVPixelFormat get_ffmpeg_video_format(enum video_format format)
@@ -140,6 +157,53 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 
 #define FIXED_1_0 (1 << 16)
 
+#ifdef USE_SWS_THREADS
+static int get_thread_count(const struct video_scale_info *dst, const struct video_scale_info *src)
+{
+	uint64_t src_pixels = (uint64_t)src->width * src->height;
+	uint64_t dst_pixels = (uint64_t)dst->width * dst->height;
+	int threads = os_get_logical_cores();
+
+	if (src_pixels < THREADED_MIN_PIXELS && dst_pixels < THREADED_MIN_PIXELS)
+		return 1;
+
+	return threads > MAX_THREADS ? MAX_THREADS : (threads < 1 ? 1 : threads);
+}
+
+static bool alloc_frames(struct video_scaler *scaler, const struct video_scale_info *dst,
+			 const struct video_scale_info *src, enum AVPixelFormat format_dst,
+			 enum AVPixelFormat format_src)
+{
+	int ret;
+
+	scaler->src_frame = av_frame_alloc();
+	scaler->dst_frame = av_frame_alloc();
+	if (!scaler->src_frame || !scaler->dst_frame)
+		return false;
+
+	scaler->src_frame->width = src->width;
+	scaler->src_frame->height = src->height;
+	scaler->src_frame->format = format_src;
+
+	scaler->dst_frame->width = dst->width;
+	scaler->dst_frame->height = dst->height;
+	scaler->dst_frame->format = format_dst;
+
+	ret = av_frame_get_buffer(scaler->dst_frame, 32);
+	if (ret < 0) {
+		blog(LOG_WARNING, "video_scaler_create: av_frame_get_buffer failed: %d", ret);
+		return false;
+	}
+
+	for (size_t i = 0; i < 4; i++) {
+		scaler->dst_pointers[i] = scaler->dst_frame->data[i];
+		scaler->dst_linesizes[i] = scaler->dst_frame->linesize[i];
+	}
+
+	return true;
+}
+#endif
+
 int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_info *dst,
 			const struct video_scale_info *src, enum video_scale_type type)
 {
@@ -175,11 +239,16 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 		}
 	}
 
+#ifdef USE_SWS_THREADS
+	if (!alloc_frames(scaler, dst, src, format_dst, format_src))
+		goto fail;
+#else
 	ret = av_image_alloc(scaler->dst_pointers, scaler->dst_linesizes, dst->width, dst->height, format_dst, 32);
 	if (ret < 0) {
 		blog(LOG_WARNING, "video_scaler_create: av_image_alloc failed: %d", ret);
 		goto fail;
 	}
+#endif
 
 	scaler->swscale = sws_alloc_context();
 	if (!scaler->swscale) {
@@ -197,6 +266,9 @@ int video_scaler_create(video_scaler_t **scaler_out, const struct video_scale_in
 	av_opt_set_int(scaler->swscale, "dst_format", format_dst, 0);
 	av_opt_set_int(scaler->swscale, "src_range", range_src, 0);
 	av_opt_set_int(scaler->swscale, "dst_range", range_dst, 0);
+#ifdef USE_SWS_THREADS
+	av_opt_set_int(scaler->swscale, "threads", get_thread_count(dst, src), 0);
+#endif
 	if (sws_init_context(scaler->swscale, NULL, NULL) < 0) {
 		blog(LOG_ERROR, "video_scaler_create: sws_init_context failed");
 		goto fail;
@@ -222,21 +294,56 @@ void video_scaler_destroy(video_scaler_t *scaler)
 	if (scaler) {
 		sws_freeContext(scaler->swscale);
 
+#ifdef USE_SWS_THREADS
+		av_frame_free(&scaler->src_frame);
+		av_frame_free(&scaler->dst_frame);
+#else
 		if (scaler->dst_pointers[0])
 			av_freep(scaler->dst_pointers);
+#endif
 
 		bfree(scaler);
 	}
 }
 
+#ifdef USE_SWS_THREADS
+static void no_free(void *opaque, uint8_t *data)
+{
+	UNUSED_PARAMETER(opaque);
+	UNUSED_PARAMETER(data);
+}
+#endif
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[], const uint32_t out_linesize[],
 			const uint8_t *const input[], const uint32_t in_linesize[])
 {
 	if (!scaler)
 		return false;
 
+#ifdef USE_SWS_THREADS
+	AVFrame *src_frame = scaler->src_frame;
+
+	/* the frame API references the source, so wrap the input in a
+	 * buffer that doesn't own it */
+	src_frame->buf[0] = av_buffer_create((uint8_t *)input[0], 1, no_free, NULL, 0);
+	if (!src_frame->buf[0])
+		return false;
+
+	for (size_t plane = 0; plane < 4; ++plane) {
+		src_frame->data[plane] = (uint8_t *)input[plane];
+		src_frame->linesize[plane] = (int)in_linesize[plane];
+	}
+
+	int ret = sws_scale_frame(scaler->swscale, scaler->dst_frame, src_frame);
+	av_buffer_unref(&src_frame->buf[0]);
+
+	/* returns 0 on success rather than the output height */
+	if (ret == 0)
+		ret = scaler->dst_heights[0];
+#else
 	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0, scaler->src_height,
 			    scaler->dst_pointers, scaler->dst_linesizes);
+#endif
 	if (ret <= 0) {
 		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d", ret);
 		return false;
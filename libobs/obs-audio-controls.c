@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/sse-intrin.h"
 
 #include "util/threading.h"
+#include "util/platform.h"
 #include "util/bmem.h"
 #include "media-io/audio-math.h"
 #include "obs.h"
@@ -61,6 +62,15 @@ struct meter_cb {
 	void *param;
 };
 
+struct volmeter_levels {
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+};
+
+/* the audio thread falls this far behind only when it is not running */
+#define VOLMETER_MAX_PENDING_FRAMES (AUDIO_OUTPUT_FRAMES * 8)
+
 struct obs_volmeter {
 	pthread_mutex_t mutex;
 	obs_source_t *source;
@@ -72,10 +82,24 @@ struct obs_volmeter {
 
 	enum obs_peak_meter_type peak_meter_type;
 	unsigned int update_ms;
-	float prev_samples[MAX_AUDIO_CHANNELS][4];
 
-	float magnitude[MAX_AUDIO_CHANNELS];
+	/* samples captured from the source, waiting for the audio thread */
+	struct deque pending[MAX_AUDIO_CHANNELS];
+	int pending_channels;
+	bool pending_muted;
+
+	/* only used by the audio thread */
+	float prev_samples[MAX_AUDIO_CHANNELS][4];
 	float peak[MAX_AUDIO_CHANNELS];
+	float sum_squares[MAX_AUDIO_CHANNELS];
+	size_t frames;
+	int nr_channels;
+	uint64_t last_update_ts;
+
+	/* published levels, levels_seq is odd while they are being written
+	 * and 0 until they are written for the first time */
+	struct volmeter_levels levels;
+	volatile long levels_seq;
 };
 
 static float cubic_def_to_db(const float def)
@@ -305,6 +329,15 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
 		r = fmaxf(r, x4_mem[3]);   \
 	} while (false)
 
+/* x4(d, c, b, a)  -->  a + b + c + d
+ */
+#define hadd_ps(r, x4)                                                  \
+	do {                                                            \
+		float x4_mem[4];                                        \
+		_mm_storeu_ps(x4_mem, x4);                              \
+		r = (x4_mem[0] + x4_mem[1]) + (x4_mem[2] + x4_mem[3]);  \
+	} while (false)
+
 /* Calculate the true peak over a set of samples.
  * The algorithm implements 5x oversampling by using Whittaker-Shannon
  * interpolation over four samples.
@@ -312,12 +345,15 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
  * The four samples have location t=-1.5, -0.5, +0.5, +1.5
  * The oversamples are taken at locations t=-0.3, -0.1, +0.1, +0.3
  *
+ * The sum of squares for the magnitude is gathered in the same pass.
+ *
  * @param previous_samples  Last 4 samples from the previous iteration.
  * @param samples           The samples to find the peak in.
- * @param nr_samples        Number of sets of 4 samples.
+ * @param nr_samples        Number of samples, a multiple of 4.
+ * @param sum_squares       Receives the sum of the squared samples.
  * @returns 5 times oversampled true-peak from the set of samples.
  */
-static float get_true_peak(__m128 previous_samples, const float *samples, size_t nr_samples)
+static float get_true_peak(__m128 previous_samples, const float *samples, size_t nr_samples, float *sum_squares)
 {
 	/* These are normalized-sinc parameters for interpolating over sample
 	 * points which are located at x-coords: -1.5, -0.5, +0.5, +1.5.
@@ -329,10 +365,13 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 
 	__m128 work = previous_samples;
 	__m128 peak = previous_samples;
+	__m128 sum = _mm_setzero_ps();
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
 		__m128 new_work = _mm_load_ps(&samples[i]);
 		__m128 intrp_samples;
 
+		sum = _mm_add_ps(sum, _mm_mul_ps(new_work, new_work));
+
 		/* Include the actual sample values in the peak. */
 		__m128 abs_new_work = abs_ps(new_work);
 		peak = _mm_max_ps(peak, abs_new_work);
@@ -357,165 +396,171 @@ static float get_true_peak(__m128 previous_samples, const float *samples, size_t
 
 	float r;
 	hmax_ps(r, peak);
+	hadd_ps(*sum_squares, sum);
 	return r;
 }
 
 /* points contain the first four samples to calculate the sinc interpolation
  * over. They will have come from a previous iteration.
  */
-static float get_sample_peak(__m128 previous_samples, const float *samples, size_t nr_samples)
+static float get_sample_peak(__m128 previous_samples, const float *samples, size_t nr_samples, float *sum_squares)
 {
 	__m128 peak = previous_samples;
+	__m128 sum = _mm_setzero_ps();
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
 		__m128 new_work = _mm_load_ps(&samples[i]);
+		sum = _mm_add_ps(sum, _mm_mul_ps(new_work, new_work));
 		peak = _mm_max_ps(peak, abs_ps(new_work));
 	}
 
 	float r;
 	hmax_ps(r, peak);
+	hadd_ps(*sum_squares, sum);
 	return r;
 }
 
-static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter, int channel_nr, float *samples,
-					       size_t nr_samples)
+static void volmeter_source_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
 {
-	/* Take the last 4 samples that need to be used for the next peak
-	 * calculation. If there are less than 4 samples in total the new
-	 * samples shift out the old samples. */
+	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	size_t size = data->frames * sizeof(float);
 
-	switch (nr_samples) {
-	case 0:
-		break;
-	case 1:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][1];
-		volmeter->prev_samples[channel_nr][1] = volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][2] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
-		break;
-	case 2:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][1] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
-		break;
-	case 3:
-		volmeter->prev_samples[channel_nr][0] = volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
-		break;
-	default:
-		volmeter->prev_samples[channel_nr][0] = samples[nr_samples - 4];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+	UNUSED_PARAMETER(source);
+
+	/* Only queue the samples here, the levels of all meters are
+	 * calculated together on the audio thread. */
+	pthread_mutex_lock(&volmeter->mutex);
+
+	if (nr_channels != volmeter->pending_channels) {
+		for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
+			deque_free(&volmeter->pending[i]);
+		volmeter->pending_channels = nr_channels;
 	}
-}
 
-static void volmeter_process_peak(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
-{
-	int nr_samples = data->frames;
 	int channel_nr = 0;
 	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
-		if (!samples) {
-			continue;
-		}
-		if (((uintptr_t)samples & 0xf) > 0) {
-			printf("Audio plane %i is not aligned %p skipping "
-			       "peak volume measurement.\n",
-			       plane_nr, samples);
-			volmeter->peak[channel_nr] = 1.0;
-			channel_nr++;
+		struct deque *pending = &volmeter->pending[channel_nr];
+		if (!data->data[plane_nr])
 			continue;
-		}
-
-		/* volmeter->prev_samples may not be aligned to 16 bytes;
-		 * use unaligned load. */
-		__m128 previous_samples = _mm_loadu_ps(volmeter->prev_samples[channel_nr]);
-
-		float peak;
-		switch (volmeter->peak_meter_type) {
-		case TRUE_PEAK_METER:
-			peak = get_true_peak(previous_samples, samples, nr_samples);
-			break;
-
-		case SAMPLE_PEAK_METER:
-		default:
-			peak = get_sample_peak(previous_samples, samples, nr_samples);
-			break;
-		}
-
-		volmeter_process_peak_last_samples(volmeter, channel_nr, samples, nr_samples);
-
-		volmeter->peak[channel_nr] = peak;
 
+		if ((pending->size + size) / sizeof(float) > VOLMETER_MAX_PENDING_FRAMES)
+			deque_pop_front(pending, NULL, pending->size);
+		deque_push_back(pending, data->data[plane_nr], size);
 		channel_nr++;
 	}
 
-	/* Clear the peak of the channels that have not been handled. */
-	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		volmeter->peak[channel_nr] = 0.0;
-	}
+	volmeter->pending_muted = muted;
+
+	pthread_mutex_unlock(&volmeter->mutex);
 }
 
-static void volmeter_process_magnitude(obs_volmeter_t *volmeter, const struct audio_data *data, int nr_channels)
+static void volmeter_publish(struct obs_volmeter *volmeter, uint64_t ts)
 {
-	size_t nr_samples = data->frames;
+	struct volmeter_levels levels;
+	float mul;
 
-	int channel_nr = 0;
-	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
-		if (!samples) {
-			continue;
-		}
+	pthread_mutex_lock(&volmeter->mutex);
+	// Adjust magnitude/peak based on the volume level set by the user.
+	mul = volmeter->pending_muted && volmeter->source && !obs_source_muted(volmeter->source)
+		      ? 0.0f
+		      : db_to_mul(volmeter->cur_db);
+	pthread_mutex_unlock(&volmeter->mutex);
+
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
+		float magnitude = 0.0f;
+		float peak = 0.0f;
 
-		float sum = 0.0;
-		for (size_t i = 0; i < nr_samples; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
+		if (channel_nr < volmeter->nr_channels) {
+			magnitude = sqrtf(volmeter->sum_squares[channel_nr] / (float)volmeter->frames);
+			peak = volmeter->peak[channel_nr];
 		}
-		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
 
-		channel_nr++;
+		levels.magnitude[channel_nr] = mul_to_db(magnitude * mul);
+		levels.peak[channel_nr] = mul_to_db(peak * mul);
+
+		/* The input-peak is NOT adjusted with volume, so that the user
+		 * can check the input-gain. */
+		levels.input_peak[channel_nr] = mul_to_db(peak);
+
+		volmeter->peak[channel_nr] = 0.0f;
+		volmeter->sum_squares[channel_nr] = 0.0f;
 	}
-}
 
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter, const struct audio_data *data)
-{
-	int nr_channels = get_nr_channels_from_audio_data(data);
+	volmeter->frames = 0;
+	volmeter->last_update_ts = ts;
+
+	os_atomic_inc_long(&volmeter->levels_seq);
+	volmeter->levels = levels;
+	os_atomic_inc_long(&volmeter->levels_seq);
 
-	volmeter_process_peak(volmeter, data, nr_channels);
-	volmeter_process_magnitude(volmeter, data, nr_channels);
+	signal_levels_updated(volmeter, levels.magnitude, levels.peak, levels.input_peak);
 }
 
-static void volmeter_source_data_received(void *vptr, obs_source_t *source, const struct audio_data *data, bool muted)
+static void volmeter_process(struct obs_volmeter *volmeter, uint64_t ts)
 {
-	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
-	float mul;
-	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
-	float input_peak[MAX_AUDIO_CHANNELS];
+	struct obs_core_data *data = &obs->data;
+	enum obs_peak_meter_type peak_meter_type;
+	size_t frames = 0;
+	int nr_channels;
+	float *buf;
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	volmeter_process_audio_data(volmeter, data);
+	nr_channels = volmeter->pending_channels;
+	peak_meter_type = volmeter->peak_meter_type;
 
-	// Adjust magnitude/peak based on the volume level set by the user.
-	// And convert to dB.
-	mul = muted && !obs_source_muted(source) ? 0.0f : db_to_mul(volmeter->cur_db);
-	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		magnitude[channel_nr] = mul_to_db(volmeter->magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr] * mul);
+	/* leave any samples that don't fill a vector for the next pass */
+	if (nr_channels)
+		frames = (volmeter->pending[0].size / sizeof(float)) & ~(size_t)3;
+	if (frames * nr_channels > data->volmeter_buf.num)
+		da_resize(data->volmeter_buf, frames * nr_channels);
 
-		/* The input-peak is NOT adjusted with volume, so that the user
-		 * can check the input-gain. */
-		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
-	}
+	buf = data->volmeter_buf.array;
+	for (int channel_nr = 0; channel_nr < nr_channels; channel_nr++)
+		deque_pop_front(&volmeter->pending[channel_nr], buf + channel_nr * frames, frames * sizeof(float));
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
-	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+	if (nr_channels != volmeter->nr_channels) {
+		memset(volmeter->prev_samples, 0, sizeof(volmeter->prev_samples));
+		volmeter->nr_channels = nr_channels;
+	}
+
+	if (frames) {
+		for (int channel_nr = 0; channel_nr < nr_channels; channel_nr++) {
+			const float *samples = buf + channel_nr * frames;
+			__m128 previous_samples = _mm_loadu_ps(volmeter->prev_samples[channel_nr]);
+			float sum_squares;
+			float peak;
+
+			if (peak_meter_type == TRUE_PEAK_METER)
+				peak = get_true_peak(previous_samples, samples, frames, &sum_squares);
+			else
+				peak = get_sample_peak(previous_samples, samples, frames, &sum_squares);
+
+			memcpy(volmeter->prev_samples[channel_nr], samples + frames - 4, sizeof(float) * 4);
+			volmeter->peak[channel_nr] = fmaxf(volmeter->peak[channel_nr], peak);
+			volmeter->sum_squares[channel_nr] += sum_squares;
+		}
+
+		volmeter->frames += frames;
+	}
+
+	if (volmeter->frames && ts - volmeter->last_update_ts >= (uint64_t)volmeter->update_ms * 1000000ULL)
+		volmeter_publish(volmeter, ts);
+}
+
+void obs_volmeters_process(void)
+{
+	struct obs_core_data *data = &obs->data;
+	uint64_t ts = os_gettime_ns();
+
+	pthread_mutex_lock(&data->volmeters_mutex);
+
+	for (size_t i = 0; i < data->volmeters.num; i++)
+		volmeter_process(data->volmeters.array[i], ts);
+
+	pthread_mutex_unlock(&data->volmeters_mutex);
 }
 
 obs_fader_t *obs_fader_create(enum obs_fader_type type)
@@ -756,6 +801,8 @@ void obs_volmeter_destroy(obs_volmeter_t *volmeter)
 
 	obs_volmeter_detach_source(volmeter);
 	da_free(volmeter->callbacks);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		deque_free(&volmeter->pending[i]);
 	pthread_mutex_destroy(&volmeter->callback_mutex);
 	pthread_mutex_destroy(&volmeter->mutex);
 
@@ -785,6 +832,10 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
+	pthread_mutex_lock(&obs->data.volmeters_mutex);
+	da_push_back(obs->data.volmeters, &volmeter);
+	pthread_mutex_unlock(&obs->data.volmeters_mutex);
+
 	return true;
 }
 
@@ -796,6 +847,11 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 	if (!volmeter)
 		return;
 
+	/* also waits for the audio thread to finish with the meter */
+	pthread_mutex_lock(&obs->data.volmeters_mutex);
+	da_erase_item(obs->data.volmeters, &volmeter);
+	pthread_mutex_unlock(&obs->data.volmeters_mutex);
+
 	pthread_mutex_lock(&volmeter->mutex);
 	source = volmeter->source;
 	volmeter->source = NULL;
@@ -817,6 +873,45 @@ void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter, enum obs_peak_me
 	pthread_mutex_unlock(&volmeter->mutex);
 }
 
+void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter, unsigned int ms)
+{
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_set_update_interval"))
+		return;
+
+	volmeter->update_ms = ms;
+}
+
+bool obs_volmeter_get_levels(obs_volmeter_t *volmeter, float magnitude[MAX_AUDIO_CHANNELS],
+			     float peak[MAX_AUDIO_CHANNELS], float input_peak[MAX_AUDIO_CHANNELS])
+{
+	struct volmeter_levels levels;
+	long seq;
+
+	if (!obs_ptr_valid(volmeter, "obs_volmeter_get_levels"))
+		return false;
+
+	/* The audio thread never waits for readers, so retry if it published
+	 * new levels while they were being copied.  The compare and swap only
+	 * checks that the sequence is unchanged, but unlike a plain load it
+	 * keeps the copy from being reordered past the check. */
+	for (;;) {
+		seq = os_atomic_load_long(&volmeter->levels_seq);
+		if (seq < 2)
+			return false;
+		if (seq & 1)
+			continue;
+
+		levels = volmeter->levels;
+		if (os_atomic_compare_swap_long(&volmeter->levels_seq, seq, seq))
+			break;
+	}
+
+	memcpy(magnitude, levels.magnitude, sizeof(levels.magnitude));
+	memcpy(peak, levels.peak, sizeof(levels.peak));
+	memcpy(input_peak, levels.input_peak, sizeof(levels.input_peak));
+	return true;
+}
+
 int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter)
 {
 	int source_nr_audio_channels;
@@ -225,6 +225,28 @@ EXPORT void obs_volmeter_detach_source(obs_volmeter_t *volmeter);
  */
 EXPORT void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter, enum obs_peak_meter_type peak_meter_type);
 
+/**
+ * @brief Set how often the volume meter publishes new levels
+ * @param volmeter pointer to the volume meter object
+ * @param ms minimum time between updates in milliseconds, 0 to update on
+ *           every audio tick (the default)
+ *
+ * The levels of all volume meters are calculated together on the audio
+ * thread. Peaks and magnitudes are accumulated until the interval has passed,
+ * then published to obs_volmeter_get_levels and the level callbacks.
+ */
+EXPORT void obs_volmeter_set_update_interval(obs_volmeter_t *volmeter, unsigned int ms);
+
+/**
+ * @brief Get the most recently published levels without waiting for a callback
+ * @param volmeter pointer to the volume meter object
+ * @return false if no levels have been published yet
+ *
+ * This never blocks the audio thread, so it is safe to poll from a UI timer.
+ */
+EXPORT bool obs_volmeter_get_levels(obs_volmeter_t *volmeter, float magnitude[MAX_AUDIO_CHANNELS],
+				    float peak[MAX_AUDIO_CHANNELS], float input_peak[MAX_AUDIO_CHANNELS]);
+
 /**
  * @brief Get the number of channels which are configured for this source.
  * @param volmeter pointer to the volume meter object
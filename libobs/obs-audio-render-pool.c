@@ -0,0 +1,107 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+
+#include "util/platform.h"
+#include "obs-audio-render-pool.h"
+
+static void render_items(struct audio_render_pool *pool)
+{
+	long i;
+
+	while ((i = os_atomic_inc_long(&pool->next) - 1) < (long)pool->count)
+		pool->render(pool->param, (size_t)i);
+}
+
+static void *audio_render_thread(void *param)
+{
+	struct audio_render_pool *pool = param;
+
+	os_set_thread_name("audio: render worker");
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (os_atomic_load_bool(&pool->exit))
+			break;
+
+		render_items(pool);
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+bool audio_render_pool_init(struct audio_render_pool *pool, size_t threads)
+{
+	memset(pool, 0, sizeof(*pool));
+
+	if (!threads)
+		return true;
+
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		return false;
+	if (os_sem_init(&pool->done_sem, 0) != 0) {
+		os_sem_destroy(pool->start_sem);
+		pool->start_sem = NULL;
+		return false;
+	}
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, audio_render_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	return true;
+}
+
+void audio_render_pool_free(struct audio_render_pool *pool)
+{
+	os_atomic_set_bool(&pool->exit, true);
+
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	os_sem_destroy(pool->start_sem);
+	os_sem_destroy(pool->done_sem);
+	da_free(pool->threads);
+}
+
+void audio_render_pool_run(struct audio_render_pool *pool, size_t count, size_t min_parallel,
+			   audio_render_func_t render, void *param)
+{
+	size_t workers = pool->threads.num;
+
+	pool->count = count;
+	pool->render = render;
+	pool->param = param;
+	os_atomic_set_long(&pool->next, 0);
+
+	if (count < min_parallel || count < 2)
+		workers = 0;
+	else if (workers > count - 1)
+		workers = count - 1;
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_post(pool->start_sem);
+
+	render_items(pool);
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_wait(pool->done_sem);
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/darray.h"
+#include "util/threading.h"
+
+/*
+ * Worker threads used by the audio thread to render leaf sources.
+ *
+ * audio_render_pool_run() calls the render function once for every index
+ * below count, on the worker threads and on the calling thread, and returns
+ * once all calls have finished.  Indices are handed out through an atomic
+ * counter, so the order of the calls is undefined.  Only one thread may run
+ * work on a pool at a time.
+ */
+
+typedef void (*audio_render_func_t)(void *param, size_t idx);
+
+struct audio_render_pool {
+	DARRAY(pthread_t) threads;
+	os_sem_t *start_sem;
+	os_sem_t *done_sem;
+	volatile long next;
+	volatile bool exit;
+
+	size_t count;
+	audio_render_func_t render;
+	void *param;
+};
+
+extern bool audio_render_pool_init(struct audio_render_pool *pool, size_t threads);
+extern void audio_render_pool_free(struct audio_render_pool *pool);
+
+static inline size_t audio_render_pool_threads(const struct audio_render_pool *pool)
+{
+	return pool->threads.num;
+}
+
+/* below min_parallel calls everything runs on the calling thread */
+extern void audio_render_pool_run(struct audio_render_pool *pool, size_t count, size_t min_parallel,
+				  audio_render_func_t render, void *param);
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "util/platform.h"
 
 struct ts_info {
 	uint64_t start;
@@ -27,6 +28,8 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 
+static const char *render_audio_sources_name = "render_audio_sources";
+
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
@@ -344,6 +347,8 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
 
+	audio->buffering_changed_ts = 0;
+
 	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
 
@@ -379,6 +384,114 @@ static void add_audio_buffering(struct obs_core_audio *audio, size_t sample_rate
 	*ts = new_ts;
 }
 
+/* ------------------------------------------------------------------------- */
+/* adaptive buffering */
+
+/* how long sources have to keep enough audio queued before a tick of
+ * buffering is removed */
+#define ADAPTIVE_STABLE_NS 5000000000ULL
+
+static inline void reset_audio_headroom(struct obs_core_audio *audio, uint64_t ts)
+{
+	audio->buffering_changed_ts = ts;
+	audio->min_headroom_frames = SIZE_MAX;
+	audio->max_jitter = 0;
+}
+
+/* called with the source's audio_buf_mutex held, after its audio for the
+ * tick has been discarded */
+static void update_audio_headroom(struct obs_core_audio *audio, obs_source_t *source, size_t sample_rate,
+				  const struct ts_info *ts, uint64_t now)
+{
+	size_t frames = source->audio_input_buf[0].size / sizeof(float);
+
+	if (source->info.audio_render || source->audio_pending || !source->audio_ts)
+		return;
+
+	/* sources that haven't sent audio for a while don't hold anything up */
+	if (!frames && now - source->audio_jitter_sys_ts > MAX_TS_VAR)
+		return;
+
+	if (source->audio_ts > ts->end)
+		frames += convert_time_to_frames(sample_rate, source->audio_ts - ts->end);
+	else if (source->audio_ts + 1 < ts->end)
+		frames = 0;
+
+	if (frames < audio->min_headroom_frames)
+		audio->min_headroom_frames = frames;
+	if (source->audio_jitter > audio->max_jitter)
+		audio->max_jitter = source->audio_jitter;
+}
+
+/* buffering can shrink by a tick when every source has had at least one more
+ * tick of audio queued than it needed (plus room for its jitter) for the
+ * whole stable period */
+static bool audio_buffering_can_shrink(struct obs_core_audio *audio, size_t sample_rate, uint64_t ts)
+{
+	size_t needed;
+
+	if (!os_atomic_load_bool(&audio->adaptive_buffer) || audio->fixed_buffer) {
+		audio->buffering_changed_ts = 0;
+		return false;
+	}
+
+	if (!audio->total_buffering_ticks || audio->buffering_wait_ticks)
+		return false;
+
+	if (!audio->buffering_changed_ts) {
+		reset_audio_headroom(audio, ts);
+		return false;
+	}
+
+	if (ts - audio->buffering_changed_ts < ADAPTIVE_STABLE_NS)
+		return false;
+
+	needed = AUDIO_OUTPUT_FRAMES + 2 * convert_time_to_frames(sample_rate, audio->max_jitter);
+	if (audio->min_headroom_frames < needed) {
+		reset_audio_headroom(audio, ts);
+		return false;
+	}
+
+	return true;
+}
+
+/* Drops a tick of buffering by having the next buffered tick output right
+ * after this one instead of waiting for its time.  Both ticks keep their own
+ * timestamps, so the output timeline stays continuous and nothing is lost. */
+static void shrink_audio_buffering(struct obs_core_audio *audio, size_t sample_rate, uint64_t ts)
+{
+	int total_ms;
+
+	if (!audio->buffered_timestamps.size)
+		return;
+
+	audio->total_buffering_ticks--;
+	audio->catching_up = true;
+	audio_output_request_extra_tick(audio->audio);
+
+	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 / (int)sample_rate;
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering is now %d milliseconds",
+	     (int)(AUDIO_OUTPUT_FRAMES * 1000 / sample_rate), total_ms);
+
+	reset_audio_headroom(audio, ts);
+}
+
+uint64_t obs_get_audio_buffering_latency(void)
+{
+	struct obs_core_audio *audio;
+
+	if (!obs || !obs->audio.audio)
+		return 0;
+
+	audio = &obs->audio;
+	return audio_frames_to_ns(audio_output_get_sample_rate(audio->audio),
+				  (uint64_t)audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES);
+}
+
+/* ------------------------------------------------------------------------- */
+
 static bool audio_buffer_insufficient(struct obs_source *source, size_t sample_rate, uint64_t min_ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
@@ -465,22 +578,101 @@ static inline void execute_audio_tasks(void)
 	}
 }
 
-bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
-		    struct audio_output_data *mixes)
+/* ------------------------------------------------------------------------- */
+/* parallel rendering of leaf sources                                        */
+
+#define MAX_AUDIO_RENDER_THREADS 3
+/* below this many leaves waking the workers costs more than it saves */
+#define MIN_PARALLEL_AUDIO_LEAVES 4
+
+static inline bool is_audio_leaf(const obs_source_t *source)
+{
+	/* sources that mix other sources (scenes, transitions) or produce
+	 * audio from a plugin callback are rendered on the audio thread */
+	return !source->info.audio_render && !source->info.audio_mix;
+}
+
+static void render_leaf(void *param, size_t idx)
+{
+	struct obs_core_audio *audio = param;
+	obs_source_t *source = audio->render_leaves.array[idx];
+
+	obs_source_audio_render(source, audio->render_mixers, audio->render_channels, audio->render_sample_rate,
+				audio->render_size);
+}
+
+bool audio_render_threads_init(struct obs_core_audio *audio)
+{
+	int threads = os_get_logical_cores() - 1;
+	if (threads > MAX_AUDIO_RENDER_THREADS)
+		threads = MAX_AUDIO_RENDER_THREADS;
+
+	audio->render_parallel = true;
+	return audio_render_pool_init(&audio->render_pool, threads > 0 ? (size_t)threads : 0);
+}
+
+void audio_render_threads_free(struct obs_core_audio *audio)
+{
+	audio_render_pool_free(&audio->render_pool);
+	da_free(audio->render_leaves);
+}
+
+/* Renders every leaf source in the render order on the worker threads and
+ * the calling thread. Leaves don't read any other source's buffers, so the
+ * order they are rendered in does not change the result. */
+static void render_audio_leaves(struct obs_core_audio *audio, uint32_t mixers, size_t channels, size_t sample_rate,
+				size_t size)
+{
+	da_resize(audio->render_leaves, 0);
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (is_audio_leaf(source))
+			da_push_back(audio->render_leaves, &source);
+	}
+
+	audio->render_mixers = mixers;
+	audio->render_channels = channels;
+	audio->render_sample_rate = sample_rate;
+	audio->render_size = size;
+
+	audio_render_pool_run(&audio->render_pool, audio->render_leaves.num, MIN_PARALLEL_AUDIO_LEAVES, render_leaf,
+			      audio);
+}
+
+void obs_set_parallel_audio_rendering(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->audio.render_parallel, enable);
+}
+
+void obs_set_audio_adaptive_buffering(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->audio.adaptive_buffer, enable);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* renders, mixes and discards the oldest buffered tick */
+static bool audio_tick(struct obs_core_audio *audio, uint32_t mixers, struct audio_output_data *mixes,
+		       uint64_t *out_ts)
 {
 	struct obs_core_data *data = &obs->data;
-	struct obs_core_audio *audio = &obs->audio;
 	struct obs_source *source;
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
-	struct ts_info ts = {start_ts_in, end_ts_in};
+	struct ts_info ts;
 	size_t audio_size;
 	uint64_t min_ts;
+	uint64_t now = os_gettime_ns();
 
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
 
-	deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
 	deque_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -531,9 +723,18 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 
 	/* ------------------------------------------------ */
 	/* render audio data */
+	profile_start(render_audio_sources_name);
+
+	bool parallel = os_atomic_load_bool(&audio->render_parallel) && audio_render_pool_threads(&audio->render_pool);
+	if (parallel)
+		render_audio_leaves(audio, mixers, channels, sample_rate, audio_size);
+
+	/* render_order has children before their parents, so scenes and
+	 * transitions see the final audio of everything they mix */
 	for (size_t i = 0; i < audio->render_order.num; i++) {
 		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
+		if (!parallel || !is_audio_leaf(source))
+			obs_source_audio_render(source, mixers, channels, sample_rate, audio_size);
 
 		/* if a source has gone backward in time and we can no
 		 * longer buffer, drop some or all of its audio */
@@ -562,6 +763,12 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 		}
 	}
 
+	profile_end(render_audio_sources_name);
+
+	/* ------------------------------------------------ */
+	/* update volume meters */
+	obs_volmeters_process();
+
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
 	pthread_mutex_lock(&data->audio_sources_mutex);
@@ -604,6 +811,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
+		if (os_atomic_load_bool(&audio->adaptive_buffer))
+			update_audio_headroom(audio, source, sample_rate, &ts, now);
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source *)source->next_audio_source;
@@ -625,6 +834,27 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint6
 	}
 
 	execute_audio_tasks();
+	return true;
+}
+
+bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
+		    struct audio_output_data *mixes)
+{
+	struct obs_core_audio *audio = &obs->audio;
+	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
+	struct ts_info ts = {start_ts_in, end_ts_in};
+
+	/* the extra tick after a shrink is already buffered */
+	if (audio->catching_up)
+		audio->catching_up = false;
+	else
+		deque_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+
+	if (!audio_tick(audio, mixers, mixes, out_ts))
+		return false;
+
+	if (audio_buffering_can_shrink(audio, sample_rate, *out_ts))
+		shrink_audio_buffering(audio, sample_rate, *out_ts);
 
 	UNUSED_PARAMETER(param);
 	return true;
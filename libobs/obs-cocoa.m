@@ -686,6 +686,11 @@ bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *platform, obs_key_t
     return platform->is_key_down[key];
 }
 
+bool obs_hotkeys_platform_wait(obs_hotkeys_platform_t *platform __unused, int timeout_ms __unused)
+{
+    return false;
+}
+
 static void unichar_to_utf8(const UniChar *character, char *buffer)
 {
     CFStringRef string = CFStringCreateWithCharactersNoCopy(NULL, character, 2, kCFAllocatorNull);
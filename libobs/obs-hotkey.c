@@ -1154,17 +1154,38 @@ static inline void query_hotkeys()
 
 #define NBSP "\xC2\xA0"
 
+/* with event driven input the thread only wakes up this often without any
+ * input, to check whether it should stop */
+#define HOTKEY_WAIT_MS 100
+
 void *obs_hotkey_thread(void *arg)
 {
 	UNUSED_PARAMETER(arg);
 
 	os_set_thread_name("libobs: hotkey thread");
 
-	const char *hotkey_thread_name =
-		profile_store_name(obs_get_profiler_name_store(), "obs_hotkey_thread(%g" NBSP "ms)", 25.);
-	profile_register_root(hotkey_thread_name, (uint64_t)25000000);
+	/* a zero timeout only picks up input that is already pending */
+	obs_hotkeys_platform_t *platform = obs->hotkeys.platform_context;
+	bool event_driven = obs_hotkeys_platform_wait(platform, 0);
+
+	profiler_name_store_t *store = obs_get_profiler_name_store();
+	const char *hotkey_thread_name;
+	if (event_driven)
+		hotkey_thread_name = profile_store_name(store, "obs_hotkey_thread(events)");
+	else
+		hotkey_thread_name = profile_store_name(store, "obs_hotkey_thread(%g" NBSP "ms)", 25.);
+	profile_register_root(hotkey_thread_name, event_driven ? 0 : (uint64_t)25000000);
+
+	for (;;) {
+		if (event_driven) {
+			if (os_event_try(obs->hotkeys.stop_event) != EAGAIN)
+				break;
+			obs_hotkeys_platform_wait(platform, HOTKEY_WAIT_MS);
+
+		} else if (os_event_timedwait(obs->hotkeys.stop_event, 25) != ETIMEDOUT) {
+			break;
+		}
 
-	while (os_event_timedwait(obs->hotkeys.stop_event, 25) == ETIMEDOUT) {
 		if (!lock())
 			continue;
 
@@ -38,6 +38,7 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-audio-render-pool.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -47,6 +48,12 @@
 #define HASH_ADD_UUID(head, uuid_field, add) HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
 #define NUM_TEXTURES 2
+/* Number of stage surfaces used for raw frame readback. A frame is mapped
+ * NUM_READBACK_TEXTURES - 1 frames after it was staged, so a deeper ring gives
+ * the GPU more time to finish the copy before the CPU waits on it. */
+#ifndef NUM_READBACK_TEXTURES
+#define NUM_READBACK_TEXTURES 3
+#endif
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
@@ -187,6 +194,9 @@ struct obs_core_hotkeys;
 bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys);
 void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys);
 bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context, obs_key_t key);
+/* waits up to timeout_ms for input and updates the key state, returns false
+ * if the platform can only be polled */
+bool obs_hotkeys_platform_wait(obs_hotkeys_platform_t *context, int timeout_ms);
 
 const char *obs_get_hotkey_translation(obs_key_t key, const char *def);
 
@@ -266,25 +276,37 @@ struct obs_task_info {
 struct obs_core_video_mix {
 	struct obs_view *view;
 
-	gs_stagesurf_t *active_copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *active_copy_surfaces[NUM_READBACK_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[NUM_READBACK_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	gs_texture_t *convert_textures_encode[NUM_CHANNELS];
 #ifdef _WIN32
-	gs_stagesurf_t *copy_surfaces_encode[NUM_TEXTURES];
+	gs_stagesurf_t *copy_surfaces_encode[NUM_READBACK_TEXTURES];
 #endif
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool textures_copied[NUM_READBACK_TEXTURES];
 	bool texture_converted;
 	bool using_nv12_tex;
 	bool using_p010_tex;
 	struct deque vframe_info_buffer;
 	struct deque vframe_info_buffer_gpu;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	gs_stagesurf_t *mapped_surfaces[NUM_READBACK_TEXTURES][NUM_CHANNELS];
 	int cur_texture;
+
+	/* mapped frames are copied to the video output on a separate thread,
+	 * readback_pending and readback_queue are protected by readback_mutex */
+	bool readback_pending[NUM_READBACK_TEXTURES];
+	pthread_mutex_t readback_mutex;
+	struct deque readback_queue;
+	os_sem_t *readback_semaphore;
+	os_event_t *readback_done;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
+
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
 	bool gpu_was_active;
@@ -313,6 +335,9 @@ struct obs_core_video_mix {
 
 	bool encoder_only_mix;
 	long encoder_refs;
+
+	/* updated by the graphics thread with mixes_mutex held */
+	struct obs_video_pacing_stats pacing_stats;
 };
 
 extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
@@ -341,8 +366,15 @@ struct obs_core_video {
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
+	volatile long frame_draw_calls;
 	bool thread_initialized;
 
+	/* frame pacing settings, read by the graphics thread every frame */
+	volatile long pacing_spin_us;
+	volatile long pacing_absorb_us;
+	volatile bool pacing_realtime;
+	volatile bool pacing_timerfd;
+
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -385,6 +417,14 @@ struct obs_core_audio {
 	int max_buffering_ticks;
 	bool fixed_buffer;
 
+	/* adaptive buffering: smallest amount of audio any source had queued
+	 * past the current tick since buffering last changed */
+	volatile bool adaptive_buffer;
+	bool catching_up;
+	uint64_t buffering_changed_ts;
+	size_t min_headroom_frames;
+	uint64_t max_jitter;
+
 	pthread_mutex_t monitoring_mutex;
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
@@ -392,6 +432,15 @@ struct obs_core_audio {
 
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
+
+	/* sources without child sources are rendered in parallel */
+	DARRAY(struct obs_source *) render_leaves;
+	struct audio_render_pool render_pool;
+	volatile bool render_parallel;
+	uint32_t render_mixers;
+	size_t render_channels;
+	size_t render_sample_rate;
+	size_t render_size;
 };
 
 /* user sources, output channels, and displays */
@@ -428,6 +477,11 @@ struct obs_core_data {
 
 	DARRAY(char *) protocols;
 	DARRAY(obs_source_t *) sources_to_tick;
+
+	/* attached volume meters, processed together on the audio thread */
+	pthread_mutex_t volmeters_mutex;
+	DARRAY(struct obs_volmeter *) volmeters;
+	DARRAY(float) volmeter_buf;
 };
 
 /* user hotkeys */
@@ -485,6 +539,7 @@ struct obs_core {
 
 	char *locale;
 	char *module_config_path;
+	char *shader_cache_path;
 	bool name_store_owned;
 	profiler_name_store_t *name_store;
 
@@ -502,6 +557,27 @@ struct obs_core {
 
 extern struct obs_core *obs;
 
+/* frame pacing state of the graphics thread */
+struct obs_video_pacing {
+	uint64_t spin_ns;
+#ifdef __linux__
+	bool realtime;
+	bool timerfd;
+	int timer_fd;
+	int old_policy;
+	struct sched_param old_param;
+#endif
+};
+
+extern void video_pacing_init(struct obs_video_pacing *pacing);
+extern void video_pacing_free(struct obs_video_pacing *pacing);
+
+/* sleeps until the deadline, returns false without sleeping if it already
+ * passed, otherwise how late the thread woke up is stored in jitter_ns */
+extern bool video_pacing_sleepto(struct obs_video_pacing *pacing, uint64_t deadline, uint64_t *jitter_ns);
+extern void video_pacing_record(struct obs_video_pacing_stats *stats, bool slept, uint64_t jitter_ns, int count,
+				bool absorbed);
+
 struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
@@ -509,6 +585,7 @@ struct obs_graphics_context {
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
 	const char *video_thread_name;
+	struct obs_video_pacing pacing;
 };
 
 extern void *obs_graphics_thread(void *param);
@@ -522,6 +599,9 @@ extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
 extern bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts, uint32_t mixers,
 			   struct audio_output_data *mixes);
+extern void obs_volmeters_process(void);
+extern bool audio_render_threads_init(struct obs_core_audio *audio);
+extern void audio_render_threads_free(struct obs_core_audio *audio);
 
 extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 
@@ -639,8 +719,13 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+	/* format changed while in use, freed once it is no longer used */
+	bool stale;
 };
 
+/* must be a power of two */
+#define ASYNC_RING_SIZE 64
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -751,6 +836,9 @@ struct obs_source {
 	struct obs_source *next_audio_source;
 	struct obs_source **prev_next_audio_source;
 	uint64_t audio_ts;
+	uint64_t audio_jitter;
+	uint64_t audio_jitter_ts;
+	uint64_t audio_jitter_sys_ts;
 	struct deque audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
 	DARRAY(struct audio_action) audio_actions;
@@ -794,8 +882,18 @@ struct obs_source {
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
-	DARRAY(struct obs_source_frame *) async_frames;
+	pthread_mutex_t async_cache_mutex;
 	pthread_mutex_t async_mutex;
+
+	/* frames waiting to be shown.  written by the thread outputting video
+	 * (serialized by async_cache_mutex), read by the graphics thread
+	 * (serialized by async_mutex) without locking each other out */
+	struct obs_source_frame *async_ring[ASYNC_RING_SIZE];
+	volatile long async_ring_head;
+	volatile long async_ring_tail;
+	volatile long async_frames_late;
+	volatile long async_frames_dropped;
+	volatile long async_frames_duplicated;
 	uint32_t async_width;
 	uint32_t async_height;
 	uint32_t async_cache_width;
@@ -872,6 +970,14 @@ struct obs_source {
 	/* color space */
 	gs_texrender_t *color_space_texrender;
 
+	/* shared per-frame render, see obs_source_video_render_cached */
+	gs_texrender_t *render_cache;
+	uint32_t render_cache_idle;
+	uint32_t render_cache_uses;
+	uint32_t render_cache_prev_uses;
+	bool render_cache_checked;
+	bool render_cache_direct;
+
 	/* audio monitoring */
 	struct audio_monitor *monitor;
 	enum obs_monitoring_type monitoring_type;
@@ -927,6 +1033,25 @@ static inline void obs_source_dosignal(struct obs_source *source, const char *si
 /* maximum timestamp variance in nanoseconds */
 #define MAX_TS_VAR 2000000000ULL
 
+static inline size_t async_frames_num(const obs_source_t *source)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&source->async_ring_head);
+	return (size_t)(head - (unsigned long)source->async_ring_tail);
+}
+
+static inline struct obs_source_frame *async_frame_peek(const obs_source_t *source, size_t idx)
+{
+	return source->async_ring[((unsigned long)source->async_ring_tail + idx) & (ASYNC_RING_SIZE - 1)];
+}
+
+/* call with async_mutex held */
+static inline struct obs_source_frame *async_frame_pop(obs_source_t *source)
+{
+	struct obs_source_frame *frame = async_frame_peek(source, 0);
+	os_atomic_set_long(&source->async_ring_tail, (long)((unsigned long)source->async_ring_tail + 1));
+	return frame;
+}
+
 static inline bool frame_out_of_bounds(const obs_source_t *source, uint64_t ts)
 {
 	if (ts < source->last_frame_ts)
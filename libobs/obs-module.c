@@ -92,16 +92,17 @@ static inline char *get_module_name(const char *file)
 
 #ifdef _WIN32
 extern void reset_win32_symbol_paths(void);
+
+static pthread_mutex_t dlopen_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
-int obs_open_module(obs_module_t **module, const char *path, const char *data_path)
+/* opens the module without adding it to the module list, so that modules can
+ * be opened from multiple threads at once */
+static int open_module(obs_module_t **module, const char *path, const char *data_path)
 {
 	struct obs_module mod = {0};
 	int errorcode;
 
-	if (!module || !path || !obs)
-		return MODULE_ERROR;
-
 #ifdef __APPLE__
 	/* HACK: Do not load obsolete obs-browser build on macOS; the
 	 * obs-browser plugin used to live in the Application Support
@@ -114,7 +115,14 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 
 	blog(LOG_DEBUG, "---------------------------------");
 
+#ifdef _WIN32
+	/* os_dlopen changes the process-wide DLL search directory */
+	pthread_mutex_lock(&dlopen_mutex);
+#endif
 	mod.module = os_dlopen(path);
+#ifdef _WIN32
+	pthread_mutex_unlock(&dlopen_mutex);
+#endif
 	if (!mod.module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FILE_NOT_FOUND;
@@ -129,14 +137,12 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 	mod.file = (!mod.file) ? mod.bin_path : (mod.file + 1);
 	mod.mod_name = get_module_name(mod.file);
 	mod.data_path = bstrdup(data_path);
-	mod.next = obs->first_module;
 
 	if (mod.file) {
 		blog(LOG_DEBUG, "Loading module: %s", mod.file);
 	}
 
 	*module = bmemdup(&mod, sizeof(mod));
-	obs->first_module = (*module);
 	mod.set_pointer(*module);
 
 	if (mod.set_locale)
@@ -145,6 +151,26 @@ int obs_open_module(obs_module_t **module, const char *path, const char *data_pa
 	return MODULE_SUCCESS;
 }
 
+static inline void link_module(obs_module_t *module)
+{
+	module->next = obs->first_module;
+	obs->first_module = module;
+}
+
+int obs_open_module(obs_module_t **module, const char *path, const char *data_path)
+{
+	int errorcode;
+
+	if (!module || !path || !obs)
+		return MODULE_ERROR;
+
+	errorcode = open_module(module, path, data_path);
+	if (errorcode == MODULE_SUCCESS)
+		link_module(*module);
+
+	return errorcode;
+}
+
 bool obs_init_module(obs_module_t *module)
 {
 	if (!module || !obs)
@@ -296,14 +322,43 @@ static bool is_safe_module(const char *name)
 	return false;
 }
 
-static void load_all_callback(void *param, const struct obs_module_info2 *info)
-{
-	struct fail_info *fail_info = param;
+/*
+ * Modules are loaded in two phases.  Opening a module (loading the library,
+ * resolving its exports and loading its locale files) doesn't touch any
+ * shared state, so the modules found are opened on several threads at once.
+ * obs_module_load then runs for each module on the calling thread, in the
+ * order the modules were found, since most modules register their types in
+ * it without expecting to race with other modules.
+ */
+
+#define MAX_OPEN_THREADS 8
+
+struct module_job {
+	char *bin_path;
+	char *data_path;
+	char *name;
+	bool can_load;
+
 	obs_module_t *module;
+	int code;
+	uint64_t open_ns;
+};
+
+struct module_jobs {
+	DARRAY(struct module_job) jobs;
+	volatile long next;
+};
+
+static void find_all_callback(void *param, const struct obs_module_info2 *info)
+{
+	struct module_jobs *mj = param;
+	struct module_job *job;
 
 	bool is_obs_plugin;
 	bool can_load_obs_plugin;
 
+	/* not thread safe everywhere (forks on linux), so this is checked
+	 * before any of the opening threads are started */
 	get_plugin_info(info->bin_path, &is_obs_plugin, &can_load_obs_plugin);
 
 	if (!is_obs_plugin) {
@@ -316,44 +371,150 @@ static void load_all_callback(void *param, const struct obs_module_info2 *info)
 		return;
 	}
 
-	if (!can_load_obs_plugin) {
+	job = da_push_back_new(mj->jobs);
+	job->bin_path = bstrdup(info->bin_path);
+	job->data_path = bstrdup(info->data_path);
+	job->name = bstrdup(info->name);
+	job->can_load = can_load_obs_plugin;
+	job->code = MODULE_ERROR;
+}
+
+/* runs on the opening threads, which have no profiler root, so modules are
+ * only timed here and the profiler entry is kept by the calling thread */
+static void open_module_jobs(struct module_jobs *mj)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&mj->next) - 1) < (long)mj->jobs.num) {
+		struct module_job *job = mj->jobs.array + idx;
+		if (!job->can_load)
+			continue;
+
+		uint64_t start = os_gettime_ns();
+		job->code = open_module(&job->module, job->bin_path, job->data_path);
+		job->open_ns = os_gettime_ns() - start;
+	}
+}
+
+static void *open_modules_thread(void *param)
+{
+	os_set_thread_name("libobs: module loader");
+	open_module_jobs(param);
+	return NULL;
+}
+
+static size_t open_all_modules(struct module_jobs *mj)
+{
+	pthread_t threads[MAX_OPEN_THREADS];
+	size_t num_threads = 0;
+	size_t max_threads = (size_t)os_get_logical_cores();
+
+	if (max_threads > MAX_OPEN_THREADS)
+		max_threads = MAX_OPEN_THREADS;
+	if (max_threads > mj->jobs.num)
+		max_threads = mj->jobs.num;
+
+	/* the calling thread takes part too */
+	for (size_t i = 1; i < max_threads; i++) {
+		if (pthread_create(&threads[num_threads], NULL, open_modules_thread, mj) != 0)
+			break;
+		num_threads++;
+	}
+
+	open_module_jobs(mj);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	return num_threads + 1;
+}
+
+static uint64_t init_module_job(struct module_job *job, struct fail_info *fail_info)
+{
+	uint64_t start, init_ns;
+	bool loaded;
+
+	if (!job->can_load) {
 		blog(LOG_WARNING,
 		     "Skipping module '%s' due to possible "
 		     "import conflicts",
-		     info->bin_path);
+		     job->bin_path);
 		goto load_failure;
 	}
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
-	switch (code) {
+	switch (job->code) {
 	case MODULE_MISSING_EXPORTS:
-		blog(LOG_DEBUG, "Failed to load module file '%s', not an OBS plugin", info->bin_path);
-		return;
+		blog(LOG_DEBUG, "Failed to load module file '%s', not an OBS plugin", job->bin_path);
+		return 0;
 	case MODULE_FILE_NOT_FOUND:
-		blog(LOG_DEBUG, "Failed to load module file '%s', file not found", info->bin_path);
-		return;
+		blog(LOG_DEBUG, "Failed to load module file '%s', file not found", job->bin_path);
+		return 0;
 	case MODULE_ERROR:
-		blog(LOG_DEBUG, "Failed to load module file '%s'", info->bin_path);
+		blog(LOG_DEBUG, "Failed to load module file '%s'", job->bin_path);
 		goto load_failure;
 	case MODULE_INCOMPATIBLE_VER:
-		blog(LOG_DEBUG, "Failed to load module file '%s', incompatible version", info->bin_path);
+		blog(LOG_DEBUG, "Failed to load module file '%s', incompatible version", job->bin_path);
 		goto load_failure;
 	case MODULE_HARDCODED_SKIP:
-		return;
+		return 0;
 	}
 
-	if (!obs_init_module(module))
-		free_module(module);
+	link_module(job->module);
 
-	UNUSED_PARAMETER(param);
-	return;
+	start = os_gettime_ns();
+	loaded = obs_init_module(job->module);
+	init_ns = os_gettime_ns() - start;
+
+	blog(LOG_DEBUG, "Module '%s': opened in %.1f ms, initialized in %.1f ms", job->name,
+	     (double)job->open_ns / 1000000.0, (double)init_ns / 1000000.0);
+
+	if (!loaded)
+		free_module(job->module);
+	return init_ns;
 
 load_failure:
 	if (fail_info) {
-		dstr_cat(&fail_info->fail_modules, info->name);
+		dstr_cat(&fail_info->fail_modules, job->name);
 		dstr_cat(&fail_info->fail_modules, ";");
 		fail_info->fail_count++;
 	}
+	return 0;
+}
+
+static const char *obs_open_modules_name = "obs_open_modules";
+
+static void load_all_modules(struct fail_info *fail_info)
+{
+	struct module_jobs mj = {0};
+	uint64_t open_ns = 0;
+	uint64_t init_ns = 0;
+	uint64_t start;
+	size_t num_threads;
+
+	obs_find_modules2(find_all_callback, &mj);
+	if (!mj.jobs.num)
+		return;
+
+	profile_start(obs_open_modules_name);
+	start = os_gettime_ns();
+	num_threads = open_all_modules(&mj);
+	open_ns = os_gettime_ns() - start;
+	profile_end(obs_open_modules_name);
+
+	for (size_t i = 0; i < mj.jobs.num; i++) {
+		struct module_job *job = mj.jobs.array + i;
+
+		init_ns += init_module_job(job, fail_info);
+
+		bfree(job->bin_path);
+		bfree(job->data_path);
+		bfree(job->name);
+	}
+
+	blog(LOG_INFO, "Loaded %zu module files: opened in %.1f ms on %zu threads, initialized in %.1f ms",
+	     mj.jobs.num, (double)open_ns / 1000000.0, num_threads, (double)init_ns / 1000000.0);
+
+	da_free(mj.jobs);
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
@@ -364,7 +525,7 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 void obs_load_all_modules(void)
 {
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules2(load_all_callback, NULL);
+	load_all_modules(NULL);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -381,7 +542,7 @@ void obs_load_all_modules2(struct obs_module_failure_info *mfi)
 	memset(mfi, 0, sizeof(*mfi));
 
 	profile_start(obs_load_all_modules2_name);
-	obs_find_modules2(load_all_callback, &fail_info);
+	load_all_modules(&fail_info);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -21,6 +21,7 @@
 #include "obs-nix-platform.h"
 #include "obs-nix-x11.h"
 
+#include <poll.h>
 #include <xcb/xcb.h>
 #if defined(XCB_XINPUT_FOUND)
 #include <xcb/xinput.h>
@@ -93,9 +94,15 @@ struct obs_hotkeys_platform {
 	int syms_per_code;
 
 #if defined(XCB_XINPUT_FOUND)
-	bool pressed[XINPUT_MOUSE_LEN];
-	bool update[XINPUT_MOUSE_LEN];
+	/* with XInput2 raw events the key and button state is tracked here
+	 * rather than queried from the server for every binding.  the latched
+	 * state holds presses since the last wait, so that a press and release
+	 * arriving together are still seen as a press. */
+	bool xi2;
+	uint8_t keys[32];
+	uint8_t keys_latched[32];
 	bool button_pressed[XINPUT_MOUSE_LEN];
+	bool button_latched[XINPUT_MOUSE_LEN];
 #endif
 };
 
@@ -820,12 +827,51 @@ static inline xcb_window_t root_window(obs_hotkeys_platform_t *context, xcb_conn
 	return 0;
 }
 
+static inline bool keycode_pressed(const uint8_t *keys, xcb_keycode_t code)
+{
+	return (keys[code / 8] & (1 << (code % 8))) != 0;
+}
+
 #if defined(XCB_XINPUT_FOUND)
-static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
+static inline void set_keycode(uint8_t *keys, xcb_keycode_t code, bool pressed)
+{
+	if (pressed)
+		keys[code / 8] |= (uint8_t)(1 << (code % 8));
+	else
+		keys[code / 8] &= (uint8_t) ~(1 << (code % 8));
+}
+
+/* XI 2.0 only sends raw events to the client that has grabbed the device,
+ * 2.1 and later send them to every client that selected them on the root
+ * window, whether or not another client has a grab */
+static bool query_xi2_version(xcb_connection_t *connection)
+{
+	xcb_input_xi_query_version_cookie_t cookie;
+	xcb_input_xi_query_version_reply_t *reply;
+	xcb_generic_error_t *error = NULL;
+	bool success;
+
+	cookie = xcb_input_xi_query_version(connection, 2, 2);
+	reply = xcb_input_xi_query_version_reply(connection, cookie, &error);
+	success = !error && reply &&
+		  (reply->major_version > 2 || (reply->major_version == 2 && reply->minor_version >= 1));
+
+	free(reply);
+	free(error);
+	return success;
+}
+
+static inline void registerInputEvents(struct obs_core_hotkeys *hotkeys)
 {
 	obs_hotkeys_platform_t *context = hotkeys->platform_context;
 	xcb_connection_t *connection = XGetXCBConnection(context->display);
 	xcb_window_t window = root_window(context, connection);
+	xcb_query_keymap_reply_t *reply;
+
+	if (!query_xi2_version(connection)) {
+		blog(LOG_INFO, "XInput 2.1 not available, polling for hotkeys");
+		return;
+	}
 
 	struct {
 		xcb_input_event_mask_t head;
@@ -833,10 +879,89 @@ static inline void registerMouseEvents(struct obs_core_hotkeys *hotkeys)
 	} mask;
 	mask.head.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
 	mask.head.mask_len = sizeof(mask.mask) / sizeof(uint32_t);
-	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE;
+	mask.mask = XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_BUTTON_RELEASE |
+		    XCB_INPUT_XI_EVENT_MASK_RAW_KEY_PRESS | XCB_INPUT_XI_EVENT_MASK_RAW_KEY_RELEASE;
 
 	xcb_input_xi_select_events(connection, window, 1, &mask.head);
-	xcb_flush(connection);
+
+	/* start from the current state, events only carry changes */
+	reply = xcb_query_keymap_reply(connection, xcb_query_keymap(connection), NULL);
+	if (reply)
+		memcpy(context->keys, reply->keys, sizeof(context->keys));
+	free(reply);
+
+	context->xi2 = true;
+}
+
+static void handle_raw_event(obs_hotkeys_platform_t *context, xcb_ge_event_t *ev)
+{
+	switch (ev->event_type) {
+	case XCB_INPUT_RAW_BUTTON_PRESS: {
+		xcb_input_raw_button_press_event_t *mot;
+		mot = (xcb_input_raw_button_press_event_t *)ev;
+		if (mot->detail > 0 && mot->detail < XINPUT_MOUSE_LEN) {
+			context->button_pressed[mot->detail - 1] = true;
+			context->button_latched[mot->detail - 1] = true;
+		} else {
+			blog(LOG_WARNING, "Unsupported button");
+		}
+		break;
+	}
+	case XCB_INPUT_RAW_BUTTON_RELEASE: {
+		xcb_input_raw_button_release_event_t *mot;
+		mot = (xcb_input_raw_button_release_event_t *)ev;
+		if (mot->detail > 0 && mot->detail < XINPUT_MOUSE_LEN)
+			context->button_pressed[mot->detail - 1] = false;
+		else
+			blog(LOG_WARNING, "Unsupported button");
+		break;
+	}
+	case XCB_INPUT_RAW_KEY_PRESS: {
+		xcb_input_raw_key_press_event_t *key;
+		key = (xcb_input_raw_key_press_event_t *)ev;
+		set_keycode(context->keys, (xcb_keycode_t)key->detail, true);
+		set_keycode(context->keys_latched, (xcb_keycode_t)key->detail, true);
+		break;
+	}
+	case XCB_INPUT_RAW_KEY_RELEASE: {
+		xcb_input_raw_key_release_event_t *key;
+		key = (xcb_input_raw_key_release_event_t *)ev;
+		set_keycode(context->keys, (xcb_keycode_t)key->detail, false);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static bool obs_nix_x11_hotkeys_platform_wait(obs_hotkeys_platform_t *context, int timeout_ms)
+{
+	xcb_connection_t *connection = XGetXCBConnection(context->display);
+	xcb_generic_event_t *ev;
+
+	if (!context->xi2)
+		return false;
+
+	memset(context->keys_latched, 0, sizeof(context->keys_latched));
+	memset(context->button_latched, 0, sizeof(context->button_latched));
+
+	ev = xcb_poll_for_queued_event(connection);
+	if (!ev && timeout_ms > 0) {
+		struct pollfd pfd = {.fd = xcb_get_file_descriptor(connection), .events = POLLIN};
+		poll(&pfd, 1, timeout_ms);
+	}
+
+	if (!ev)
+		ev = xcb_poll_for_event(connection);
+
+	while (ev) {
+		if ((ev->response_type & ~0x80) == XCB_GE_GENERIC)
+			handle_raw_event(context, (xcb_ge_event_t *)ev);
+		free(ev);
+		ev = xcb_poll_for_event(connection);
+	}
+
+	return true;
 }
 #endif
 
@@ -851,7 +976,7 @@ static bool obs_nix_x11_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
 	hotkeys->platform_context->display = display;
 
 #if defined(XCB_XINPUT_FOUND)
-	registerMouseEvents(hotkeys);
+	registerInputEvents(hotkeys);
 #endif
 	fill_base_keysyms(hotkeys);
 	fill_keycodes(hotkeys);
@@ -879,138 +1004,29 @@ static bool mouse_button_pressed(xcb_connection_t *connection, obs_hotkeys_platf
 	bool ret = false;
 
 #if defined(XCB_XINPUT_FOUND)
-	memset(context->pressed, 0, XINPUT_MOUSE_LEN);
-	memset(context->update, 0, XINPUT_MOUSE_LEN);
+	if (context->xi2) {
+		size_t idx;
 
-	xcb_generic_event_t *ev;
-	while ((ev = xcb_poll_for_event(connection))) {
-		if ((ev->response_type & ~80) == XCB_GE_GENERIC) {
-			switch (((xcb_ge_event_t *)ev)->event_type) {
-			case XCB_INPUT_RAW_BUTTON_PRESS: {
-				xcb_input_raw_button_press_event_t *mot;
-				mot = (xcb_input_raw_button_press_event_t *)ev;
-				if (mot->detail < XINPUT_MOUSE_LEN) {
-					context->pressed[mot->detail - 1] = true;
-					context->update[mot->detail - 1] = true;
-				} else {
-					blog(LOG_WARNING, "Unsupported button");
-				}
-				break;
-			}
-			case XCB_INPUT_RAW_BUTTON_RELEASE: {
-				xcb_input_raw_button_release_event_t *mot;
-				mot = (xcb_input_raw_button_release_event_t *)ev;
-				if (mot->detail < XINPUT_MOUSE_LEN)
-					context->update[mot->detail - 1] = true;
-				else
-					blog(LOG_WARNING, "Unsupported button");
-				break;
-			}
-			default:
-				break;
-			}
+		// Mouse 2 for OBS is Right Click and Mouse 3 is Wheel Click.
+		// Mouse Wheel axis clicks (xinput mot->detail 4 5 6 7) are ignored.
+		switch (key) {
+		case OBS_KEY_MOUSE1:
+			idx = 0;
+			break;
+		case OBS_KEY_MOUSE2:
+			idx = 2;
+			break;
+		case OBS_KEY_MOUSE3:
+			idx = 1;
+			break;
+		default:
+			idx = (size_t)(key - OBS_KEY_MOUSE1) + 4;
 		}
-		free(ev);
-	}
 
-	// Mouse 2 for OBS is Right Click and Mouse 3 is Wheel Click.
-	// Mouse Wheel axis clicks (xinput mot->detail 4 5 6 7) are ignored.
-	switch (key) {
-	case OBS_KEY_MOUSE1:
-		ret = context->pressed[0] || context->button_pressed[0];
-		break;
-	case OBS_KEY_MOUSE2:
-		ret = context->pressed[2] || context->button_pressed[2];
-		break;
-	case OBS_KEY_MOUSE3:
-		ret = context->pressed[1] || context->button_pressed[1];
-		break;
-	case OBS_KEY_MOUSE4:
-		ret = context->pressed[7] || context->button_pressed[7];
-		break;
-	case OBS_KEY_MOUSE5:
-		ret = context->pressed[8] || context->button_pressed[8];
-		break;
-	case OBS_KEY_MOUSE6:
-		ret = context->pressed[9] || context->button_pressed[9];
-		break;
-	case OBS_KEY_MOUSE7:
-		ret = context->pressed[10] || context->button_pressed[10];
-		break;
-	case OBS_KEY_MOUSE8:
-		ret = context->pressed[11] || context->button_pressed[11];
-		break;
-	case OBS_KEY_MOUSE9:
-		ret = context->pressed[12] || context->button_pressed[12];
-		break;
-	case OBS_KEY_MOUSE10:
-		ret = context->pressed[13] || context->button_pressed[13];
-		break;
-	case OBS_KEY_MOUSE11:
-		ret = context->pressed[14] || context->button_pressed[14];
-		break;
-	case OBS_KEY_MOUSE12:
-		ret = context->pressed[15] || context->button_pressed[15];
-		break;
-	case OBS_KEY_MOUSE13:
-		ret = context->pressed[16] || context->button_pressed[16];
-		break;
-	case OBS_KEY_MOUSE14:
-		ret = context->pressed[17] || context->button_pressed[17];
-		break;
-	case OBS_KEY_MOUSE15:
-		ret = context->pressed[18] || context->button_pressed[18];
-		break;
-	case OBS_KEY_MOUSE16:
-		ret = context->pressed[19] || context->button_pressed[19];
-		break;
-	case OBS_KEY_MOUSE17:
-		ret = context->pressed[20] || context->button_pressed[20];
-		break;
-	case OBS_KEY_MOUSE18:
-		ret = context->pressed[21] || context->button_pressed[21];
-		break;
-	case OBS_KEY_MOUSE19:
-		ret = context->pressed[22] || context->button_pressed[22];
-		break;
-	case OBS_KEY_MOUSE20:
-		ret = context->pressed[23] || context->button_pressed[23];
-		break;
-	case OBS_KEY_MOUSE21:
-		ret = context->pressed[24] || context->button_pressed[24];
-		break;
-	case OBS_KEY_MOUSE22:
-		ret = context->pressed[25] || context->button_pressed[25];
-		break;
-	case OBS_KEY_MOUSE23:
-		ret = context->pressed[26] || context->button_pressed[26];
-		break;
-	case OBS_KEY_MOUSE24:
-		ret = context->pressed[27] || context->button_pressed[27];
-		break;
-	case OBS_KEY_MOUSE25:
-		ret = context->pressed[28] || context->button_pressed[28];
-		break;
-	case OBS_KEY_MOUSE26:
-		ret = context->pressed[29] || context->button_pressed[29];
-		break;
-	case OBS_KEY_MOUSE27:
-		ret = context->pressed[30] || context->button_pressed[30];
-		break;
-	case OBS_KEY_MOUSE28:
-		ret = context->pressed[31] || context->button_pressed[31];
-		break;
-	case OBS_KEY_MOUSE29:
-		ret = context->pressed[32] || context->button_pressed[32];
-		break;
-	default:
-		break;
+		return context->button_pressed[idx] || context->button_latched[idx];
 	}
+#endif
 
-	for (int i = 0; i != XINPUT_MOUSE_LEN; i++)
-		if (context->update[i])
-			context->button_pressed[i] = context->pressed[i];
-#else
 	xcb_generic_error_t *error = NULL;
 	xcb_query_pointer_cookie_t qpc;
 	xcb_query_pointer_reply_t *reply;
@@ -1039,38 +1055,41 @@ static bool mouse_button_pressed(xcb_connection_t *connection, obs_hotkeys_platf
 
 	free(reply);
 	free(error);
-#endif
 	return ret;
 }
 
-static inline bool keycode_pressed(xcb_query_keymap_reply_t *reply, xcb_keycode_t code)
+static bool keycodes_pressed(obs_hotkeys_platform_t *context, const uint8_t *keys, obs_key_t key)
 {
-	return (reply->keys[code / 8] & (1 << (code % 8))) != 0;
+	struct keycode_list *codes = &context->keycodes[key];
+
+	if (key == OBS_KEY_META)
+		return keycode_pressed(keys, context->super_l_code) || keycode_pressed(keys, context->super_r_code);
+
+	for (size_t i = 0; i < codes->list.num; i++) {
+		if (keycode_pressed(keys, codes->list.array[i]))
+			return true;
+	}
+
+	return false;
 }
 
 static bool key_pressed(xcb_connection_t *connection, obs_hotkeys_platform_t *context, obs_key_t key)
 {
-	struct keycode_list *codes = &context->keycodes[key];
 	xcb_generic_error_t *error = NULL;
 	xcb_query_keymap_reply_t *reply;
 	bool pressed = false;
 
+#if defined(XCB_XINPUT_FOUND)
+	if (context->xi2)
+		return keycodes_pressed(context, context->keys, key) ||
+		       keycodes_pressed(context, context->keys_latched, key);
+#endif
+
 	reply = xcb_query_keymap_reply(connection, xcb_query_keymap(connection), &error);
-	if (error) {
+	if (error)
 		blog(LOG_WARNING, "xcb_query_keymap failed");
-
-	} else if (key == OBS_KEY_META) {
-		pressed = keycode_pressed(reply, context->super_l_code) ||
-			  keycode_pressed(reply, context->super_r_code);
-
-	} else {
-		for (size_t i = 0; i < codes->list.num; i++) {
-			if (keycode_pressed(reply, codes->list.array[i])) {
-				pressed = true;
-				break;
-			}
-		}
-	}
+	else
+		pressed = keycodes_pressed(context, reply->keys, key);
 
 	free(reply);
 	free(error);
@@ -1269,6 +1288,9 @@ static const struct obs_nix_hotkeys_vtable x11_hotkeys_vtable = {
 	.init = obs_nix_x11_hotkeys_platform_init,
 	.free = obs_nix_x11_hotkeys_platform_free,
 	.is_pressed = obs_nix_x11_hotkeys_platform_is_pressed,
+#if defined(XCB_XINPUT_FOUND)
+	.wait = obs_nix_x11_hotkeys_platform_wait,
+#endif
 	.key_to_str = obs_nix_x11_key_to_str,
 	.key_from_virtual_key = obs_nix_x11_key_from_virtual_key,
 	.key_to_virtual_key = obs_nix_x11_key_to_virtual_key,
@@ -444,6 +444,14 @@ bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context, obs_key_t
 	return hotkeys_vtable->is_pressed(context, key);
 }
 
+bool obs_hotkeys_platform_wait(obs_hotkeys_platform_t *context, int timeout_ms)
+{
+	if (!hotkeys_vtable->wait)
+		return false;
+
+	return hotkeys_vtable->wait(context, timeout_ms);
+}
+
 void obs_key_to_str(obs_key_t key, struct dstr *dstr)
 {
 	return hotkeys_vtable->key_to_str(key, dstr);
@@ -30,6 +30,9 @@ struct obs_nix_hotkeys_vtable {
 
 	bool (*is_pressed)(obs_hotkeys_platform_t *context, obs_key_t key);
 
+	/* optional, hotkeys are polled without it */
+	bool (*wait)(obs_hotkeys_platform_t *context, int timeout_ms);
+
 	void (*key_to_str)(obs_key_t key, struct dstr *dstr);
 
 	obs_key_t (*key_from_virtual_key)(int sym);
@@ -176,6 +176,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_cache_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -194,6 +195,8 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init_recursive(&source->async_mutex) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_cache_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
@@ -661,6 +664,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		gs_texrender_destroy(source->filter_texrender);
 	if (source->color_space_texrender)
 		gs_texrender_destroy(source->color_space_texrender);
+	if (source->render_cache)
+		gs_texrender_destroy(source->render_cache);
 	gs_leave_context();
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
@@ -680,7 +685,6 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->audio_cb_list);
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
-	da_free(source->async_frames);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -690,6 +694,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_cache_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
@@ -1118,6 +1123,17 @@ void obs_source_deactivate(obs_source_t *source, enum view_type type)
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time);
 
+/* how many frames can be queued before the oldest ones are dropped */
+#define MAX_ASYNC_FRAMES 30
+
+static void evict_async_frames(obs_source_t *source)
+{
+	while (async_frames_num(source) > MAX_ASYNC_FRAMES) {
+		remove_async_frame(source, async_frame_pop(source));
+		os_atomic_inc_long(&source->async_frames_dropped);
+	}
+}
+
 static void filter_frame(obs_source_t *source, struct obs_source_frame **ref_frame)
 {
 	struct obs_source_frame *frame = *ref_frame;
@@ -1187,6 +1203,8 @@ static void async_tick(obs_source_t *source)
 
 	pthread_mutex_lock(&source->async_mutex);
 
+	evict_async_frames(source);
+
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
 	} else {
@@ -1198,6 +1216,10 @@ static void async_tick(obs_source_t *source)
 		source->cur_async_frame = get_closest_frame(source, sys_time);
 	}
 
+	/* nothing new was due, so the last frame stays up for another tick */
+	if (!source->cur_async_frame && source->async_active && source->last_frame_ts)
+		os_atomic_inc_long(&source->async_frames_duplicated);
+
 	source->last_sys_timestamp = sys_time;
 
 	if (deinterlacing_enabled(source))
@@ -1210,6 +1232,8 @@ static void async_tick(obs_source_t *source)
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
+#define RENDER_CACHE_MAX_IDLE_TICKS 300
+
 void obs_source_video_tick(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
@@ -1233,6 +1257,21 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	if (source->filter_texrender)
 		gs_texrender_reset(source->filter_texrender);
 
+	/* the shared render is redone every frame, and freed if unused */
+	source->render_cache_checked = false;
+	source->render_cache_prev_uses = source->render_cache_uses;
+	source->render_cache_uses = 0;
+	if (source->render_cache) {
+		if (++source->render_cache_idle > RENDER_CACHE_MAX_IDLE_TICKS) {
+			obs_enter_graphics();
+			gs_texrender_destroy(source->render_cache);
+			obs_leave_graphics();
+			source->render_cache = NULL;
+		} else {
+			gs_texrender_reset(source->render_cache);
+		}
+	}
+
 	/* call show/hide if the reference changed */
 	now_showing = !!source->show_refs;
 	if (now_showing != source->showing) {
@@ -1425,6 +1464,25 @@ static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 	       (source->push_to_talk_enabled && !push_to_talk_active);
 }
 
+/* RFC 3550 style interarrival jitter: the difference between how far apart
+ * packets arrived and how far apart their timestamps are, smoothed over the
+ * last 16 or so packets.  Timestamp jumps are left to the timing code. */
+static void update_audio_jitter(obs_source_t *source, uint64_t timestamp, uint64_t os_time)
+{
+	if (source->audio_jitter_sys_ts && timestamp > source->audio_jitter_ts) {
+		int64_t d = (int64_t)(os_time - source->audio_jitter_sys_ts) -
+			    (int64_t)(timestamp - source->audio_jitter_ts);
+		uint64_t dev = (uint64_t)(d < 0 ? -d : d);
+
+		if (dev < MAX_TS_VAR)
+			source->audio_jitter = (uint64_t)((int64_t)source->audio_jitter +
+							  ((int64_t)dev - (int64_t)source->audio_jitter) / 16);
+	}
+
+	source->audio_jitter_ts = timestamp;
+	source->audio_jitter_sys_ts = os_time;
+}
+
 static void source_output_audio_data(obs_source_t *source, const struct audio_data *data)
 {
 	size_t sample_rate = audio_output_get_sample_rate(obs->audio.audio);
@@ -1470,6 +1528,8 @@ static void source_output_audio_data(obs_source_t *source, const struct audio_da
 
 	pthread_mutex_lock(&source->audio_buf_mutex);
 
+	update_audio_jitter(source, data->timestamp, os_time);
+
 	if (source->next_audio_sys_ts_min == in.timestamp) {
 		push_back = true;
 
@@ -2580,28 +2640,23 @@ static uint32_t get_base_height(const obs_source_t *source)
 	return source->async_active ? get_async_height(source) : 0;
 }
 
-static void source_render(obs_source_t *source, gs_effect_t *effect)
+/* technique of the default effect that draws a texture in source_space to a
+ * target in current_space, NULL if no conversion is needed */
+static const char *get_convert_tech(enum gs_color_space source_space, enum gs_color_space current_space,
+				    float *multiplier)
 {
-	gs_timer_t *timer = NULL;
-	const uint64_t start = source_profiler_source_render_begin(&timer);
+	const char *tech = NULL;
 
-	void *const data = source->context.data;
-	const enum gs_color_space current_space = gs_get_color_space();
-	const enum gs_color_space source_space = obs_source_get_color_space(source, 1, &current_space);
-
-	const char *convert_tech = NULL;
-	float multiplier = 1.0;
-	enum gs_color_format format = gs_get_format_from_space(source_space);
 	switch (source_space) {
 	case GS_CS_SRGB:
 	case GS_CS_SRGB_16F:
 		switch (current_space) {
 		case GS_CS_709_EXTENDED:
-			convert_tech = "Draw";
+			tech = "Draw";
 			break;
 		case GS_CS_709_SCRGB:
-			convert_tech = "DrawMultiply";
-			multiplier = obs_get_video_sdr_white_level() / 80.0f;
+			tech = "DrawMultiply";
+			*multiplier = obs_get_video_sdr_white_level() / 80.0f;
 			break;
 		case GS_CS_SRGB:
 			break;
@@ -2613,11 +2668,11 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 		switch (current_space) {
 		case GS_CS_SRGB:
 		case GS_CS_SRGB_16F:
-			convert_tech = "DrawTonemap";
+			tech = "DrawTonemap";
 			break;
 		case GS_CS_709_SCRGB:
-			convert_tech = "DrawMultiply";
-			multiplier = obs_get_video_sdr_white_level() / 80.0f;
+			tech = "DrawMultiply";
+			*multiplier = obs_get_video_sdr_white_level() / 80.0f;
 			break;
 		case GS_CS_709_EXTENDED:
 			break;
@@ -2627,18 +2682,34 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 		switch (current_space) {
 		case GS_CS_SRGB:
 		case GS_CS_SRGB_16F:
-			convert_tech = "DrawMultiplyTonemap";
-			multiplier = 80.0f / obs_get_video_sdr_white_level();
+			tech = "DrawMultiplyTonemap";
+			*multiplier = 80.0f / obs_get_video_sdr_white_level();
 			break;
 		case GS_CS_709_EXTENDED:
-			convert_tech = "DrawMultiply";
-			multiplier = 80.0f / obs_get_video_sdr_white_level();
+			tech = "DrawMultiply";
+			*multiplier = 80.0f / obs_get_video_sdr_white_level();
 			break;
 		case GS_CS_709_SCRGB:
 			break;
 		}
 	}
 
+	return tech;
+}
+
+static void source_render(obs_source_t *source, gs_effect_t *effect)
+{
+	gs_timer_t *timer = NULL;
+	const uint64_t start = source_profiler_source_render_begin(&timer);
+
+	void *const data = source->context.data;
+	const enum gs_color_space current_space = gs_get_color_space();
+	const enum gs_color_space source_space = obs_source_get_color_space(source, 1, &current_space);
+
+	float multiplier = 1.0;
+	const char *convert_tech = get_convert_tech(source_space, current_space, &multiplier);
+	enum gs_color_format format = gs_get_format_from_space(source_space);
+
 	if (convert_tech) {
 		if (source->color_space_texrender) {
 			if (gs_texrender_get_format(source->color_space_texrender) != format) {
@@ -2813,6 +2884,116 @@ void obs_source_video_render(obs_source_t *source)
 	}
 }
 
+static void check_view_dependent(obs_source_t *parent, obs_source_t *child, void *param)
+{
+	bool *view_dependent = param;
+
+	if ((child->info.output_flags & OBS_SOURCE_VIEW_DEPENDENT) != 0)
+		*view_dependent = true;
+
+	UNUSED_PARAMETER(parent);
+}
+
+static bool is_view_dependent(obs_source_t *source)
+{
+	bool view_dependent = (source->info.output_flags & OBS_SOURCE_VIEW_DEPENDENT) != 0;
+
+	if (!view_dependent)
+		obs_source_enum_active_tree(source, check_view_dependent, &view_dependent);
+	return view_dependent;
+}
+
+static void draw_render_cache(gs_texture_t *tex, enum gs_color_space source_space)
+{
+	float multiplier = 1.0f;
+	const char *tech_name = get_convert_tech(source_space, gs_get_color_space(), &multiplier);
+
+	gs_effect_t *effect = obs->video.default_effect;
+	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name ? tech_name : "Draw");
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+
+	gs_effect_set_texture_srgb(gs_effect_get_param_by_name(effect, "image"), tex);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "multiplier"), multiplier);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	const size_t passes = gs_technique_begin(tech);
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
+		gs_draw_sprite(tex, 0, 0, 0);
+		gs_technique_end_pass(tech);
+	}
+	gs_technique_end(tech);
+
+	gs_blend_state_pop();
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
+void obs_source_video_render_cached(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_video_render_cached"))
+		return;
+
+	source = obs_source_get_ref(source);
+	if (!source)
+		return;
+
+	/* the active tree is only checked once per frame */
+	if (!source->render_cache_checked) {
+		source->render_cache_direct = is_view_dependent(source);
+		source->render_cache_checked = true;
+	}
+
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+
+	/* the texture only pays off if another view draws the source too, which
+	 * is assumed to be the case if it did on the previous frame */
+	const bool shared = ++source->render_cache_uses > 1 || source->render_cache_prev_uses > 1;
+
+	if (source->render_cache_direct || !shared || !cx || !cy) {
+		render_video(source);
+		obs_source_release(source);
+		return;
+	}
+
+	const enum gs_color_space source_space = obs_source_get_color_space(source, 0, NULL);
+	const enum gs_color_format format = gs_get_format_from_space(source_space);
+
+	if (source->render_cache && gs_texrender_get_format(source->render_cache) != format) {
+		gs_texrender_destroy(source->render_cache);
+		source->render_cache = NULL;
+	}
+
+	if (!source->render_cache)
+		source->render_cache = gs_texrender_create(format, GS_ZS_NONE);
+
+	/* only succeeds once until the texrender is reset on the next tick */
+	if (gs_texrender_begin_with_color_space(source->render_cache, cx, cy, source_space)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		render_video(source);
+
+		gs_texrender_end(source->render_cache);
+	}
+
+	source->render_cache_idle = 0;
+
+	gs_texture_t *tex = gs_texrender_get_texture(source->render_cache);
+	if (tex)
+		draw_render_cache(tex, source_space);
+
+	obs_source_release(source);
+}
+
 static uint32_t get_recurse_width(obs_source_t *source)
 {
 	uint32_t width;
@@ -3328,13 +3509,29 @@ static inline bool async_texture_changed(struct obs_source *source, const struct
 	return source->async_cache_width != frame->width || source->async_cache_height != frame->height || prev != cur;
 }
 
-static inline void free_async_cache(struct obs_source *source)
+/* frees the cached frames that aren't in use, and marks the rest to be freed
+ * once they are.  call with async_cache_mutex held */
+static void expire_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+		if (af->used) {
+			af->stale = true;
+		} else {
+			obs_source_frame_decref(af->frame);
+			da_erase(source->async_cache, i - 1);
+		}
+	}
+}
+
+/* call with async_mutex held */
+static void flush_async_frames(struct obs_source *source)
+{
+	while (async_frames_num(source))
+		remove_async_frame(source, async_frame_pop(source));
 
-	da_resize(source->async_cache, 0);
-	da_resize(source->async_frames, 0);
+	remove_async_frame(source, source->cur_async_frame);
+	remove_async_frame(source, source->prev_async_frame);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
 }
@@ -3356,23 +3553,15 @@ static void clean_cache(obs_source_t *source)
 	}
 }
 
-#define MAX_ASYNC_FRAMES 30
 //if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
 static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 {
 	struct obs_source_frame *new_frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
-
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
-		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
-	}
+	pthread_mutex_lock(&source->async_cache_mutex);
 
 	if (async_texture_changed(source, frame)) {
-		free_async_cache(source);
+		expire_async_cache(source);
 		source->async_cache_width = frame->width;
 		source->async_cache_height = frame->height;
 	}
@@ -3409,13 +3598,34 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 
 	os_atomic_inc_long(&new_frame->refs);
 
-	pthread_mutex_unlock(&source->async_mutex);
+	pthread_mutex_unlock(&source->async_cache_mutex);
 
 	copy_frame_data(new_frame, frame);
 
 	return new_frame;
 }
 
+/* queues a frame for the graphics thread, false if the queue is full */
+static bool push_async_frame(struct obs_source *source, struct obs_source_frame *frame)
+{
+	unsigned long head, tail;
+	bool success = false;
+
+	pthread_mutex_lock(&source->async_cache_mutex);
+
+	head = (unsigned long)source->async_ring_head;
+	tail = (unsigned long)os_atomic_load_long(&source->async_ring_tail);
+
+	if (head - tail < ASYNC_RING_SIZE) {
+		source->async_ring[head & (ASYNC_RING_SIZE - 1)] = frame;
+		os_atomic_set_long(&source->async_ring_head, (long)(head + 1));
+		success = true;
+	}
+
+	pthread_mutex_unlock(&source->async_cache_mutex);
+	return success;
+}
+
 static void obs_source_output_video_internal(obs_source_t *source, const struct obs_source_frame *frame)
 {
 	if (!obs_source_valid(source, "obs_source_output_video"))
@@ -3425,7 +3635,11 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 		pthread_mutex_lock(&source->async_mutex);
 		source->async_active = false;
 		source->last_frame_ts = 0;
-		free_async_cache(source);
+		flush_async_frames(source);
+
+		pthread_mutex_lock(&source->async_cache_mutex);
+		expire_async_cache(source);
+		pthread_mutex_unlock(&source->async_cache_mutex);
 		pthread_mutex_unlock(&source->async_mutex);
 		return;
 	}
@@ -3435,17 +3649,16 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 	struct obs_source_frame *output = cache_video(source, frame);
 
 	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
 	if (output) {
 		if (os_atomic_dec_long(&output->refs) == 0) {
 			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
+		} else if (push_async_frame(source, output)) {
 			source->async_active = true;
+		} else {
+			remove_async_frame(source, output);
+			os_atomic_inc_long(&source->async_frames_dropped);
 		}
 	}
-	pthread_mutex_unlock(&source->async_mutex);
 }
 
 void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame)
@@ -3925,34 +4138,45 @@ void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio
 
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
-	if (frame)
-		frame->prev_frame = false;
+	if (!frame)
+		return;
+
+	frame->prev_frame = false;
+
+	pthread_mutex_lock(&source->async_cache_mutex);
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			if (f->stale) {
+				obs_source_frame_decref(frame);
+				da_erase(source->async_cache, i);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
+
+	pthread_mutex_unlock(&source->async_cache_mutex);
 }
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 {
-	struct obs_source_frame *next_frame = source->async_frames.array[0];
+	struct obs_source_frame *next_frame = async_frame_peek(source, 0);
 	struct obs_source_frame *frame = NULL;
 	uint64_t sys_offset = sys_time - source->last_sys_timestamp;
 	uint64_t frame_time = next_frame->timestamp;
 	uint64_t frame_offset = 0;
 
 	if (source->async_unbuffered) {
-		while (source->async_frames.num > 1) {
-			da_erase(source->async_frames, 0);
-			remove_async_frame(source, next_frame);
-			next_frame = source->async_frames.array[0];
+		while (async_frames_num(source) > 1) {
+			remove_async_frame(source, async_frame_pop(source));
+			os_atomic_inc_long(&source->async_frames_late);
+			next_frame = async_frame_peek(source, 0);
 		}
 
 		source->last_frame_ts = next_frame->timestamp;
@@ -3965,7 +4189,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 	     "sys_offset: %llu, frame_offset: %llu, "
 	     "number of frames: %lu",
 	     source->last_frame_ts, frame_time, sys_offset, frame_time - source->last_frame_ts,
-	     (unsigned long)source->async_frames.num);
+	     (unsigned long)async_frames_num(source));
 #endif
 
 	/* account for timestamp invalidation */
@@ -3989,8 +4213,10 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		if (frame && (source->last_frame_ts - next_frame->timestamp) < 2000000)
 			break;
 
-		if (frame)
-			da_erase(source->async_frames, 0);
+		if (frame) {
+			async_frame_pop(source);
+			os_atomic_inc_long(&source->async_frames_late);
+		}
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -4002,11 +4228,11 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 
 		remove_async_frame(source, frame);
 
-		if (source->async_frames.num == 1)
+		if (async_frames_num(source) == 1)
 			return true;
 
 		frame = next_frame;
-		next_frame = source->async_frames.array[1];
+		next_frame = async_frame_peek(source, 1);
 
 		/* more timestamp checking and compensating */
 		if ((next_frame->timestamp - frame_time) > MAX_TS_VAR) {
@@ -4030,12 +4256,11 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source, uint64_t sys_time)
 {
-	if (!source->async_frames.num)
+	if (!async_frames_num(source))
 		return NULL;
 
 	if (!source->last_frame_ts || ready_async_frame(source, sys_time)) {
-		struct obs_source_frame *frame = source->async_frames.array[0];
-		da_erase(source->async_frames, 0);
+		struct obs_source_frame *frame = async_frame_pop(source);
 
 		if (!source->last_frame_ts)
 			source->last_frame_ts = frame->timestamp;
@@ -4416,6 +4641,25 @@ int64_t obs_source_get_sync_offset(const obs_source_t *source)
 	return obs_source_valid(source, "obs_source_get_sync_offset") ? source->sync_offset : 0;
 }
 
+void obs_source_get_async_frame_counts(const obs_source_t *source, uint64_t *late, uint64_t *dropped,
+				       uint64_t *duplicated)
+{
+	bool valid = obs_source_valid(source, "obs_source_get_async_frame_counts");
+
+	if (late)
+		*late = valid ? (uint64_t)(unsigned long)os_atomic_load_long(&source->async_frames_late) : 0;
+	if (dropped)
+		*dropped = valid ? (uint64_t)(unsigned long)os_atomic_load_long(&source->async_frames_dropped) : 0;
+	if (duplicated)
+		*duplicated =
+			valid ? (uint64_t)(unsigned long)os_atomic_load_long(&source->async_frames_duplicated) : 0;
+}
+
+uint64_t obs_source_get_audio_jitter(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_audio_jitter") ? source->audio_jitter : 0;
+}
+
 struct source_enum_data {
 	obs_source_enum_proc_t enum_callback;
 	void *param;
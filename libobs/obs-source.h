@@ -203,6 +203,12 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source renders differently depending on where it is drawn, and must not be
+ * drawn from a render cached for another view
+ */
+#define OBS_SOURCE_VIEW_DEPENDENT (1 << 17)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
@@ -0,0 +1,242 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+
+#include "obs-internal.h"
+#include "util/sse-intrin.h"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <errno.h>
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif
+
+#define MAX_PACING_US 1000000
+
+void video_pacing_init(struct obs_video_pacing *pacing)
+{
+	memset(pacing, 0, sizeof(*pacing));
+#ifdef __linux__
+	pacing->timer_fd = -1;
+#endif
+}
+
+void video_pacing_free(struct obs_video_pacing *pacing)
+{
+#ifdef __linux__
+	if (pacing->timer_fd != -1)
+		close(pacing->timer_fd);
+	pacing->timer_fd = -1;
+#else
+	UNUSED_PARAMETER(pacing);
+#endif
+}
+
+#ifdef __linux__
+static void set_realtime(struct obs_video_pacing *pacing, bool realtime)
+{
+	pthread_t self = pthread_self();
+	int ret;
+
+	if (realtime) {
+		struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
+
+		pthread_getschedparam(self, &pacing->old_policy, &pacing->old_param);
+		ret = pthread_setschedparam(self, SCHED_FIFO, &param);
+		if (ret != 0) {
+			blog(LOG_WARNING, "Could not run the graphics thread with SCHED_FIFO: %s", strerror(ret));
+			return;
+		}
+	} else if (pacing->realtime) {
+		pthread_setschedparam(self, pacing->old_policy, &pacing->old_param);
+	}
+}
+
+static void set_timerfd(struct obs_video_pacing *pacing, bool timerfd)
+{
+	if (timerfd && pacing->timer_fd == -1) {
+		pacing->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (pacing->timer_fd == -1)
+			blog(LOG_WARNING, "Could not create frame pacing timerfd: %s", strerror(errno));
+	} else if (!timerfd && pacing->timer_fd != -1) {
+		close(pacing->timer_fd);
+		pacing->timer_fd = -1;
+	}
+}
+#endif
+
+static void update_settings(struct obs_video_pacing *pacing)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pacing->spin_ns = (uint64_t)os_atomic_load_long(&video->pacing_spin_us) * 1000;
+
+#ifdef __linux__
+	bool realtime = os_atomic_load_bool(&video->pacing_realtime);
+	bool timerfd = os_atomic_load_bool(&video->pacing_timerfd);
+
+	/* only tried once per change so failures aren't logged every frame */
+	if (realtime != pacing->realtime) {
+		set_realtime(pacing, realtime);
+		pacing->realtime = realtime;
+	}
+	if (timerfd != pacing->timerfd) {
+		set_timerfd(pacing, timerfd);
+		pacing->timerfd = timerfd;
+	}
+#endif
+}
+
+/* Sleeps until an absolute time, so that interrupted and late wakeups don't
+ * add up over frames.  os_gettime_ns uses CLOCK_MONOTONIC outside of Windows
+ * and macOS. */
+static void sleep_until(struct obs_video_pacing *pacing, uint64_t target)
+{
+#ifdef __linux__
+	if (pacing->timer_fd != -1) {
+		struct itimerspec its = {0};
+		uint64_t expirations;
+
+		its.it_value.tv_sec = (time_t)(target / 1000000000);
+		its.it_value.tv_nsec = (long)(target % 1000000000);
+
+		if (timerfd_settime(pacing->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+			while (read(pacing->timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EINTR)
+				;
+			return;
+		}
+	}
+#endif
+
+#if defined(_WIN32) || defined(__APPLE__)
+	UNUSED_PARAMETER(pacing);
+	os_sleepto_ns(target);
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t)(target / 1000000000);
+	ts.tv_nsec = (long)(target % 1000000000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+#endif
+}
+
+bool video_pacing_sleepto(struct obs_video_pacing *pacing, uint64_t deadline, uint64_t *jitter_ns)
+{
+	uint64_t now;
+
+	update_settings(pacing);
+
+	now = os_gettime_ns();
+	if (deadline < now)
+		return false;
+
+	/* sleep through most of the interval and spin the rest, waking up on
+	 * time is worth a bit of CPU when the scheduler is slow to wake us */
+	if (deadline - now > pacing->spin_ns)
+		sleep_until(pacing, deadline - pacing->spin_ns);
+
+	now = os_gettime_ns();
+	while (now < deadline) {
+		_mm_pause();
+		now = os_gettime_ns();
+	}
+
+	*jitter_ns = now - deadline;
+	return true;
+}
+
+void video_pacing_record(struct obs_video_pacing_stats *stats, bool slept, uint64_t jitter_ns, int count,
+			 bool absorbed)
+{
+	stats->frames++;
+	stats->duplicated += (uint64_t)(count - 1);
+	if (absorbed)
+		stats->absorbed++;
+
+	if (slept) {
+		uint64_t jitter_us = jitter_ns / 1000;
+		size_t bucket = 0;
+
+		while (bucket < OBS_VIDEO_PACING_BUCKETS - 1 && jitter_us >= (1ULL << bucket))
+			bucket++;
+
+		stats->jitter_buckets[bucket]++;
+		if (jitter_ns > stats->max_jitter_ns)
+			stats->max_jitter_ns = jitter_ns;
+	} else {
+		stats->overruns++;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+void obs_set_video_pacing(const struct obs_video_pacing_info *info)
+{
+	if (!obs || !info)
+		return;
+
+	struct obs_core_video *video = &obs->video;
+	uint32_t spin_us = info->spin_us < MAX_PACING_US ? info->spin_us : MAX_PACING_US;
+	uint32_t absorb_us = info->absorb_us < MAX_PACING_US ? info->absorb_us : MAX_PACING_US;
+
+	os_atomic_set_long(&video->pacing_spin_us, (long)spin_us);
+	os_atomic_set_long(&video->pacing_absorb_us, (long)absorb_us);
+	os_atomic_set_bool(&video->pacing_realtime, info->realtime);
+	os_atomic_set_bool(&video->pacing_timerfd, info->timerfd);
+}
+
+void obs_get_video_pacing(struct obs_video_pacing_info *info)
+{
+	if (!info)
+		return;
+
+	memset(info, 0, sizeof(*info));
+	if (!obs)
+		return;
+
+	struct obs_core_video *video = &obs->video;
+	info->spin_us = (uint32_t)os_atomic_load_long(&video->pacing_spin_us);
+	info->absorb_us = (uint32_t)os_atomic_load_long(&video->pacing_absorb_us);
+	info->realtime = os_atomic_load_bool(&video->pacing_realtime);
+	info->timerfd = os_atomic_load_bool(&video->pacing_timerfd);
+}
+
+bool obs_get_video_pacing_stats(video_t *video, struct obs_video_pacing_stats *stats)
+{
+	bool found = false;
+
+	if (!obs || !video || !stats)
+		return false;
+
+	pthread_mutex_lock(&obs->video.mixes_mutex);
+	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
+
+		if (mix->video == video) {
+			*stats = mix->pacing_stats;
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&obs->video.mixes_mutex);
+
+	return found;
+}
@@ -121,12 +121,36 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video_mix *video)
+static const char *wait_for_readback_name = "wait_for_readback";
+
+/* Checked under readback_mutex so that everything the readback thread did
+ * with the mapped frame happens before the surfaces are unmapped. */
+static inline bool readback_pending(struct obs_core_video_mix *video, int texture)
 {
+	bool pending;
+
+	pthread_mutex_lock(&video->readback_mutex);
+	pending = video->readback_pending[texture];
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	return pending;
+}
+
+/* Waits until the readback thread no longer uses the frame mapped from the
+ * given stage surfaces, then unmaps them so they can be staged again. */
+static inline void unmap_surfaces(struct obs_core_video_mix *video, int texture)
+{
+	if (readback_pending(video, texture)) {
+		profile_start(wait_for_readback_name);
+		while (readback_pending(video, texture))
+			os_event_wait(video->readback_done);
+		profile_end(wait_for_readback_name);
+	}
+
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+		if (video->mapped_surfaces[texture][c]) {
+			gs_stagesurface_unmap(video->mapped_surfaces[texture][c]);
+			video->mapped_surfaces[texture][c] = NULL;
 		}
 	}
 }
@@ -408,7 +432,7 @@ static inline void stage_output_texture(struct obs_core_video_mix *video, int cu
 {
 	profile_start(stage_output_texture_name);
 
-	unmap_last_surface(video);
+	unmap_surfaces(video, cur_texture);
 
 	if (!video->gpu_conversion) {
 		gs_stagesurf_t *copy = copy_surfaces[0];
@@ -580,18 +604,21 @@ static inline void render_video(struct obs_core_video_mix *video, bool raw_activ
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video_mix *video, int prev_texture, struct video_data *frame)
+static inline bool download_frame(struct obs_core_video_mix *video, int read_texture, struct video_data *frame)
 {
-	if (!video->textures_copied[prev_texture])
+	if (!video->textures_copied[read_texture])
 		return false;
 
+	/* still mapped if raw output was toggled before it was staged again */
+	unmap_surfaces(video, read_texture);
+
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-		gs_stagesurf_t *surface = video->active_copy_surfaces[prev_texture][channel];
+		gs_stagesurf_t *surface = video->active_copy_surfaces[read_texture][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel], &frame->linesize[channel]))
 				return false;
 
-			video->mapped_surfaces[channel] = surface;
+			video->mapped_surfaces[read_texture][channel] = surface;
 		}
 	}
 	return true;
@@ -794,6 +821,109 @@ static inline void output_video_data(struct obs_core_video_mix *video, struct vi
 	}
 }
 
+struct obs_readback_frame {
+	struct video_data frame;
+	int count;
+	int texture;
+};
+
+#define NBSP "\xC2\xA0"
+
+static const char *output_frame_output_video_data_name = "output_video_data";
+
+/* Copies mapped frames into the video output so that the graphics thread
+ * does not have to. The stage surfaces stay mapped until the copy is done,
+ * see unmap_surfaces(). */
+static void *readback_thread(void *data)
+{
+	struct obs_core_video_mix *video = data;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("obs raw readback thread");
+	const char *readback_thread_name = profile_store_name(
+		obs_get_profiler_name_store(), "obs_raw_readback_thread(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(readback_thread_name, interval);
+
+	while (os_sem_wait(video->readback_semaphore) == 0) {
+		struct obs_readback_frame rf;
+
+		if (os_atomic_load_bool(&video->readback_stop))
+			break;
+
+		profile_start(readback_thread_name);
+
+		pthread_mutex_lock(&video->readback_mutex);
+		deque_pop_front(&video->readback_queue, &rf, sizeof(rf));
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		profile_start(output_frame_output_video_data_name);
+		output_video_data(video, &rf.frame, rf.count);
+		profile_end(output_frame_output_video_data_name);
+
+		pthread_mutex_lock(&video->readback_mutex);
+		video->readback_pending[rf.texture] = false;
+		pthread_mutex_unlock(&video->readback_mutex);
+		os_event_signal(video->readback_done);
+
+		profile_end(readback_thread_name);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static inline void queue_readback(struct obs_core_video_mix *video, struct video_data *frame, int count,
+				  int texture)
+{
+	struct obs_readback_frame rf = {.frame = *frame, .count = count, .texture = texture};
+
+	pthread_mutex_lock(&video->readback_mutex);
+	video->readback_pending[texture] = true;
+	deque_push_back(&video->readback_queue, &rf, sizeof(rf));
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	os_sem_post(video->readback_semaphore);
+}
+
+bool init_raw_readback(struct obs_core_video_mix *video)
+{
+	video->readback_stop = false;
+
+	if (pthread_mutex_init(&video->readback_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&video->readback_semaphore, 0) != 0)
+		return false;
+	if (os_event_init(&video->readback_done, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+	if (pthread_create(&video->readback_thread, NULL, readback_thread, video) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+void free_raw_readback(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized) {
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_semaphore);
+		pthread_join(video->readback_thread, NULL);
+		video->readback_thread_initialized = false;
+	}
+
+	for (size_t i = 0; i < NUM_READBACK_TEXTURES; i++)
+		video->readback_pending[i] = false;
+
+	os_sem_destroy(video->readback_semaphore);
+	os_event_destroy(video->readback_done);
+	video->readback_semaphore = NULL;
+	video->readback_done = NULL;
+
+	deque_free(&video->readback_queue);
+	pthread_mutex_destroy(&video->readback_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
+}
+
 void add_ready_encoder_group(obs_encoder_t *encoder)
 {
 	obs_weak_encoder_t *weak = obs_encoder_get_weak_encoder(encoder);
@@ -802,14 +932,20 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
-static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, uint64_t interval_ns)
+static inline void video_sleep(struct obs_graphics_context *context)
 {
+	struct obs_core_video *video = &obs->video;
 	struct obs_vframe_info vframe_info;
+	uint64_t *p_time = &video->video_time;
+	uint64_t interval_ns = context->interval;
 	uint64_t cur_time = *p_time;
 	uint64_t t = cur_time + interval_ns;
+	uint64_t jitter_ns = 0;
+	bool slept = video_pacing_sleepto(&context->pacing, t, &jitter_ns);
+	bool absorbed = false;
 	int count;
 
-	if (os_sleepto_ns(t)) {
+	if (slept) {
 		*p_time = t;
 		count = 1;
 	} else {
@@ -818,6 +954,18 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, u
 		memcpy(&diff, &udiff, sizeof(diff));
 		const uint64_t clamped_diff = (diff > (int64_t)interval_ns) ? (uint64_t)diff : interval_ns;
 		count = (int)(clamped_diff / interval_ns);
+
+		/* overruns of up to absorb_ns are caught up on by the next
+		 * frames, which start right away, instead of being covered by
+		 * repeating this one */
+		const uint64_t absorb_ns = (uint64_t)os_atomic_load_long(&video->pacing_absorb_us) * 1000;
+		const uint64_t late_ns = clamped_diff - interval_ns;
+		if (count > 1 && absorb_ns) {
+			int absorbed_count = 1 + (int)(late_ns > absorb_ns ? (late_ns - absorb_ns) / interval_ns : 0);
+			absorbed = absorbed_count < count;
+			count = absorbed_count;
+		}
+
 		*p_time = cur_time + interval_ns * count;
 	}
 
@@ -856,6 +1004,8 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, u
 			deque_push_back(&video->vframe_info_buffer, &vframe_info, sizeof(vframe_info));
 		if (gpu_active)
 			deque_push_back(&video->vframe_info_buffer_gpu, &vframe_info, sizeof(vframe_info));
+
+		video_pacing_record(&video->pacing_stats, slept, jitter_ns, count, absorbed);
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
@@ -864,14 +1014,14 @@ static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
 static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
-static const char *output_frame_output_video_data_name = "output_video_data";
 static inline void output_frame(struct obs_core_video_mix *video)
 {
 	const bool raw_active = video->raw_was_active;
 	const bool gpu_active = video->gpu_was_active;
 
+	/* read back the oldest staged frame, it's the most likely to be ready */
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1 : cur_texture - 1;
+	int read_texture = cur_texture == NUM_READBACK_TEXTURES - 1 ? 0 : cur_texture + 1;
 	struct video_data frame;
 	bool frame_ready = 0;
 
@@ -888,7 +1038,7 @@ static inline void output_frame(struct obs_core_video_mix *video)
 
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
+		frame_ready = download_frame(video, read_texture, &frame);
 		profile_end(output_frame_download_frame_name);
 	}
 
@@ -904,12 +1054,10 @@ static inline void output_frame(struct obs_core_video_mix *video)
 		deque_pop_front(&video->vframe_info_buffer, &vframe_info, sizeof(vframe_info));
 
 		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
+		queue_readback(video, &frame, vframe_info.count, read_texture);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == NUM_READBACK_TEXTURES)
 		video->cur_texture = 0;
 }
 
@@ -931,8 +1079,6 @@ static inline void output_frames(void)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
@@ -1105,6 +1251,8 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	source_profiler_frame_begin();
 
 	gs_enter_context(obs->video.graphics);
+	/* draw calls of the previous frame, counted until the next one begins */
+	os_atomic_set_long(&obs->video.frame_draw_calls, (long)gs_get_draw_count());
 	gs_begin_frame();
 	gs_leave_context();
 
@@ -1139,7 +1287,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	profile_reenable_thread();
 
-	video_sleep(&obs->video, &obs->video.video_time, context->interval);
+	video_sleep(context);
 
 	context->frame_time_total_ns += frame_time_ns;
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
@@ -1186,6 +1334,7 @@ void *obs_graphics_thread(void *param)
 	context.fps_total_frames = 0;
 	context.last_time = 0;
 	context.video_thread_name = video_thread_name;
+	video_pacing_init(&context.pacing);
 
 #ifdef __APPLE__
 	while (obs_graphics_thread_loop_autorelease(&context))
@@ -1194,6 +1343,8 @@ void *obs_graphics_thread(void *param)
 #endif
 		;
 
+	video_pacing_free(&context.pacing);
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
@@ -370,7 +370,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < NUM_READBACK_TEXTURES; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] = gs_stagesurface_create_nv12(info->width, info->height);
@@ -434,7 +434,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	if (success) {
 		video->render_space = space;
 	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < NUM_READBACK_TEXTURES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -503,6 +503,7 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 
 	profile_start(shader_comp_name);
 	gs_enter_context(video->graphics);
+	gs_set_shader_cache_path(obs->shader_cache_path);
 
 	char *filename = obs_find_data_file("default.effect");
 	video->default_effect = gs_effect_create_from_file(filename, NULL);
@@ -602,11 +603,15 @@ static inline void set_video_matrix(struct obs_core_video_mix *video, struct vid
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
+extern bool init_raw_readback(struct obs_core_video_mix *video);
+extern void free_raw_readback(struct obs_core_video_mix *video);
+
 static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_mix *video)
 {
 	struct video_output_info vi;
 
 	pthread_mutex_init_value(&video->gpu_encoder_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
 
 	make_video_info(&vi, ovi);
 	video->ovi = *ovi;
@@ -642,6 +647,8 @@ static int obs_init_video_mix(struct obs_video_info *ovi, struct obs_core_video_
 
 	if (pthread_mutex_init(&video->gpu_encoder_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
+	if (!init_raw_readback(video))
+		return OBS_VIDEO_FAIL;
 
 	gs_enter_context(obs->video.graphics);
 
@@ -721,14 +728,16 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 	gs_enter_context(obs->video.graphics);
 
-	for (size_t c = 0; c < NUM_CHANNELS; c++) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+	for (size_t i = 0; i < NUM_READBACK_TEXTURES; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->mapped_surfaces[i][c]) {
+				gs_stagesurface_unmap(video->mapped_surfaces[i][c]);
+				video->mapped_surfaces[i][c] = NULL;
+			}
 		}
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < NUM_READBACK_TEXTURES; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
 				gs_stagesurface_destroy(video->copy_surfaces[i][c]);
@@ -768,6 +777,9 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		/* the readback thread writes to the video output */
+		free_raw_readback(video);
+
 		video_output_close(video->video);
 		video->video = NULL;
 
@@ -869,6 +881,9 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	struct obs_task_info audio_init = {.task = set_audio_thread};
 	deque_push_back(&audio->tasks, &audio_init, sizeof(audio_init));
 
+	if (!audio_render_threads_init(audio))
+		return false;
+
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
@@ -899,6 +914,8 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	audio_render_threads_free(audio);
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -926,6 +943,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->audio_sources_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init_recursive(&data->volmeters_mutex) != 0)
+		goto fail;
 	if (pthread_mutex_init_recursive(&data->displays_mutex) != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->outputs_mutex) != 0)
@@ -1007,6 +1026,7 @@ static void obs_free_data(void)
 
 	pthread_mutex_destroy(&data->sources_mutex);
 	pthread_mutex_destroy(&data->audio_sources_mutex);
+	pthread_mutex_destroy(&data->volmeters_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
 	pthread_mutex_destroy(&data->outputs_mutex);
 	pthread_mutex_destroy(&data->encoders_mutex);
@@ -1021,6 +1041,8 @@ static void obs_free_data(void)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
 	da_free(data->sources_to_tick);
+	da_free(data->volmeters);
+	da_free(data->volmeter_buf);
 }
 
 static const char *obs_signals[] = {
@@ -1234,6 +1256,15 @@ void obs_add_data_path(const char *path)
 	dstr_init_copy(new_path, path);
 }
 
+void obs_set_shader_cache_path(const char *path)
+{
+	if (!obs)
+		return;
+
+	bfree(obs->shader_cache_path);
+	obs->shader_cache_path = path ? bstrdup(path) : NULL;
+}
+
 bool obs_remove_data_path(const char *path)
 {
 	for (size_t i = 0; i < core_module_paths.num; ++i) {
@@ -1379,6 +1410,7 @@ void obs_shutdown(void)
 		profiler_name_store_free(obs->name_store);
 
 	bfree(obs->module_config_path);
+	bfree(obs->shader_cache_path);
 	bfree(obs->locale);
 	bfree(obs);
 	obs = NULL;
@@ -2907,6 +2939,11 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint32_t obs_get_frame_draw_calls(void)
+{
+	return (uint32_t)os_atomic_load_long(&obs->video.frame_draw_calls);
+}
+
 struct obs_core_video_mix *get_mix_for_video(video_t *v)
 {
 	struct obs_core_video_mix *result = NULL;
@@ -348,6 +348,16 @@ EXPORT bool obs_startup(const char *locale, const char *module_config_path, prof
 /** Releases all data associated with OBS and terminates the OBS context */
 EXPORT void obs_shutdown(void);
 
+/**
+ * Sets the directory graphics modules may keep compiled shaders in, so that
+ * later runs don't have to compile them again.  Only takes effect if called
+ * before graphics are initialized by the first call to obs_reset_video.
+ *
+ * @param  path  Full path to the directory, or NULL to not cache shaders
+ *               (the default).  The string is copied.
+ */
+EXPORT void obs_set_shader_cache_path(const char *path);
+
 /** @return true if the main OBS context has been initialized */
 EXPORT bool obs_initialized(void);
 
@@ -437,9 +447,71 @@ EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 /** Sets the video levels */
 EXPORT void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level);
 
+/**
+ * Frame pacing settings of the graphics thread, all zero by default
+ */
+struct obs_video_pacing_info {
+	/** Wake up this long before each frame deadline and spin the rest */
+	uint32_t spin_us;
+
+	/**
+	 * Frames that start up to this late are caught up on by the following
+	 * frames instead of being output more than once
+	 */
+	uint32_t absorb_us;
+
+	/** Run the graphics thread with SCHED_FIFO (Linux only) */
+	bool realtime;
+
+	/** Sleep on an absolute timerfd, which has no timer slack (Linux only) */
+	bool timerfd;
+};
+
+#define OBS_VIDEO_PACING_BUCKETS 16
+
+/**
+ * Frame pacing statistics of a video mix.  Jitter is how late the graphics
+ * thread woke up for a frame deadline.  jitter_buckets[i] counts wakeups that
+ * were less than 2^i microseconds late, the last bucket counts all later ones.
+ */
+struct obs_video_pacing_stats {
+	uint64_t frames;
+	uint64_t overruns;   /**< Frames that started after their deadline */
+	uint64_t absorbed;   /**< Overruns caught up on instead of duplicated */
+	uint64_t duplicated; /**< Frames output again because of overruns */
+	uint64_t max_jitter_ns;
+	uint64_t jitter_buckets[OBS_VIDEO_PACING_BUCKETS];
+};
+
+/** Sets the frame pacing settings, applied starting with the next frame */
+EXPORT void obs_set_video_pacing(const struct obs_video_pacing_info *info);
+
+/** Gets the current frame pacing settings */
+EXPORT void obs_get_video_pacing(struct obs_video_pacing_info *info);
+
+/** Gets the frame pacing statistics of a video mix, false if not found */
+EXPORT bool obs_get_video_pacing_stats(video_t *video, struct obs_video_pacing_stats *stats);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+/**
+ * Enables or disables rendering audio sources without child sources on
+ * worker threads (enabled by default, reset along with audio). The mixed
+ * output is the same either way.
+ */
+EXPORT void obs_set_parallel_audio_rendering(bool enable);
+
+/**
+ * Enables or disables reducing audio buffering again once sources have been
+ * stable for a while (disabled by default, reset along with audio). Has no
+ * effect with fixed buffering.
+ */
+EXPORT void obs_set_audio_adaptive_buffering(bool enable);
+
+/** Gets the amount of audio currently being buffered, in nanoseconds */
+EXPORT uint64_t obs_get_audio_buffering_latency(void);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -831,6 +903,9 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Gets the number of draw calls the graphics thread made for the last frame */
+EXPORT uint32_t obs_get_frame_draw_calls(void);
+
 EXPORT bool obs_nv12_tex_active(void);
 EXPORT bool obs_p010_tex_active(void);
 
@@ -1030,6 +1105,14 @@ EXPORT void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t *source);
 
+/**
+ * Renders a video source through a cache shared by everything drawing it in
+ * the same frame: the first call of a frame renders the source at its size
+ * and in its own color space, later calls draw that texture.  Sources that
+ * are (or contain) OBS_SOURCE_VIEW_DEPENDENT are rendered directly.
+ */
+EXPORT void obs_source_video_render_cached(obs_source_t *source);
+
 /** Gets the width of a source (if it has video) */
 EXPORT uint32_t obs_source_get_width(obs_source_t *source);
 
@@ -1121,6 +1204,21 @@ EXPORT void obs_source_set_sync_offset(obs_source_t *source, int64_t offset);
 /** Gets the audio sync offset (in nanoseconds) for a source */
 EXPORT int64_t obs_source_get_sync_offset(const obs_source_t *source);
 
+/**
+ * Gets how many async video frames of a source were skipped because a newer
+ * frame was already due (late), discarded because too many were queued
+ * (dropped), or had to be shown again because no new frame was ready
+ * (duplicated).  Any of the pointers can be NULL.
+ */
+EXPORT void obs_source_get_async_frame_counts(const obs_source_t *source, uint64_t *late, uint64_t *dropped,
+					      uint64_t *duplicated);
+
+/**
+ * Gets the smoothed variation in arrival time of a source's audio packets
+ * relative to their timestamps (in nanoseconds), 0 if it has no audio
+ */
+EXPORT uint64_t obs_source_get_audio_jitter(const obs_source_t *source);
+
 /** Enumerates active child sources used by this source */
 EXPORT void obs_source_enum_active_sources(obs_source_t *source, obs_source_enum_proc_t enum_callback, void *param);
 
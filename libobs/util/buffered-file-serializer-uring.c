@@ -0,0 +1,412 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "buffered-file-serializer-uring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <liburing.h>
+
+#include "bmem.h"
+#include "base.h"
+
+#define URING_BUFFER_COUNT 4
+#define URING_DIRECT_ALIGNMENT 4096
+
+/* fdatasync every 64 MiB so dirty pages don't pile up until close */
+static const uint64_t SYNC_INTERVAL = 64ULL * 1048576ULL;
+
+/* user_data of sync requests, write requests encode buffer index and size */
+#define SYNC_USER_DATA 0
+
+struct uring_buffer {
+	unsigned char *data;
+	unsigned int pending;
+};
+
+struct uring_writer {
+	struct io_uring ring;
+	bool registered;
+
+	int fd;
+	int buffered_fd;
+	bool direct;
+
+	size_t chunk_size;
+	struct uring_buffer buffers[URING_BUFFER_COUNT];
+	size_t current;
+	unsigned int in_flight;
+
+	/* unaligned tail carried into the next buffer (O_DIRECT only) */
+	unsigned char *carry;
+	size_t carry_size;
+	uint64_t carry_offset;
+
+	uint64_t bytes_since_sync;
+	bool error;
+};
+
+static inline uint64_t encode_user_data(size_t idx, size_t size)
+{
+	return ((uint64_t)(idx + 1) << 32) | (uint64_t)size;
+}
+
+static void handle_completion(struct uring_writer *w, struct io_uring_cqe *cqe)
+{
+	uint64_t user_data = io_uring_cqe_get_data64(cqe);
+
+	w->in_flight--;
+
+	if (user_data == SYNC_USER_DATA) {
+		if (cqe->res < 0) {
+			blog(LOG_WARNING, "io_uring fdatasync failed: %s", strerror(-cqe->res));
+		}
+		return;
+	}
+
+	size_t idx = (size_t)(user_data >> 32) - 1;
+	size_t size = (size_t)(user_data & 0xFFFFFFFF);
+
+	if (cqe->res < 0) {
+		blog(LOG_ERROR, "io_uring write failed: %s", strerror(-cqe->res));
+		w->error = true;
+	} else if ((size_t)cqe->res != size) {
+		blog(LOG_ERROR, "io_uring short write (%d != %zu)", cqe->res, size);
+		w->error = true;
+	}
+
+	w->buffers[idx].pending--;
+}
+
+static bool reap(struct uring_writer *w, bool wait)
+{
+	struct io_uring_cqe *cqe;
+
+	if (wait && w->in_flight) {
+		int ret;
+		do {
+			ret = io_uring_wait_cqe(&w->ring, &cqe);
+		} while (ret == -EINTR);
+
+		if (ret < 0) {
+			blog(LOG_ERROR, "io_uring_wait_cqe failed: %s", strerror(-ret));
+			w->error = true;
+			return false;
+		}
+	}
+
+	while (io_uring_peek_cqe(&w->ring, &cqe) == 0) {
+		handle_completion(w, cqe);
+		io_uring_cqe_seen(&w->ring, cqe);
+	}
+
+	return true;
+}
+
+/* Waits until everything in flight has completed */
+static bool drain(struct uring_writer *w)
+{
+	io_uring_submit(&w->ring);
+
+	while (w->in_flight) {
+		if (!reap(w, true))
+			return false;
+	}
+
+	return !w->error;
+}
+
+static struct io_uring_sqe *get_sqe(struct uring_writer *w)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&w->ring);
+
+	/* Submission queue full, push out what we have and wait for room */
+	while (!sqe) {
+		io_uring_submit(&w->ring);
+		if (!reap(w, true) || w->error)
+			return NULL;
+		sqe = io_uring_get_sqe(&w->ring);
+	}
+
+	return sqe;
+}
+
+static bool queue_write(struct uring_writer *w, int fd, size_t idx, size_t buf_offset, size_t size, uint64_t offset,
+			bool ordered)
+{
+	struct io_uring_sqe *sqe = get_sqe(w);
+	if (!sqe)
+		return false;
+
+	unsigned char *data = w->buffers[idx].data + buf_offset;
+
+	if (w->registered)
+		io_uring_prep_write_fixed(sqe, fd, data, (unsigned int)size, offset, (int)idx);
+	else
+		io_uring_prep_write(sqe, fd, data, (unsigned int)size, offset);
+
+	/* A drained request waits for everything before it and holds back
+	 * everything after it, so overwrites land in submission order. */
+	if (ordered)
+		io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+
+	io_uring_sqe_set_data64(sqe, encode_user_data(idx, size));
+
+	w->buffers[idx].pending++;
+	w->in_flight++;
+	return true;
+}
+
+static void queue_sync(struct uring_writer *w)
+{
+	struct io_uring_sqe *sqe = get_sqe(w);
+	if (!sqe)
+		return;
+
+	io_uring_prep_fsync(sqe, w->fd, IORING_FSYNC_DATASYNC);
+	io_uring_sqe_set_data64(sqe, SYNC_USER_DATA);
+
+	w->in_flight++;
+	w->bytes_since_sync = 0;
+}
+
+static int open_output(const char *path, bool direct)
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+	if (direct)
+		flags |= O_DIRECT;
+
+	return open(path, flags, 0644);
+}
+
+struct uring_writer *uring_writer_create(const char *path, size_t chunk_size, bool direct)
+{
+	struct uring_writer *w = bzalloc(sizeof(*w));
+	struct iovec iovecs[URING_BUFFER_COUNT];
+	int ret;
+
+	w->fd = -1;
+	w->buffered_fd = -1;
+	w->chunk_size = chunk_size;
+
+	ret = io_uring_queue_init(URING_BUFFER_COUNT * 4, &w->ring, 0);
+	if (ret < 0) {
+		blog(LOG_WARNING, "io_uring_queue_init failed: %s", strerror(-ret));
+		bfree(w);
+		return NULL;
+	}
+
+	if (direct) {
+		w->fd = open_output(path, true);
+		if (w->fd < 0) {
+			blog(LOG_INFO, "O_DIRECT not supported for '%s' (%s), using buffered I/O", path,
+			     strerror(errno));
+		} else {
+			w->direct = true;
+			w->buffered_fd = open(path, O_WRONLY | O_CLOEXEC);
+			if (w->buffered_fd < 0)
+				goto fail;
+		}
+	}
+
+	if (w->fd < 0) {
+		w->fd = open_output(path, false);
+		if (w->fd < 0)
+			goto fail;
+		w->buffered_fd = w->fd;
+	}
+
+	/* Buffers have room for the carried-over tail in addition to a full
+	 * chunk, and are aligned for O_DIRECT regardless. */
+	size_t buf_size = chunk_size + URING_DIRECT_ALIGNMENT;
+
+	for (size_t i = 0; i < URING_BUFFER_COUNT; i++) {
+		void *data = NULL;
+		if (posix_memalign(&data, URING_DIRECT_ALIGNMENT, buf_size) != 0) {
+			blog(LOG_ERROR, "Error allocating memory for output");
+			goto fail_buffers;
+		}
+
+		w->buffers[i].data = data;
+		iovecs[i].iov_base = w->buffers[i].data;
+		iovecs[i].iov_len = buf_size;
+	}
+
+	w->carry = bmalloc(URING_DIRECT_ALIGNMENT);
+
+	ret = io_uring_register_buffers(&w->ring, iovecs, URING_BUFFER_COUNT);
+	if (ret < 0) {
+		blog(LOG_INFO, "io_uring_register_buffers failed (%s), using unregistered buffers", strerror(-ret));
+	} else {
+		w->registered = true;
+	}
+
+	blog(LOG_DEBUG, "io_uring writer: %d buffers of %zu KiB%s%s", URING_BUFFER_COUNT, chunk_size / 1024,
+	     w->registered ? ", registered" : "", w->direct ? ", O_DIRECT" : "");
+	return w;
+
+fail_buffers:
+	for (size_t i = 0; i < URING_BUFFER_COUNT; i++)
+		free(w->buffers[i].data);
+	if (w->buffered_fd != w->fd)
+		close(w->buffered_fd);
+	close(w->fd);
+	io_uring_queue_exit(&w->ring);
+	bfree(w);
+	return NULL;
+
+fail:
+	blog(LOG_WARNING, "Failed to open '%s': %s", path, strerror(errno));
+	if (w->fd >= 0)
+		close(w->fd);
+	io_uring_queue_exit(&w->ring);
+	bfree(w);
+	return NULL;
+}
+
+bool uring_writer_destroy(struct uring_writer *w)
+{
+	bool success;
+
+	if (!w)
+		return true;
+
+	/* Buffers must not be freed while the kernel may still read them */
+	drain(w);
+
+	/* Only left over if the I/O thread bailed out early */
+	if (w->carry_size && !w->error) {
+		ssize_t written = pwrite(w->buffered_fd, w->carry, w->carry_size, (off_t)w->carry_offset);
+		if (written != (ssize_t)w->carry_size)
+			w->error = true;
+	}
+
+	if (fdatasync(w->fd) != 0)
+		blog(LOG_WARNING, "fdatasync failed: %s", strerror(errno));
+
+	if (w->registered)
+		io_uring_unregister_buffers(&w->ring);
+	io_uring_queue_exit(&w->ring);
+
+	if (w->buffered_fd != w->fd)
+		close(w->buffered_fd);
+	close(w->fd);
+
+	for (size_t i = 0; i < URING_BUFFER_COUNT; i++)
+		free(w->buffers[i].data);
+	bfree(w->carry);
+
+	success = !w->error;
+	bfree(w);
+	return success;
+}
+
+size_t uring_writer_acquire(struct uring_writer *w, unsigned char **buf)
+{
+	struct uring_buffer *buffer = &w->buffers[w->current];
+	size_t carried = w->carry_size;
+
+	while (buffer->pending) {
+		/* The kernel may still own the buffer, don't hand it out */
+		if (!reap(w, true)) {
+			w->error = true;
+			*buf = NULL;
+			return 0;
+		}
+	}
+
+	if (carried) {
+		memcpy(buffer->data, w->carry, carried);
+		w->carry_size = 0;
+	}
+
+	*buf = buffer->data;
+	return carried;
+}
+
+bool uring_writer_submit(struct uring_writer *w, size_t size, uint64_t offset, bool contiguous, bool ordered)
+{
+	size_t idx = w->current;
+
+	if (w->error)
+		return false;
+
+	if (!w->direct) {
+		if (!queue_write(w, w->fd, idx, 0, size, offset, ordered))
+			return false;
+	} else {
+		/* Split into an unaligned head, an aligned body that goes
+		 * through O_DIRECT, and a tail that is either carried into the
+		 * next chunk or written through the page cache. */
+		size_t head = (URING_DIRECT_ALIGNMENT - offset % URING_DIRECT_ALIGNMENT) % URING_DIRECT_ALIGNMENT;
+		if (head > size)
+			head = size;
+
+		/* Only happens for the first chunk after a seek. The head is
+		 * written synchronously so the rest can be moved to the
+		 * (aligned) start of the buffer. */
+		if (head) {
+			if (!drain(w))
+				return false;
+
+			ssize_t written = pwrite(w->buffered_fd, w->buffers[idx].data, head, (off_t)offset);
+			if (written != (ssize_t)head) {
+				blog(LOG_ERROR, "pwrite failed: %s", strerror(errno));
+				w->error = true;
+				return false;
+			}
+
+			memmove(w->buffers[idx].data, w->buffers[idx].data + head, size - head);
+			ordered = false;
+		}
+
+		uint64_t body_offset = offset + head;
+		size_t body = (size - head) & ~((size_t)URING_DIRECT_ALIGNMENT - 1);
+		size_t tail = size - head - body;
+
+		if (body) {
+			if (!queue_write(w, w->fd, idx, 0, body, body_offset, ordered))
+				return false;
+			ordered = false;
+		}
+
+		if (tail && contiguous) {
+			memcpy(w->carry, w->buffers[idx].data + body, tail);
+			w->carry_size = tail;
+			w->carry_offset = body_offset + body;
+		} else if (tail) {
+			if (!queue_write(w, w->buffered_fd, idx, body, tail, body_offset + body, ordered))
+				return false;
+		}
+	}
+
+	w->bytes_since_sync += size;
+	if (w->bytes_since_sync >= SYNC_INTERVAL)
+		queue_sync(w);
+
+	io_uring_submit(&w->ring);
+	reap(w, false);
+
+	w->current = (w->current + 1) % URING_BUFFER_COUNT;
+	return !w->error;
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * io_uring write backend used by the buffered file serializer's I/O thread
+ * (internal, Linux only).
+ *
+ * The writer owns a small ring of registered chunk buffers. The I/O thread
+ * acquires a buffer, fills it and submits it with an absolute file offset,
+ * so several chunks can be in flight at once. Writes that follow a seek are
+ * ordered behind everything already in flight, which keeps the overwrite
+ * semantics that muxers rely on for header fixups.
+ *
+ * With O_DIRECT only the block aligned part of a chunk is written directly,
+ * the remainder is carried over into the next buffer (see
+ * uring_writer_acquire), and unaligned writes fall back to a buffered file
+ * descriptor.
+ */
+
+struct uring_writer;
+
+struct uring_writer *uring_writer_create(const char *path, size_t chunk_size, bool direct);
+
+/* Returns false if the writer encountered an error */
+bool uring_writer_destroy(struct uring_writer *w);
+
+/* Waits for a free buffer, returns the amount of data carried over from the
+ * previous chunk that is already at the start of the buffer. Sets buf to NULL
+ * if waiting for the buffer failed. */
+size_t uring_writer_acquire(struct uring_writer *w, unsigned char **buf);
+
+/* Submits the acquired buffer to be written at offset. If contiguous is set
+ * the next chunk will continue right after this one, which permits carrying
+ * over an unaligned tail in O_DIRECT mode. If ordered is set the write will
+ * not start before all previous writes have completed. */
+bool uring_writer_submit(struct uring_writer *w, size_t size, uint64_t offset, bool contiguous, bool ordered);
@@ -21,19 +21,34 @@
 #include "platform.h"
 #include "threading.h"
 #include "deque.h"
+#include "darray.h"
 #include "dstr.h"
 
+#ifdef HAVE_LIBURING
+#include "buffered-file-serializer-uring.h"
+#endif
+
 static const size_t DEFAULT_BUF_SIZE = 256ULL * 1048576ULL; // 256 MiB
 static const size_t DEFAULT_CHUNK_SIZE = 1048576;           // 1 MiB
 
 /* ========================================================================== */
 /* Buffered writer based on ffmpeg-mux implementation                         */
 
+// Set in data_length if the header is followed by an io_ref instead of data
+#define IO_HEADER_REF (1ULL << 63)
+
 struct io_header {
 	uint64_t seek_offset;
 	uint64_t data_length;
 };
 
+// Data referenced by write_ref, release is only set on the last piece
+struct io_ref {
+	const uint8_t *data;
+	void (*release)(void *);
+	void *param;
+};
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -43,9 +58,15 @@ struct io_buffer {
 	pthread_t io_thread;
 	pthread_mutex_t data_mutex;
 	FILE *output_file;
+#ifdef HAVE_LIBURING
+	struct uring_writer *uring;
+#endif
 	struct deque data;
 	uint64_t next_pos;
 
+	// Bytes queued by reference, counted against buffer_size
+	size_t ref_bytes;
+
 	size_t buffer_size;
 	size_t chunk_size;
 };
@@ -55,6 +76,17 @@ struct file_output_data {
 	struct io_buffer io;
 };
 
+// Data has been copied into the chunk, referenced buffers can go
+static void release_refs(struct darray *refs)
+{
+	struct io_ref *array = refs->array;
+
+	for (size_t i = 0; i < refs->num; i++)
+		array[i].release(array[i].param);
+
+	refs->num = 0;
+}
+
 static void *io_thread(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -63,8 +95,23 @@ static void *io_thread(void *opaque)
 	// Chunk collects the writes into a larger batch
 	size_t chunk_used = 0;
 	size_t chunk_size = out->io.chunk_size;
+	unsigned char *chunk = NULL;
+
+	// References that were copied into the chunk, released after unlocking
+	DARRAY(struct io_ref) consumed_refs;
+	da_init(consumed_refs);
+
+#ifdef HAVE_LIBURING
+	// The io_uring writer hands out its own (registered) buffers and may
+	// carry a few bytes over from the previous chunk to keep O_DIRECT
+	// writes aligned, so the chunk can start out partially filled.
+	if (out->io.uring) {
+		chunk_used = uring_writer_acquire(out->io.uring, &chunk);
+		chunk_size = out->io.chunk_size + chunk_used;
+	} else
+#endif
+		chunk = bmalloc(chunk_size);
 
-	unsigned char *chunk = bmalloc(chunk_size);
 	if (!chunk) {
 		os_atomic_set_bool(&out->io.output_error, true);
 		fprintf(stderr, "Error allocating memory for output\n");
@@ -74,6 +121,10 @@ static void *io_thread(void *opaque)
 	bool shutting_down;
 	bool want_seek = false;
 	bool force_flush_chunk = false;
+#ifdef HAVE_LIBURING
+	bool flush_for_seek = false;
+	bool ordered_write = false;
+#endif
 
 	// current_seek_position is a virtual position updated as we read from
 	// the buffer, if it becomes discontinuous due to a seek request we
@@ -107,6 +158,9 @@ static void *io_thread(void *opaque)
 				struct io_header header;
 				deque_peek_front(&out->io.data, &header, sizeof(header));
 
+				bool is_ref = (header.data_length & IO_HEADER_REF) != 0;
+				header.data_length &= ~IO_HEADER_REF;
+
 				// Do we need to seek?
 				if (header.seek_offset != current_seek_position) {
 
@@ -115,6 +169,9 @@ static void *io_thread(void *opaque)
 					// if we already plan to seek, then seek.
 					if (chunk_used || want_seek) {
 						force_flush_chunk = true;
+#ifdef HAVE_LIBURING
+						flush_for_seek = true;
+#endif
 						break;
 					}
 
@@ -136,8 +193,19 @@ static void *io_thread(void *opaque)
 				// Remove header that we already read
 				deque_pop_front(&out->io.data, NULL, sizeof(header));
 
-				// Copy from the buffer to our local chunk
-				deque_pop_front(&out->io.data, chunk + chunk_used, header.data_length);
+				// Copy from the buffer (or referenced data) to our
+				// local chunk
+				if (is_ref) {
+					struct io_ref ref;
+					deque_pop_front(&out->io.data, &ref, sizeof(ref));
+					memcpy(chunk + chunk_used, ref.data, header.data_length);
+					out->io.ref_bytes -= header.data_length;
+
+					if (ref.release)
+						da_push_back(consumed_refs, &ref);
+				} else {
+					deque_pop_front(&out->io.data, chunk + chunk_used, header.data_length);
+				}
 
 				// Update offsets
 				chunk_used += header.data_length;
@@ -153,14 +221,23 @@ static void *io_thread(void *opaque)
 			if (!force_flush_chunk && (!chunk_used || (chunk_used < 65536 && !shutting_down))) {
 				os_event_reset(out->io.new_data_available_event);
 				pthread_mutex_unlock(&out->io.data_mutex);
+				release_refs(&consumed_refs.da);
 				break;
 			}
 
 			pthread_mutex_unlock(&out->io.data_mutex);
+			release_refs(&consumed_refs.da);
 
 			// Seek if we need to
 			if (want_seek) {
-				os_fseeki64(out->io.output_file, next_seek_position, SEEK_SET);
+#ifdef HAVE_LIBURING
+				// Writes are positional, but anything after a seek
+				// may overwrite data that is still in flight.
+				if (out->io.uring)
+					ordered_write = true;
+				else
+#endif
+					os_fseeki64(out->io.output_file, next_seek_position, SEEK_SET);
 
 				// Update the next virtual position, making sure to take
 				// into account the size of the chunk we're about to write.
@@ -176,6 +253,35 @@ static void *io_thread(void *opaque)
 				}
 			}
 
+#ifdef HAVE_LIBURING
+			if (out->io.uring) {
+				uint64_t chunk_offset = current_seek_position - chunk_used;
+				bool contiguous = !flush_for_seek && !shutting_down;
+
+				if (!uring_writer_submit(out->io.uring, chunk_used, chunk_offset, contiguous,
+							 ordered_write)) {
+					blog(LOG_ERROR, "Error writing to '%s'", out->filename.array);
+					os_atomic_set_bool(&out->io.output_error, true);
+
+					goto error;
+				}
+
+				chunk_used = uring_writer_acquire(out->io.uring, &chunk);
+				if (!chunk) {
+					blog(LOG_ERROR, "Error writing to '%s'", out->filename.array);
+					os_atomic_set_bool(&out->io.output_error, true);
+
+					goto error;
+				}
+
+				chunk_size = out->io.chunk_size + chunk_used;
+				ordered_write = false;
+				flush_for_seek = false;
+				force_flush_chunk = false;
+				continue;
+			}
+#endif
+
 			// Write the current chunk to the output file
 			size_t bytes_written = fwrite(chunk, 1, chunk_used, out->io.output_file);
 			if (bytes_written != chunk_used) {
@@ -196,6 +302,17 @@ static void *io_thread(void *opaque)
 	}
 
 error:
+	da_free(consumed_refs);
+
+#ifdef HAVE_LIBURING
+	if (out->io.uring) {
+		if (!uring_writer_destroy(out->io.uring))
+			os_atomic_set_bool(&out->io.output_error, true);
+		out->io.uring = NULL;
+		return NULL;
+	}
+#endif
+
 	if (chunk)
 		bfree(chunk);
 
@@ -246,6 +363,14 @@ static inline size_t min(size_t a, size_t b)
 }
 #endif
 
+static inline size_t get_free_space(struct io_buffer *io)
+{
+	size_t cap = max(io->data.capacity, io->buffer_size);
+	size_t used = io->data.size + io->ref_bytes;
+
+	return cap > used ? cap - used : 0;
+}
+
 static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 {
 	struct file_output_data *out = opaque;
@@ -266,8 +391,7 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 		size_t next_chunk_size = min(remaining, out->io.chunk_size);
 
 		// Avoid unbounded growth of the deque, cap to buffer_size
-		size_t cap = max(out->io.data.capacity, out->io.buffer_size);
-		size_t free_space = cap - out->io.data.size;
+		size_t free_space = get_free_space(&out->io);
 
 		if (free_space < next_chunk_size + sizeof(struct io_header)) {
 			blog(LOG_DEBUG, "Waiting for I/O thread...");
@@ -309,6 +433,95 @@ static size_t file_output_write(void *opaque, const void *buf, size_t buf_size)
 	return buf_size - remaining;
 }
 
+static size_t file_output_write_ref(void *opaque, const void *buf, size_t buf_size, void (*release)(void *),
+				    void *param)
+{
+	struct file_output_data *out = opaque;
+
+	if (!buf_size) {
+		if (release)
+			release(param);
+		return 0;
+	}
+
+	// Same as file_output_write, except that only a reference to the data
+	// is queued. The I/O thread copies it straight into its chunk and calls
+	// release once the last piece has been consumed.
+	uintptr_t ptr = (uintptr_t)buf;
+	size_t remaining = buf_size;
+
+	while (remaining) {
+		if (os_atomic_load_bool(&out->io.output_error)) {
+			// The I/O thread has exited and won't touch any
+			// queued pieces, so the data can be released here.
+			if (release)
+				release(param);
+			return 0;
+		}
+
+		pthread_mutex_lock(&out->io.data_mutex);
+
+		size_t next_chunk_size = min(remaining, out->io.chunk_size);
+		size_t entry_size = sizeof(struct io_header) + sizeof(struct io_ref);
+
+		if (get_free_space(&out->io) < next_chunk_size + entry_size) {
+			blog(LOG_DEBUG, "Waiting for I/O thread...");
+			os_event_reset(out->io.buffer_space_available_event);
+			pthread_mutex_unlock(&out->io.data_mutex);
+			os_event_wait(out->io.buffer_space_available_event);
+			continue;
+		}
+
+		while (remaining && get_free_space(&out->io) >= next_chunk_size + entry_size) {
+			struct io_header header = {
+				.data_length = next_chunk_size | IO_HEADER_REF,
+				.seek_offset = out->io.next_pos,
+			};
+			struct io_ref ref = {
+				.data = (const uint8_t *)ptr,
+				.release = remaining == next_chunk_size ? release : NULL,
+				.param = param,
+			};
+
+			deque_push_back(&out->io.data, &header, sizeof(header));
+			deque_push_back(&out->io.data, &ref, sizeof(ref));
+
+			out->io.ref_bytes += next_chunk_size;
+			out->io.next_pos += next_chunk_size;
+
+			remaining -= next_chunk_size;
+			ptr += next_chunk_size;
+			next_chunk_size = min(remaining, out->io.chunk_size);
+		}
+
+		os_event_signal(out->io.new_data_available_event);
+
+		pthread_mutex_unlock(&out->io.data_mutex);
+	}
+
+	return buf_size;
+}
+
+// Releases references the I/O thread did not get to because of an error
+static void release_pending_refs(struct io_buffer *io)
+{
+	while (io->data.size) {
+		struct io_header header;
+		deque_pop_front(&io->data, &header, sizeof(header));
+
+		if (header.data_length & IO_HEADER_REF) {
+			struct io_ref ref;
+			deque_pop_front(&io->data, &ref, sizeof(ref));
+			if (ref.release)
+				ref.release(ref.param);
+		} else {
+			deque_pop_front(&io->data, NULL, header.data_length);
+		}
+	}
+
+	io->ref_bytes = 0;
+}
+
 static int64_t file_output_get_pos(void *opaque)
 {
 	struct file_output_data *out = opaque;
@@ -325,6 +538,12 @@ bool buffered_file_serializer_init_defaults(struct serializer *s, const char *pa
 }
 
 bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size)
+{
+	return buffered_file_serializer_init_ex(s, path, max_bufsize, chunk_size, 0);
+}
+
+bool buffered_file_serializer_init_ex(struct serializer *s, const char *path, size_t max_bufsize, size_t chunk_size,
+				      uint32_t flags)
 {
 	struct file_output_data *out;
 
@@ -332,13 +551,31 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 
 	dstr_init_copy(&out->filename, path);
 
-	out->io.output_file = os_fopen(path, "wb");
-	if (!out->io.output_file)
-		return false;
-
 	out->io.buffer_size = max_bufsize ? max_bufsize : DEFAULT_BUF_SIZE;
 	out->io.chunk_size = chunk_size ? chunk_size : DEFAULT_CHUNK_SIZE;
 
+#ifdef HAVE_LIBURING
+	if (flags & BUFFERED_FILE_SERIALIZER_IO_URING) {
+		bool direct = (flags & BUFFERED_FILE_SERIALIZER_DIRECT_IO) != 0;
+		out->io.uring = uring_writer_create(path, out->io.chunk_size, direct);
+		if (!out->io.uring)
+			blog(LOG_WARNING, "io_uring unavailable for '%s', falling back to stdio", path);
+	}
+
+	if (!out->io.uring)
+#else
+	if (flags & BUFFERED_FILE_SERIALIZER_IO_URING)
+		blog(LOG_DEBUG, "io_uring support not compiled in, using stdio");
+#endif
+	{
+		out->io.output_file = os_fopen(path, "wb");
+		if (!out->io.output_file) {
+			dstr_free(&out->filename);
+			bfree(out);
+			return false;
+		}
+	}
+
 	// Start at 1MB, this can grow up to max_bufsize depending
 	// on how fast data is going in and out.
 	deque_reserve(&out->io.data, 1048576);
@@ -360,6 +597,31 @@ bool buffered_file_serializer_init(struct serializer *s, const char *path, size_
 	return true;
 }
 
+size_t buffered_file_serializer_write_ref(struct serializer *s, const void *data, size_t size,
+					  void (*release)(void *), void *param)
+{
+	size_t written;
+
+	if (s && s->write == file_output_write && data && size)
+		return file_output_write_ref(s->data, data, size, release, param);
+
+	written = s_write(s, data, size);
+	if (release)
+		release(param);
+	return written;
+}
+
+bool buffered_file_serializer_io_uring_active(const struct serializer *s)
+{
+#ifdef HAVE_LIBURING
+	const struct file_output_data *out = s->data;
+	return out && out->io.uring;
+#else
+	UNUSED_PARAMETER(s);
+	return false;
+#endif
+}
+
 void buffered_file_serializer_free(struct serializer *s)
 {
 	struct file_output_data *out = s->data;
@@ -376,6 +638,8 @@ void buffered_file_serializer_free(struct serializer *s)
 		pthread_mutex_unlock(&out->io.data_mutex);
 		pthread_join(out->io.io_thread, NULL);
 
+		release_pending_refs(&out->io);
+
 		os_event_destroy(out->io.new_data_available_event);
 		os_event_destroy(out->io.buffer_space_available_event);
 
@@ -22,11 +22,29 @@
 extern "C" {
 #endif
 
+/* Write through io_uring with several chunks in flight (Linux only, falls back
+ * to the stdio writer if unavailable) */
+#define BUFFERED_FILE_SERIALIZER_IO_URING (1 << 0)
+/* Open the file with O_DIRECT, requires BUFFERED_FILE_SERIALIZER_IO_URING */
+#define BUFFERED_FILE_SERIALIZER_DIRECT_IO (1 << 1)
+
 EXPORT bool buffered_file_serializer_init_defaults(struct serializer *s, const char *path);
 EXPORT bool buffered_file_serializer_init(struct serializer *s, const char *path, size_t max_bufsize,
 					  size_t chunk_size);
+EXPORT bool buffered_file_serializer_init_ex(struct serializer *s, const char *path, size_t max_bufsize,
+					     size_t chunk_size, uint32_t flags);
 EXPORT void buffered_file_serializer_free(struct serializer *s);
 
+/* Writes data without copying it if s is a buffered file serializer, otherwise
+ * falls back to a regular write.  release(param) is called once the data is no
+ * longer needed, which may happen on the I/O thread. */
+EXPORT size_t buffered_file_serializer_write_ref(struct serializer *s, const void *data, size_t size,
+						 void (*release)(void *), void *param);
+
+/* Whether writes go through io_uring, false if it was not requested or fell
+ * back to stdio */
+EXPORT bool buffered_file_serializer_io_uring_active(const struct serializer *s);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,18 +3,49 @@
 #include <obs-module.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <util/darray.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
 #include <string.h>
+#include <inttypes.h>
+
+#define VIRTUALCAM_BUFFER_COUNT 4
+
+struct virtualcam_buffer {
+	void *start;
+	size_t length;
+};
 
 struct virtualcam_data {
 	obs_output_t *output;
 	int device;
 	uint32_t frame_size;
+	uint32_t width;
+	uint32_t height;
+
+	/* mmap streaming, falls back to write() if the device refuses */
+	bool use_mmap;
+	struct virtualcam_buffer *buffers;
+	uint32_t buffer_count;
+
+	pthread_mutex_t buffer_mutex;
+	DARRAY(uint32_t) free_buffers;
+	DARRAY(uint32_t) filled_buffers;
+
+	pthread_t queue_thread;
+	bool queue_thread_active;
+	volatile bool stopping;
+	os_sem_t *queue_sem;
+
+	uint64_t frames_sent;
+	uint64_t frames_dropped;
 };
 
 static const char *virtualcam_name(void *unused)
@@ -26,7 +57,11 @@ static const char *virtualcam_name(void *unused)
 static void virtualcam_destroy(void *data)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
-	close(vcam->device);
+	if (vcam->device >= 0)
+		close(vcam->device);
+	da_free(vcam->free_buffers);
+	da_free(vcam->filled_buffers);
+	pthread_mutex_destroy(&vcam->buffer_mutex);
 	bfree(data);
 }
 
@@ -105,11 +140,195 @@ static void *virtualcam_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)bzalloc(sizeof(*vcam));
 	vcam->output = output;
+	vcam->device = -1;
+
+	if (pthread_mutex_init(&vcam->buffer_mutex, NULL) != 0) {
+		bfree(vcam);
+		return NULL;
+	}
 
 	UNUSED_PARAMETER(settings);
 	return vcam;
 }
 
+static void unmap_buffers(struct virtualcam_data *vcam)
+{
+	for (uint32_t i = 0; i < vcam->buffer_count; i++) {
+		if (vcam->buffers[i].start && vcam->buffers[i].start != MAP_FAILED)
+			munmap(vcam->buffers[i].start, vcam->buffers[i].length);
+	}
+
+	bfree(vcam->buffers);
+	vcam->buffers = NULL;
+	vcam->buffer_count = 0;
+
+	da_resize(vcam->free_buffers, 0);
+	da_resize(vcam->filled_buffers, 0);
+}
+
+static void release_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req = {0};
+
+	unmap_buffers(vcam);
+
+	req.count = 0;
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+	ioctl(vcam->device, VIDIOC_REQBUFS, &req);
+}
+
+static bool map_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req = {0};
+
+	req.count = VIRTUALCAM_BUFFER_COUNT;
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+
+	if (ioctl(vcam->device, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+		blog(LOG_INFO, "Virtual camera: mmap buffers unavailable (%s), using write()", strerror(errno));
+		return false;
+	}
+
+	vcam->buffer_count = req.count;
+	vcam->buffers = bzalloc(req.count * sizeof(struct virtualcam_buffer));
+
+	for (uint32_t i = 0; i < req.count; i++) {
+		struct v4l2_buffer buf = {0};
+		buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+
+		if (ioctl(vcam->device, VIDIOC_QUERYBUF, &buf) < 0) {
+			blog(LOG_WARNING, "Virtual camera: failed to query buffer %" PRIu32 " (%s)", i,
+			     strerror(errno));
+			goto fail;
+		}
+
+		if (buf.length < vcam->frame_size) {
+			blog(LOG_WARNING, "Virtual camera: buffer %" PRIu32 " too small (%" PRIu32 " < %" PRIu32 ")",
+			     i, buf.length, vcam->frame_size);
+			goto fail;
+		}
+
+		vcam->buffers[i].length = buf.length;
+		vcam->buffers[i].start =
+			mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, vcam->device, buf.m.offset);
+
+		if (vcam->buffers[i].start == MAP_FAILED) {
+			blog(LOG_WARNING, "Virtual camera: mmap for buffer %" PRIu32 " failed (%s)", i,
+			     strerror(errno));
+			goto fail;
+		}
+
+		/* output buffers start out owned by us */
+		da_push_back(vcam->free_buffers, &i);
+	}
+
+	return true;
+
+fail:
+	release_buffers(vcam);
+	return false;
+}
+
+/* Reclaims every buffer the driver is done with without blocking. */
+static void dequeue_buffers(struct virtualcam_data *vcam)
+{
+	struct pollfd pfd = {.fd = vcam->device, .events = POLLOUT};
+
+	while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLOUT)) {
+		struct v4l2_buffer buf = {0};
+		buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+		buf.memory = V4L2_MEMORY_MMAP;
+
+		if (ioctl(vcam->device, VIDIOC_DQBUF, &buf) < 0)
+			break;
+
+		pthread_mutex_lock(&vcam->buffer_mutex);
+		da_push_back(vcam->free_buffers, &buf.index);
+		pthread_mutex_unlock(&vcam->buffer_mutex);
+	}
+}
+
+static void *queue_thread(void *data)
+{
+	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
+
+	os_set_thread_name("v4l2-output: queue thread");
+
+	while (os_sem_wait(vcam->queue_sem) == 0) {
+		if (os_atomic_load_bool(&vcam->stopping))
+			break;
+
+		dequeue_buffers(vcam);
+
+		for (;;) {
+			struct v4l2_buffer buf = {0};
+			bool have_buffer = false;
+
+			pthread_mutex_lock(&vcam->buffer_mutex);
+			if (vcam->filled_buffers.num) {
+				buf.index = vcam->filled_buffers.array[0];
+				da_erase(vcam->filled_buffers, 0);
+				have_buffer = true;
+			}
+			pthread_mutex_unlock(&vcam->buffer_mutex);
+
+			if (!have_buffer)
+				break;
+
+			buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+			buf.memory = V4L2_MEMORY_MMAP;
+			buf.bytesused = vcam->frame_size;
+			buf.field = V4L2_FIELD_NONE;
+
+			if (ioctl(vcam->device, VIDIOC_QBUF, &buf) < 0) {
+				blog(LOG_DEBUG, "Virtual camera: failed to queue buffer %" PRIu32 " (%s)", buf.index,
+				     strerror(errno));
+
+				pthread_mutex_lock(&vcam->buffer_mutex);
+				da_push_back(vcam->free_buffers, &buf.index);
+				pthread_mutex_unlock(&vcam->buffer_mutex);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static bool start_queue_thread(struct virtualcam_data *vcam)
+{
+	os_atomic_set_bool(&vcam->stopping, false);
+
+	if (os_sem_init(&vcam->queue_sem, 0) != 0)
+		return false;
+
+	if (pthread_create(&vcam->queue_thread, NULL, queue_thread, vcam) != 0) {
+		os_sem_destroy(vcam->queue_sem);
+		vcam->queue_sem = NULL;
+		return false;
+	}
+
+	vcam->queue_thread_active = true;
+	return true;
+}
+
+static void stop_queue_thread(struct virtualcam_data *vcam)
+{
+	if (!vcam->queue_thread_active)
+		return;
+
+	os_atomic_set_bool(&vcam->stopping, true);
+	os_sem_post(vcam->queue_sem);
+	pthread_join(vcam->queue_thread, NULL);
+	os_sem_destroy(vcam->queue_sem);
+
+	vcam->queue_sem = NULL;
+	vcam->queue_thread_active = false;
+}
+
 static bool try_connect(void *data, const char *device)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
@@ -120,7 +339,11 @@ static bool try_connect(void *data, const char *device)
 	uint32_t width = obs_output_get_width(vcam->output);
 	uint32_t height = obs_output_get_height(vcam->output);
 
+	vcam->width = width;
+	vcam->height = height;
 	vcam->frame_size = width * height * 2;
+	vcam->frames_sent = 0;
+	vcam->frames_dropped = 0;
 
 	vcam->device = open(device, O_RDWR);
 
@@ -165,18 +388,33 @@ static bool try_connect(void *data, const char *device)
 	memset(&parm, 0, sizeof(parm));
 	parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
+	vcam->use_mmap = map_buffers(vcam);
+
+	if (vcam->use_mmap && !start_queue_thread(vcam)) {
+		release_buffers(vcam);
+		vcam->use_mmap = false;
+	}
+
 	if (ioctl(vcam->device, VIDIOC_STREAMON, &parm) < 0) {
 		blog(LOG_ERROR, "Failed to start streaming on '%s' (%s)", device, strerror(errno));
-		goto fail_close_device;
+		goto fail_stop_thread;
 	}
 
-	blog(LOG_INFO, "Virtual camera started");
+	blog(LOG_INFO, "Virtual camera started (%s)", vcam->use_mmap ? "mmap" : "write");
 	obs_output_begin_data_capture(vcam->output, 0);
 
 	return true;
 
+fail_stop_thread:
+	if (vcam->use_mmap) {
+		stop_queue_thread(vcam);
+		release_buffers(vcam);
+		vcam->use_mmap = false;
+	}
+
 fail_close_device:
 	close(vcam->device);
+	vcam->device = -1;
 	return false;
 }
 
@@ -241,20 +479,80 @@ static void virtualcam_stop(void *data, uint64_t ts)
 	struct v4l2_streamparm parm = {0};
 	parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
+	if (vcam->use_mmap)
+		stop_queue_thread(vcam);
+
 	if (ioctl(vcam->device, VIDIOC_STREAMOFF, &parm) < 0) {
 		blog(LOG_WARNING, "Failed to stop streaming on video device %d (%s)", vcam->device, strerror(errno));
 	}
 
+	if (vcam->use_mmap) {
+		release_buffers(vcam);
+		vcam->use_mmap = false;
+	}
+
 	close(vcam->device);
-	blog(LOG_INFO, "Virtual camera stopped");
+	vcam->device = -1;
+	blog(LOG_INFO, "Virtual camera stopped (%" PRIu64 " frames sent, %" PRIu64 " dropped)", vcam->frames_sent,
+	     vcam->frames_dropped);
 
 	UNUSED_PARAMETER(ts);
 }
 
+static void copy_frame(struct virtualcam_data *vcam, uint8_t *dst, const struct video_data *frame)
+{
+	const uint32_t row_size = vcam->width * 2;
+
+	if (frame->linesize[0] == row_size) {
+		memcpy(dst, frame->data[0], vcam->frame_size);
+		return;
+	}
+
+	for (uint32_t y = 0; y < vcam->height; y++)
+		memcpy(dst + y * row_size, frame->data[0] + y * frame->linesize[0], row_size);
+}
+
+/* Never blocks the video-io thread: if the reader hasn't handed any buffer
+ * back yet, the frame is dropped. */
+static void virtual_video_mmap(struct virtualcam_data *vcam, struct video_data *frame)
+{
+	uint32_t index = 0;
+	bool have_buffer = false;
+
+	pthread_mutex_lock(&vcam->buffer_mutex);
+	if (vcam->free_buffers.num) {
+		index = vcam->free_buffers.array[vcam->free_buffers.num - 1];
+		da_pop_back(vcam->free_buffers);
+		have_buffer = true;
+	}
+	pthread_mutex_unlock(&vcam->buffer_mutex);
+
+	if (have_buffer) {
+		copy_frame(vcam, vcam->buffers[index].start, frame);
+
+		pthread_mutex_lock(&vcam->buffer_mutex);
+		da_push_back(vcam->filled_buffers, &index);
+		pthread_mutex_unlock(&vcam->buffer_mutex);
+
+		vcam->frames_sent++;
+	} else {
+		vcam->frames_dropped++;
+	}
+
+	/* wake the queue thread either way so it can reclaim buffers */
+	os_sem_post(vcam->queue_sem);
+}
+
 static void virtual_video(void *param, struct video_data *frame)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)param;
 	uint32_t frame_size = vcam->frame_size;
+
+	if (vcam->use_mmap) {
+		virtual_video_mmap(vcam, frame);
+		return;
+	}
+
 	while (frame_size > 0) {
 		ssize_t written = write(vcam->device, frame->data[0], vcam->frame_size);
 		if (written == -1)
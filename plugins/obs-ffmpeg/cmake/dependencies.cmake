@@ -8,6 +8,10 @@ if(NOT TARGET OBS::media-playback)
   add_subdirectory("${CMAKE_SOURCE_DIR}/shared/media-playback" "${CMAKE_BINARY_DIR}/shared/media-playback")
 endif()
 
+if(NOT TARGET OBS::congestion-control)
+  add_subdirectory("${CMAKE_SOURCE_DIR}/shared/congestion-control" "${CMAKE_BINARY_DIR}/shared/congestion-control")
+endif()
+
 if(NOT TARGET OBS::opts-parser)
   add_subdirectory("${CMAKE_SOURCE_DIR}/shared/opts-parser" "${CMAKE_BINARY_DIR}/shared/opts-parser")
 endif()
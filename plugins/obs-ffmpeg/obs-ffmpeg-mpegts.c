@@ -16,6 +16,10 @@
 ******************************************************************************/
 
 #include <obs-module.h>
+#include <obs-avc.h>
+#ifdef ENABLE_HEVC
+#include <obs-hevc.h>
+#endif
 #include <util/deque.h>
 #include <util/threading.h>
 #include <util/dstr.h>
@@ -38,6 +42,16 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define error(format, ...) do_log(LOG_ERROR, format, ##__VA_ARGS__)
 
+#define OPT_DROP_FRAMES "drop_frames"
+
+struct mpegts_packet {
+	AVPacket *packet;
+	int64_t dts_usec;
+	int drop_priority;
+	bool video;
+	bool keyframe;
+};
+
 static void ffmpeg_mpegts_set_last_error(struct ffmpeg_data *data, const char *error)
 {
 	if (data->last_error)
@@ -621,10 +635,13 @@ static void *ffmpeg_mpegts_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_output *data = bzalloc(sizeof(struct ffmpeg_output));
 	pthread_mutex_init_value(&data->write_mutex);
+	pthread_mutex_init_value(&data->cc.mutex);
 	data->output = output;
 
 	if (pthread_mutex_init(&data->write_mutex, NULL) != 0)
 		goto fail;
+	if (!congestion_init(&data->cc, output))
+		goto fail;
 	if (os_event_init(&data->stop_event, OS_EVENT_TYPE_AUTO) != 0)
 		goto fail;
 	if (os_sem_init(&data->write_sem, 0) != 0)
@@ -637,6 +654,7 @@ static void *ffmpeg_mpegts_create(obs_data_t *settings, obs_output_t *output)
 
 fail:
 	pthread_mutex_destroy(&data->write_mutex);
+	congestion_free(&data->cc);
 	os_event_destroy(data->stop_event);
 	bfree(data);
 	return NULL;
@@ -655,8 +673,10 @@ static void ffmpeg_mpegts_destroy(void *data)
 			pthread_join(output->start_thread, NULL);
 
 		pthread_mutex_destroy(&output->write_mutex);
+		congestion_free(&output->cc);
 		os_sem_destroy(output->write_sem);
 		os_event_destroy(output->stop_event);
+		deque_free(&output->queue);
 		bfree(data);
 	}
 }
@@ -682,25 +702,22 @@ static uint64_t get_packet_sys_dts(struct ffmpeg_output *output, AVPacket *packe
 
 static int mpegts_process_packet(struct ffmpeg_output *output)
 {
+	struct mpegts_packet entry;
 	AVPacket *packet = NULL;
+	bool app_limited = false;
 	int ret = 0;
 
 	pthread_mutex_lock(&output->write_mutex);
-	if (output->packets.num) {
-		packet = output->packets.array[0];
-		da_erase(output->packets, 0);
+	if (output->queue.size) {
+		deque_pop_front(&output->queue, &entry, sizeof(entry));
+		packet = entry.packet;
+		app_limited = output->queue.size == 0;
 	}
 	pthread_mutex_unlock(&output->write_mutex);
 
 	if (!packet)
 		return 0;
 
-	//blog(LOG_DEBUG,
-	//     "size = %d, flags = %lX, stream = %d, "
-	//     "packets queued: %lu",
-	//     packet->size, packet->flags, packet->stream_index,
-	//     output->packets.num);
-
 	if (stopping(output)) {
 		uint64_t sys_ts = get_packet_sys_dts(output, packet);
 		if (sys_ts >= output->stop_ts) {
@@ -708,10 +725,14 @@ static int mpegts_process_packet(struct ffmpeg_output *output)
 			goto end;
 		}
 	}
+
 	output->total_bytes += packet->size;
-	uint8_t *buf = packet->data;
 	ret = av_interleaved_write_frame(output->ff_data.output, packet);
-	av_freep(&buf);
+
+	/* the round trip time isn't available through the URL context, so
+	 * only the send throughput is measured */
+	if (output->cc.dbr_enabled)
+		congestion_add_sample(&output->cc, os_gettime_ns(), output->total_bytes, 0, app_limited);
 
 	if (ret < 0) {
 		ffmpeg_mpegts_log_error(LOG_WARNING, &output->ff_data, "process_packet: Error writing packet: %s",
@@ -773,6 +794,17 @@ static bool get_extradata(struct ffmpeg_output *stream)
 }
 
 /* set ffmpeg_config & init write_thread & capture */
+static void init_frame_dropping(struct ffmpeg_output *stream, obs_data_t *settings)
+{
+	stream->min_priority = 0;
+	stream->dropped_frames = 0;
+	stream->last_dts_usec = 0;
+
+	/* dropping frames is opt-in, SRT and RIST have their own latency
+	 * budget and retransmission */
+	congestion_start(&stream->cc, settings, obs_data_get_bool(settings, OPT_DROP_FRAMES));
+}
+
 static bool set_config(struct ffmpeg_output *stream)
 {
 	struct ffmpeg_cfg config;
@@ -895,6 +927,7 @@ static bool set_config(struct ffmpeg_output *stream)
 	settings = obs_output_get_settings(stream->output);
 	obs_data_set_default_string(settings, "muxer_settings", "");
 	config.muxer_settings = obs_data_get_string(settings, "muxer_settings");
+	init_frame_dropping(stream, settings);
 	obs_data_release(settings);
 	config.protocol_settings = "";
 
@@ -1014,11 +1047,17 @@ static void ffmpeg_mpegts_deactivate(struct ffmpeg_output *output)
 
 	pthread_mutex_lock(&output->write_mutex);
 
-	for (size_t i = 0; i < output->packets.num; i++)
-		av_packet_free(output->packets.array + i);
-	da_free(output->packets);
+	while (output->queue.size) {
+		struct mpegts_packet entry;
+		deque_pop_front(&output->queue, &entry, sizeof(entry));
+		av_packet_free(&entry.packet);
+	}
+	deque_free(&output->queue);
 
 	pthread_mutex_unlock(&output->write_mutex);
+
+	/* reset bitrate on stop */
+	congestion_stop(&output->cc);
 }
 
 static uint64_t ffmpeg_mpegts_total_bytes(void *data)
@@ -1033,8 +1072,96 @@ static inline int64_t rescale_ts2(AVStream *stream, AVRational codec_time_base,
 				AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
 }
 
+static int get_drop_priority(struct encoder_packet *packet)
+{
+	const char *const codec = obs_encoder_get_codec(packet->encoder);
+
+	if (strcmp(codec, "h264") == 0)
+		return obs_parse_avc_packet_priority(packet);
+#ifdef ENABLE_HEVC
+	if (strcmp(codec, "hevc") == 0)
+		return obs_parse_hevc_packet_priority(packet);
+#endif
+
+	return packet->keyframe ? OBS_NAL_PRIORITY_HIGHEST : packet->priority;
+}
+
+static void drop_frames(struct ffmpeg_output *stream, int highest_priority)
+{
+	size_t count = stream->queue.size / sizeof(struct mpegts_packet);
+	size_t kept = 0;
+	int num_frames_dropped = 0;
+
+	/* walk the queue from the front and move the packets that are kept
+	 * forward in place, then cut off what's left at the back */
+	for (size_t i = 0; i < count; i++) {
+		struct mpegts_packet *entry = deque_data(&stream->queue, i * sizeof(*entry));
+
+		/* do not drop audio data or video keyframes */
+		if (!entry->video || entry->drop_priority >= highest_priority) {
+			if (kept != i)
+				*(struct mpegts_packet *)deque_data(&stream->queue, kept * sizeof(*entry)) = *entry;
+			kept++;
+		} else {
+			num_frames_dropped++;
+			av_packet_free(&entry->packet);
+		}
+	}
+
+	if (kept < count)
+		deque_pop_back(&stream->queue, NULL, (count - kept) * sizeof(struct mpegts_packet));
+
+	if (stream->min_priority < highest_priority)
+		stream->min_priority = highest_priority;
+
+	stream->dropped_frames += num_frames_dropped;
+}
+
+static bool find_first_video_packet(struct ffmpeg_output *stream, int64_t *dts_usec)
+{
+	size_t count = stream->queue.size / sizeof(struct mpegts_packet);
+
+	for (size_t i = 0; i < count; i++) {
+		struct mpegts_packet *cur = deque_data(&stream->queue, i * sizeof(*cur));
+		if (cur->video && !cur->keyframe) {
+			*dts_usec = cur->dts_usec;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void check_to_drop_frames(struct ffmpeg_output *stream, bool pframes)
+{
+	int64_t first_dts_usec;
+	int64_t buffer_duration_usec = 0;
+	size_t num_packets = stream->queue.size / sizeof(struct mpegts_packet);
+	int priority;
+
+	if (num_packets >= 5 && find_first_video_packet(stream, &first_dts_usec))
+		buffer_duration_usec = stream->last_dts_usec - first_dts_usec;
+
+	priority = congestion_check(&stream->cc, buffer_duration_usec, pframes);
+	if (priority)
+		drop_frames(stream, priority);
+}
+
+static void release_packet_buffer(void *opaque, uint8_t *data)
+{
+	struct encoder_packet *ref = opaque;
+
+	obs_encoder_packet_release(ref);
+	bfree(ref);
+
+	UNUSED_PARAMETER(data);
+}
+
 /* Convert obs encoder_packet to FFmpeg AVPacket and write to circular buffer
  * where it will be processed in the write_thread by process_packet.
+ *
+ * The AVPacket references the encoder packet data directly, the reference is
+ * released once FFmpeg is done with it.
  */
 void mpegts_write_packet(struct ffmpeg_output *stream, struct encoder_packet *encpacket)
 {
@@ -1055,11 +1182,16 @@ void mpegts_write_packet(struct ffmpeg_output *stream, struct encoder_packet *en
 
 	packet = av_packet_alloc();
 
-	packet->data = av_memdup(encpacket->data, (int)encpacket->size);
-	if (packet->data == NULL) {
-		error("Couldn't allocate packet data");
+	struct encoder_packet *ref = bmalloc(sizeof(struct encoder_packet));
+	obs_encoder_packet_ref(ref, encpacket);
+
+	packet->buf = av_buffer_create(ref->data, ref->size, release_packet_buffer, ref, AV_BUFFER_FLAG_READONLY);
+	if (packet->buf == NULL) {
+		error("Couldn't allocate packet buffer");
+		release_packet_buffer(ref, NULL);
 		goto fail;
 	}
+	packet->data = ref->data;
 	packet->size = (int)encpacket->size;
 	packet->stream_index = avstream->id;
 	packet->pts = rescale_ts2(avstream, codec_time_base, encpacket->pts);
@@ -1068,9 +1200,44 @@ void mpegts_write_packet(struct ffmpeg_output *stream, struct encoder_packet *en
 	if (encpacket->keyframe)
 		packet->flags = AV_PKT_FLAG_KEY;
 
+	struct mpegts_packet entry = {
+		.packet = packet,
+		.dts_usec = encpacket->dts_usec,
+		.drop_priority = is_video ? get_drop_priority(encpacket) : OBS_NAL_PRIORITY_HIGHEST,
+		.video = is_video,
+		.keyframe = encpacket->keyframe,
+	};
+
+	bool dropped = false;
+
 	pthread_mutex_lock(&stream->write_mutex);
-	da_push_back(stream->packets, &packet);
+
+	if (is_video) {
+		check_to_drop_frames(stream, false);
+		check_to_drop_frames(stream, true);
+
+		/* if currently dropping frames, drop packets until it reaches
+		 * the desired priority */
+		if (entry.drop_priority < stream->min_priority) {
+			stream->dropped_frames++;
+			dropped = true;
+		} else {
+			stream->min_priority = 0;
+			stream->last_dts_usec = entry.dts_usec;
+		}
+	}
+
+	if (!dropped)
+		deque_push_back(&stream->queue, &entry, sizeof(entry));
 	pthread_mutex_unlock(&stream->write_mutex);
+
+	/* updating the encoder can block, keep it off the write lock */
+	if (is_video)
+		congestion_apply_bitrate(&stream->cc);
+
+	if (dropped)
+		goto fail;
+
 	os_sem_post(stream->write_sem);
 	return;
 fail:
@@ -1171,6 +1338,25 @@ fail:
 	ffmpeg_mpegts_full_stop(stream);
 }
 
+static float ffmpeg_mpegts_congestion(void *data)
+{
+	struct ffmpeg_output *output = data;
+	return output->min_priority > 0 ? 1.0f : output->cc.congestion;
+}
+
+static int ffmpeg_mpegts_dropped_frames(void *data)
+{
+	struct ffmpeg_output *output = data;
+	return output->dropped_frames;
+}
+
+static void ffmpeg_mpegts_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_bool(defaults, OPT_DROP_FRAMES, false);
+	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
+}
+
 static obs_properties_t *ffmpeg_mpegts_properties(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -1198,5 +1384,8 @@ struct obs_output_info ffmpeg_mpegts_muxer = {
 	.stop = ffmpeg_mpegts_stop,
 	.encoded_packet = ffmpeg_mpegts_data,
 	.get_total_bytes = ffmpeg_mpegts_total_bytes,
+	.get_defaults = ffmpeg_mpegts_defaults,
 	.get_properties = ffmpeg_mpegts_properties,
+	.get_congestion = ffmpeg_mpegts_congestion,
+	.get_dropped_frames = ffmpeg_mpegts_dropped_frames,
 };
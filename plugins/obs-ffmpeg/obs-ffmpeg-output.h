@@ -7,6 +7,7 @@
 #include <libswscale/swscale.h>
 #ifdef NEW_MPEGTS_OUTPUT
 #include "obs-ffmpeg-url.h"
+#include "congestion-control.h"
 #endif
 
 struct ffmpeg_cfg {
@@ -114,6 +115,17 @@ struct ffmpeg_output {
 	URLContext *h;
 	AVIOContext *s;
 	bool got_headers;
+
+	/* packet queue, protected by write_mutex */
+	struct deque queue;
+	int64_t last_dts_usec;
+
+	/* frame drop variables */
+	int min_priority;
+	int dropped_frames;
+
+	/* frame dropping and dynamic bitrate */
+	struct congestion_control cc;
 #endif
 };
 bool ffmpeg_data_init(struct ffmpeg_data *data, struct ffmpeg_cfg *config);
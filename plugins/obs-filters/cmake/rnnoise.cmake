@@ -37,7 +37,10 @@ if(ENABLE_RNNOISE)
 
       target_include_directories(obs-rnnoise PUBLIC "${CMAKE_CURRENT_SOURCE_DIR}/rnnoise/include")
 
-      target_compile_definitions(obs-rnnoise PUBLIC COMPILE_OPUS)
+      target_compile_definitions(obs-rnnoise PUBLIC COMPILE_OPUS PRIVATE RNN_ENABLE_SIMD)
+
+      # Only for util/sse-intrin.h (simde), used by the dense and GRU kernels
+      target_link_libraries(obs-rnnoise PRIVATE OBS::libobs)
 
       target_compile_options(obs-rnnoise PRIVATE -Wno-newline-eof -Wno-error=null-dereference)
 
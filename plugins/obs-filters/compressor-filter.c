@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -74,6 +76,7 @@ struct compressor_data {
 	size_t sample_rate;
 	float envelope;
 	float slope;
+	struct dyn_gain_table gain_table;
 
 	pthread_mutex_t sidechain_update_mutex;
 	uint64_t sidechain_check_time;
@@ -197,6 +200,7 @@ static void compressor_update(void *data, obs_data_t *s)
 	cd->num_channels = num_channels;
 	cd->sample_rate = sample_rate;
 	cd->slope = 1.0f - (1.0f / cd->ratio);
+	dyn_gain_table_init(&cd->gain_table, cd->threshold, cd->slope, cd->output_gain);
 
 	bool valid_sidechain = *sidechain_name && strcmp(sidechain_name, "none") != 0;
 	obs_weak_source_t *old_weak_sidechain = NULL;
@@ -297,26 +301,9 @@ static void analyze_envelope(struct compressor_data *cd, float **samples, const
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
 	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
+	dyn_envelope_follow(cd->envelope_buf, samples, cd->num_channels, num_samples, cd->envelope, cd->attack_gain,
+			    cd->release_gain);
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
 
@@ -328,44 +315,19 @@ static void analyze_sidechain(struct compressor_data *cd, const uint32_t num_sam
 
 	get_sidechain_data(cd, num_samples);
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-	float **sidechain_buf = cd->sidechain_buf;
-
 	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!sidechain_buf[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(sidechain_buf[chan][i]);
-
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
+	dyn_envelope_follow(cd->envelope_buf, cd->sidechain_buf, cd->num_channels, num_samples, cd->envelope,
+			    cd->attack_gain, cd->release_gain);
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
 
-static inline void process_compression(const struct compressor_data *cd, float **samples, uint32_t num_samples)
+static inline void process_compression(struct compressor_data *cd, float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
-	}
+	/* the envelope has already been carried over, so convert it to gains in place */
+	float *gain = cd->envelope_buf;
+
+	dyn_gain_table_apply(&cd->gain_table, gain, cd->envelope_buf, num_samples);
+	dyn_apply_gain(samples, cd->num_channels, gain, num_samples);
 }
 
 static void compressor_tick(void *data, float seconds)
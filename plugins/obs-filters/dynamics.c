@@ -0,0 +1,200 @@
+#include <math.h>
+
+#include <util/sse-intrin.h>
+#include <media-io/audio-math.h>
+
+#include "dynamics.h"
+
+/* -------------------------------------------------------- */
+/* vector versions of dyn_fast_log2/dyn_fast_exp2           */
+
+static inline __m128 log2_ps(__m128 x)
+{
+	const __m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xFF)), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x7FFFFF)),
+						 _mm_set1_epi32(0x3F800000)));
+
+	const __m128 hi = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = _mm_or_ps(_mm_andnot_ps(hi, m), _mm_and_ps(hi, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+	e = _mm_sub_epi32(e, _mm_castps_si128(hi)); /* mask is -1 where set */
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	const __m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_set1_ps(0.41219858f);
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.57707801f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.96179669f));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(2.8853901f));
+	return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, p));
+}
+
+static inline __m128 exp2_ps(__m128 x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+	const __m128i n = _mm_cvtps_epi32(x); /* round to nearest */
+	const __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+	__m128 p = _mm_set1_ps(0.00015403530f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0013333558f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0096181291f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.055504109f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.24022651f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.69314718f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	const __m128i scale = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 abs_ps(__m128 x)
+{
+	return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+}
+
+/* -------------------------------------------------------- */
+/* buffer operations                                        */
+
+void dyn_mul_to_db_buf(float *dst, const float *src, size_t count)
+{
+	const __m128 min_level = _mm_set1_ps(DYN_MIN_LEVEL);
+	const __m128 db_per_octave = _mm_set1_ps(DYN_DB_PER_OCTAVE);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_max_ps(_mm_loadu_ps(src + i), min_level);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(log2_ps(x), db_per_octave));
+	}
+	for (; i < count; i++)
+		dst[i] = dyn_mul_to_db(src[i]);
+}
+
+void dyn_db_to_mul_buf(float *dst, const float *src, size_t count)
+{
+	const __m128 octaves_per_db = _mm_set1_ps(DYN_OCTAVES_PER_DB);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), octaves_per_db);
+		_mm_storeu_ps(dst + i, exp2_ps(x));
+	}
+	for (; i < count; i++)
+		dst[i] = dyn_db_to_mul(src[i]);
+}
+
+void dyn_peak_channels(float *peak, float **samples, size_t channels, size_t count)
+{
+	memset(peak, 0, count * sizeof(float));
+
+	for (size_t c = 0; c < channels; c++) {
+		const float *in = samples[c];
+		size_t i = 0;
+
+		if (!in)
+			continue;
+
+		for (; i + 4 <= count; i += 4) {
+			__m128 v = abs_ps(_mm_loadu_ps(in + i));
+			_mm_storeu_ps(peak + i, _mm_max_ps(_mm_loadu_ps(peak + i), v));
+		}
+		for (; i < count; i++)
+			peak[i] = fmaxf(peak[i], fabsf(in[i]));
+	}
+}
+
+void dyn_apply_gain(float **samples, size_t channels, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	/* walk the channels together so each block of gains is loaded once */
+	for (; i + 4 <= count; i += 4) {
+		const __m128 g = _mm_loadu_ps(gain + i);
+
+		for (size_t c = 0; c < channels; c++) {
+			float *out = samples[c];
+			if (out)
+				_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(out + i), g));
+		}
+	}
+	for (; i < count; i++) {
+		for (size_t c = 0; c < channels; c++) {
+			if (samples[c])
+				samples[c][i] *= gain[i];
+		}
+	}
+}
+
+void dyn_envelope_follow(float *env_buf, float **samples, size_t channels, size_t count, float state,
+			 float attack_gain, float release_gain)
+{
+	for (size_t c = 0; c < channels; c++) {
+		const float *in = samples[c];
+		float env = state;
+
+		if (!in)
+			continue;
+
+		/* the recursion is inherently serial, so just keep it branchless */
+		for (size_t i = 0; i < count; i++) {
+			const float env_in = fabsf(in[i]);
+			const float coef = env < env_in ? attack_gain : release_gain;
+
+			env = env_in + coef * (env - env_in);
+			env_buf[i] = fmaxf(env_buf[i], env);
+		}
+	}
+}
+
+/* -------------------------------------------------------- */
+/* gain lookup table                                        */
+
+#define TABLE_SHIFT (23 - DYN_GAIN_TABLE_STEP_BITS)
+#define TABLE_FRAC_MASK ((1u << TABLE_SHIFT) - 1)
+#define TABLE_MIN_BITS ((uint32_t)(127 + DYN_GAIN_TABLE_MIN_EXP) << 23)
+#define TABLE_MAX_BITS ((uint32_t)(127 + DYN_GAIN_TABLE_MAX_EXP) << 23)
+
+static inline float curve_gain(const struct dyn_gain_table *gt, float env)
+{
+	const float gain_db = gt->slope * (gt->threshold - dyn_mul_to_db(env));
+	return gain_db < 0.0f ? dyn_db_to_mul(gain_db) * gt->output_gain : gt->output_gain;
+}
+
+void dyn_gain_table_init(struct dyn_gain_table *gt, float threshold_db, float slope, float output_gain)
+{
+	gt->threshold = threshold_db;
+	gt->slope = slope;
+	gt->output_gain = output_gain;
+	gt->knee_idx = UINT32_MAX;
+
+	const uint32_t threshold_bits = dyn_float_bits(db_to_mul(threshold_db));
+	if (threshold_bits >= TABLE_MIN_BITS && threshold_bits < TABLE_MAX_BITS)
+		gt->knee_idx = (threshold_bits - TABLE_MIN_BITS) >> TABLE_SHIFT;
+
+	/* entry i sits exactly on the level whose top bits form index i */
+	for (size_t i = 0; i < DYN_GAIN_TABLE_SIZE; i++) {
+		const int e = DYN_GAIN_TABLE_MIN_EXP + (int)(i >> DYN_GAIN_TABLE_STEP_BITS);
+		const float m = 1.0f + (float)(i & (DYN_GAIN_TABLE_STEPS - 1)) / (float)DYN_GAIN_TABLE_STEPS;
+		gt->table[i] = curve_gain(gt, ldexpf(m, e));
+	}
+}
+
+void dyn_gain_table_apply(const struct dyn_gain_table *gt, float *gain, const float *env, size_t count)
+{
+	const float frac_scale = 1.0f / (float)(1u << TABLE_SHIFT);
+
+	for (size_t i = 0; i < count; i++) {
+		/* the envelope is never negative, so the sign bit is clear */
+		const uint32_t bits = dyn_float_bits(env[i]);
+		const uint32_t idx = (bits - TABLE_MIN_BITS) >> TABLE_SHIFT;
+
+		if (bits < TABLE_MIN_BITS) {
+			gain[i] = gt->output_gain;
+		} else if (bits >= TABLE_MAX_BITS || idx == gt->knee_idx) {
+			gain[i] = curve_gain(gt, env[i]);
+		} else {
+			const float frac = (float)(bits & TABLE_FRAC_MASK) * frac_scale;
+			const float a = gt->table[idx];
+			gain[i] = a + frac * (gt->table[idx + 1] - a);
+		}
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Shared processing core for the dynamics filters (compressor, limiter,
+ * expander/upward compressor and noise gate).
+ *
+ * The fast log2/exp2 approximations below replace log10f/powf in the
+ * per-sample paths. Level to decibel conversion is accurate to within
+ * DYN_DB_MAX_ERROR (absolute) and decibel to level conversion to within
+ * DYN_MUL_MAX_REL_ERROR (relative), both far below anything audible.
+ */
+
+#define DYN_DB_MAX_ERROR 1e-4f
+#define DYN_MUL_MAX_REL_ERROR 2e-6f
+
+/* 20 * log10(2) and its inverse */
+#define DYN_DB_PER_OCTAVE 6.0205999f
+#define DYN_OCTAVES_PER_DB 0.16609640f
+
+/* Lowest level handled by the buffer conversions, about -600 dB. Anything
+ * quieter (including silence) is clamped to it so results stay finite. */
+#define DYN_MIN_LEVEL 1e-30f
+
+static inline uint32_t dyn_float_bits(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static inline float dyn_bits_float(uint32_t u)
+{
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+/* Expects a positive, normal input */
+static inline float dyn_fast_log2(float x)
+{
+	uint32_t bits = dyn_float_bits(x);
+	int e = (int)((bits >> 23) & 0xFF) - 127;
+	float m = dyn_bits_float((bits & 0x7FFFFF) | 0x3F800000);
+
+	/* centre the mantissa on 1 so that |t| <= 0.172 */
+	if (m > 1.41421356f) {
+		m *= 0.5f;
+		e++;
+	}
+
+	const float t = (m - 1.0f) / (m + 1.0f);
+	const float t2 = t * t;
+	const float p = 2.8853901f + t2 * (0.96179669f + t2 * (0.57707801f + t2 * 0.41219858f));
+	return (float)e + t * p;
+}
+
+static inline float dyn_fast_exp2(float x)
+{
+	if (x < -126.0f)
+		x = -126.0f;
+	else if (x > 126.0f)
+		x = 126.0f;
+
+	const float n = (float)(int)(x < 0.0f ? x - 0.5f : x + 0.5f);
+	const float f = x - n;
+	const float p =
+		1.0f +
+		f * (0.69314718f +
+		     f * (0.24022651f +
+			  f * (0.055504109f + f * (0.0096181291f + f * (0.0013333558f + f * 0.00015403530f)))));
+	return p * dyn_bits_float((uint32_t)((int)n + 127) << 23);
+}
+
+static inline float dyn_mul_to_db(float mul)
+{
+	return DYN_DB_PER_OCTAVE * dyn_fast_log2(mul < DYN_MIN_LEVEL ? DYN_MIN_LEVEL : mul);
+}
+
+static inline float dyn_db_to_mul(float db)
+{
+	return dyn_fast_exp2(db * DYN_OCTAVES_PER_DB);
+}
+
+/* -------------------------------------------------------- */
+/* buffer operations                                        */
+
+/* dst[i] = mul_to_db(src[i]) */
+extern void dyn_mul_to_db_buf(float *dst, const float *src, size_t count);
+
+/* dst[i] = db_to_mul(src[i]) */
+extern void dyn_db_to_mul_buf(float *dst, const float *src, size_t count);
+
+/* peak[i] = max over channels of |samples[c][i]|, NULL channels skipped */
+extern void dyn_peak_channels(float *peak, float **samples, size_t channels, size_t count);
+
+/* samples[c][i] *= gain[i] for every non-NULL channel */
+extern void dyn_apply_gain(float **samples, size_t channels, const float *gain, size_t count);
+
+/*
+ * Peak envelope follower with separate attack and release coefficients.
+ * Every channel starts from the same envelope state and env_buf receives
+ * the per-sample maximum across channels, so it must be cleared first.
+ */
+extern void dyn_envelope_follow(float *env_buf, float **samples, size_t channels, size_t count, float state,
+				float attack_gain, float release_gain);
+
+/* -------------------------------------------------------- */
+/* gain lookup table                                        */
+
+/*
+ * Maps a linear envelope level directly to a linear gain for a downward
+ * compressor curve (threshold, slope = 1 - 1/ratio, output gain), without
+ * any per-sample log/pow. The table is indexed by the float's exponent and
+ * top mantissa bits, so each octave is split into DYN_GAIN_TABLE_STEPS
+ * linear segments which are then interpolated. Levels below the table range
+ * are always under the threshold; levels above it, and the one segment that
+ * holds the threshold (where the curve has a corner), fall back to the fast
+ * approximations.
+ */
+
+#define DYN_GAIN_TABLE_STEP_BITS 6
+#define DYN_GAIN_TABLE_STEPS (1 << DYN_GAIN_TABLE_STEP_BITS)
+#define DYN_GAIN_TABLE_MIN_EXP -20
+#define DYN_GAIN_TABLE_MAX_EXP 4
+#define DYN_GAIN_TABLE_SIZE ((DYN_GAIN_TABLE_MAX_EXP - DYN_GAIN_TABLE_MIN_EXP) * DYN_GAIN_TABLE_STEPS + 1)
+
+struct dyn_gain_table {
+	float threshold;
+	float slope;
+	float output_gain;
+	uint32_t knee_idx;
+	float table[DYN_GAIN_TABLE_SIZE];
+};
+
+extern void dyn_gain_table_init(struct dyn_gain_table *gt, float threshold_db, float slope, float output_gain);
+
+/* gain[i] = gain curve of env[i], output gain included */
+extern void dyn_gain_table_apply(const struct dyn_gain_table *gt, float *gain, const float *env, size_t count);
@@ -8,6 +8,8 @@
 #include <util/deque.h>
 #include <util/threading.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -79,6 +81,7 @@ struct expander_data {
 	float attack_gain;
 	float release_gain;
 	float output_gain;
+	float output_gain_db;
 
 	size_t num_channels;
 	size_t sample_rate;
@@ -208,6 +211,7 @@ static void expander_update(void *data, obs_data_t *s)
 	cd->attack_gain = gain_coefficient(sample_rate, attack_time_ms / MS_IN_S_F);
 	cd->release_gain = gain_coefficient(sample_rate, release_time_ms / MS_IN_S_F);
 	cd->output_gain = db_to_mul(output_gain_db);
+	cd->output_gain_db = output_gain_db;
 	cd->num_channels = num_channels;
 	cd->sample_rate = sample_rate;
 	cd->slope = 1.0f - cd->ratio;
@@ -299,15 +303,16 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 		float *env_in = cd->env_in;
 
 		if (cd->detector == RMS_DETECT) {
-			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * powf(samples[chan][0], 2.0f);
+			runave[0] = rmscoef * cd->runave[chan] + (1 - rmscoef) * samples[chan][0] * samples[chan][0];
 			env_in[0] = sqrtf(fmaxf(runave[0], 0));
 			for (uint32_t i = 1; i < num_samples; ++i) {
-				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * powf(samples[chan][i], 2.0f);
+				const float x = samples[chan][i];
+				runave[i] = rmscoef * runave[i - 1] + (1 - rmscoef) * x * x;
 				env_in[i] = sqrtf(runave[i]);
 			}
 		} else if (cd->detector == PEAK_DETECT) {
 			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
+				runave[i] = samples[chan][i] * samples[chan][i];
 				env_in[i] = fabsf(samples[chan][i]);
 			}
 		}
@@ -319,15 +324,15 @@ static void analyze_envelope(struct expander_data *cd, float **samples, const ui
 	}
 }
 
-static inline void process_sample(size_t idx, float *samples, float *env_buf, float *gain_db, bool is_upwcomp,
-				  float channel_gain, float threshold, float slope, float attack_gain,
-				  float inv_attack_gain, float release_gain, float inv_release_gain, float output_gain,
-				  float knee)
+/* env_db holds the envelope in dB on entry and the output gain in dB on return */
+static inline void process_sample(size_t idx, float *env_db_buf, float *gain_db, bool is_upwcomp, float channel_gain,
+				  float threshold, float slope, float attack_gain, float inv_attack_gain,
+				  float release_gain, float inv_release_gain, float output_gain_db, float knee)
 {
 	/* --------------------------------- */
 	/* gain stage of expansion           */
 
-	float env_db = mul_to_db(env_buf[idx]);
+	float env_db = env_db_buf[idx];
 	float diff = threshold - env_db;
 
 	if (is_upwcomp && env_db <= (threshold - 60.0f) / 2)
@@ -346,8 +351,10 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 		if (threshold - knee / 2 >= env_db)
 			gain = slope * diff;
 		// gain in knee:
-		if (env_db > threshold - knee / 2 && threshold + knee / 2 > env_db)
-			gain = slope * powf(diff + knee / 2, 2) / (2.0f * knee);
+		if (env_db > threshold - knee / 2 && threshold + knee / 2 > env_db) {
+			const float x = diff + knee / 2;
+			gain = slope * x * x / (2.0f * knee);
+		}
 	} else {
 		prev_gain = idx > 0 ? gain_db[idx - 1] : channel_gain;
 		gain = diff > 0.0f ? fmaxf(slope * diff, -60.0f) : 0.0f;
@@ -364,13 +371,10 @@ static inline void process_sample(size_t idx, float *samples, float *env_buf, fl
 	/* --------------------------------- */
 	/* output                            */
 
-	if (!is_upwcomp) {
-		gain = db_to_mul(fminf(0, gain_db[idx]));
-	} else {
-		gain = db_to_mul(gain_db[idx]);
-	}
-
-	samples[idx] *= gain * output_gain;
+	if (!is_upwcomp)
+		env_db_buf[idx] = fminf(0, gain_db[idx]) + output_gain_db;
+	else
+		env_db_buf[idx] = gain_db[idx] + output_gain_db;
 }
 
 // gain stage and ballistics in dB domain
@@ -382,7 +386,7 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 	const float inv_release_gain = 1.0f - release_gain;
 	const float threshold = cd->threshold;
 	const float slope = cd->slope;
-	const float output_gain = cd->output_gain;
+	const float output_gain_db = cd->output_gain_db;
 	const bool is_upwcomp = cd->is_upwcomp;
 	const float knee = cd->knee;
 
@@ -398,10 +402,16 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 		float *gain_db = cd->gain_db[chan];
 		float channel_gain = cd->gain_db_buf[chan];
 
+		/* only the ballistics are serial, the conversions run vectorized
+		 * in place over the envelope buffer */
+		dyn_mul_to_db_buf(env_buf, env_buf, num_samples);
 		for (size_t i = 0; i < num_samples; ++i) {
-			process_sample(i, channel_samples, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope,
-				       attack_gain, inv_attack_gain, release_gain, inv_release_gain, output_gain, knee);
+			process_sample(i, env_buf, gain_db, is_upwcomp, channel_gain, threshold, slope, attack_gain,
+				       inv_attack_gain, release_gain, inv_release_gain, output_gain_db, knee);
 		}
+		dyn_db_to_mul_buf(env_buf, env_buf, num_samples);
+		dyn_apply_gain(&channel_samples, 1, env_buf, num_samples);
+
 		cd->gain_db_buf[chan] = gain_db[num_samples - 1];
 	}
 }
@@ -6,6 +6,8 @@
 #include <media-io/audio-math.h>
 #include <util/platform.h>
 
+#include "dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...) \
@@ -58,6 +60,7 @@ struct limiter_data {
 	size_t sample_rate;
 	float envelope;
 	float slope;
+	struct dyn_gain_table gain_table;
 };
 
 /* -------------------------------------------------------- */
@@ -98,6 +101,7 @@ static void limiter_update(void *data, obs_data_t *s)
 	cd->num_channels = num_channels;
 	cd->sample_rate = sample_rate;
 	cd->slope = 1.0f;
+	dyn_gain_table_init(&cd->gain_table, cd->threshold, cd->slope, cd->output_gain);
 
 	size_t sample_len = sample_rate * DEFAULT_AUDIO_BUF_MS / MS_IN_S;
 	if (cd->envelope_buf_len == 0)
@@ -127,42 +131,19 @@ static void analyze_envelope(struct limiter_data *cd, float **samples, const uin
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
 	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
+	dyn_envelope_follow(cd->envelope_buf, samples, cd->num_channels, num_samples, cd->envelope, cd->attack_gain,
+			    cd->release_gain);
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
 
-static inline void process_compression(const struct limiter_data *cd, float **samples, uint32_t num_samples)
+static inline void process_compression(struct limiter_data *cd, float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
-	}
+	/* the envelope has already been carried over, so convert it to gains in place */
+	float *gain = cd->envelope_buf;
+
+	dyn_gain_table_apply(&cd->gain_table, gain, cd->envelope_buf, num_samples);
+	dyn_apply_gain(samples, cd->num_channels, gain, num_samples);
 }
 
 static struct obs_audio_data *limiter_filter_audio(void *data, struct obs_audio_data *audio)
@@ -342,6 +342,59 @@ static inline void process_speexdsp(struct noise_suppress_data *ng)
 #endif
 }
 
+#ifdef RNNOISE_HAS_PROCESS_FRAMES
+static inline void process_rnnoise(struct noise_suppress_data *ng)
+{
+	const float *input[MAX_PREPROC_CHANNELS];
+	float **output = ng->rnn_segment_buffers;
+
+	/* Resample if necessary. The level adjustment RNNoise expects is done
+	 * inside rnnoise_process_frames(), and all channels are denoised in one
+	 * batched pass. */
+	if (ng->rnn_resampler) {
+		float *resampled[MAX_PREPROC_CHANNELS];
+		uint32_t out_frames;
+		uint64_t ts_offset;
+		audio_resampler_resample(ng->rnn_resampler, (uint8_t **)resampled, &out_frames, &ts_offset,
+					 (const uint8_t **)ng->copy_buffers, (uint32_t)ng->frames);
+
+		for (size_t i = 0; i < ng->channels; i++) {
+			if (out_frames >= RNNOISE_FRAME_SIZE) {
+				input[i] = resampled[i] + out_frames - RNNOISE_FRAME_SIZE;
+				continue;
+			}
+
+			size_t pad = RNNOISE_FRAME_SIZE - out_frames;
+			memset(ng->rnn_segment_buffers[i], 0, pad * sizeof(float));
+			memcpy(ng->rnn_segment_buffers[i] + pad, resampled[i], out_frames * sizeof(float));
+			input[i] = ng->rnn_segment_buffers[i];
+		}
+	} else {
+		/* frames == RNNOISE_FRAME_SIZE here, so work in place */
+		for (size_t i = 0; i < ng->channels; i++)
+			input[i] = ng->copy_buffers[i];
+		output = ng->copy_buffers;
+	}
+
+	rnnoise_process_frames(ng->rnn_states, (int)ng->channels, output, input, 32768.0f, 1.0f / 32768.0f, NULL);
+
+	/* Resample back if necessary */
+	if (ng->rnn_resampler) {
+		float *resampled[MAX_PREPROC_CHANNELS];
+		uint32_t out_frames;
+		uint64_t ts_offset;
+		audio_resampler_resample(ng->rnn_resampler_back, (uint8_t **)resampled, &out_frames, &ts_offset,
+					 (const uint8_t **)ng->rnn_segment_buffers, RNNOISE_FRAME_SIZE);
+
+		for (size_t i = 0; i < ng->channels; i++) {
+			size_t pad = out_frames < ng->frames ? ng->frames - out_frames : 0;
+			memset(ng->copy_buffers[i], 0, pad * sizeof(float));
+			memcpy(ng->copy_buffers[i] + pad, resampled[i] + out_frames + pad - ng->frames,
+			       (ng->frames - pad) * sizeof(float));
+		}
+	}
+}
+#else
 static inline void process_rnnoise(struct noise_suppress_data *ng)
 {
 #ifdef LIBRNNOISE_ENABLED
@@ -404,6 +457,7 @@ static inline void process_rnnoise(struct noise_suppress_data *ng)
 	UNUSED_PARAMETER(ng);
 #endif
 }
+#endif
 
 static inline void process(struct noise_suppress_data *ng)
 {
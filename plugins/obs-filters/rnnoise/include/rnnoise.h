@@ -61,6 +61,16 @@ RNNOISE_EXPORT void rnnoise_destroy(DenoiseState *st);
 
 RNNOISE_EXPORT float rnnoise_process_frame(DenoiseState *st, float *out, const float *in);
 
+/* Processes one frame for each of the count states in a single pass, so the
+ * network weights are shared by all of them (e.g. the channels of a source).
+ * Input samples are multiplied by in_scale and output samples by out_scale,
+ * which lets float audio in [-1, 1] be passed through without extra copies.
+ * out may alias in. vad receives one voice probability per state and may be
+ * NULL. */
+RNNOISE_EXPORT void rnnoise_process_frames(DenoiseState **st, int count, float **out, const float **in,
+                                           float in_scale, float out_scale, float *vad);
+#define RNNOISE_HAS_PROCESS_FRAMES 1
+
 RNNOISE_EXPORT RNNModel *rnnoise_model_from_file(FILE *f);
 
 RNNOISE_EXPORT void rnnoise_model_free(RNNModel *model);
@@ -97,6 +97,15 @@ struct DenoiseState {
   float mem_hp_x[2];
   float lastg[NB_BANDS];
   RNNState rnn;
+  /* Per-frame analysis results, kept here rather than on the stack so that
+     several states can be analysed before the network runs on all of them. */
+  kiss_fft_cpx X[FREQ_SIZE];
+  kiss_fft_cpx P[WINDOW_SIZE];
+  float Ex[NB_BANDS], Ep[NB_BANDS];
+  float Exp[NB_BANDS];
+  float features[NB_FEATURES];
+  float g[NB_BANDS];
+  int silence;
 };
 
 void compute_band_energy(float *bandE, const kiss_fft_cpx *X) {
@@ -396,27 +405,31 @@ static int compute_frame_features(DenoiseState *st, kiss_fft_cpx *X, kiss_fft_cp
   return TRAINING && E < 0.1;
 }
 
-static void frame_synthesis(DenoiseState *st, float *out, const kiss_fft_cpx *y) {
+static void frame_synthesis(DenoiseState *st, float *out, const kiss_fft_cpx *y, float scale) {
   float x[WINDOW_SIZE];
   int i;
   inverse_transform(x, y);
   apply_window(x);
-  for (i=0;i<FRAME_SIZE;i++) out[i] = x[i] + st->synthesis_mem[i];
+  for (i=0;i<FRAME_SIZE;i++) out[i] = (x[i] + st->synthesis_mem[i])*scale;
   RNN_COPY(st->synthesis_mem, &x[FRAME_SIZE], FRAME_SIZE);
 }
 
-static void biquad(float *y, float mem[2], const float *x, const float *b, const float *a, int N) {
+static void biquad_scaled(float *y, float mem[2], const float *x, float scale, const float *b, const float *a, int N) {
   int i;
   for (i=0;i<N;i++) {
     float xi, yi;
-    xi = x[i];
-    yi = x[i] + mem[0];
+    xi = x[i]*scale;
+    yi = xi + mem[0];
     mem[0] = (float)(mem[1] + (b[0]*(double)xi - a[0]*(double)yi));
     mem[1] = (float)((b[1]*(double)xi - a[1]*(double)yi));
     y[i] = yi;
   }
 }
 
+static void biquad(float *y, float mem[2], const float *x, const float *b, const float *a, int N) {
+  biquad_scaled(y, mem, x, 1.f, b, a, N);
+}
+
 void pitch_filter(kiss_fft_cpx *X, const kiss_fft_cpx *P, const float *Ex, const float *Ep,
                   const float *Exp, const float *g) {
   int i;
@@ -453,26 +466,20 @@ void pitch_filter(kiss_fft_cpx *X, const kiss_fft_cpx *P, const float *Ex, const
   }
 }
 
-float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
-  int i;
-  kiss_fft_cpx X[FREQ_SIZE];
-  kiss_fft_cpx P[WINDOW_SIZE];
+static void frame_analysis_features(DenoiseState *st, const float *in, float in_scale) {
   float x[FRAME_SIZE];
-  float Ex[NB_BANDS], Ep[NB_BANDS];
-  float Exp[NB_BANDS];
-  float features[NB_FEATURES];
-  float g[NB_BANDS];
-  float gf[FREQ_SIZE]={1};
-  float vad_prob = 0;
-  int silence;
   static const float a_hp[2] = {-1.99599f, 0.99600f};
   static const float b_hp[2] = {-2, 1};
-  biquad(x, st->mem_hp_x, in, b_hp, a_hp, FRAME_SIZE);
-  silence = compute_frame_features(st, X, P, Ex, Ep, Exp, features, x);
+  biquad_scaled(x, st->mem_hp_x, in, in_scale, b_hp, a_hp, FRAME_SIZE);
+  st->silence = compute_frame_features(st, st->X, st->P, st->Ex, st->Ep, st->Exp, st->features, x);
+}
 
-  if (!silence) {
-    compute_rnn(&st->rnn, g, &vad_prob, features);
-    pitch_filter(X, P, Ex, Ep, Exp, g);
+static void frame_apply_gains(DenoiseState *st, float *out, float out_scale) {
+  int i;
+  float gf[FREQ_SIZE]={1};
+  if (!st->silence) {
+    float *g = st->g;
+    pitch_filter(st->X, st->P, st->Ex, st->Ep, st->Exp, g);
     for (i=0;i<NB_BANDS;i++) {
       float alpha = .6f;
       g[i] = MAX16(g[i], alpha*st->lastg[i]);
@@ -481,13 +488,69 @@ float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
     interp_band_gain(gf, g);
 #if 1
     for (i=0;i<FREQ_SIZE;i++) {
-      X[i].r *= gf[i];
-      X[i].i *= gf[i];
+      st->X[i].r *= gf[i];
+      st->X[i].i *= gf[i];
     }
 #endif
   }
 
-  frame_synthesis(st, out, X);
+  frame_synthesis(st, out, st->X, out_scale);
+}
+
+/* Runs the network on the non-silent frames among st[0..count), count being
+   at most RNN_MAX_BATCH. States sharing a model are evaluated together. */
+static void compute_rnn_frames(DenoiseState **st, int count, float *vad) {
+  int i, n, npending = 0;
+  int pending[RNN_MAX_BATCH];
+  for (i=0;i<count;i++) {
+    if (!st[i]->silence) pending[npending++] = i;
+  }
+  while (npending > 0) {
+    RNNState *batch[RNN_MAX_BATCH];
+    float *gains[RNN_MAX_BATCH];
+    const float *features[RNN_MAX_BATCH];
+    float batch_vad[RNN_MAX_BATCH];
+    int index[RNN_MAX_BATCH];
+    const RNNModel *model = st[pending[0]]->rnn.model;
+    int keep = 0;
+    n = 0;
+    for (i=0;i<npending;i++) {
+      DenoiseState *s = st[pending[i]];
+      if (s->rnn.model != model) {
+        pending[keep++] = pending[i];
+        continue;
+      }
+      batch[n] = &s->rnn;
+      gains[n] = s->g;
+      features[n] = s->features;
+      index[n++] = pending[i];
+    }
+    npending = keep;
+    compute_rnn_batch(batch, n, gains, batch_vad, features);
+    for (i=0;i<n;i++) vad[index[i]] = batch_vad[i];
+  }
+}
+
+void rnnoise_process_frames(DenoiseState **st, int count, float **out, const float **in,
+                            float in_scale, float out_scale, float *vad) {
+  int i, base;
+  for (base=0;base<count;base+=RNN_MAX_BATCH) {
+    int n = IMIN(count - base, RNN_MAX_BATCH);
+    float batch_vad[RNN_MAX_BATCH] = {0};
+    /* Analyse every frame first so the network weights are only walked
+       once for the whole batch. */
+    for (i=0;i<n;i++) frame_analysis_features(st[base+i], in[base+i], in_scale);
+    compute_rnn_frames(&st[base], n, batch_vad);
+    for (i=0;i<n;i++) {
+      frame_apply_gains(st[base+i], out[base+i], out_scale);
+      if (vad) vad[base+i] = batch_vad[i];
+    }
+  }
+}
+
+float rnnoise_process_frame(DenoiseState *st, float *out, const float *in) {
+  float vad_prob;
+  rnnoise_process_frames(&st, 1, &out, &in, 1.f, 1.f, &vad_prob);
   return vad_prob;
 }
 
@@ -38,6 +38,10 @@
 #include "rnn_data.h"
 #include <stdio.h>
 
+#ifdef RNN_ENABLE_SIMD
+#include <util/sse-intrin.h>
+#endif
+
 static OPUS_INLINE float tansig_approx(float x)
 {
     int i;
@@ -76,103 +80,172 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+#ifdef RNN_ENABLE_SIMD
+/* Sign-extends four consecutive int8 weights to floats. */
+static OPUS_INLINE __m128 load_weights4(const rnn_weight *w)
 {
-   int i, j;
-   int N, M;
-   int stride;
-   M = layer->nb_inputs;
-   N = layer->nb_neurons;
-   stride = N;
-   for (i=0;i<N;i++)
+   int v;
+   __m128i x;
+   memcpy(&v, w, sizeof(v));
+   x = _mm_cvtsi32_si128(v);
+   x = _mm_unpacklo_epi8(x, x);
+   x = _mm_unpacklo_epi16(x, x);
+   return _mm_cvtepi32_ps(_mm_srai_epi32(x, 24));
+}
+#endif
+
+/* out[b][i] += sum_j weights[j*stride + i]*in[b][j] for every batch entry b.
+   The weights are stored neuron-minor, so four neurons are handled per SIMD
+   lane group and each weight is loaded once for the whole batch. */
+static void accumulate_batch(float **out, int count, const rnn_weight *weights, int stride,
+                             int N, int M, float **in)
+{
+   int i=0, j, b;
+#ifdef RNN_ENABLE_SIMD
+   for (;i+4<=N;i+=4)
    {
-      /* Compute update gate. */
-      float sum = layer->bias[i];
+      __m128 acc[RNN_MAX_BATCH];
+      for (b=0;b<count;b++)
+         acc[b] = _mm_loadu_ps(&out[b][i]);
       for (j=0;j<M;j++)
-         sum += layer->input_weights[j*stride + i]*input[j];
-      output[i] = WEIGHTS_SCALE*sum;
+      {
+         const __m128 w = load_weights4(&weights[j*stride + i]);
+         for (b=0;b<count;b++)
+            acc[b] = _mm_add_ps(acc[b], _mm_mul_ps(w, _mm_set1_ps(in[b][j])));
+      }
+      for (b=0;b<count;b++)
+         _mm_storeu_ps(&out[b][i], acc[b]);
    }
-   if (layer->activation == ACTIVATION_SIGMOID) {
-      for (i=0;i<N;i++)
-         output[i] = sigmoid_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_TANH) {
+#endif
+   for (;i<N;i++)
+   {
+      for (j=0;j<M;j++)
+      {
+         const float w = weights[j*stride + i];
+         for (b=0;b<count;b++)
+            out[b][i] += w*in[b][j];
+      }
+   }
+}
+
+static OPUS_INLINE float activate(int activation, float x)
+{
+   if (activation == ACTIVATION_SIGMOID) return sigmoid_approx(x);
+   else if (activation == ACTIVATION_TANH) return tansig_approx(x);
+   else if (activation == ACTIVATION_RELU) return relu(x);
+   *(int*)0=0;
+   return 0;
+}
+
+static void compute_dense_batch(const DenseLayer *layer, int count, float **output, float **input)
+{
+   int i, b;
+   int N, M;
+   M = layer->nb_inputs;
+   N = layer->nb_neurons;
+   for (b=0;b<count;b++)
       for (i=0;i<N;i++)
-         output[i] = tansig_approx(output[i]);
-   } else if (layer->activation == ACTIVATION_RELU) {
+         output[b][i] = layer->bias[i];
+   accumulate_batch(output, count, layer->input_weights, N, N, M, input);
+   for (b=0;b<count;b++)
       for (i=0;i<N;i++)
-         output[i] = relu(output[i]);
-   } else {
-     *(int*)0=0;
-   }
+         output[b][i] = activate(layer->activation, WEIGHTS_SCALE*output[b][i]);
 }
 
-static void compute_gru(const GRULayer *gru, float *state, const float *input)
+static void compute_gru_batch(const GRULayer *gru, int count, float **state, float **input)
 {
-   int i, j;
+   int i, b;
    int N, M;
    int stride;
-   float z[MAX_NEURONS];
-   float r[MAX_NEURONS];
-   float h[MAX_NEURONS];
+   float z[RNN_MAX_BATCH][MAX_NEURONS];
+   float r[RNN_MAX_BATCH][MAX_NEURONS];
+   float h[RNN_MAX_BATCH][MAX_NEURONS];
+   float *zp[RNN_MAX_BATCH], *rp[RNN_MAX_BATCH], *hp[RNN_MAX_BATCH];
    M = gru->nb_inputs;
    N = gru->nb_neurons;
    stride = 3*N;
-   for (i=0;i<N;i++)
+   for (b=0;b<count;b++)
    {
-      /* Compute update gate. */
-      float sum = gru->bias[i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[j*stride + i]*state[j];
-      z[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      zp[b] = z[b];
+      rp[b] = r[b];
+      hp[b] = h[b];
+      for (i=0;i<N;i++)
+      {
+         z[b][i] = gru->bias[i];
+         r[b][i] = gru->bias[N + i];
+         h[b][i] = gru->bias[2*N + i];
+      }
    }
-   for (i=0;i<N;i++)
+   /* Compute update gate. */
+   accumulate_batch(zp, count, gru->input_weights, stride, N, M, input);
+   accumulate_batch(zp, count, gru->recurrent_weights, stride, N, N, state);
+   /* Compute reset gate. */
+   accumulate_batch(rp, count, gru->input_weights + N, stride, N, M, input);
+   accumulate_batch(rp, count, gru->recurrent_weights + N, stride, N, N, state);
+   for (b=0;b<count;b++)
    {
-      /* Compute reset gate. */
-      float sum = gru->bias[N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[N + j*stride + i]*state[j];
-      r[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      for (i=0;i<N;i++)
+      {
+         z[b][i] = sigmoid_approx(WEIGHTS_SCALE*z[b][i]);
+         /* the reset gate is only ever used multiplied with the state */
+         r[b][i] = sigmoid_approx(WEIGHTS_SCALE*r[b][i])*state[b][i];
+      }
    }
-   for (i=0;i<N;i++)
+   /* Compute output. */
+   accumulate_batch(hp, count, gru->input_weights + 2*N, stride, N, M, input);
+   accumulate_batch(hp, count, gru->recurrent_weights + 2*N, stride, N, N, rp);
+   for (b=0;b<count;b++)
    {
-      /* Compute output. */
-      float sum = gru->bias[2*N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[2*N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[2*N + j*stride + i]*state[j]*r[j];
-      if (gru->activation == ACTIVATION_SIGMOID) sum = sigmoid_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_TANH) sum = tansig_approx(WEIGHTS_SCALE*sum);
-      else if (gru->activation == ACTIVATION_RELU) sum = relu(WEIGHTS_SCALE*sum);
-      else *(int*)0=0;
-      h[i] = z[i]*state[i] + (1-z[i])*sum;
+      for (i=0;i<N;i++)
+      {
+         float sum = activate(gru->activation, WEIGHTS_SCALE*h[b][i]);
+         state[b][i] = z[b][i]*state[b][i] + (1-z[b][i])*sum;
+      }
    }
-   for (i=0;i<N;i++)
-      state[i] = h[i];
 }
 
 #define INPUT_SIZE 42
 
+void compute_rnn_batch(RNNState **rnn, int count, float **gains, float *vad, const float **input) {
+  int i, b;
+  const RNNModel *model = rnn[0]->model;
+  float dense_out[RNN_MAX_BATCH][MAX_NEURONS];
+  float noise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float denoise_input[RNN_MAX_BATCH][MAX_NEURONS*3];
+  float *dense_p[RNN_MAX_BATCH], *noise_p[RNN_MAX_BATCH], *denoise_p[RNN_MAX_BATCH];
+  float *in_p[RNN_MAX_BATCH], *vad_p[RNN_MAX_BATCH];
+  float *vad_state[RNN_MAX_BATCH], *noise_state[RNN_MAX_BATCH], *denoise_state[RNN_MAX_BATCH];
+  celt_assert(count > 0 && count <= RNN_MAX_BATCH);
+  for (b=0;b<count;b++) {
+    celt_assert(rnn[b]->model == model);
+    dense_p[b] = dense_out[b];
+    noise_p[b] = noise_input[b];
+    denoise_p[b] = denoise_input[b];
+    in_p[b] = (float *)input[b];
+    vad_p[b] = &vad[b];
+    vad_state[b] = rnn[b]->vad_gru_state;
+    noise_state[b] = rnn[b]->noise_gru_state;
+    denoise_state[b] = rnn[b]->denoise_gru_state;
+  }
+  compute_dense_batch(model->input_dense, count, dense_p, in_p);
+  compute_gru_batch(model->vad_gru, count, vad_state, dense_p);
+  compute_dense_batch(model->vad_output, count, vad_p, vad_state);
+  for (b=0;b<count;b++) {
+    for (i=0;i<model->input_dense_size;i++) noise_input[b][i] = dense_out[b][i];
+    for (i=0;i<model->vad_gru_size;i++) noise_input[b][i+model->input_dense_size] = vad_state[b][i];
+    for (i=0;i<INPUT_SIZE;i++) noise_input[b][i+model->input_dense_size+model->vad_gru_size] = input[b][i];
+  }
+  compute_gru_batch(model->noise_gru, count, noise_state, noise_p);
+
+  for (b=0;b<count;b++) {
+    for (i=0;i<model->vad_gru_size;i++) denoise_input[b][i] = vad_state[b][i];
+    for (i=0;i<model->noise_gru_size;i++) denoise_input[b][i+model->vad_gru_size] = noise_state[b][i];
+    for (i=0;i<INPUT_SIZE;i++) denoise_input[b][i+model->vad_gru_size+model->noise_gru_size] = input[b][i];
+  }
+  compute_gru_batch(model->denoise_gru, count, denoise_state, denoise_p);
+  compute_dense_batch(model->denoise_output, count, gains, denoise_state);
+}
+
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input) {
-  int i;
-  float dense_out[MAX_NEURONS];
-  float noise_input[MAX_NEURONS*3];
-  float denoise_input[MAX_NEURONS*3];
-  compute_dense(rnn->model->input_dense, dense_out, input);
-  compute_gru(rnn->model->vad_gru, rnn->vad_gru_state, dense_out);
-  compute_dense(rnn->model->vad_output, vad, rnn->vad_gru_state);
-  for (i=0;i<rnn->model->input_dense_size;i++) noise_input[i] = dense_out[i];
-  for (i=0;i<rnn->model->vad_gru_size;i++) noise_input[i+rnn->model->input_dense_size] = rnn->vad_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) noise_input[i+rnn->model->input_dense_size+rnn->model->vad_gru_size] = input[i];
-  compute_gru(rnn->model->noise_gru, rnn->noise_gru_state, noise_input);
-
-  for (i=0;i<rnn->model->vad_gru_size;i++) denoise_input[i] = rnn->vad_gru_state[i];
-  for (i=0;i<rnn->model->noise_gru_size;i++) denoise_input[i+rnn->model->vad_gru_size] = rnn->noise_gru_state[i];
-  for (i=0;i<INPUT_SIZE;i++) denoise_input[i+rnn->model->vad_gru_size+rnn->model->noise_gru_size] = input[i];
-  compute_gru(rnn->model->denoise_gru, rnn->denoise_gru_state, denoise_input);
-  compute_dense(rnn->model->denoise_output, gains, rnn->denoise_gru_state);
+  compute_rnn_batch(&rnn, 1, &gains, vad, &input);
 }
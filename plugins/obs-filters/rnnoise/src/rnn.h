@@ -35,6 +35,9 @@
 
 #define MAX_NEURONS 128
 
+/* Largest number of frames the batched kernels evaluate at once */
+#define RNN_MAX_BATCH 8
+
 #define ACTIVATION_TANH    0
 #define ACTIVATION_SIGMOID 1
 #define ACTIVATION_RELU    2
@@ -62,4 +65,7 @@ typedef struct RNNState RNNState;
 
 void compute_rnn(RNNState *rnn, float *gains, float *vad, const float *input);
 
+/* Evaluates the network for count states sharing the same model. */
+void compute_rnn_batch(RNNState **rnn, int count, float **gains, float *vad, const float **input);
+
 #endif /* _MLP_H_ */
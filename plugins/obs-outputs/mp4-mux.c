@@ -25,7 +25,9 @@
 #include <obs-module.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <util/array-serializer.h>
+#include <util/buffered-file-serializer.h>
 
 #include <time.h>
 
@@ -78,6 +80,47 @@ static inline void write_fullbox(struct serializer *s, const size_t size, const
 	s_wb24(s, flags);
 }
 
+/* Sample tables can have hundreds of thousands of entries, so rather than
+ * going through the serializer for every value they are converted in batches
+ * and written with a single call per batch. */
+struct table_writer {
+	struct serializer *s;
+	size_t len;
+	uint8_t buf[8192];
+};
+
+static inline void table_init(struct table_writer *tw, struct serializer *s)
+{
+	tw->s = s;
+	tw->len = 0;
+}
+
+static inline void table_flush(struct table_writer *tw)
+{
+	if (tw->len)
+		s_write(tw->s, tw->buf, tw->len);
+	tw->len = 0;
+}
+
+static inline void table_wb32(struct table_writer *tw, uint32_t val)
+{
+	if (tw->len + 4 > sizeof(tw->buf))
+		table_flush(tw);
+
+	uint8_t *ptr = tw->buf + tw->len;
+	ptr[0] = (uint8_t)(val >> 24);
+	ptr[1] = (uint8_t)(val >> 16);
+	ptr[2] = (uint8_t)(val >> 8);
+	ptr[3] = (uint8_t)val;
+	tw->len += 4;
+}
+
+static inline void table_wb64(struct table_writer *tw, uint64_t val)
+{
+	table_wb32(tw, (uint32_t)(val >> 32));
+	table_wb32(tw, (uint32_t)val);
+}
+
 /// 4.3 File Type Box
 static size_t mp4_write_ftyp(struct mp4_mux *mux, bool fragmented)
 {
@@ -1120,15 +1163,20 @@ static size_t mp4_write_stts(struct mp4_mux *mux, struct mp4_track *track, bool
 
 	s_wb32(s, (uint32_t)num); // entry_count
 
+	struct table_writer tw;
+	table_init(&tw, s);
+
 	for (size_t idx = 0; idx < num; idx++) {
 		struct sample_delta *smp = &arr[idx];
 
 		uint64_t delta = util_mul_div64(smp->delta, track->timescale, track->timebase_den);
 
-		s_wb32(s, smp->count);      // sample_count
-		s_wb32(s, (uint32_t)delta); // sample_delta
+		table_wb32(&tw, smp->count);      // sample_count
+		table_wb32(&tw, (uint32_t)delta); // sample_delta
 	}
 
+	table_flush(&tw);
+
 	return write_box_size(s, start);
 }
 
@@ -1147,8 +1195,13 @@ static size_t mp4_write_stss(struct mp4_mux *mux, struct mp4_track *track)
 	write_fullbox(s, size, "stss", 0, 0);
 	s_wb32(s, num); // entry_count
 
+	struct table_writer tw;
+	table_init(&tw, s);
+
 	for (size_t idx = 0; idx < num; idx++)
-		s_wb32(s, track->sync_samples.array[idx]); // sample_number
+		table_wb32(&tw, track->sync_samples.array[idx]); // sample_number
+
+	table_flush(&tw);
 
 	return size;
 }
@@ -1167,14 +1220,19 @@ static size_t mp4_write_ctts(struct mp4_mux *mux, struct mp4_track *track)
 
 	s_wb32(s, num); // entry_count
 
+	struct table_writer tw;
+	table_init(&tw, s);
+
 	for (size_t idx = 0; idx < num; idx++) {
 		int64_t offset = (int64_t)track->offsets.array[idx].offset * (int64_t)track->timescale /
 				 (int64_t)track->timebase_den;
 
-		s_wb32(s, track->offsets.array[idx].count); // sample_count
-		s_wb32(s, (uint32_t)offset);                // sample_offset
+		table_wb32(&tw, track->offsets.array[idx].count); // sample_count
+		table_wb32(&tw, (uint32_t)offset);                // sample_offset
 	}
 
+	table_flush(&tw);
+
 	return size;
 }
 
@@ -1218,13 +1276,17 @@ static size_t mp4_write_stsc(struct mp4_mux *mux, struct mp4_track *track, bool
 
 	s_wb32(s, num); // entry_count
 
+	struct table_writer tw;
+	table_init(&tw, s);
+
 	for (size_t idx = 0; idx < num; idx++) {
 		struct chunk_run *cr = &chunk_runs.array[idx];
-		s_wb32(s, cr->first);   // first_chunk
-		s_wb32(s, cr->samples); // samples_per_chunk
-		s_wb32(s, 1);           // sample_description_index
+		table_wb32(&tw, cr->first);   // first_chunk
+		table_wb32(&tw, cr->samples); // samples_per_chunk
+		table_wb32(&tw, 1);           // sample_description_index
 	}
 
+	table_flush(&tw);
 	da_free(chunk_runs);
 
 	return size;
@@ -1264,9 +1326,13 @@ static size_t mp4_write_stsz(struct mp4_mux *mux, struct mp4_track *track, bool
 		s_wb32(s, 0);                                 // sample_size
 		s_wb32(s, (uint32_t)track->sample_sizes.num); // sample_count
 
-		for (size_t idx = 0; idx < track->sample_sizes.num; idx++) {
-			s_wb32(s, track->sample_sizes.array[idx]); // entry_size
-		}
+		struct table_writer tw;
+		table_init(&tw, s);
+
+		for (size_t idx = 0; idx < track->sample_sizes.num; idx++)
+			table_wb32(&tw, track->sample_sizes.array[idx]); // entry_size
+
+		table_flush(&tw);
 	}
 
 	return write_box_size(s, start);
@@ -1302,13 +1368,18 @@ static size_t mp4_write_stco(struct mp4_mux *mux, struct mp4_track *track, bool
 
 	s_wb32(s, num); // entry_count
 
+	struct table_writer tw;
+	table_init(&tw, s);
+
 	for (size_t idx = 0; idx < num; idx++) {
 		if (co64)
-			s_wb64(s, arr[idx].offset); // chunk_offset
+			table_wb64(&tw, arr[idx].offset); // chunk_offset
 		else
-			s_wb32(s, (uint32_t)arr[idx].offset); // chunk_offset
+			table_wb32(&tw, (uint32_t)arr[idx].offset); // chunk_offset
 	}
 
+	table_flush(&tw);
+
 	return size;
 }
 
@@ -1941,6 +2012,60 @@ static size_t mp4_write_udta(struct mp4_mux *mux)
 	return write_box_size(s, start);
 }
 
+struct trak_job {
+	struct mp4_mux mux;
+	struct mp4_track *track;
+	struct serializer s;
+	struct array_output_data ao;
+	pthread_t thread;
+	bool thread_created;
+};
+
+static void *trak_job_thread(void *data)
+{
+	struct trak_job *job = data;
+
+	os_set_thread_name("mp4 trak writer");
+	mp4_write_trak(&job->mux, job->track, false);
+	return NULL;
+}
+
+/* The sample tables of a long recording can be several MiB per track, so
+ * when finalising each trak is built into its own buffer on a separate
+ * thread and the results are appended in track order afterwards. Writing
+ * a trak only reads from the muxer, so each job gets a shallow copy with
+ * its serializer replaced. */
+static void mp4_write_traks_parallel(struct mp4_mux *mux)
+{
+	size_t num = mux->tracks.num + (mux->chapter_track ? 1 : 0);
+	struct trak_job *jobs = bzalloc(num * sizeof(struct trak_job));
+
+	for (size_t i = 0; i < num; i++) {
+		struct trak_job *job = &jobs[i];
+
+		job->mux = *mux;
+		job->track = i < mux->tracks.num ? &mux->tracks.array[i] : mux->chapter_track;
+		array_output_serializer_init(&job->s, &job->ao);
+		job->mux.serializer = &job->s;
+
+		job->thread_created = pthread_create(&job->thread, NULL, trak_job_thread, job) == 0;
+		if (!job->thread_created)
+			mp4_write_trak(&job->mux, job->track, false);
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		struct trak_job *job = &jobs[i];
+
+		if (job->thread_created)
+			pthread_join(job->thread, NULL);
+
+		s_write(mux->serializer, job->ao.bytes.array, job->ao.bytes.num);
+		array_output_serializer_free(&job->ao);
+	}
+
+	bfree(jobs);
+}
+
 /// Movie Box (8.2.1)
 static size_t mp4_write_moov(struct mp4_mux *mux, bool fragmented)
 {
@@ -1952,14 +2077,15 @@ static size_t mp4_write_moov(struct mp4_mux *mux, bool fragmented)
 	mp4_write_mvhd(mux);
 
 	// trak(s)
-	for (size_t i = 0; i < mux->tracks.num; i++) {
-		struct mp4_track *track = &mux->tracks.array[i];
-		mp4_write_trak(mux, track, fragmented);
+	if (fragmented) {
+		for (size_t i = 0; i < mux->tracks.num; i++) {
+			struct mp4_track *track = &mux->tracks.array[i];
+			mp4_write_trak(mux, track, true);
+		}
+	} else {
+		mp4_write_traks_parallel(mux);
 	}
 
-	if (!fragmented && mux->chapter_track)
-		mp4_write_trak(mux, mux->chapter_track, false);
-
 	// mvex
 	if (fragmented)
 		mp4_write_mvex(mux);
@@ -1985,6 +2111,31 @@ static size_t mp4_write_mfhd(struct mp4_mux *mux)
 	return 16;
 }
 
+/* Default size/duration can be used if all samples match. */
+static void get_fragment_defaults(struct mp4_track *track, bool *durations_match, bool *sizes_match,
+				  uint32_t *duration, uint32_t *sample_size)
+{
+	*durations_match = true;
+	*sizes_match = true;
+
+	if (track->sample_size) {
+		*duration = 1;
+		*sample_size = track->sample_size;
+		return;
+	}
+
+	*duration = track->fragment_samples.array[0].duration;
+	*sample_size = track->fragment_samples.array[0].size;
+
+	for (size_t idx = 1; idx < track->fragment_samples.num; idx++) {
+		uint32_t frag_duration = track->fragment_samples.array[idx].duration;
+		uint32_t frag_size = track->fragment_samples.array[idx].size;
+
+		*durations_match = frag_duration == *duration;
+		*sizes_match = frag_size == *sample_size;
+	}
+}
+
 /// 8.8.7 Track Fragment Header Box
 static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_t moof_start)
 {
@@ -1993,27 +2144,12 @@ static size_t mp4_write_tfhd(struct mp4_mux *mux, struct mp4_track *track, size_
 
 	uint32_t flags = BASE_DATA_OFFSET_PRESENT | DEFAULT_SAMPLE_FLAGS_PRESENT;
 
-	/* Add default size/duration if all samples match. */
-	bool durations_match = true;
-	bool sizes_match = true;
+	bool durations_match;
+	bool sizes_match;
 	uint32_t duration;
 	uint32_t sample_size;
 
-	if (track->sample_size) {
-		duration = 1;
-		sample_size = track->sample_size;
-	} else {
-		duration = track->fragment_samples.array[0].duration;
-		sample_size = track->fragment_samples.array[0].size;
-
-		for (size_t idx = 1; idx < track->fragment_samples.num; idx++) {
-			uint32_t frag_duration = track->fragment_samples.array[idx].duration;
-			uint32_t frag_size = track->fragment_samples.array[idx].size;
-
-			durations_match = frag_duration == duration;
-			sizes_match = frag_size == sample_size;
-		}
-	}
+	get_fragment_defaults(track, &durations_match, &sizes_match, &duration, &sample_size);
 
 	if (durations_match)
 		flags |= DEFAULT_SAMPLE_DURATION_PRESENT;
@@ -2154,6 +2290,51 @@ static size_t mp4_write_traf(struct mp4_mux *mux, struct mp4_track *track, int64
 	return write_box_size(s, start);
 }
 
+/* Computes the size of the moof box that mp4_write_moof() will produce, so it
+ * does not have to be written twice to find out. Must be kept in sync with
+ * the tfhd/tfdt/trun writers above. */
+static size_t mp4_get_moof_size(struct mp4_mux *mux)
+{
+	size_t size = 8 + 16; // moof + mfhd
+
+	for (size_t i = 0; i < mux->tracks.num; i++) {
+		struct mp4_track *track = &mux->tracks.array[i];
+		if (!track->fragment_samples.num)
+			continue;
+
+		bool durations_match;
+		bool sizes_match;
+		uint32_t duration;
+		uint32_t sample_size;
+
+		get_fragment_defaults(track, &durations_match, &sizes_match, &duration, &sample_size);
+
+		/* tfhd: track_ID, base_data_offset, default_sample_flags */
+		size_t tfhd_size = 12 + 4 + 8 + 4;
+		if (durations_match)
+			tfhd_size += 4;
+		if (sizes_match)
+			tfhd_size += 4;
+
+		/* trun: sample_count, data_offset */
+		size_t trun_size = 12 + 4 + 4;
+		if (!track->sample_size) {
+			size_t entry_size = 4; // sample_size
+
+			if (track->type == TRACK_VIDEO) {
+				trun_size += 4;  // first_sample_flags
+				entry_size += 4; // sample_composition_time_offset
+			}
+
+			trun_size += track->fragment_samples.num * entry_size;
+		}
+
+		size += 8 + tfhd_size + 20 + trun_size; // traf + tfhd + tfdt + trun
+	}
+
+	return size;
+}
+
 /// 8.8.4 Movie Fragment Box
 static size_t mp4_write_moof(struct mp4_mux *mux, uint32_t moof_size, int64_t moof_start)
 {
@@ -2328,6 +2509,12 @@ static void process_packets(struct mp4_mux *mux, struct mp4_track *track, uint64
 	}
 }
 
+static void release_packet_data(void *data)
+{
+	struct encoder_packet pkt = {.data = data};
+	obs_encoder_packet_release(&pkt);
+}
+
 /* Write track data to file */
 static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
 {
@@ -2344,8 +2531,9 @@ static void write_packets(struct mp4_mux *mux, struct mp4_track *track)
 	for (size_t i = 0; i < track->fragment_samples.num; i++) {
 		struct encoder_packet pkt;
 		deque_pop_front(&track->packets, &pkt, sizeof(struct encoder_packet));
-		s_write(s, pkt.data, pkt.size);
-		obs_encoder_packet_release(&pkt);
+		/* Hand our packet reference to the serializer to avoid copying
+		 * the payload, it is released once written. */
+		buffered_file_serializer_write_ref(s, pkt.data, pkt.size, release_packet_data, pkt.data);
 	}
 
 	chk->size = (uint32_t)(serializer_get_pos(s) - chk->offset);
@@ -2404,13 +2592,18 @@ static void mp4_flush_fragment(struct mp4_mux *mux)
 		process_packets(mux, mux->chapter_track, &mdat_size);
 	}
 
-	// write moof once to get size
 	int64_t moof_start = serializer_get_pos(s);
-	size_t moof_size = mp4_write_moof(mux, 0, moof_start);
-	array_output_serializer_reset(&aod);
-
-	// write moof again with known size
-	mp4_write_moof(mux, (uint32_t)moof_size, moof_start);
+	size_t moof_size = mp4_get_moof_size(mux);
+	size_t written = mp4_write_moof(mux, (uint32_t)moof_size, moof_start);
+
+	/* The computed size is out of sync with the writers, so the data
+	 * offsets in the moof would point at the wrong place. Throw it away and
+	 * write it again with the size it actually has. */
+	if (written != moof_size) {
+		warn("Fragment moof size mismatch (%zu != %zu), rewriting", written, moof_size);
+		array_output_serializer_reset(&aod);
+		mp4_write_moof(mux, (uint32_t)written, moof_start);
+	}
 
 	// Write to output and restore real serializer
 	s_write(s, aod.bytes.array, aod.bytes.num);
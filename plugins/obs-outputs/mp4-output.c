@@ -23,6 +23,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/buffered-file-serializer.h>
 
 #include <opts-parser.h>
@@ -42,7 +43,7 @@ struct mp4_output {
 	obs_output_t *output;
 	struct dstr path;
 
-	struct serializer serializer;
+	struct serializer *serializer;
 
 	volatile bool active;
 	volatile bool stopping;
@@ -55,6 +56,7 @@ struct mp4_output {
 
 	struct mp4_mux *muxer;
 	int flags;
+	uint32_t io_flags;
 
 	int64_t last_dts_usec;
 	DARRAY(struct chapter) chapters;
@@ -77,6 +79,17 @@ struct mp4_output {
 
 	/* Buffer for packets while we reinitialise the muxer after splitting */
 	DARRAY(struct encoder_packet) split_buffer;
+
+	/* Previous files are finalised in the background after a split */
+	os_task_queue_t *finalise_queue;
+};
+
+struct finalise_job {
+	struct mp4_output *out;
+	struct mp4_mux *muxer;
+	struct serializer *serializer;
+	char *next_file;
+	int code;
 };
 
 static inline bool stopping(struct mp4_output *out)
@@ -140,6 +153,8 @@ static void mp4_output_destory(void *data)
 {
 	struct mp4_output *out = data;
 
+	os_task_queue_destroy(out->finalise_queue);
+
 	for (size_t i = 0; i < out->chapters.num; i++)
 		bfree(out->chapters.array[i].name);
 	da_free(out->chapters);
@@ -191,6 +206,7 @@ static void *mp4_output_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct mp4_output *out = bzalloc(sizeof(struct mp4_output));
 	out->output = output;
+	out->finalise_queue = os_task_queue_create();
 	pthread_mutex_init(&out->mutex, NULL);
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
@@ -212,9 +228,10 @@ static inline void apply_flag(int *flags, const char *value, int flag_value)
 		*flags &= ~flag_value;
 }
 
-static int parse_custom_options(const char *opts_str)
+static int parse_custom_options(const char *opts_str, uint32_t *io_flags)
 {
 	int flags = MP4_USE_NEGATIVE_CTS;
+	int serializer_flags = 0;
 
 	struct obs_options opts = obs_parse_options(opts_str);
 
@@ -229,6 +246,10 @@ static int parse_custom_options(const char *opts_str)
 			apply_flag(&flags, opt.value, MP4_USE_MDTA_KEY_VALUE);
 		} else if (strcmp(opt.name, "use_negative_cts") == 0) {
 			apply_flag(&flags, opt.value, MP4_USE_NEGATIVE_CTS);
+		} else if (strcmp(opt.name, "io_uring") == 0) {
+			apply_flag(&serializer_flags, opt.value, BUFFERED_FILE_SERIALIZER_IO_URING);
+		} else if (strcmp(opt.name, "direct_io") == 0) {
+			apply_flag(&serializer_flags, opt.value, BUFFERED_FILE_SERIALIZER_DIRECT_IO);
 		} else {
 			blog(LOG_WARNING, "Unknown muxer option: %s = %s", opt.name, opt.value);
 		}
@@ -236,6 +257,7 @@ static int parse_custom_options(const char *opts_str)
 
 	obs_free_options(opts);
 
+	*io_flags = (uint32_t)serializer_flags;
 	return flags;
 }
 
@@ -263,17 +285,20 @@ static bool mp4_output_start(void *data)
 
 	/* Allow skipping the remux step for debugging purposes. */
 	const char *muxer_settings = obs_data_get_string(settings, "muxer_settings");
-	out->flags = parse_custom_options(muxer_settings);
+	out->flags = parse_custom_options(muxer_settings, &out->io_flags);
 
 	obs_data_release(settings);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer, out->path.array)) {
+	out->serializer = bzalloc(sizeof(struct serializer));
+	if (!buffered_file_serializer_init_ex(out->serializer, out->path.array, 0, 0, out->io_flags)) {
 		warn("Unable to open MP4 file '%s'", out->path.array);
+		bfree(out->serializer);
+		out->serializer = NULL;
 		return false;
 	}
 
 	/* Initialise muxer and start capture */
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	out->muxer = mp4_mux_create(out->output, out->serializer, out->flags);
 	os_atomic_set_bool(&out->active, true);
 	obs_output_begin_data_capture(out->output, 0);
 
@@ -362,47 +387,73 @@ static void generate_filename(struct mp4_output *out, struct dstr *dst, bool ove
 	obs_data_release(settings);
 }
 
-static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+static void finalise_file_task(void *param)
 {
+	struct finalise_job *job = param;
+	struct mp4_output *out = job->out;
 	uint64_t start_time = os_gettime_ns();
 
-	/* finalise file */
-	for (size_t i = 0; i < out->chapters.num; i++) {
-		struct chapter *chap = &out->chapters.array[i];
-		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
-	}
-
-	mp4_mux_finalise(out->muxer);
-
-	info("Waiting for file writer to finish...");
+	mp4_mux_finalise(job->muxer);
 
 	/* flush/close file and destroy old muxer */
-	buffered_file_serializer_free(&out->serializer);
-	mp4_mux_destroy(out->muxer);
+	buffered_file_serializer_free(job->serializer);
+	bfree(job->serializer);
+	mp4_mux_destroy(job->muxer);
 
-	for (size_t i = 0; i < out->chapters.num; i++)
-		bfree(out->chapters.array[i].name);
+	info("MP4 file split complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
 
-	da_clear(out->chapters);
+	/* Only announce the next file once the previous one is complete, as
+	 * listeners expect the file they were last told about to be done. */
+	calldata_t cd = {0};
+	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
+	calldata_set_string(&cd, "next_file", job->next_file);
+	signal_handler_signal(sh, "file_changed", &cd);
+	calldata_free(&cd);
 
-	info("MP4 file split complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
+	bfree(job->next_file);
+	bfree(job);
+}
 
-	/* open new file */
+static bool change_file(struct mp4_output *out, struct encoder_packet *pkt)
+{
+	struct serializer *serializer;
+	struct finalise_job *job;
+
+	/* open new file, if that fails the current one is finalised by the
+	 * stop as usual */
 	generate_filename(out, &out->path, out->allow_overwrite);
 	info("Changing output file to '%s'", out->path.array);
 
-	if (!buffered_file_serializer_init_defaults(&out->serializer, out->path.array)) {
+	serializer = bzalloc(sizeof(struct serializer));
+	if (!buffered_file_serializer_init_ex(serializer, out->path.array, 0, 0, out->io_flags)) {
 		warn("Unable to open MP4 file '%s'", out->path.array);
+		bfree(serializer);
 		return false;
 	}
 
-	out->muxer = mp4_mux_create(out->output, &out->serializer, out->flags);
+	for (size_t i = 0; i < out->chapters.num; i++) {
+		struct chapter *chap = &out->chapters.array[i];
+		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
+	}
 
-	calldata_t cd = {0};
-	signal_handler_t *sh = obs_output_get_signal_handler(out->output);
-	calldata_set_string(&cd, "next_file", out->path.array);
-	signal_handler_signal(sh, "file_changed", &cd);
-	calldata_free(&cd);
+	for (size_t i = 0; i < out->chapters.num; i++)
+		bfree(out->chapters.array[i].name);
+
+	da_clear(out->chapters);
+
+	job = bzalloc(sizeof(struct finalise_job));
+	job->out = out;
+	job->muxer = out->muxer;
+	job->serializer = out->serializer;
+	job->next_file = bstrdup(out->path.array);
+
+	/* Finalising the previous file (writing its moov and waiting for all
+	 * data to hit the disk) happens on a separate thread so that the new
+	 * file can start receiving packets immediately. */
+	os_task_queue_queue_task(out->finalise_queue, finalise_file_task, job);
+
+	out->serializer = serializer;
+	out->muxer = mp4_mux_create(out->output, out->serializer, out->flags);
 
 	out->cur_size = 0;
 	out->start_time = pkt->dts_usec;
@@ -424,21 +475,16 @@ static void mp4_mux_destroy_task(void *ptr)
 	mp4_mux_destroy(muxer);
 }
 
-static void mp4_output_actual_stop(struct mp4_output *out, int code)
+static void stop_task(void *param)
 {
-	os_atomic_set_bool(&out->active, false);
-
+	struct finalise_job *job = param;
+	struct mp4_output *out = job->out;
 	uint64_t start_time = os_gettime_ns();
 
-	for (size_t i = 0; i < out->chapters.num; i++) {
-		struct chapter *chap = &out->chapters.array[i];
-		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
-	}
-
-	mp4_mux_finalise(out->muxer);
+	mp4_mux_finalise(job->muxer);
 
-	if (code) {
-		obs_output_signal_stop(out->output, code);
+	if (job->code) {
+		obs_output_signal_stop(out->output, job->code);
 	} else {
 		obs_output_end_data_capture(out->output);
 	}
@@ -446,9 +492,38 @@ static void mp4_output_actual_stop(struct mp4_output *out, int code)
 	info("Waiting for file writer to finish...");
 
 	/* Flush/close output file and destroy muxer */
-	buffered_file_serializer_free(&out->serializer);
-	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, out->muxer, false);
-	out->muxer = NULL;
+	buffered_file_serializer_free(job->serializer);
+	bfree(job->serializer);
+	obs_queue_task(OBS_TASK_DESTROY, mp4_mux_destroy_task, job->muxer, false);
+
+	info("MP4 file output complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
+	bfree(job);
+}
+
+static void free_split_buffer(struct mp4_output *out)
+{
+	for (size_t i = 0; i < out->split_buffer.num; i++)
+		obs_encoder_packet_release(&out->split_buffer.array[i]);
+
+	da_free(out->split_buffer);
+	out->split_file_ready = false;
+}
+
+/* Called with the mutex held, so the last file is finalised on the finalise
+ * thread, after any previously split file is complete */
+static void mp4_output_actual_stop(struct mp4_output *out, int code)
+{
+	struct finalise_job *job;
+
+	os_atomic_set_bool(&out->active, false);
+
+	/* Packets held back for a split that won't happen anymore */
+	free_split_buffer(out);
+
+	for (size_t i = 0; i < out->chapters.num; i++) {
+		struct chapter *chap = &out->chapters.array[i];
+		mp4_mux_add_chapter(out->muxer, chap->dts_usec, chap->name);
+	}
 
 	/* Clear chapter data */
 	for (size_t i = 0; i < out->chapters.num; i++)
@@ -456,7 +531,15 @@ static void mp4_output_actual_stop(struct mp4_output *out, int code)
 
 	da_clear(out->chapters);
 
-	info("MP4 file output complete. Finalization took %" PRIu64 " ms.", (os_gettime_ns() - start_time) / 1000000);
+	job = bzalloc(sizeof(struct finalise_job));
+	job->out = out;
+	job->muxer = out->muxer;
+	job->serializer = out->serializer;
+	job->code = code;
+	out->muxer = NULL;
+	out->serializer = NULL;
+
+	os_task_queue_queue_task(out->finalise_queue, stop_task, job);
 }
 
 static void push_back_packet(struct mp4_output *out, struct encoder_packet *packet)
@@ -556,7 +639,7 @@ static void mp4_output_packet(void *data, struct encoder_packet *packet)
 
 	submit_packet(out, packet);
 
-	if (serializer_get_pos(&out->serializer) == -1)
+	if (serializer_get_pos(out->serializer) == -1)
 		mp4_output_actual_stop(out, OBS_OUTPUT_ERROR);
 
 unlock:
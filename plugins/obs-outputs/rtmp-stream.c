@@ -38,11 +38,8 @@
 #define MSEC_TO_NSEC 1000000ULL
 #endif
 
-/* dynamic bitrate coefficients */
-#define DBR_INC_TIMER (4ULL * SEC_TO_NSEC)
-#define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
-#define MIN_ESTIMATE_DURATION_MS 1000
-#define MAX_ESTIMATE_DURATION_MS 2000
+/* dynamic bitrate bandwidth sampling interval */
+#define DBR_SAMPLE_INTERVAL (50ULL * MSEC_TO_NSEC)
 
 static const char *rtmp_stream_getname(void *unused)
 {
@@ -58,24 +55,60 @@ static void log_rtmp(int level, const char *format, va_list args)
 	blogva(LOG_INFO, format, args);
 }
 
-static inline size_t num_buffered_packets(struct rtmp_stream *stream);
+static inline size_t num_buffered_packets(struct rtmp_stream *stream)
+{
+	return (size_t)os_atomic_load_long(&stream->num_packets);
+}
+
+static inline int drop_priority_idx(const struct encoder_packet *packet)
+{
+	int priority = packet->drop_priority;
+	return priority < 0 ? 0 : (priority >= NUM_DROP_PRIORITIES ? NUM_DROP_PRIORITIES - 1 : priority);
+}
+
+static inline void packet_dequeued(struct rtmp_stream *stream, const struct encoder_packet *packet)
+{
+	os_atomic_dec_long(&stream->num_packets);
+	if (packet->type == OBS_ENCODER_VIDEO)
+		os_atomic_dec_long(&stream->num_video_packets[drop_priority_idx(packet)]);
+}
+
+/* Consumer side, called from the send thread (or when it is not running) */
+static bool get_next_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&stream->packets_head);
+	unsigned long tail = (unsigned long)os_atomic_load_long(&stream->packets_tail);
+
+	while (head != tail) {
+		struct packet_slot *slot = &stream->packets[head & PACKET_QUEUE_MASK];
+		bool sent = os_atomic_compare_swap_long(&slot->state, PACKET_SLOT_QUEUED, PACKET_SLOT_SENT);
+
+		/* The slot may be reused as soon as the head moves past it */
+		if (sent)
+			*packet = slot->packet;
+
+		os_atomic_set_long(&stream->packets_head, (long)++head);
+
+		if (sent) {
+			packet_dequeued(stream, packet);
+			return true;
+		}
+	}
+
+	return false;
+}
 
 static inline void free_packets(struct rtmp_stream *stream)
 {
+	struct encoder_packet packet;
 	size_t num_packets;
 
-	pthread_mutex_lock(&stream->packets_mutex);
-
 	num_packets = num_buffered_packets(stream);
 	if (num_packets)
 		info("Freeing %d remaining packets", (int)num_packets);
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		deque_pop_front(&stream->packets, &packet, sizeof(packet));
+	while (get_next_packet(stream, &packet))
 		obs_encoder_packet_release(&packet);
-	}
-	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
 static inline bool stopping(struct rtmp_stream *stream)
@@ -129,13 +162,11 @@ static void rtmp_stream_destroy(void *data)
 	dstr_free(&stream->bind_ip);
 	os_event_destroy(stream->stop_event);
 	os_sem_destroy(stream->send_sem);
-	pthread_mutex_destroy(&stream->packets_mutex);
-	deque_free(&stream->packets);
+	bfree(stream->packets);
 #ifdef TEST_FRAMEDROPS
 	deque_free(&stream->droptest_info);
 #endif
-	deque_free(&stream->dbr_frames);
-	pthread_mutex_destroy(&stream->dbr_mutex);
+	congestion_free(&stream->cc);
 
 	os_event_destroy(stream->buffer_space_available_event);
 	os_event_destroy(stream->buffer_has_data_event);
@@ -148,17 +179,17 @@ static void rtmp_stream_destroy(void *data)
 	bfree(stream);
 }
 
+static void get_bandwidth_estimate_proc(void *data, calldata_t *cd);
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
-	pthread_mutex_init_value(&stream->packets_mutex);
+	stream->packets = bzalloc(PACKET_QUEUE_SIZE * sizeof(struct packet_slot));
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_LogSetLevel(RTMP_LOGWARNING);
 
-	if (pthread_mutex_init(&stream->packets_mutex, NULL) != 0)
-		goto fail;
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 
@@ -167,7 +198,7 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
-	if (pthread_mutex_init(&stream->dbr_mutex, NULL) != 0) {
+	if (!congestion_init(&stream->cc, output)) {
 		warn("Failed to initialize dbr mutex");
 		goto fail;
 	}
@@ -189,6 +220,12 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_bandwidth_estimate(out int bandwidth_kbps, out int rtt_ms, out int min_rtt_ms, "
+			 "out int bitrate_kbps)",
+			 get_bandwidth_estimate_proc, stream);
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -228,20 +265,6 @@ static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
 	val->av_len = valid ? (int)str->len : 0;
 }
 
-static inline bool get_next_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
-{
-	bool new_packet = false;
-
-	pthread_mutex_lock(&stream->packets_mutex);
-	if (stream->packets.size) {
-		deque_pop_front(&stream->packets, packet, sizeof(struct encoder_packet));
-		new_packet = true;
-	}
-	pthread_mutex_unlock(&stream->packets_mutex);
-
-	return new_packet;
-}
-
 static bool process_recv_data(struct rtmp_stream *stream, size_t size)
 {
 	UNUSED_PARAMETER(size);
@@ -381,6 +404,11 @@ static int handle_socket_read(struct rtmp_stream *stream)
 {
 	int ret = 0;
 	int recv_size = 0;
+
+	/* nothing is ever sent back on striped connections */
+	if (stripe_active(&stream->stripe))
+		return 0;
+
 	if (!stream->new_socket_loop) {
 #ifdef _WIN32
 		ret = ioctlsocket(stream->rtmp.m_sb.sb_socket, FIONREAD, (u_long *)&recv_size);
@@ -396,6 +424,14 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+static inline int stream_write(struct rtmp_stream *stream, const uint8_t *data, size_t size)
+{
+	if (stripe_active(&stream->stripe))
+		return stripe_write(&stream->stripe, data, size);
+
+	return RTMP_Write(&stream->rtmp, (const char *)data, (int)size, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
 {
 	uint8_t *data;
@@ -411,7 +447,7 @@ static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+	ret = stream_write(stream, data, size);
 	bfree(data);
 
 	if (is_header)
@@ -445,7 +481,7 @@ static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *pac
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+	ret = stream_write(stream, data, size);
 	bfree(data);
 
 	if (is_header || is_footer) // manually created packets
@@ -472,7 +508,7 @@ static int send_audio_packet_ex(struct rtmp_stream *stream, struct encoder_packe
 		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
 	}
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+	ret = stream_write(stream, data, size);
 	bfree(data);
 
 	if (is_header)
@@ -582,35 +618,48 @@ static void set_output_error(struct rtmp_stream *stream)
 		obs_output_set_last_error(stream->output, msg);
 }
 
-static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
+/* Samples how much of the sent data has actually left the socket, which
+ * unlike the time spent in send() also works once the socket buffer hides
+ * congestion from the send thread */
+static void dbr_sample(struct rtmp_stream *stream)
 {
-	struct dbr_frame front;
-	uint64_t dur;
+	uint64_t ts = os_gettime_ns();
+	uint64_t delivered = stream->total_bytes_sent;
+	bool app_limited = num_buffered_packets(stream) == 0;
+	uint32_t rtt_us = 0;
 
-	deque_push_back(&stream->dbr_frames, back, sizeof(*back));
-	deque_peek_front(&stream->dbr_frames, &front, sizeof(front));
+	if (ts - stream->dbr_sample_ts < DBR_SAMPLE_INTERVAL)
+		return;
+	stream->dbr_sample_ts = ts;
 
-	stream->dbr_data_size += back->size;
+#ifdef __linux__
+	bool striped = stripe_active(&stream->stripe);
+	size_t num_sockets = striped ? stream->stripe.num_sockets : 1;
 
-	dur = (back->send_end - front.send_beg) / 1000000;
+	for (size_t i = 0; i < num_sockets; i++) {
+		int fd = striped ? stream->stripe.sockets[i] : stream->rtmp.m_sb.sb_socket;
+		int queued = 0;
+		struct tcp_info tcpi;
+		socklen_t tcpi_size = sizeof(tcpi);
 
-	if (dur >= MAX_ESTIMATE_DURATION_MS) {
-		stream->dbr_data_size -= front.size;
-		deque_pop_front(&stream->dbr_frames, NULL, sizeof(front));
-	}
+		/* not yet acknowledged, approximate with TLS since
+		 * total_bytes_sent doesn't include its overhead */
+		if (ioctl(fd, SIOCOUTQ, &queued) == 0 && (uint64_t)queued <= delivered)
+			delivered -= (uint64_t)queued;
 
-	stream->dbr_est_bitrate = (dur >= MIN_ESTIMATE_DURATION_MS) ? (long)(stream->dbr_data_size * 1000 / dur) : 0;
-	stream->dbr_est_bitrate *= 8;
-	stream->dbr_est_bitrate /= 1000;
+		/* data still waiting for the congestion window means we're
+		 * not the ones holding things up */
+		if (ioctl(fd, SIOCOUTQNSD, &queued) == 0 && queued > 0)
+			app_limited = false;
 
-	if (stream->dbr_est_bitrate) {
-		stream->dbr_est_bitrate -= stream->audio_bitrate;
-		if (stream->dbr_est_bitrate < 50)
-			stream->dbr_est_bitrate = 50;
+		/* the receiver has to wait for the slowest connection */
+		if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &tcpi, &tcpi_size) == 0 && tcpi.tcpi_rtt > rtt_us)
+			rtt_us = tcpi.tcpi_rtt;
 	}
-}
+#endif
 
-static void dbr_set_bitrate(struct rtmp_stream *stream);
+	congestion_add_sample(&stream->cc, ts, delivered, rtt_us, app_limited);
+}
 
 #ifdef _WIN32
 #define socklen_t int
@@ -638,7 +687,6 @@ static void *send_thread(void *data)
 
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
-		struct dbr_frame dbr_frame;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
@@ -661,11 +709,6 @@ static void *send_thread(void *data)
 			}
 		}
 
-		if (stream->dbr_enabled) {
-			dbr_frame.send_beg = os_gettime_ns();
-			dbr_frame.size = packet.size;
-		}
-
 		int sent;
 		if (packet.type == OBS_ENCODER_VIDEO &&
 		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
@@ -682,13 +725,8 @@ static void *send_thread(void *data)
 			break;
 		}
 
-		if (stream->dbr_enabled) {
-			dbr_frame.send_end = os_gettime_ns();
-
-			pthread_mutex_lock(&stream->dbr_mutex);
-			dbr_add_frame(stream, &dbr_frame);
-			pthread_mutex_unlock(&stream->dbr_mutex);
-		}
+		if (stream->cc.dbr_enabled)
+			dbr_sample(stream);
 	}
 
 	bool encode_error = os_atomic_load_bool(&stream->encode_error);
@@ -703,6 +741,10 @@ static void *send_thread(void *data)
 		send_footers(stream); // Y2023 spec
 	}
 
+	long dropped_audio = os_atomic_load_long(&stream->dropped_audio_packets);
+	if (dropped_audio)
+		warn("Dropped %ld audio packets because the packet queue was full", dropped_audio);
+
 #ifdef _WIN32
 	log_sndbuf_size(stream);
 #endif
@@ -718,14 +760,10 @@ static void *send_thread(void *data)
 	set_output_error(stream);
 
 	RTMP_Close(&stream->rtmp);
+	stripe_close(&stream->stripe);
 
 	/* reset bitrate on stop */
-	if (stream->dbr_enabled) {
-		if (stream->dbr_cur_bitrate != stream->dbr_orig_bitrate) {
-			stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
-			dbr_set_bitrate(stream);
-		}
-	}
+	congestion_stop(&stream->cc);
 
 	if (!stopping(stream)) {
 		pthread_detach(stream->send_thread);
@@ -750,8 +788,10 @@ static bool send_meta_data(struct rtmp_stream *stream)
 	size_t meta_data_size;
 	bool success = true;
 
-	flv_meta_data(stream->output, &meta_data, &meta_data_size, false);
-	success = RTMP_Write(&stream->rtmp, (char *)meta_data, (int)meta_data_size, 0) >= 0;
+	/* striped uploads are restored into a plain FLV stream on the
+	 * receiving end, so it needs the file header */
+	flv_meta_data(stream->output, &meta_data, &meta_data_size, stripe_active(&stream->stripe));
+	success = stream_write(stream, meta_data, meta_data_size) >= 0;
 	bfree(meta_data);
 
 	return success;
@@ -907,7 +947,7 @@ static bool send_video_metadata(struct rtmp_stream *stream, size_t idx)
 		flv_packet_metadata(stream->video_codec[idx], &data, &size, bits_per_raw_sample, pri, trc, spc, 0,
 				    max_luminance, idx);
 
-		int ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+		int ret = stream_write(stream, data, size);
 		bfree(data);
 
 		stream->total_bytes_sent += size;
@@ -984,6 +1024,7 @@ static int init_send(struct rtmp_stream *stream)
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
 		RTMP_Close(&stream->rtmp);
+		stripe_close(&stream->stripe);
 		warn("Failed to create send thread");
 		return OBS_OUTPUT_ERROR;
 	}
@@ -1158,6 +1199,53 @@ static void win32_log_interface_type(struct rtmp_stream *stream)
 }
 #endif
 
+static void set_bind_ip(struct rtmp_stream *stream)
+{
+	if (dstr_is_empty(&stream->bind_ip) || dstr_cmp(&stream->bind_ip, "default") == 0) {
+		memset(&stream->rtmp.m_bindIP, 0, sizeof(stream->rtmp.m_bindIP));
+	} else {
+		bool success = netif_str_to_addr(&stream->rtmp.m_bindIP.addr, &stream->rtmp.m_bindIP.addrLen,
+						 stream->bind_ip.array);
+		if (success) {
+			int len = stream->rtmp.m_bindIP.addrLen;
+			bool ipv6 = len == sizeof(struct sockaddr_in6);
+			info("Binding to IPv%d", ipv6 ? 6 : 4);
+		}
+	}
+}
+
+static int try_connect_striped(struct rtmp_stream *stream)
+{
+	const RTMP_BINDINFO *bind_info = &stream->rtmp.m_bindIP;
+	const struct sockaddr *bind_addr = bind_info->addrLen ? (const struct sockaddr *)&bind_info->addr : NULL;
+	struct dstr host = {0};
+	struct dstr path = {0};
+	bool success;
+
+	if (stream->rtmp.Link.protocol != RTMP_PROTOCOL_RTMP) {
+		warn("Striped upload only supports plain rtmp:// URLs");
+		return OBS_OUTPUT_BAD_PATH;
+	}
+
+	dstr_ncopy(&host, stream->rtmp.Link.hostname.av_val, stream->rtmp.Link.hostname.av_len);
+	dstr_ncopy(&path, stream->rtmp.Link.app.av_val, stream->rtmp.Link.app.av_len);
+	dstr_cat(&path, "/");
+	dstr_cat_dstr(&path, &stream->key);
+
+	info("Striping upload over %d connections", stream->stripe_connections);
+	success = stripe_connect(&stream->stripe, host.array, stream->rtmp.Link.port, path.array,
+				 (size_t)stream->stripe_connections, bind_addr, bind_info->addrLen);
+
+	dstr_free(&host);
+	dstr_free(&path);
+
+	if (!success)
+		return OBS_OUTPUT_CONNECT_FAILED;
+
+	info("Connection to %s successful", stream->path.array);
+	return init_send(stream);
+}
+
 static int try_connect(struct rtmp_stream *stream)
 {
 	if (dstr_is_empty(&stream->path)) {
@@ -1175,6 +1263,11 @@ static int try_connect(struct rtmp_stream *stream)
 	if (!RTMP_SetupURL(&stream->rtmp, stream->path.array))
 		return OBS_OUTPUT_BAD_PATH;
 
+	set_bind_ip(stream);
+
+	if (stream->stripe_connections > 1)
+		return try_connect_striped(stream);
+
 	RTMP_EnableWrite(&stream->rtmp);
 
 	dstr_copy(&stream->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
@@ -1184,18 +1277,6 @@ static int try_connect(struct rtmp_stream *stream)
 	set_rtmp_dstr(&stream->rtmp.Link.flashVer, &stream->encoder_name);
 	stream->rtmp.Link.swfUrl = stream->rtmp.Link.tcUrl;
 
-	if (dstr_is_empty(&stream->bind_ip) || dstr_cmp(&stream->bind_ip, "default") == 0) {
-		memset(&stream->rtmp.m_bindIP, 0, sizeof(stream->rtmp.m_bindIP));
-	} else {
-		bool success = netif_str_to_addr(&stream->rtmp.m_bindIP.addr, &stream->rtmp.m_bindIP.addrLen,
-						 stream->bind_ip.array);
-		if (success) {
-			int len = stream->rtmp.m_bindIP.addrLen;
-			bool ipv6 = len == sizeof(struct sockaddr_in6);
-			info("Binding to IPv%d", ipv6 ? 6 : 4);
-		}
-	}
-
 	// Only use the IPv4 / IPv6 hint if a binding address isn't specified.
 	if (stream->rtmp.m_bindIP.addrLen == 0)
 		stream->rtmp.m_bindIP.addrLen = stream->addrlen_hint;
@@ -1231,9 +1312,6 @@ static bool init_connect(struct rtmp_stream *stream)
 	obs_data_t *settings;
 	const char *bind_ip;
 	const char *ip_family;
-	int64_t drop_p;
-	int64_t drop_b;
-	uint32_t caps;
 
 	if (stopping(stream)) {
 		pthread_join(stream->send_thread, NULL);
@@ -1249,6 +1327,7 @@ static bool init_connect(struct rtmp_stream *stream)
 	os_atomic_set_bool(&stream->encode_error, false);
 	stream->total_bytes_sent = 0;
 	stream->dropped_frames = 0;
+	stream->dropped_audio_packets = 0;
 	stream->min_priority = 0;
 	stream->got_first_packet = false;
 
@@ -1259,14 +1338,11 @@ static bool init_connect(struct rtmp_stream *stream)
 	dstr_copy(&stream->password, obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_PASSWORD));
 	dstr_depad(&stream->path);
 	dstr_depad(&stream->key);
-	drop_b = (int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD);
-	drop_p = (int64_t)obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
 	stream->max_shutdown_time_sec = (int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	stream->stripe_connections = (int)obs_data_get_int(settings, OPT_STRIPE_CONNECTIONS);
+	if (stream->stripe_connections > STRIPE_MAX_CONNECTIONS)
+		stream->stripe_connections = STRIPE_MAX_CONNECTIONS;
 
-	obs_encoder_t *venc = obs_output_get_video_encoder(stream->output);
-	obs_encoder_t *aenc = obs_output_get_audio_encoder(stream->output, 0);
-	obs_data_t *vsettings = obs_encoder_get_settings(venc);
-	obs_data_t *asettings = obs_encoder_get_settings(aenc);
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		obs_encoder_t *enc = obs_output_get_audio_encoder(stream->output, i);
 		if (enc) {
@@ -1284,39 +1360,8 @@ static bool init_connect(struct rtmp_stream *stream)
 		}
 	}
 
-	deque_free(&stream->dbr_frames);
-	stream->audio_bitrate = (long)obs_data_get_int(asettings, "bitrate");
-	stream->dbr_data_size = 0;
-	stream->dbr_orig_bitrate = (long)obs_data_get_int(vsettings, "bitrate");
-	stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
-	stream->dbr_est_bitrate = 0;
-	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
-	stream->dbr_inc_timeout = 0;
-	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
-
-	caps = obs_encoder_get_caps(venc);
-	if ((caps & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
-		stream->dbr_enabled = false;
-		info("Dynamic bitrate disabled. "
-		     "The encoder does not support on-the-fly bitrate reconfiguration.");
-	}
-
-	if (obs_output_get_delay(stream->output) != 0) {
-		stream->dbr_enabled = false;
-	}
-
-	if (stream->dbr_enabled) {
-		info("Dynamic bitrate enabled.  Dropped frames begone!");
-	}
-
-	obs_data_release(vsettings);
-	obs_data_release(asettings);
-
-	if (drop_p < (drop_b + 200))
-		drop_p = drop_b + 200;
-
-	stream->drop_threshold_usec = 1000 * drop_b;
-	stream->pframe_drop_threshold_usec = 1000 * drop_p;
+	stream->dbr_sample_ts = 0;
+	congestion_start(&stream->cc, settings, true);
 
 	bind_ip = obs_data_get_string(settings, OPT_BIND_IP);
 	dstr_copy(&stream->bind_ip, bind_ip);
@@ -1342,6 +1387,10 @@ static bool init_connect(struct rtmp_stream *stream)
 		warn("Disabling network optimizations, not compatible with RTMPS");
 		stream->new_socket_loop = false;
 	}
+	if (stream->new_socket_loop && stream->stripe_connections > 1) {
+		warn("Disabling network optimizations, not compatible with striped upload");
+		stream->new_socket_loop = false;
+	}
 #else
 	stream->new_socket_loop = false;
 	stream->low_latency_mode = false;
@@ -1404,23 +1453,39 @@ static bool rtmp_stream_start(void *data)
 	return pthread_create(&stream->connect_thread, NULL, connect_thread, stream) == 0;
 }
 
-static inline bool add_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
+/* Producer side, called from rtmp_stream_data */
+static bool add_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
 {
-	deque_push_back(&stream->packets, packet, sizeof(struct encoder_packet));
-	return true;
-}
+	unsigned long head = (unsigned long)os_atomic_load_long(&stream->packets_head);
+	unsigned long tail = (unsigned long)stream->packets_tail;
 
-static inline size_t num_buffered_packets(struct rtmp_stream *stream)
-{
-	return stream->packets.size / sizeof(struct encoder_packet);
+	if (tail - head >= PACKET_QUEUE_SIZE) {
+		if (!stream->packets_full)
+			warn("Packet queue is full, dropping packets");
+		stream->packets_full = true;
+		return false;
+	}
+
+	stream->packets_full = false;
+
+	struct packet_slot *slot = &stream->packets[tail & PACKET_QUEUE_MASK];
+	slot->packet = *packet;
+	slot->state = PACKET_SLOT_QUEUED;
+
+	os_atomic_inc_long(&stream->num_packets);
+	if (packet->type == OBS_ENCODER_VIDEO)
+		os_atomic_inc_long(&stream->num_video_packets[drop_priority_idx(packet)]);
+
+	os_atomic_set_long(&stream->packets_tail, (long)(tail + 1));
+	return true;
 }
 
 static void drop_frames(struct rtmp_stream *stream, const char *name, int highest_priority, bool pframes)
 {
 	UNUSED_PARAMETER(pframes);
 
-	struct deque new_buf = {0};
 	int num_frames_dropped = 0;
+	long num_droppable = 0;
 
 #ifdef _DEBUG
 	int start_packets = (int)num_buffered_packets(stream);
@@ -1428,25 +1493,31 @@ static void drop_frames(struct rtmp_stream *stream, const char *name, int highes
 	UNUSED_PARAMETER(name);
 #endif
 
-	deque_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
+	for (int i = 0; i < highest_priority && i < NUM_DROP_PRIORITIES; i++)
+		num_droppable += os_atomic_load_long(&stream->num_video_packets[i]);
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		deque_pop_front(&stream->packets, &packet, sizeof(packet));
+	/* Only the producer writes slots, so every slot between head and tail
+	 * stays valid here. Packets that the send thread takes in the meantime
+	 * simply fail to be claimed. */
+	unsigned long head = (unsigned long)os_atomic_load_long(&stream->packets_head);
+	unsigned long tail = (unsigned long)stream->packets_tail;
+
+	for (; num_droppable > 0 && head != tail; head++) {
+		struct packet_slot *slot = &stream->packets[head & PACKET_QUEUE_MASK];
+		struct encoder_packet *packet = &slot->packet;
 
 		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO || packet.drop_priority >= highest_priority) {
-			deque_push_back(&new_buf, &packet, sizeof(packet));
+		if (packet->type == OBS_ENCODER_AUDIO || packet->drop_priority >= highest_priority)
+			continue;
 
-		} else {
+		if (os_atomic_compare_swap_long(&slot->state, PACKET_SLOT_QUEUED, PACKET_SLOT_DROPPED)) {
+			packet_dequeued(stream, packet);
+			obs_encoder_packet_release(packet);
 			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
+			num_droppable--;
 		}
 	}
 
-	deque_free(&stream->packets);
-	stream->packets = new_buf;
-
 	if (stream->min_priority < highest_priority)
 		stream->min_priority = highest_priority;
 	if (!num_frames_dropped)
@@ -1461,10 +1532,16 @@ static void drop_frames(struct rtmp_stream *stream, const char *name, int highes
 
 static bool find_first_video_packet(struct rtmp_stream *stream, struct encoder_packet *first)
 {
-	size_t count = stream->packets.size / sizeof(*first);
+	unsigned long head = (unsigned long)os_atomic_load_long(&stream->packets_head);
+	unsigned long tail = (unsigned long)stream->packets_tail;
+
+	for (; head != tail; head++) {
+		struct packet_slot *slot = &stream->packets[head & PACKET_QUEUE_MASK];
+		struct encoder_packet *cur = &slot->packet;
+
+		if (os_atomic_load_long(&slot->state) != PACKET_SLOT_QUEUED)
+			continue;
 
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur = deque_data(&stream->packets, i * sizeof(*first));
 		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
 			*first = *cur;
 			return true;
@@ -1474,164 +1551,28 @@ static bool find_first_video_packet(struct rtmp_stream *stream, struct encoder_p
 	return false;
 }
 
-static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
-{
-	long prev_bitrate = stream->dbr_prev_bitrate;
-	long est_bitrate = 0;
-	long new_bitrate;
-
-	if (stream->dbr_est_bitrate && stream->dbr_est_bitrate < stream->dbr_cur_bitrate) {
-		stream->dbr_data_size = 0;
-		deque_pop_front(&stream->dbr_frames, NULL, stream->dbr_frames.size);
-		est_bitrate = stream->dbr_est_bitrate / 100 * 100;
-		if (est_bitrate < 50) {
-			est_bitrate = 50;
-		}
-	}
-
-#if 0
-	if (prev_bitrate && est_bitrate) {
-		if (prev_bitrate < est_bitrate) {
-			blog(LOG_INFO, "going back to prev bitrate: "
-					"prev_bitrate (%d) < est_bitrate (%d)",
-					prev_bitrate,
-					est_bitrate);
-			new_bitrate = prev_bitrate;
-		} else {
-			new_bitrate = est_bitrate;
-		}
-		new_bitrate = est_bitrate;
-	} else if (prev_bitrate) {
-		new_bitrate = prev_bitrate;
-		info("going back to prev bitrate");
-
-	} else if (est_bitrate) {
-		new_bitrate = est_bitrate;
-
-	} else {
-		return false;
-	}
-#else
-	if (est_bitrate) {
-		new_bitrate = est_bitrate;
-
-	} else if (prev_bitrate) {
-		new_bitrate = prev_bitrate;
-		info("going back to prev bitrate");
-
-	} else {
-		return false;
-	}
-
-	if (new_bitrate == stream->dbr_cur_bitrate) {
-		return false;
-	}
-#endif
-
-	stream->dbr_prev_bitrate = 0;
-	stream->dbr_cur_bitrate = new_bitrate;
-	stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
-	info("bitrate decreased to: %ld", stream->dbr_cur_bitrate);
-	return true;
-}
-
-static void dbr_set_bitrate(struct rtmp_stream *stream)
-{
-	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
-	obs_data_t *settings = obs_encoder_get_settings(vencoder);
-
-	obs_data_set_int(settings, "bitrate", stream->dbr_cur_bitrate);
-	obs_encoder_update(vencoder, settings);
-
-	obs_data_release(settings);
-}
-
-static void dbr_inc_bitrate(struct rtmp_stream *stream)
-{
-	stream->dbr_prev_bitrate = stream->dbr_cur_bitrate;
-	stream->dbr_cur_bitrate += stream->dbr_inc_bitrate;
-
-	if (stream->dbr_cur_bitrate >= stream->dbr_orig_bitrate) {
-		stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
-		info("bitrate increased to: %ld, done", stream->dbr_cur_bitrate);
-	} else if (stream->dbr_cur_bitrate < stream->dbr_orig_bitrate) {
-		stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
-		info("bitrate increased to: %ld, waiting", stream->dbr_cur_bitrate);
-	}
-}
-
 static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 {
 	struct encoder_packet first;
-	int64_t buffer_duration_usec;
-	size_t num_packets = num_buffered_packets(stream);
+	int64_t buffer_duration_usec = 0;
 	const char *name = pframes ? "p-frames" : "b-frames";
-	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
-	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec : stream->drop_threshold_usec;
-
-	if (!pframes && stream->dbr_enabled) {
-		if (stream->dbr_inc_timeout) {
-			uint64_t t = os_gettime_ns();
-
-			if (t >= stream->dbr_inc_timeout) {
-				stream->dbr_inc_timeout = 0;
-				dbr_inc_bitrate(stream);
-				dbr_set_bitrate(stream);
-			}
-		}
-	}
-
-	if (num_packets < 5) {
-		if (!pframes)
-			stream->congestion = 0.0f;
-		return;
-	}
-
-	if (!find_first_video_packet(stream, &first))
-		return;
-
-	/* if the amount of time stored in the buffered packets waiting to be
-	 * sent is higher than threshold, drop frames */
-	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
-
-	if (!pframes) {
-		stream->congestion = (float)buffer_duration_usec / (float)drop_threshold;
-	}
-
-	/* alternatively, drop only pframes:
-	 * (!pframes && stream->dbr_enabled)
-	 * but let's test without dropping frames
-	 * at all first */
-	if (stream->dbr_enabled) {
-		bool bitrate_changed = false;
-
-		if (pframes) {
-			return;
-		}
-
-		if ((uint64_t)buffer_duration_usec >= DBR_TRIGGER_USEC) {
-			pthread_mutex_lock(&stream->dbr_mutex);
-			bitrate_changed = dbr_bitrate_lowered(stream);
-			pthread_mutex_unlock(&stream->dbr_mutex);
-		}
+	int priority;
 
-		if (bitrate_changed) {
-			debug("buffer_duration_msec: %" PRId64, buffer_duration_usec / 1000);
-			dbr_set_bitrate(stream);
-		}
-		return;
-	}
+	/* the amount of time stored in the buffered packets waiting to be
+	 * sent */
+	if (num_buffered_packets(stream) >= 5 && find_first_video_packet(stream, &first))
+		buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
-	if (buffer_duration_usec > drop_threshold) {
-		debug("buffer_duration_usec: %" PRId64, buffer_duration_usec);
+	priority = congestion_check(&stream->cc, buffer_duration_usec, pframes);
+	if (priority)
 		drop_frames(stream, name, priority, pframes);
-	}
 }
 
 static bool add_video_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
 {
 	check_to_drop_frames(stream, false);
 	check_to_drop_frames(stream, true);
+	congestion_apply_bitrate(&stream->cc);
 
 	/* if currently dropping frames, drop packets until it reaches the
 	 * desired priority */
@@ -1643,7 +1584,26 @@ static bool add_video_packet(struct rtmp_stream *stream, struct encoder_packet *
 	}
 
 	stream->last_dts_usec = packet->dts_usec;
-	return add_packet(stream, packet);
+
+	/* later frames may reference this one, so drop everything up to the
+	 * next keyframe as well */
+	if (!add_packet(stream, packet)) {
+		stream->dropped_frames++;
+		stream->min_priority = OBS_NAL_PRIORITY_HIGHEST;
+		return false;
+	}
+
+	return true;
+}
+
+static bool add_audio_packet(struct rtmp_stream *stream, struct encoder_packet *packet)
+{
+	if (!add_packet(stream, packet)) {
+		os_atomic_inc_long(&stream->dropped_audio_packets);
+		return false;
+	}
+
+	return true;
 }
 
 static void rtmp_stream_data(void *data, struct encoder_packet *packet)
@@ -1696,15 +1656,11 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 		obs_encoder_packet_ref(&new_packet, packet);
 	}
 
-	pthread_mutex_lock(&stream->packets_mutex);
-
 	if (!disconnected(stream)) {
 		added_packet = (packet->type == OBS_ENCODER_VIDEO) ? add_video_packet(stream, &new_packet)
-								   : add_packet(stream, &new_packet);
+								   : add_audio_packet(stream, &new_packet);
 	}
 
-	pthread_mutex_unlock(&stream->packets_mutex);
-
 	if (added_packet)
 		os_sem_post(stream->send_sem);
 	else
@@ -1717,6 +1673,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+	obs_data_set_default_int(defaults, OPT_STRIPE_CONNECTIONS, 1);
 #ifdef _WIN32
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
@@ -1754,6 +1711,10 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
+	p = obs_properties_add_int(props, OPT_STRIPE_CONNECTIONS, obs_module_text("RTMPStream.StripeConnections"), 1,
+				   STRIPE_MAX_CONNECTIONS, 1);
+	obs_property_set_long_description(p, obs_module_text("RTMPStream.StripeConnections.ToolTip"));
+
 #ifdef _WIN32
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED, obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED, obs_module_text("RTMPStream.LowLatencyMode"));
@@ -1781,7 +1742,7 @@ static float rtmp_stream_congestion(void *data)
 	if (stream->new_socket_loop)
 		return (float)stream->write_buf_len / (float)stream->write_buf_size;
 	else
-		return stream->min_priority > 0 ? 1.0f : stream->congestion;
+		return stream->min_priority > 0 ? 1.0f : stream->cc.congestion;
 }
 
 static int rtmp_stream_connect_time(void *data)
@@ -1790,6 +1751,18 @@ static int rtmp_stream_connect_time(void *data)
 	return stream->rtmp.connect_time_ms;
 }
 
+static void get_bandwidth_estimate_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+
+	pthread_mutex_lock(&stream->cc.mutex);
+	calldata_set_int(cd, "bandwidth_kbps", bwe_bandwidth_kbps(&stream->cc.bwe));
+	calldata_set_int(cd, "rtt_ms", stream->cc.bwe.rtt_us / 1000);
+	calldata_set_int(cd, "min_rtt_ms", stream->cc.bwe.min_rtt_us / 1000);
+	calldata_set_int(cd, "bitrate_kbps", stream->cc.dbr_enabled ? stream->cc.dbr_cur_bitrate : 0);
+	pthread_mutex_unlock(&stream->cc.mutex);
+}
+
 struct obs_output_info rtmp_output_info = {
 	.id = "rtmp_output",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE | OBS_OUTPUT_MULTI_TRACK_AV,
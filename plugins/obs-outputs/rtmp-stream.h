@@ -1,4 +1,5 @@
 #include <obs-module.h>
+#include <obs-nal.h>
 #include <util/platform.h>
 #include <util/deque.h>
 #include <util/dstr.h>
@@ -6,8 +7,10 @@
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
+#include "congestion-control.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "rtmp-stripe.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -15,6 +18,11 @@
 #include <sys/ioctl.h>
 #endif
 
+#ifdef __linux__
+#include <linux/sockios.h>
+#include <netinet/tcp.h>
+#endif
+
 #define do_log(level, format, ...) \
 	blog(level, "[rtmp stream: '%s'] " format, obs_output_get_name(stream->output), ##__VA_ARGS__)
 
@@ -22,15 +30,13 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
-#define OPT_DYN_BITRATE "dyn_bitrate"
-#define OPT_DROP_THRESHOLD "drop_threshold_ms"
-#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
 #define OPT_BIND_IP "bind_ip"
 #define OPT_IP_FAMILY "ip_family"
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
 #define OPT_METADATA_MULTITRACK "metadata_multitrack"
+#define OPT_STRIPE_CONNECTIONS "stripe_connections"
 
 //#define TEST_FRAMEDROPS
 //#define TEST_FRAMEDROPS_WITH_BITRATE_SHORTCUTS
@@ -46,17 +52,42 @@ struct droptest_info {
 };
 #endif
 
-struct dbr_frame {
-	uint64_t send_beg;
-	uint64_t send_end;
-	size_t size;
+/* Packets are handed from rtmp_stream_data to the send thread through a
+ * bounded single producer/single consumer ring. The producer may also drop
+ * packets that are still queued by claiming their slot, in which case the
+ * consumer skips it. */
+#define PACKET_QUEUE_SIZE 4096
+#define PACKET_QUEUE_MASK (PACKET_QUEUE_SIZE - 1)
+#define NUM_DROP_PRIORITIES (OBS_NAL_PRIORITY_HIGHEST + 1)
+
+enum packet_slot_state {
+	PACKET_SLOT_QUEUED,
+	PACKET_SLOT_SENT,
+	PACKET_SLOT_DROPPED,
+};
+
+struct packet_slot {
+	struct encoder_packet packet;
+	volatile long state;
 };
 
 struct rtmp_stream {
 	obs_output_t *output;
 
-	pthread_mutex_t packets_mutex;
-	struct deque packets;
+	struct packet_slot *packets;
+	volatile long packets_head;
+	volatile long packets_tail;
+	bool packets_full;
+
+	/* Audio packets lost to a full queue, there is no frame drop count
+	 * for audio so they are logged when the stream ends */
+	volatile long dropped_audio_packets;
+
+	/* Number of packets in the queue, and of video packets per drop
+	 * priority, so that frame drop checks don't need to scan the queue */
+	volatile long num_packets;
+	volatile long num_video_packets[NUM_DROP_PRIORITIES];
+
 	bool sent_headers;
 
 	bool got_first_packet;
@@ -84,10 +115,7 @@ struct rtmp_stream {
 	socklen_t addrlen_hint; /* hint IPv4 vs IPv6 */
 
 	/* frame drop variables */
-	int64_t drop_threshold_usec;
-	int64_t pframe_drop_threshold_usec;
 	int min_priority;
-	float congestion;
 
 	int64_t last_dts_usec;
 
@@ -101,23 +129,20 @@ struct rtmp_stream {
 	size_t droptest_size;
 #endif
 
-	pthread_mutex_t dbr_mutex;
-	struct deque dbr_frames;
-	size_t dbr_data_size;
-	uint64_t dbr_inc_timeout;
-	long audio_bitrate;
-	long dbr_est_bitrate;
-	long dbr_orig_bitrate;
-	long dbr_prev_bitrate;
-	long dbr_cur_bitrate;
-	long dbr_inc_bitrate;
-	bool dbr_enabled;
+	/* frame dropping and dynamic bitrate */
+	struct congestion_control cc;
+	uint64_t dbr_sample_ts;
 
 	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
 	RTMP rtmp;
 
+	/* striped upload over several connections instead of RTMP, see
+	 * rtmp-stripe.h */
+	int stripe_connections;
+	struct stripe_sender stripe;
+
 	bool new_socket_loop;
 	bool low_latency_mode;
 	bool disable_send_window_optimization;
@@ -0,0 +1,214 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "rtmp-stripe.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#define INVALID_SOCKET -1
+#define closesocket close
+#endif
+
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define DEFAULT_PORT 1935
+
+static inline void put_be16(uint8_t *p, uint16_t val)
+{
+	p[0] = (uint8_t)(val >> 8);
+	p[1] = (uint8_t)val;
+}
+
+static inline void put_be32(uint8_t *p, uint32_t val)
+{
+	put_be16(p, (uint16_t)(val >> 16));
+	put_be16(p + 2, (uint16_t)val);
+}
+
+static inline void put_be64(uint8_t *p, uint64_t val)
+{
+	put_be32(p, (uint32_t)(val >> 32));
+	put_be32(p + 4, (uint32_t)val);
+}
+
+static bool send_all(stripe_socket_t sock, const uint8_t *data, size_t size)
+{
+	while (size) {
+		int ret = send(sock, (const char *)data, size > INT_MAX ? INT_MAX : (int)size, MSG_NOSIGNAL);
+		if (ret <= 0) {
+#ifndef _WIN32
+			if (ret < 0 && errno == EINTR)
+				continue;
+#endif
+			return false;
+		}
+
+		data += ret;
+		size -= (size_t)ret;
+	}
+
+	return true;
+}
+
+static stripe_socket_t open_socket(const struct addrinfo *ai, const struct sockaddr *bind_addr, int bind_len)
+{
+	for (; ai; ai = ai->ai_next) {
+		stripe_socket_t sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sock == INVALID_SOCKET)
+			continue;
+		if ((!bind_addr || bind(sock, bind_addr, bind_len) == 0) &&
+		    connect(sock, ai->ai_addr, (int)ai->ai_addrlen) == 0)
+			return sock;
+		closesocket(sock);
+	}
+
+	return INVALID_SOCKET;
+}
+
+bool stripe_connect(struct stripe_sender *stripe, const char *host, unsigned int port, const char *path,
+		    size_t count, const struct sockaddr *bind_addr, int bind_len)
+{
+	struct addrinfo hints = {0};
+	struct addrinfo *res = NULL;
+	size_t path_size = strlen(path);
+	size_t hello_size = STRIPE_HELLO_SIZE + path_size;
+	char port_str[16];
+	uint8_t *hello;
+	uint64_t session;
+	bool success = false;
+
+	memset(stripe, 0, sizeof(*stripe));
+
+	if (count < 1 || count > STRIPE_MAX_CONNECTIONS || path_size > UINT16_MAX)
+		return false;
+
+	snprintf(port_str, sizeof(port_str), "%u", port ? port : DEFAULT_PORT);
+	hints.ai_family = bind_addr ? bind_addr->sa_family : AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	if (getaddrinfo(host, port_str, &hints, &res) != 0) {
+		blog(LOG_WARNING, "[rtmp stripe] Could not resolve '%s'", host);
+		return false;
+	}
+
+	/* only needs to tell apart sessions that are open at the same time */
+	session = os_gettime_ns() ^ ((uint64_t)(uintptr_t)stripe << 32);
+
+	hello = bmalloc(hello_size);
+	memcpy(hello, STRIPE_MAGIC, STRIPE_MAGIC_SIZE);
+	hello[STRIPE_MAGIC_SIZE] = STRIPE_VERSION;
+	hello[STRIPE_MAGIC_SIZE + 2] = (uint8_t)count;
+	put_be64(hello + STRIPE_MAGIC_SIZE + 3, session);
+	put_be16(hello + STRIPE_MAGIC_SIZE + 11, (uint16_t)path_size);
+	memcpy(hello + STRIPE_HELLO_SIZE, path, path_size);
+
+	for (size_t i = 0; i < count; i++) {
+		stripe_socket_t sock = open_socket(res, bind_addr, bind_len);
+		if (sock == INVALID_SOCKET) {
+			blog(LOG_WARNING, "[rtmp stripe] Could not open connection %zu of %zu to %s:%s%s", i + 1,
+			     count, host, port_str, bind_addr ? " from the bind address" : "");
+			goto fail;
+		}
+
+		stripe->sockets[stripe->num_sockets++] = sock;
+
+		hello[STRIPE_MAGIC_SIZE + 1] = (uint8_t)i;
+		if (!send_all(sock, hello, hello_size))
+			goto fail;
+	}
+
+	success = true;
+
+fail:
+	if (!success)
+		stripe_close(stripe);
+	bfree(hello);
+	freeaddrinfo(res);
+	return success;
+}
+
+void stripe_close(struct stripe_sender *stripe)
+{
+	for (size_t i = 0; i < stripe->num_sockets; i++)
+		closesocket(stripe->sockets[i]);
+	stripe->num_sockets = 0;
+}
+
+/* Round robin, but skip connections that still have data waiting for their
+ * congestion window so that one slow flow doesn't hold up the others */
+static size_t pick_socket(struct stripe_sender *stripe)
+{
+	size_t best = stripe->next % stripe->num_sockets;
+
+#ifdef __linux__
+	int best_queued = INT_MAX;
+
+	for (size_t n = 0; n < stripe->num_sockets; n++) {
+		size_t i = (stripe->next + n) % stripe->num_sockets;
+		int queued;
+
+		if (ioctl(stripe->sockets[i], SIOCOUTQNSD, &queued) != 0)
+			break;
+		if (queued < best_queued) {
+			best = i;
+			best_queued = queued;
+			if (!queued)
+				break;
+		}
+	}
+#endif
+
+	stripe->next = best + 1;
+	return best;
+}
+
+int stripe_write(struct stripe_sender *stripe, const uint8_t *data, size_t size)
+{
+	uint8_t header[STRIPE_MESSAGE_HEADER_SIZE];
+	stripe_socket_t sock;
+
+	if (!stripe->num_sockets || size > INT_MAX)
+		return -1;
+
+	sock = stripe->sockets[pick_socket(stripe)];
+
+	put_be32(header, stripe->sequence++);
+	put_be32(header + 4, (uint32_t)size);
+
+	if (!send_all(sock, header, sizeof(header)) || !send_all(sock, data, size))
+		return -1;
+
+	return (int)size;
+}
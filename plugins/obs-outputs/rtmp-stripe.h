@@ -0,0 +1,83 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET stripe_socket_t;
+#else
+#include <sys/socket.h>
+typedef int stripe_socket_t;
+#endif
+
+/*
+ * Striped FLV upload, for ingest servers that support it.
+ *
+ * A single TCP connection only gets so much throughput on long fat paths, so
+ * instead of RTMP the FLV tag stream is spread over several plain TCP
+ * connections.  Each connection starts with a hello:
+ *
+ *   magic       8 bytes, STRIPE_MAGIC
+ *   version     u8, STRIPE_VERSION
+ *   index       u8, index of this connection
+ *   count       u8, number of connections in the session
+ *   session     u64, identical on all connections of a session
+ *   path size   u16
+ *   path        app and stream key, "app/key"
+ *
+ * followed by any number of messages:
+ *
+ *   sequence    u32, counts up by one per message across all connections
+ *   size        u32
+ *   data        size bytes of the FLV stream
+ *
+ * All integers are big endian.  The receiver restores the FLV stream by
+ * concatenating message data in sequence order, the first message starts
+ * with the FLV file header.
+ */
+
+#define STRIPE_MAGIC "OBSSTRIP"
+#define STRIPE_MAGIC_SIZE 8
+#define STRIPE_VERSION 1
+#define STRIPE_HELLO_SIZE (STRIPE_MAGIC_SIZE + 3 + 8 + 2)
+#define STRIPE_MESSAGE_HEADER_SIZE 8
+#define STRIPE_MAX_CONNECTIONS 16
+
+struct stripe_sender {
+	stripe_socket_t sockets[STRIPE_MAX_CONNECTIONS];
+	size_t num_sockets;
+	size_t next;
+	uint32_t sequence;
+};
+
+/* If bind_addr is set, every connection is made from that local address and
+ * only to server addresses of the same family */
+extern bool stripe_connect(struct stripe_sender *stripe, const char *host, unsigned int port, const char *path,
+			   size_t count, const struct sockaddr *bind_addr, int bind_len);
+extern void stripe_close(struct stripe_sender *stripe);
+
+/* Sends one message on the connection with the least unsent data, returns
+ * the number of bytes written or -1 on error */
+extern int stripe_write(struct stripe_sender *stripe, const uint8_t *data, size_t size);
+
+static inline bool stripe_active(const struct stripe_sender *stripe)
+{
+	return stripe->num_sockets > 0;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+#include "bw-estimator.h"
+
+void bwe_init(struct bw_estimator *bwe)
+{
+	memset(bwe, 0, sizeof(*bwe));
+}
+
+static void update_estimates(struct bw_estimator *bwe)
+{
+	long max_rate = 0;
+	uint32_t min_rtt = 0;
+
+	for (size_t i = 0; i < bwe->num_slots; i++) {
+		if (bwe->rates_kbps[i] > max_rate)
+			max_rate = bwe->rates_kbps[i];
+		if (bwe->min_rtts_us[i] && (!min_rtt || bwe->min_rtts_us[i] < min_rtt))
+			min_rtt = bwe->min_rtts_us[i];
+	}
+
+	bwe->bandwidth_kbps = max_rate;
+	bwe->min_rtt_us = min_rtt;
+}
+
+static inline void start_interval(struct bw_estimator *bwe, uint64_t ts_ns, uint64_t delivered)
+{
+	bwe->interval_start_ns = ts_ns;
+	bwe->interval_start_bytes = delivered;
+	bwe->interval_min_rtt_us = 0;
+	bwe->interval_app_limited = false;
+}
+
+void bwe_add_sample(struct bw_estimator *bwe, uint64_t ts_ns, uint64_t delivered, uint32_t rtt_us, bool app_limited)
+{
+	uint64_t elapsed;
+	uint64_t bytes;
+	long rate;
+
+	if (!bwe->interval_start_ns) {
+		start_interval(bwe, ts_ns, delivered);
+		bwe->interval_app_limited = app_limited;
+		return;
+	}
+
+	if (rtt_us) {
+		bwe->rtt_us = rtt_us;
+		if (!bwe->interval_min_rtt_us || rtt_us < bwe->interval_min_rtt_us)
+			bwe->interval_min_rtt_us = rtt_us;
+	}
+
+	bwe->interval_app_limited |= app_limited;
+
+	elapsed = ts_ns - bwe->interval_start_ns;
+	if (elapsed < BWE_INTERVAL_NS)
+		return;
+
+	/* the delivered count is derived from queue sizes, so it can be a
+	 * little behind the previous one */
+	bytes = delivered > bwe->interval_start_bytes ? delivered - bwe->interval_start_bytes : 0;
+	rate = (long)(bytes * 8 * 1000000 / elapsed);
+
+	if (bwe->interval_app_limited && rate < bwe->bandwidth_kbps)
+		rate = bwe->bandwidth_kbps;
+
+	bwe->rates_kbps[bwe->slot] = rate;
+	bwe->min_rtts_us[bwe->slot] = bwe->interval_min_rtt_us;
+	bwe->slot = (bwe->slot + 1) % BWE_SLOTS;
+	if (bwe->num_slots < BWE_SLOTS)
+		bwe->num_slots++;
+
+	update_estimates(bwe);
+	start_interval(bwe, ts_ns, delivered);
+}
+
+void bwe_congested(struct bw_estimator *bwe)
+{
+	long rate;
+
+	if (!bwe->num_slots)
+		return;
+
+	rate = bwe->rates_kbps[(bwe->slot + BWE_SLOTS - 1) % BWE_SLOTS];
+	for (size_t i = 0; i < bwe->num_slots; i++) {
+		if (bwe->rates_kbps[i] > rate)
+			bwe->rates_kbps[i] = rate;
+	}
+
+	update_estimates(bwe);
+}
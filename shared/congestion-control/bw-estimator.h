@@ -0,0 +1,76 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Bandwidth estimator used by dynamic bitrate.
+ *
+ * The send thread periodically reports how many bytes the peer has received
+ * so far and the current round trip time.  Every BWE_INTERVAL_NS the delivery
+ * rate over the last interval is stored in a ring covering BWE_WINDOW_NS, and
+ * the bandwidth estimate is the maximum over that window, as in BBR.
+ *
+ * Intervals during which the sender ran out of data are application limited
+ * and say nothing about the link, so they can raise the estimate but never
+ * lower it.
+ */
+
+#define BWE_INTERVAL_NS 250000000ULL
+#define BWE_WINDOW_NS 10000000000ULL
+#define BWE_SLOTS (BWE_WINDOW_NS / BWE_INTERVAL_NS)
+
+struct bw_estimator {
+	long rates_kbps[BWE_SLOTS];
+	uint32_t min_rtts_us[BWE_SLOTS];
+	size_t slot;
+	size_t num_slots;
+
+	uint64_t interval_start_ns;
+	uint64_t interval_start_bytes;
+	uint32_t interval_min_rtt_us;
+	bool interval_app_limited;
+
+	long bandwidth_kbps;
+	uint32_t rtt_us;
+	uint32_t min_rtt_us;
+};
+
+extern void bwe_init(struct bw_estimator *bwe);
+
+/* delivered is the running total of bytes received by the peer, rtt_us may be
+ * 0 if the platform can't provide it */
+extern void bwe_add_sample(struct bw_estimator *bwe, uint64_t ts_ns, uint64_t delivered, uint32_t rtt_us,
+			   bool app_limited);
+
+/* Called when the link turned out to be slower than estimated; caps the window
+ * at the most recent delivery rate so that the estimate drops immediately
+ * instead of after BWE_WINDOW_NS */
+extern void bwe_congested(struct bw_estimator *bwe);
+
+/* 0 until the first interval has completed */
+static inline long bwe_bandwidth_kbps(const struct bw_estimator *bwe)
+{
+	return bwe->bandwidth_kbps;
+}
+
+/* time spent in queues along the path, 0 if unknown */
+static inline uint32_t bwe_queue_delay_us(const struct bw_estimator *bwe)
+{
+	return bwe->rtt_us > bwe->min_rtt_us ? bwe->rtt_us - bwe->min_rtt_us : 0;
+}
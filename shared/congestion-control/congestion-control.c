@@ -0,0 +1,311 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <obs-nal.h>
+#include <util/platform.h>
+
+#include "congestion-control.h"
+
+#define do_log(level, format, ...) \
+	blog(level, "[%s: '%s'] " format, obs_output_get_id(cc->output), obs_output_get_name(cc->output), ##__VA_ARGS__)
+
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+#define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
+
+#define SEC_TO_NSEC 1000000000ULL
+#define MSEC_TO_USEC 1000ULL
+
+/* dynamic bitrate coefficients */
+#define DBR_INC_TIMER (4ULL * SEC_TO_NSEC)
+#define DBR_DEC_HOLD (1ULL * SEC_TO_NSEC)
+#define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
+#define DBR_QUEUE_DELAY_USEC (100ULL * MSEC_TO_USEC)
+#define DBR_INC_MAX_CONGESTION 0.1f
+#define DBR_HEADROOM_PERCENT 90
+#define DBR_MIN_BITRATE 50
+
+bool congestion_init(struct congestion_control *cc, obs_output_t *output)
+{
+	memset(cc, 0, sizeof(*cc));
+	cc->output = output;
+	return pthread_mutex_init(&cc->mutex, NULL) == 0;
+}
+
+void congestion_free(struct congestion_control *cc)
+{
+	pthread_mutex_destroy(&cc->mutex);
+}
+
+static long get_audio_bitrate(obs_output_t *output)
+{
+	long bitrate = 0;
+
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		obs_encoder_t *aencoder = obs_output_get_audio_encoder(output, i);
+		obs_data_t *asettings;
+
+		if (!aencoder)
+			continue;
+
+		asettings = obs_encoder_get_settings(aencoder);
+		bitrate += (long)obs_data_get_int(asettings, "bitrate");
+		obs_data_release(asettings);
+	}
+
+	return bitrate;
+}
+
+void congestion_start(struct congestion_control *cc, obs_data_t *settings, bool drop_frames)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(cc->output);
+	obs_data_t *vsettings = obs_encoder_get_settings(vencoder);
+	int64_t drop_b = obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	int64_t drop_p = obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	cc->drop_threshold_usec = 1000 * drop_b;
+	cc->pframe_drop_threshold_usec = 1000 * drop_p;
+	cc->drop_frames = drop_frames;
+	cc->congestion = 0.0f;
+
+	pthread_mutex_lock(&cc->mutex);
+	bwe_init(&cc->bwe);
+	pthread_mutex_unlock(&cc->mutex);
+
+	cc->audio_bitrate = get_audio_bitrate(cc->output);
+	cc->dbr_orig_bitrate = (long)obs_data_get_int(vsettings, "bitrate");
+	cc->dbr_cur_bitrate = cc->dbr_orig_bitrate;
+	cc->dbr_prev_bitrate = 0;
+	cc->dbr_inc_bitrate = cc->dbr_orig_bitrate / 10;
+	cc->dbr_inc_timeout = 0;
+	cc->dbr_dec_hold = 0;
+	cc->dbr_pending = false;
+	cc->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
+
+	obs_data_release(vsettings);
+
+	if ((obs_encoder_get_caps(vencoder) & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
+		cc->dbr_enabled = false;
+		info("Dynamic bitrate disabled. "
+		     "The encoder does not support on-the-fly bitrate reconfiguration.");
+	}
+
+	if (obs_output_get_delay(cc->output) != 0)
+		cc->dbr_enabled = false;
+
+	if (cc->dbr_enabled)
+		info("Dynamic bitrate enabled.  Dropped frames begone!");
+}
+
+static void dbr_set_bitrate(struct congestion_control *cc, long bitrate)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(cc->output);
+	obs_data_t *settings = obs_encoder_get_settings(vencoder);
+
+	obs_data_set_int(settings, "bitrate", bitrate);
+	obs_encoder_update(vencoder, settings);
+
+	obs_data_release(settings);
+}
+
+void congestion_stop(struct congestion_control *cc)
+{
+	bool restore;
+
+	pthread_mutex_lock(&cc->mutex);
+	restore = cc->dbr_enabled && cc->dbr_cur_bitrate != cc->dbr_orig_bitrate;
+	cc->dbr_cur_bitrate = cc->dbr_orig_bitrate;
+	cc->dbr_pending = false;
+	pthread_mutex_unlock(&cc->mutex);
+
+	if (restore)
+		dbr_set_bitrate(cc, cc->dbr_orig_bitrate);
+}
+
+void congestion_apply_bitrate(struct congestion_control *cc)
+{
+	long bitrate = 0;
+
+	if (!cc->dbr_enabled)
+		return;
+
+	pthread_mutex_lock(&cc->mutex);
+	if (cc->dbr_pending)
+		bitrate = cc->dbr_cur_bitrate;
+	cc->dbr_pending = false;
+	pthread_mutex_unlock(&cc->mutex);
+
+	if (bitrate)
+		dbr_set_bitrate(cc, bitrate);
+}
+
+void congestion_add_sample(struct congestion_control *cc, uint64_t ts_ns, uint64_t delivered, uint32_t rtt_us,
+			   bool app_limited)
+{
+	pthread_mutex_lock(&cc->mutex);
+	bwe_add_sample(&cc->bwe, ts_ns, delivered, rtt_us, app_limited);
+	pthread_mutex_unlock(&cc->mutex);
+}
+
+/* encoder bitrate that fits into the estimated bandwidth, leaving room for
+ * audio and for bursts of large frames */
+static long dbr_target_bitrate(struct congestion_control *cc)
+{
+	long bandwidth = bwe_bandwidth_kbps(&cc->bwe);
+	long target;
+
+	if (!bandwidth)
+		return 0;
+
+	target = bandwidth * DBR_HEADROOM_PERCENT / 100 - cc->audio_bitrate;
+	target = target / 100 * 100;
+	return target < DBR_MIN_BITRATE ? DBR_MIN_BITRATE : target;
+}
+
+static bool dbr_bitrate_lowered(struct congestion_control *cc)
+{
+	long prev_bitrate = cc->dbr_prev_bitrate;
+	uint64_t t = os_gettime_ns();
+	long est_bitrate;
+	long new_bitrate;
+
+	/* give the queues time to drain before judging the last decrease */
+	if (t < cc->dbr_dec_hold)
+		return false;
+
+	bwe_congested(&cc->bwe);
+	est_bitrate = dbr_target_bitrate(cc);
+	if (est_bitrate >= cc->dbr_cur_bitrate)
+		est_bitrate = 0;
+
+	if (est_bitrate) {
+		new_bitrate = est_bitrate;
+
+	} else if (prev_bitrate) {
+		new_bitrate = prev_bitrate;
+		info("going back to prev bitrate");
+
+	} else {
+		return false;
+	}
+
+	if (new_bitrate == cc->dbr_cur_bitrate)
+		return false;
+
+	cc->dbr_prev_bitrate = 0;
+	cc->dbr_cur_bitrate = new_bitrate;
+	cc->dbr_pending = true;
+	cc->dbr_inc_timeout = t + DBR_INC_TIMER;
+	cc->dbr_dec_hold = t + DBR_DEC_HOLD;
+	info("bitrate decreased to: %ld", cc->dbr_cur_bitrate);
+	return true;
+}
+
+static void dbr_inc_bitrate(struct congestion_control *cc)
+{
+	long est_bitrate = dbr_target_bitrate(cc);
+
+	cc->dbr_prev_bitrate = cc->dbr_cur_bitrate;
+
+	/* go straight to what the link has already shown it can take,
+	 * otherwise probe for more in small steps */
+	if (est_bitrate > cc->dbr_cur_bitrate + cc->dbr_inc_bitrate)
+		cc->dbr_cur_bitrate = est_bitrate;
+	else
+		cc->dbr_cur_bitrate += cc->dbr_inc_bitrate;
+
+	cc->dbr_pending = true;
+
+	if (cc->dbr_cur_bitrate >= cc->dbr_orig_bitrate) {
+		cc->dbr_cur_bitrate = cc->dbr_orig_bitrate;
+		info("bitrate increased to: %ld, done", cc->dbr_cur_bitrate);
+	} else {
+		cc->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
+		info("bitrate increased to: %ld, waiting", cc->dbr_cur_bitrate);
+	}
+}
+
+/* The round trip time rises as soon as queues along the path fill up, well
+ * before the socket buffer is full and packets back up in our own queue.
+ * Outputs that can't measure the round trip time only have the latter. */
+static inline bool dbr_queue_delayed(struct congestion_control *cc)
+{
+	uint32_t queue_delay = bwe_queue_delay_us(&cc->bwe);
+
+	return queue_delay >= DBR_QUEUE_DELAY_USEC && queue_delay >= cc->bwe.min_rtt_us;
+}
+
+static void dbr_update(struct congestion_control *cc)
+{
+	uint64_t t = os_gettime_ns();
+
+	pthread_mutex_lock(&cc->mutex);
+
+	/* only increase once the link has been calm for a while, so that the
+	 * bitrate doesn't oscillate around the trigger points */
+	if (dbr_queue_delayed(cc)) {
+		dbr_bitrate_lowered(cc);
+	} else if (cc->dbr_inc_timeout && t >= cc->dbr_inc_timeout) {
+		if (cc->congestion < DBR_INC_MAX_CONGESTION) {
+			cc->dbr_inc_timeout = 0;
+			dbr_inc_bitrate(cc);
+		} else {
+			cc->dbr_inc_timeout = t + DBR_INC_TIMER;
+		}
+	}
+
+	pthread_mutex_unlock(&cc->mutex);
+}
+
+int congestion_check(struct congestion_control *cc, int64_t buffer_duration_usec, bool pframes)
+{
+	int64_t drop_threshold = pframes ? cc->pframe_drop_threshold_usec : cc->drop_threshold_usec;
+
+	if (!pframes) {
+		if (cc->dbr_enabled)
+			dbr_update(cc);
+
+		cc->congestion = drop_threshold ? (float)buffer_duration_usec / (float)drop_threshold : 0.0f;
+	}
+
+	/* with dynamic bitrate, lower the bitrate instead of dropping */
+	if (cc->dbr_enabled) {
+		bool bitrate_changed = false;
+
+		if (pframes)
+			return 0;
+
+		if (buffer_duration_usec >= (int64_t)DBR_TRIGGER_USEC) {
+			pthread_mutex_lock(&cc->mutex);
+			bitrate_changed = dbr_bitrate_lowered(cc);
+			pthread_mutex_unlock(&cc->mutex);
+		}
+
+		if (bitrate_changed)
+			debug("buffer_duration_msec: %" PRId64, buffer_duration_usec / 1000);
+		return 0;
+	}
+
+	if (!cc->drop_frames || buffer_duration_usec <= drop_threshold)
+		return 0;
+
+	debug("buffer_duration_usec: %" PRId64, buffer_duration_usec);
+	return pframes ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <util/threading.h>
+
+#include "bw-estimator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OPT_DYN_BITRATE "dyn_bitrate"
+#define OPT_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+
+/*
+ * Congestion handling shared by the streaming outputs.
+ *
+ * The output keeps its own packet queue.  Before queuing a video packet it
+ * reports how much video is still waiting to be sent, and depending on the
+ * output settings congestion_check() either lowers the encoder bitrate
+ * (dynamic bitrate) or tells the output which frames to drop from its queue.
+ *
+ * The send thread feeds the bandwidth estimator through
+ * congestion_add_sample(), everything else runs on the thread that queues
+ * packets.  A new bitrate is only passed to the encoder by
+ * congestion_apply_bitrate(), so the output can decide it under its queue lock
+ * and update the encoder after unlocking.
+ */
+struct congestion_control {
+	obs_output_t *output;
+
+	/* frame drop variables */
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+	bool drop_frames;
+	float congestion;
+
+	/* dynamic bitrate, mutex protects bwe */
+	pthread_mutex_t mutex;
+	struct bw_estimator bwe;
+	uint64_t dbr_inc_timeout;
+	uint64_t dbr_dec_hold;
+	long audio_bitrate;
+	long dbr_orig_bitrate;
+	long dbr_prev_bitrate;
+	long dbr_cur_bitrate;
+	long dbr_inc_bitrate;
+	bool dbr_pending;
+	bool dbr_enabled;
+};
+
+extern bool congestion_init(struct congestion_control *cc, obs_output_t *output);
+extern void congestion_free(struct congestion_control *cc);
+
+/* Reads the drop thresholds and the dynamic bitrate setting when the output
+ * starts.  Frames are only dropped if drop_frames is set and dynamic bitrate
+ * is disabled. */
+extern void congestion_start(struct congestion_control *cc, obs_data_t *settings, bool drop_frames);
+
+/* Restores the original encoder bitrate */
+extern void congestion_stop(struct congestion_control *cc);
+
+/* delivered is the running total of bytes that left the output, see
+ * bwe_add_sample() */
+extern void congestion_add_sample(struct congestion_control *cc, uint64_t ts_ns, uint64_t delivered, uint32_t rtt_us,
+				  bool app_limited);
+
+/* Called before queuing a video packet, first for b-frames and then for
+ * p-frames.  buffer_duration_usec is the duration of the video waiting to be
+ * sent, 0 if the queue is nearly empty.  Returns the drop priority below
+ * which the queued video frames have to be dropped, or 0. */
+extern int congestion_check(struct congestion_control *cc, int64_t buffer_duration_usec, bool pframes);
+
+/* Updates the encoder if congestion_check() changed the bitrate.  Don't call
+ * it with locks held that the packet path needs, the update can take a while
+ * with some encoders. */
+extern void congestion_apply_bitrate(struct congestion_control *cc);
+
+#ifdef __cplusplus
+}
+#endif
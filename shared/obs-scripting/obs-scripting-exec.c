@@ -0,0 +1,250 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+#include "obs-scripting-internal.h"
+
+/*
+ * Script ticks and timers run on their own thread instead of the graphics
+ * thread, so a slow script delays its own callbacks rather than the frame.
+ * The graphics tick only adds up the elapsed time and wakes the thread; any
+ * frames that pass while a script is still busy are coalesced into a single
+ * tick with the summed time.
+ */
+
+/* per-call budget before a call counts as an overrun */
+#define EXEC_BUDGET_NS 10000000ULL
+/* consecutive overruns before a script gets throttled */
+#define EXEC_MAX_OVERRUNS 3
+/* first throttle period, doubled for every repeat up to the max level */
+#define EXEC_THROTTLE_NS 50000000ULL
+#define EXEC_MAX_THROTTLE_LEVEL 5
+/* a single call running this long is reported from the graphics thread */
+#define EXEC_HANG_NS 2000000000ULL
+
+static const char *exec_thread_name = "scripting: exec";
+
+struct exec_tick {
+	script_tick_cb cb;
+	void *param;
+};
+
+static pthread_mutex_t exec_mutex;
+static DARRAY(struct exec_tick) exec_ticks;
+
+static pthread_mutex_t exec_state_mutex;
+static float exec_pending_seconds = 0.0f;
+static bool exec_pending = false;
+static const char *exec_current = NULL;
+static uint64_t exec_current_start = 0;
+static bool exec_hang_reported = false;
+
+static bool exec_exit = false;
+static os_sem_t *exec_semaphore;
+static pthread_t exec_thread;
+
+static void *exec_thread_loop(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	os_set_thread_name(exec_thread_name);
+
+	profile_register_root(exec_thread_name, 0);
+
+	while (os_sem_wait(exec_semaphore) == 0) {
+		float seconds;
+
+		pthread_mutex_lock(&exec_state_mutex);
+		if (exec_exit) {
+			pthread_mutex_unlock(&exec_state_mutex);
+			break;
+		}
+
+		seconds = exec_pending_seconds;
+		exec_pending_seconds = 0.0f;
+		exec_pending = false;
+		pthread_mutex_unlock(&exec_state_mutex);
+
+		profile_start(exec_thread_name);
+
+		pthread_mutex_lock(&exec_mutex);
+		for (size_t i = exec_ticks.num; i > 0; i--) {
+			struct exec_tick *tick = exec_ticks.array + (i - 1);
+			tick->cb(tick->param, seconds);
+		}
+		pthread_mutex_unlock(&exec_mutex);
+
+		profile_end(exec_thread_name);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static void exec_graphics_tick(void *unused, float seconds)
+{
+	bool post;
+
+	UNUSED_PARAMETER(unused);
+
+	pthread_mutex_lock(&exec_state_mutex);
+	exec_pending_seconds += seconds;
+	post = !exec_pending;
+	exec_pending = true;
+
+	if (exec_current && !exec_hang_reported && os_gettime_ns() - exec_current_start > EXEC_HANG_NS) {
+		blog(LOG_WARNING, "[Scripting] '%s' has been running for over %llu ms, script ticks are stalled",
+		     exec_current, EXEC_HANG_NS / 1000000ULL);
+		exec_hang_reported = true;
+	}
+	pthread_mutex_unlock(&exec_state_mutex);
+
+	if (post)
+		os_sem_post(exec_semaphore);
+}
+
+/* -------------------------------------------- */
+
+void script_exec_add_tick(script_tick_cb cb, void *param)
+{
+	struct exec_tick tick = {cb, param};
+
+	pthread_mutex_lock(&exec_mutex);
+	da_insert(exec_ticks, 0, &tick);
+	pthread_mutex_unlock(&exec_mutex);
+}
+
+void script_exec_remove_tick(script_tick_cb cb, void *param)
+{
+	struct exec_tick tick = {cb, param};
+
+	/* waits for the tick to finish if it is currently running */
+	pthread_mutex_lock(&exec_mutex);
+	da_erase_item(exec_ticks, &tick);
+	pthread_mutex_unlock(&exec_mutex);
+}
+
+bool script_exec_begin(obs_script_t *script, float *seconds)
+{
+	uint64_t now = os_gettime_ns();
+
+	if (seconds)
+		script->pending_seconds += *seconds;
+	if (now < script->throttle_until)
+		return false;
+
+	if (seconds) {
+		*seconds = script->pending_seconds;
+		script->pending_seconds = 0.0f;
+	}
+
+	if (!script->profile_name)
+		script->profile_name =
+			profile_store_name(obs_get_profiler_name_store(), "script: %s", script->file.array);
+
+	profile_start(script->profile_name);
+	script->exec_start = now;
+
+	pthread_mutex_lock(&exec_state_mutex);
+	exec_current = script->profile_name;
+	exec_current_start = now;
+	exec_hang_reported = false;
+	pthread_mutex_unlock(&exec_state_mutex);
+	return true;
+}
+
+void script_exec_end(obs_script_t *script)
+{
+	uint64_t now = os_gettime_ns();
+	uint64_t elapsed = now - script->exec_start;
+	uint64_t throttle;
+
+	profile_end(script->profile_name);
+
+	pthread_mutex_lock(&exec_state_mutex);
+	exec_current = NULL;
+	pthread_mutex_unlock(&exec_state_mutex);
+
+	if (elapsed <= EXEC_BUDGET_NS) {
+		script->overruns = 0;
+		if (script->throttle_level)
+			script->throttle_level--;
+		return;
+	}
+
+	if (++script->overruns < EXEC_MAX_OVERRUNS)
+		return;
+
+	throttle = EXEC_THROTTLE_NS << script->throttle_level;
+	script->throttle_until = now + throttle;
+	script->overruns = 0;
+	if (script->throttle_level < EXEC_MAX_THROTTLE_LEVEL)
+		script->throttle_level++;
+
+	script_warn(script, "took %.1f ms, over the %llu ms budget %d times in a row; throttling for %llu ms",
+		    (double)elapsed / 1000000.0, EXEC_BUDGET_NS / 1000000ULL, EXEC_MAX_OVERRUNS,
+		    throttle / 1000000ULL);
+}
+
+/* -------------------------------------------- */
+
+bool script_exec_init(void)
+{
+	da_init(exec_ticks);
+
+	if (pthread_mutex_init_recursive(&exec_mutex) != 0)
+		return false;
+	if (pthread_mutex_init(&exec_state_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&exec_mutex);
+		return false;
+	}
+	if (os_sem_init(&exec_semaphore, 0) != 0) {
+		pthread_mutex_destroy(&exec_state_mutex);
+		pthread_mutex_destroy(&exec_mutex);
+		return false;
+	}
+
+	exec_exit = false;
+	if (pthread_create(&exec_thread, NULL, exec_thread_loop, NULL) != 0) {
+		os_sem_destroy(exec_semaphore);
+		pthread_mutex_destroy(&exec_state_mutex);
+		pthread_mutex_destroy(&exec_mutex);
+		return false;
+	}
+
+	obs_add_tick_callback(exec_graphics_tick, NULL);
+	return true;
+}
+
+void script_exec_free(void)
+{
+	obs_remove_tick_callback(exec_graphics_tick, NULL);
+
+	pthread_mutex_lock(&exec_state_mutex);
+	exec_exit = true;
+	pthread_mutex_unlock(&exec_state_mutex);
+
+	os_sem_post(exec_semaphore);
+	pthread_join(exec_thread, NULL);
+
+	da_free(exec_ticks);
+	os_sem_destroy(exec_semaphore);
+	pthread_mutex_destroy(&exec_state_mutex);
+	pthread_mutex_destroy(&exec_mutex);
+}
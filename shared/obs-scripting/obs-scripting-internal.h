@@ -30,6 +30,14 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	/* execution accounting, only touched from the exec thread */
+	const char *profile_name;
+	uint64_t exec_start;
+	uint64_t throttle_until;
+	float pending_seconds;
+	int overruns;
+	int throttle_level;
 };
 
 struct script_callback;
@@ -37,6 +45,21 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+/* Ticks and timers of the script runtimes run on the scripting exec thread.
+ * Every call into a script from there is wrapped in script_exec_begin/end,
+ * which does the per-script profiling and throttles scripts that keep
+ * running over budget. script_exec_begin returns false while the script is
+ * throttled, in which case any seconds passed are saved up for the next
+ * call that goes through. */
+typedef void (*script_tick_cb)(void *param, float seconds);
+
+extern bool script_exec_init(void);
+extern void script_exec_free(void);
+extern void script_exec_add_tick(script_tick_cb cb, void *param);
+extern void script_exec_remove_tick(script_tick_cb cb, void *param);
+extern bool script_exec_begin(obs_script_t *script, float *seconds);
+extern void script_exec_end(obs_script_t *script);
+
 extern void script_log(obs_script_t *script, int level, const char *format, ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format, va_list args);
 
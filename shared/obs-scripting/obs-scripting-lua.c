@@ -286,16 +286,23 @@ static int timer_remove(lua_State *script)
 	return 0;
 }
 
-static void timer_call(struct script_callback *p_cb)
+/* returns false if the script is throttled and the call has to wait */
+static bool timer_call(struct script_callback *p_cb)
 {
 	struct lua_obs_callback *cb = (struct lua_obs_callback *)p_cb;
+	bool called = false;
 
 	if (script_callback_removed(p_cb))
-		return;
+		return true;
 
 	lock_callback();
-	call_func_(cb->script, cb->reg_idx, 0, 0, "timer_cb", __FUNCTION__);
+	if (script_exec_begin(p_cb->script, NULL)) {
+		call_func_(cb->script, cb->reg_idx, 0, 0, "timer_cb", __FUNCTION__);
+		script_exec_end(p_cb->script);
+		called = true;
+	}
 	unlock_callback();
+	return called;
 }
 
 static void defer_timer_init(void *p_cb)
@@ -372,20 +379,43 @@ static int obs_lua_add_main_render_callback(lua_State *script)
 
 /* -------------------------------------------- */
 
+/* runs on the scripting exec thread */
 static void obs_lua_tick_callback(void *priv, float seconds)
 {
 	struct lua_obs_callback *cb = priv;
 	lua_State *script = cb->script;
 
 	if (script_callback_removed(&cb->base)) {
-		obs_remove_tick_callback(obs_lua_tick_callback, cb);
+		script_exec_remove_tick(obs_lua_tick_callback, cb);
+		return;
+	}
+
+	lock_callback();
+
+	if (script_exec_begin(cb->base.script, NULL)) {
+		lua_pushnumber(script, (lua_Number)seconds);
+		call_func(obs_lua_tick_callback, 1, 0);
+		script_exec_end(cb->base.script);
+	}
+
+	unlock_callback();
+}
+
+/* runs on the graphics thread, for scripts that need to render */
+static void obs_lua_graphics_tick_callback(void *priv, float seconds)
+{
+	struct lua_obs_callback *cb = priv;
+	lua_State *script = cb->script;
+
+	if (script_callback_removed(&cb->base)) {
+		obs_remove_tick_callback(obs_lua_graphics_tick_callback, cb);
 		return;
 	}
 
 	lock_callback();
 
 	lua_pushnumber(script, (lua_Number)seconds);
-	call_func(obs_lua_tick_callback, 1, 0);
+	call_func(obs_lua_graphics_tick_callback, 1, 0);
 
 	unlock_callback();
 }
@@ -403,7 +433,7 @@ static int obs_lua_remove_tick_callback(lua_State *script)
 
 static void defer_add_tick(void *cb)
 {
-	obs_add_tick_callback(obs_lua_tick_callback, cb);
+	script_exec_add_tick(obs_lua_tick_callback, cb);
 }
 
 static int obs_lua_add_tick_callback(lua_State *script)
@@ -416,6 +446,21 @@ static int obs_lua_add_tick_callback(lua_State *script)
 	return 0;
 }
 
+static void defer_add_graphics_tick(void *cb)
+{
+	obs_add_tick_callback(obs_lua_graphics_tick_callback, cb);
+}
+
+static int obs_lua_add_graphics_tick_callback(lua_State *script)
+{
+	if (!verify_args1(script, is_function))
+		return 0;
+
+	struct lua_obs_callback *cb = add_lua_obs_callback(script, 1);
+	defer_call_post(defer_add_graphics_tick, cb);
+	return 0;
+}
+
 /* -------------------------------------------- */
 
 static void calldata_signal_callback(void *priv, calldata_t *cd)
@@ -1020,6 +1065,8 @@ static void add_hook_functions(lua_State *script)
 	add_func("obs_remove_main_render_callback", obs_lua_remove_main_render_callback);
 	add_func("obs_add_tick_callback", obs_lua_add_tick_callback);
 	add_func("obs_remove_tick_callback", obs_lua_remove_tick_callback);
+	add_func("obs_add_graphics_tick_callback", obs_lua_add_graphics_tick_callback);
+	add_func("obs_remove_graphics_tick_callback", obs_lua_remove_tick_callback);
 	add_func("signal_handler_connect", obs_lua_signal_handler_connect);
 	add_func("signal_handler_disconnect", obs_lua_signal_handler_disconnect);
 	add_func("signal_handler_connect_global", obs_lua_signal_handler_connect_global);
@@ -1049,12 +1096,16 @@ static void lua_tick(void *param, float seconds)
 	data = first_tick_script;
 	while (data) {
 		lua_State *script = data->script;
+		float tick_seconds = seconds;
 		current_lua_script = data;
 
 		pthread_mutex_lock(&data->mutex);
 
-		lua_pushnumber(script, (double)seconds);
-		call_func_(script, data->tick, 1, 0, "tick", __FUNCTION__);
+		if (script_exec_begin(&data->base, &tick_seconds)) {
+			lua_pushnumber(script, (double)tick_seconds);
+			call_func_(script, data->tick, 1, 0, "tick", __FUNCTION__);
+			script_exec_end(&data->base);
+		}
 
 		pthread_mutex_unlock(&data->mutex);
 
@@ -1077,10 +1128,10 @@ static void lua_tick(void *param, float seconds)
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
-			if (elapsed >= timer->interval) {
-				timer_call(&cb->base);
-				timer->last_ts += timer->interval;
-			}
+			/* intervals missed while the exec thread was
+			 * busy are coalesced into a single call */
+			if (elapsed >= timer->interval && timer_call(&cb->base))
+				timer->last_ts += elapsed - elapsed % timer->interval;
 		}
 
 		timer = next;
@@ -1364,12 +1415,12 @@ void obs_lua_load(void)
 	dstr_free(&package_cpath);
 	startup_script = tmp.array;
 
-	obs_add_tick_callback(lua_tick, NULL);
+	script_exec_add_tick(lua_tick, NULL);
 }
 
 void obs_lua_unload(void)
 {
-	obs_remove_tick_callback(lua_tick, NULL);
+	script_exec_remove_tick(lua_tick, NULL);
 
 	bfree(startup_script);
 	pthread_mutex_destroy(&tick_mutex);
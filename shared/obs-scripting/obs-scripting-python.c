@@ -416,18 +416,25 @@ static PyObject *timer_remove(PyObject *self, PyObject *args)
 	return python_none();
 }
 
-static void timer_call(struct script_callback *p_cb)
+/* returns false if the script is throttled and the call has to wait */
+static bool timer_call(struct script_callback *p_cb)
 {
 	struct python_obs_callback *cb = (struct python_obs_callback *)p_cb;
+	bool called = false;
 
 	if (script_callback_removed(p_cb))
-		return;
+		return true;
 
 	lock_callback(cb);
-	PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
-	py_error();
-	Py_XDECREF(py_ret);
+	if (script_exec_begin(p_cb->script, NULL)) {
+		PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
+		py_error();
+		Py_XDECREF(py_ret);
+		script_exec_end(p_cb->script);
+		called = true;
+	}
 	unlock_callback();
+	return called;
 }
 
 static void defer_timer_init(void *p_cb)
@@ -460,23 +467,45 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
+static inline void call_tick_func(struct python_obs_callback *cb, float seconds)
+{
+	PyObject *args = Py_BuildValue("(f)", seconds);
+	PyObject *py_ret = PyObject_CallObject(cb->func, args);
+	py_error();
+	Py_XDECREF(py_ret);
+	Py_XDECREF(args);
+}
+
+/* runs on the scripting exec thread */
 static void obs_python_tick_callback(void *priv, float seconds)
 {
 	struct python_obs_callback *cb = priv;
 
 	if (script_callback_removed(&cb->base)) {
-		obs_remove_tick_callback(obs_python_tick_callback, cb);
+		script_exec_remove_tick(obs_python_tick_callback, cb);
 		return;
 	}
 
 	lock_callback(cb);
+	if (script_exec_begin(cb->base.script, NULL)) {
+		call_tick_func(cb, seconds);
+		script_exec_end(cb->base.script);
+	}
+	unlock_callback();
+}
 
-	PyObject *args = Py_BuildValue("(f)", seconds);
-	PyObject *py_ret = PyObject_CallObject(cb->func, args);
-	py_error();
-	Py_XDECREF(py_ret);
-	Py_XDECREF(args);
+/* runs on the graphics thread, for scripts that need to render */
+static void obs_python_graphics_tick_callback(void *priv, float seconds)
+{
+	struct python_obs_callback *cb = priv;
 
+	if (script_callback_removed(&cb->base)) {
+		obs_remove_tick_callback(obs_python_graphics_tick_callback, cb);
+		return;
+	}
+
+	lock_callback(cb);
+	call_tick_func(cb, seconds);
 	unlock_callback();
 }
 
@@ -521,7 +550,29 @@ static PyObject *obs_python_add_tick_callback(PyObject *self, PyObject *args)
 		return python_none();
 
 	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
-	obs_add_tick_callback(obs_python_tick_callback, cb);
+	script_exec_add_tick(obs_python_tick_callback, cb);
+	return python_none();
+}
+
+static PyObject *obs_python_add_graphics_tick_callback(PyObject *self, PyObject *args)
+{
+	struct obs_python_script *script = cur_python_script;
+	PyObject *py_cb = NULL;
+
+	if (!script) {
+		PyErr_SetString(PyExc_RuntimeError, "No active script, report this to Lain");
+		return NULL;
+	}
+
+	UNUSED_PARAMETER(self);
+
+	if (!parse_args(args, "O", &py_cb))
+		return python_none();
+	if (!py_cb || !PyFunction_Check(py_cb))
+		return python_none();
+
+	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
+	obs_add_tick_callback(obs_python_graphics_tick_callback, cb);
 	return python_none();
 }
 
@@ -1211,6 +1262,8 @@ static void add_hook_functions(PyObject *module)
 		DEF_FUNC("obs_sceneitem_group_enum_items", sceneitem_group_enum_items),
 		DEF_FUNC("obs_remove_tick_callback", obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback", obs_python_add_tick_callback),
+		DEF_FUNC("obs_remove_graphics_tick_callback", obs_python_remove_tick_callback),
+		DEF_FUNC("obs_add_graphics_tick_callback", obs_python_add_graphics_tick_callback),
 		DEF_FUNC("signal_handler_disconnect", obs_python_signal_handler_disconnect),
 		DEF_FUNC("signal_handler_connect", obs_python_signal_handler_connect),
 		DEF_FUNC("signal_handler_disconnect_global", obs_python_signal_handler_disconnect_global),
@@ -1496,8 +1549,6 @@ static void python_tick(void *param, float seconds)
 	if (valid) {
 		lock_python();
 
-		PyObject *args = Py_BuildValue("(f)", seconds);
-
 		pthread_mutex_lock(&tick_mutex);
 		data = first_tick_script;
 
@@ -1505,11 +1556,19 @@ static void python_tick(void *param, float seconds)
 			busy_script = cur_python_script;
 
 		while (data) {
-			cur_python_script = data;
+			float tick_seconds = seconds;
 
-			PyObject *py_ret = PyObject_CallObject(data->tick, args);
-			Py_XDECREF(py_ret);
-			py_error();
+			if (script_exec_begin(&data->base, &tick_seconds)) {
+				cur_python_script = data;
+
+				PyObject *args = Py_BuildValue("(f)", tick_seconds);
+				PyObject *py_ret = PyObject_CallObject(data->tick, args);
+				Py_XDECREF(py_ret);
+				Py_XDECREF(args);
+				py_error();
+
+				script_exec_end(&data->base);
+			}
 
 			data = data->next_tick;
 		}
@@ -1522,8 +1581,6 @@ static void python_tick(void *param, float seconds)
 
 		pthread_mutex_unlock(&tick_mutex);
 
-		Py_XDECREF(args);
-
 		unlock_python();
 	}
 
@@ -1541,13 +1598,10 @@ static void python_tick(void *param, float seconds)
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
-			if (elapsed >= timer->interval) {
-				lock_python();
-				timer_call(&cb->base);
-				unlock_python();
-
-				timer->last_ts += timer->interval;
-			}
+			/* intervals missed while the exec thread was
+			 * busy are coalesced into a single call */
+			if (elapsed >= timer->interval && timer_call(&cb->base))
+				timer->last_ts += elapsed - elapsed % timer->interval;
 		}
 
 		timer = next;
@@ -1732,13 +1786,18 @@ out:
 	python_loaded_at_all = success;
 
 	if (python_loaded)
-		obs_add_tick_callback(python_tick, NULL);
+		script_exec_add_tick(python_tick, NULL);
 
 	return python_loaded;
 }
 
 void obs_python_unload(void)
 {
+	/* must happen before taking the GIL, a running tick may be waiting
+	 * for it */
+	if (python_loaded_at_all)
+		script_exec_remove_tick(python_tick, NULL);
+
 	if (mutexes_loaded) {
 		pthread_mutex_destroy(&tick_mutex);
 		pthread_mutex_destroy(&timer_mutex);
@@ -1756,8 +1815,6 @@ void obs_python_unload(void)
 
 	/* ---------------------- */
 
-	obs_remove_tick_callback(python_tick, NULL);
-
 	for (size_t i = 0; i < python_paths.num; i++)
 		bfree(python_paths.array[i]);
 	da_free(python_paths);
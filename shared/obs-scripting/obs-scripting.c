@@ -141,6 +141,16 @@ bool obs_scripting_load(void)
 		return false;
 	}
 
+	if (!script_exec_init()) {
+		defer_call_exit = true;
+		os_sem_post(defer_call_semaphore);
+		pthread_join(defer_call_thread, NULL);
+		os_sem_destroy(defer_call_semaphore);
+		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&detach_mutex);
+		return false;
+	}
+
 #if defined(LUAJIT_FOUND)
 	obs_lua_load();
 #endif
@@ -171,6 +181,8 @@ void obs_scripting_unload(void)
 	obs_python_unload();
 #endif
 
+	script_exec_free();
+
 	dstr_free(&file_filter);
 
 	/* ---------------------- */
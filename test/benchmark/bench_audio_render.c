@@ -0,0 +1,157 @@
+/*
+ * Audio source rendering benchmark.
+ *
+ * Loads the test-input module and puts a number of "test_sinewave" sources
+ * into scenes set as output channels, then measures the time the audio
+ * thread spends rendering sources (the "render_audio_sources" profiler
+ * entry) with parallel rendering of leaf sources enabled and disabled.
+ *
+ * usage: bench_audio_render <test-input module> [sources] [seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+
+#define SOURCES_PER_SCENE 8
+#define MAX_SCENES 16
+
+static const char *entry_name = "render_audio_sources";
+
+struct entry_total {
+	uint64_t time_us;
+	uint64_t count;
+};
+
+static bool sum_entry(void *context, profiler_snapshot_entry_t *entry)
+{
+	struct entry_total *total = context;
+
+	if (strcmp(profiler_snapshot_entry_name(entry), entry_name) == 0) {
+		profiler_time_entries_t *times = profiler_snapshot_entry_times(entry);
+
+		for (size_t i = 0; i < times->num; i++) {
+			total->time_us += times->array[i].time_delta * times->array[i].count;
+			total->count += times->array[i].count;
+		}
+	}
+
+	profiler_snapshot_enumerate_children(entry, sum_entry, context);
+	return true;
+}
+
+static struct entry_total get_total(void)
+{
+	struct entry_total total = {0};
+	profiler_snapshot_t *snap = profile_snapshot_create();
+
+	profiler_snapshot_enumerate_roots(snap, sum_entry, &total);
+	profile_snapshot_free(snap);
+	return total;
+}
+
+static double run(bool parallel, unsigned int seconds)
+{
+	obs_set_parallel_audio_rendering(parallel);
+
+	/* let the setting settle in before measuring */
+	os_sleep_ms(500);
+	struct entry_total start = get_total();
+	os_sleep_ms(seconds * 1000);
+	struct entry_total end = get_total();
+
+	uint64_t count = end.count - start.count;
+	return count ? (double)(end.time_us - start.time_us) / (double)count : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+	obs_module_t *module = NULL;
+	obs_scene_t *scenes[MAX_SCENES] = {0};
+	DARRAY(obs_source_t *) sources;
+	int ret = EXIT_FAILURE;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <test-input module> [sources] [seconds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	size_t num_sources = argc > 2 ? strtoul(argv[2], NULL, 10) : 48;
+	unsigned int seconds = argc > 3 ? (unsigned int)strtoul(argv[3], NULL, 10) : 10;
+	size_t num_scenes = (num_sources + SOURCES_PER_SCENE - 1) / SOURCES_PER_SCENE;
+
+	if (!num_sources || num_scenes > MAX_SCENES) {
+		num_sources = 48;
+		num_scenes = 48 / SOURCES_PER_SCENE;
+	}
+
+	da_init(sources);
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "obs_startup failed\n");
+		goto out;
+	}
+
+	struct obs_audio_info ai = {.samples_per_sec = 48000, .speakers = SPEAKERS_STEREO};
+	if (!obs_reset_audio(&ai)) {
+		fprintf(stderr, "obs_reset_audio failed\n");
+		goto out;
+	}
+
+	if (obs_open_module(&module, argv[1], NULL) != MODULE_SUCCESS || !obs_init_module(module)) {
+		fprintf(stderr, "could not load test-input from '%s'\n", argv[1]);
+		goto out;
+	}
+
+	for (size_t i = 0; i < num_scenes; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "scene %zu", i);
+		scenes[i] = obs_scene_create(name);
+		obs_set_output_source((uint32_t)i, obs_scene_get_source(scenes[i]));
+	}
+
+	for (size_t i = 0; i < num_sources; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "sinewave %zu", i);
+
+		obs_source_t *source = obs_source_create("test_sinewave", name, NULL, NULL);
+		if (!source) {
+			fprintf(stderr, "could not create test_sinewave source\n");
+			goto out;
+		}
+
+		obs_scene_add(scenes[i / SOURCES_PER_SCENE], source);
+		da_push_back(sources, &source);
+	}
+
+	double serial_us = run(false, seconds);
+	double parallel_us = run(true, seconds);
+
+	printf("%zu sources in %zu scenes, %u seconds per run\n", num_sources, num_scenes, seconds);
+	printf("serial   %8.2f us per audio tick\n", serial_us);
+	printf("parallel %8.2f us per audio tick  (%.2fx)\n", parallel_us,
+	       parallel_us > 0.0 ? serial_us / parallel_us : 0.0);
+	ret = EXIT_SUCCESS;
+
+out:
+	if (obs_initialized()) {
+		for (size_t i = 0; i < MAX_CHANNELS; i++)
+			obs_set_output_source((uint32_t)i, NULL);
+		for (size_t i = 0; i < num_scenes && i < MAX_SCENES; i++)
+			obs_scene_release(scenes[i]);
+		for (size_t i = 0; i < sources.num; i++)
+			obs_source_release(sources.array[i]);
+		obs_shutdown();
+	}
+	da_free(sources);
+
+	profiler_stop();
+	profiler_free();
+	return ret;
+}
@@ -0,0 +1,154 @@
+/*
+ * Dynamics filter core benchmark.
+ *
+ * Runs the per-sample gain stage of the compressor/limiter and the dB
+ * conversions of the expander both the old scalar way (log10f/powf for
+ * every sample) and through the shared dynamics core, and reports the time
+ * per audio packet along with the largest deviation from the scalar output.
+ *
+ * usage: bench_dynamics [channels] [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-math.h>
+
+#include "dynamics.h"
+
+#define FRAMES 1024
+#define MAX_CHANNELS 8
+
+static float *channels_data[MAX_CHANNELS];
+static float *scalar_data[MAX_CHANNELS];
+static float env_buf[FRAMES];
+static float gain_buf[FRAMES];
+
+static void fill(size_t channels, size_t packet)
+{
+	for (size_t c = 0; c < channels; c++) {
+		for (size_t i = 0; i < FRAMES; i++) {
+			const size_t n = packet * FRAMES + i;
+			const float level = db_to_mul(-80.0f + (float)(n % 48000) * (80.0f / 48000.0f));
+			channels_data[c][i] = scalar_data[c][i] =
+				level * sinf(0.0287f * (float)n * (float)(c + 1));
+		}
+	}
+}
+
+static void scalar_compress(size_t channels, float threshold, float slope, float output_gain)
+{
+	for (size_t i = 0; i < FRAMES; i++) {
+		const float env_db = mul_to_db(env_buf[i]);
+		float gain = slope * (threshold - env_db);
+		gain = db_to_mul(fminf(0, gain));
+
+		for (size_t c = 0; c < channels; c++)
+			scalar_data[c][i] *= gain * output_gain;
+	}
+}
+
+static void core_compress(size_t channels, const struct dyn_gain_table *gt)
+{
+	dyn_gain_table_apply(gt, gain_buf, env_buf, FRAMES);
+	dyn_apply_gain(channels_data, channels, gain_buf, FRAMES);
+}
+
+static void scalar_convert(void)
+{
+	for (size_t i = 0; i < FRAMES; i++)
+		gain_buf[i] = db_to_mul(fminf(0.0f, mul_to_db(env_buf[i]) + 20.0f));
+}
+
+static void core_convert(void)
+{
+	dyn_mul_to_db_buf(gain_buf, env_buf, FRAMES);
+	for (size_t i = 0; i < FRAMES; i++)
+		gain_buf[i] = fminf(0.0f, gain_buf[i] + 20.0f);
+	dyn_db_to_mul_buf(gain_buf, gain_buf, FRAMES);
+}
+
+static void envelope(size_t channels)
+{
+	memset(env_buf, 0, sizeof(env_buf));
+	dyn_envelope_follow(env_buf, scalar_data, channels, FRAMES, 0.0f, 0.99653f, 0.99965f);
+}
+
+static double max_error_db(size_t channels)
+{
+	double max_err = 0.0;
+
+	for (size_t c = 0; c < channels; c++) {
+		for (size_t i = 0; i < FRAMES; i++) {
+			if (fabsf(scalar_data[c][i]) < 1e-6f)
+				continue;
+			double err = fabs(20.0 * log10((double)channels_data[c][i] / (double)scalar_data[c][i]));
+			if (err > max_err)
+				max_err = err;
+		}
+	}
+
+	return max_err;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t channels = argc > 1 ? strtoul(argv[1], NULL, 10) : 2;
+	size_t packets = argc > 2 ? strtoul(argv[2], NULL, 10) : 20000;
+
+	if (!channels || channels > MAX_CHANNELS)
+		channels = 2;
+
+	for (size_t c = 0; c < channels; c++) {
+		channels_data[c] = bmalloc(FRAMES * sizeof(float));
+		scalar_data[c] = bmalloc(FRAMES * sizeof(float));
+	}
+
+	struct dyn_gain_table *gt = bmalloc(sizeof(*gt));
+	dyn_gain_table_init(gt, -18.0f, 0.9f, db_to_mul(3.0f));
+
+	uint64_t scalar_ns = 0, core_ns = 0, scalar_conv_ns = 0, core_conv_ns = 0;
+	double max_err = 0.0;
+
+	for (size_t p = 0; p < packets; p++) {
+		fill(channels, p);
+		envelope(channels);
+
+		uint64_t t0 = os_gettime_ns();
+		scalar_compress(channels, -18.0f, 0.9f, db_to_mul(3.0f));
+		uint64_t t1 = os_gettime_ns();
+		core_compress(channels, gt);
+		uint64_t t2 = os_gettime_ns();
+		scalar_convert();
+		uint64_t t3 = os_gettime_ns();
+		core_convert();
+		uint64_t t4 = os_gettime_ns();
+
+		scalar_ns += t1 - t0;
+		core_ns += t2 - t1;
+		scalar_conv_ns += t3 - t2;
+		core_conv_ns += t4 - t3;
+
+		double err = max_error_db(channels);
+		if (err > max_err)
+			max_err = err;
+	}
+
+	printf("%zu channels, %zu packets of %d frames\n", channels, packets, FRAMES);
+	printf("compressor gain  scalar %8.2f us/packet  core %8.2f us/packet  (%.1fx, max error %.5f dB)\n",
+	       (double)scalar_ns / packets / 1000.0, (double)core_ns / packets / 1000.0,
+	       (double)scalar_ns / (double)core_ns, max_err);
+	printf("dB round trip    scalar %8.2f us/packet  core %8.2f us/packet  (%.1fx)\n",
+	       (double)scalar_conv_ns / packets / 1000.0, (double)core_conv_ns / packets / 1000.0,
+	       (double)scalar_conv_ns / (double)core_conv_ns);
+
+	for (size_t c = 0; c < channels; c++) {
+		bfree(channels_data[c]);
+		bfree(scalar_data[c]);
+	}
+	bfree(gt);
+	return 0;
+}
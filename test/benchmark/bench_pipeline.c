@@ -0,0 +1,605 @@
+/*
+ * Sustained load pipeline benchmark.
+ *
+ * Loads test-input, obs-x264, obs-ffmpeg and obs-outputs, puts a number of
+ * "random" video sources and "test_sinewave" audio sources into a scene and
+ * runs a number of x264 + AAC encoder pairs into null outputs for a fixed
+ * amount of time.  The whole pipeline runs: source ticks, rendering, video-io,
+ * encoders, interleaving and the outputs.
+ *
+ * After a warmup period it reports as JSON on stdout:
+ *
+ *  - latency percentiles of the pipeline stages, from the profiler
+ *  - rendered, lagged, skipped and dropped frames, draw calls of the last frame
+ *  - audio buffering
+ *  - frame pacing jitter of the graphics thread
+ *  - CPU usage of the process and (on Linux) of each thread
+ *
+ * Canvas size, frame rate, encoder settings and the random seed are fixed so
+ * that runs on the same machine can be compared, e.g. to gate regressions.
+ * Still needs a graphics context, so on Linux run it under Xvfb on headless
+ * machines.
+ *
+ * usage: bench_pipeline <plugin bin path> <plugin data path> [sources] [encoders] [seconds]
+ *
+ * The paths are passed to obs_add_module_path, so they may contain %module%.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+#define MAX_ENCODERS 16
+#define WARMUP_SECONDS 3
+
+#define CANVAS_WIDTH 1280
+#define CANVAS_HEIGHT 720
+#define FPS 30
+#define VIDEO_BITRATE 2500
+#define AUDIO_BITRATE 160
+
+static const char *modules[] = {"test-input", "obs-x264", "obs-ffmpeg", "obs-outputs"};
+
+/* profiler entries reported as pipeline stages, "encode(<name>)" entries of
+ * all encoders are combined into "encode" */
+static const char *stages[] = {
+	"tick_sources",  "render_video", "output_video_data", "output_frame", "render_audio_sources",
+	"receive_video", "receive_audio", "do_encode",        "encode",       "send_packet",
+};
+
+#define NUM_STAGES (sizeof(stages) / sizeof(stages[0]))
+
+/* signed counts so that the warmup snapshot can be subtracted */
+struct hist_entry {
+	uint64_t time_us;
+	int64_t count;
+};
+
+typedef DARRAY(struct hist_entry) hist_t;
+
+struct collect_context {
+	hist_t *hists;
+	int64_t sign;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static size_t find_stage(const char *name)
+{
+	if (strncmp(name, "encode(", 7) == 0)
+		name = "encode";
+
+	for (size_t i = 0; i < NUM_STAGES; i++) {
+		if (strcmp(name, stages[i]) == 0)
+			return i;
+	}
+
+	return NUM_STAGES;
+}
+
+static bool collect_entry(void *param, profiler_snapshot_entry_t *entry)
+{
+	struct collect_context *ctx = param;
+	size_t stage = find_stage(profiler_snapshot_entry_name(entry));
+
+	if (stage < NUM_STAGES) {
+		profiler_time_entries_t *times = profiler_snapshot_entry_times(entry);
+
+		for (size_t i = 0; i < times->num; i++) {
+			struct hist_entry he = {times->array[i].time_delta, (int64_t)times->array[i].count * ctx->sign};
+			da_push_back(ctx->hists[stage], &he);
+		}
+	}
+
+	profiler_snapshot_enumerate_children(entry, collect_entry, param);
+	return true;
+}
+
+static void collect_stages(hist_t *hists, int64_t sign)
+{
+	struct collect_context ctx = {hists, sign};
+	profiler_snapshot_t *snap = profile_snapshot_create();
+
+	profiler_snapshot_enumerate_roots(snap, collect_entry, &ctx);
+	profile_snapshot_free(snap);
+}
+
+static int cmp_hist_entry(const void *a, const void *b)
+{
+	const struct hist_entry *ha = a;
+	const struct hist_entry *hb = b;
+	return ha->time_us < hb->time_us ? -1 : (ha->time_us > hb->time_us ? 1 : 0);
+}
+
+/* sorts the histogram and merges entries of the same time, dropping the ones
+ * that only happened during warmup */
+static int64_t finish_hist(hist_t *hist)
+{
+	size_t out = 0;
+	int64_t total = 0;
+
+	qsort(hist->array, hist->num, sizeof(struct hist_entry), cmp_hist_entry);
+
+	for (size_t i = 0; i < hist->num;) {
+		struct hist_entry merged = hist->array[i];
+
+		while (++i < hist->num && hist->array[i].time_us == merged.time_us)
+			merged.count += hist->array[i].count;
+
+		if (merged.count > 0) {
+			hist->array[out++] = merged;
+			total += merged.count;
+		}
+	}
+
+	hist->num = out;
+	return total;
+}
+
+static uint64_t percentile(const hist_t *hist, int64_t total, double p)
+{
+	int64_t target = (int64_t)((double)total * p + 0.5);
+	int64_t count = 0;
+
+	if (target < 1)
+		target = 1;
+
+	for (size_t i = 0; i < hist->num; i++) {
+		count += hist->array[i].count;
+		if (count >= target)
+			return hist->array[i].time_us;
+	}
+
+	return hist->num ? hist->array[hist->num - 1].time_us : 0;
+}
+
+static obs_data_array_t *get_stage_stats(hist_t *hists)
+{
+	obs_data_array_t *array = obs_data_array_create();
+
+	for (size_t i = 0; i < NUM_STAGES; i++) {
+		hist_t *hist = &hists[i];
+		int64_t total = finish_hist(hist);
+		uint64_t sum = 0;
+
+		if (total <= 0)
+			continue;
+
+		for (size_t j = 0; j < hist->num; j++)
+			sum += hist->array[j].time_us * (uint64_t)hist->array[j].count;
+
+		obs_data_t *stage = obs_data_create();
+		obs_data_set_string(stage, "name", stages[i]);
+		obs_data_set_int(stage, "count", total);
+		obs_data_set_double(stage, "mean_us", (double)sum / (double)total);
+		obs_data_set_int(stage, "p50_us", (long long)percentile(hist, total, 0.50));
+		obs_data_set_int(stage, "p90_us", (long long)percentile(hist, total, 0.90));
+		obs_data_set_int(stage, "p99_us", (long long)percentile(hist, total, 0.99));
+		obs_data_set_int(stage, "max_us", (long long)hist->array[hist->num - 1].time_us);
+		obs_data_array_push_back(array, stage);
+		obs_data_release(stage);
+	}
+
+	return array;
+}
+
+static obs_data_t *get_pacing_stats(const struct obs_video_pacing_stats *start,
+				    const struct obs_video_pacing_stats *end)
+{
+	obs_data_t *pacing = obs_data_create();
+	obs_data_array_t *buckets = obs_data_array_create();
+
+	obs_data_set_int(pacing, "frames", (long long)(end->frames - start->frames));
+	obs_data_set_int(pacing, "overruns", (long long)(end->overruns - start->overruns));
+	obs_data_set_int(pacing, "absorbed", (long long)(end->absorbed - start->absorbed));
+	obs_data_set_int(pacing, "duplicated", (long long)(end->duplicated - start->duplicated));
+
+	/* jitter_buckets[i] counts wakeups less than 2^i us late */
+	for (size_t i = 0; i < OBS_VIDEO_PACING_BUCKETS; i++) {
+		obs_data_t *bucket = obs_data_create();
+		if (i < OBS_VIDEO_PACING_BUCKETS - 1)
+			obs_data_set_int(bucket, "below_us", 1LL << i);
+		obs_data_set_int(bucket, "count", (long long)(end->jitter_buckets[i] - start->jitter_buckets[i]));
+		obs_data_array_push_back(buckets, bucket);
+		obs_data_release(bucket);
+	}
+
+	obs_data_set_array(pacing, "jitter", buckets);
+	obs_data_array_release(buckets);
+	return pacing;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef __linux__
+struct thread_time {
+	long tid;
+	char name[32];
+	uint64_t ticks;
+};
+
+typedef DARRAY(struct thread_time) thread_times_t;
+
+static bool read_thread_time(long tid, struct thread_time *tt)
+{
+	char path[64];
+	char buf[512];
+	FILE *f;
+
+	tt->tid = tid;
+	tt->ticks = 0;
+	strcpy(tt->name, "unknown");
+
+	snprintf(path, sizeof(path), "/proc/self/task/%ld/comm", tid);
+	f = fopen(path, "r");
+	if (f) {
+		if (fgets(tt->name, sizeof(tt->name), f))
+			tt->name[strcspn(tt->name, "\n")] = 0;
+		fclose(f);
+	}
+
+	snprintf(path, sizeof(path), "/proc/self/task/%ld/stat", tid);
+	f = fopen(path, "r");
+	if (!f)
+		return false;
+
+	size_t size = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[size] = 0;
+
+	/* the name in parentheses may contain spaces, fields after it are
+	 * state, ppid, ..., utime (14) and stime (15) */
+	char *pos = strrchr(buf, ')');
+	unsigned long long utime, stime;
+	if (!pos || sscanf(pos + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+		return false;
+
+	tt->ticks = utime + stime;
+	return true;
+}
+
+static void get_thread_times(thread_times_t *times)
+{
+	DIR *dir = opendir("/proc/self/task");
+	struct dirent *ent;
+
+	da_resize(*times, 0);
+	if (!dir)
+		return;
+
+	while ((ent = readdir(dir)) != NULL) {
+		struct thread_time tt;
+		char *end;
+		long tid = strtol(ent->d_name, &end, 10);
+
+		if (*end || end == ent->d_name)
+			continue;
+		if (read_thread_time(tid, &tt))
+			da_push_back(*times, &tt);
+	}
+
+	closedir(dir);
+}
+
+static obs_data_array_t *get_thread_stats(const thread_times_t *start, const thread_times_t *end,
+					  uint64_t duration_ns)
+{
+	obs_data_array_t *array = obs_data_array_create();
+	double seconds = (double)duration_ns / 1000000000.0;
+	double ticks_per_sec = (double)sysconf(_SC_CLK_TCK);
+
+	for (size_t i = 0; i < end->num; i++) {
+		const struct thread_time *tt = &end->array[i];
+		uint64_t ticks = tt->ticks;
+
+		for (size_t j = 0; j < start->num; j++) {
+			if (start->array[j].tid == tt->tid) {
+				ticks -= start->array[j].ticks;
+				break;
+			}
+		}
+
+		obs_data_t *thread = obs_data_create();
+		obs_data_set_int(thread, "tid", tt->tid);
+		obs_data_set_string(thread, "name", tt->name);
+		obs_data_set_double(thread, "cpu_percent", (double)ticks / ticks_per_sec / seconds * 100.0);
+		obs_data_array_push_back(array, thread);
+		obs_data_release(thread);
+	}
+
+	return array;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static bool reset_video(void)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = GRAPHICS_MODULE,
+		.fps_num = FPS,
+		.fps_den = 1,
+		.base_width = CANVAS_WIDTH,
+		.base_height = CANVAS_HEIGHT,
+		.output_width = CANVAS_WIDTH,
+		.output_height = CANVAS_HEIGHT,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+static obs_output_t *create_output(size_t idx)
+{
+	char name[32];
+	obs_data_t *settings;
+	obs_encoder_t *venc;
+	obs_encoder_t *aenc;
+	obs_output_t *output;
+
+	settings = obs_data_create();
+	obs_data_set_string(settings, "rate_control", "CBR");
+	obs_data_set_int(settings, "bitrate", VIDEO_BITRATE);
+	obs_data_set_int(settings, "keyint_sec", 2);
+	obs_data_set_string(settings, "preset", "veryfast");
+	snprintf(name, sizeof(name), "video encoder %zu", idx);
+	venc = obs_video_encoder_create("obs_x264", name, settings, NULL);
+	obs_data_release(settings);
+
+	settings = obs_data_create();
+	obs_data_set_int(settings, "bitrate", AUDIO_BITRATE);
+	snprintf(name, sizeof(name), "audio encoder %zu", idx);
+	aenc = obs_audio_encoder_create("ffmpeg_aac", name, settings, 0, NULL);
+	obs_data_release(settings);
+
+	snprintf(name, sizeof(name), "null output %zu", idx);
+	output = obs_output_create("null_output", name, NULL, NULL);
+
+	if (venc && aenc && output) {
+		obs_encoder_set_video(venc, obs_get_video());
+		obs_encoder_set_audio(aenc, obs_get_audio());
+		obs_output_set_video_encoder(output, venc);
+		obs_output_set_audio_encoder(output, aenc, 0);
+	} else {
+		fprintf(stderr, "could not create encoders/output %zu\n", idx);
+		obs_output_release(output);
+		output = NULL;
+	}
+
+	/* the output keeps its own references */
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	return output;
+}
+
+int main(int argc, char *argv[])
+{
+	obs_scene_t *scene = NULL;
+	obs_output_t *outputs[MAX_ENCODERS] = {0};
+	DARRAY(obs_source_t *) sources;
+	hist_t hists[NUM_STAGES] = {0};
+	int ret = EXIT_FAILURE;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <plugin bin path> <plugin data path> [sources] [encoders] [seconds]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	size_t num_sources = argc > 3 ? strtoul(argv[3], NULL, 10) : 8;
+	size_t num_encoders = argc > 4 ? strtoul(argv[4], NULL, 10) : 1;
+	unsigned int seconds = argc > 5 ? (unsigned int)strtoul(argv[5], NULL, 10) : 30;
+
+	if (!num_sources)
+		num_sources = 8;
+	if (!num_encoders || num_encoders > MAX_ENCODERS)
+		num_encoders = 1;
+	if (!seconds)
+		seconds = 30;
+
+	/* the random source uses rand() */
+	srand(0);
+
+	da_init(sources);
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "obs_startup failed\n");
+		goto out;
+	}
+
+	struct obs_audio_info ai = {.samples_per_sec = 48000, .speakers = SPEAKERS_STEREO};
+	if (!obs_reset_audio(&ai)) {
+		fprintf(stderr, "obs_reset_audio failed\n");
+		goto out;
+	}
+
+	if (!reset_video()) {
+		fprintf(stderr, "obs_reset_video failed\n");
+		goto out;
+	}
+
+	for (size_t i = 0; i < sizeof(modules) / sizeof(modules[0]); i++)
+		obs_add_safe_module(modules[i]);
+	obs_add_module_path(argv[1], argv[2]);
+	obs_load_all_modules();
+	obs_post_load_modules();
+
+	scene = obs_scene_create("scene");
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	for (size_t i = 0; i < num_sources * 2; i++) {
+		const char *id = (i & 1) ? "test_sinewave" : "random";
+		char name[32];
+		snprintf(name, sizeof(name), "%s %zu", id, i / 2);
+
+		obs_source_t *source = obs_source_create(id, name, NULL, NULL);
+		if (!source) {
+			fprintf(stderr, "could not create %s source\n", id);
+			goto out;
+		}
+
+		/* tile the video sources so that all of them get rendered */
+		obs_sceneitem_t *item = obs_scene_add(scene, source);
+		size_t tile = i / 2 % 64;
+		struct vec2 pos, scale;
+		vec2_set(&pos, (float)(tile % 8 * CANVAS_WIDTH / 8), (float)(tile / 8 * CANVAS_HEIGHT / 8));
+		vec2_set(&scale, CANVAS_WIDTH / 8 / 20.0f, CANVAS_HEIGHT / 8 / 20.0f);
+		obs_sceneitem_set_pos(item, &pos);
+		obs_sceneitem_set_scale(item, &scale);
+
+		da_push_back(sources, &source);
+	}
+
+	for (size_t i = 0; i < num_encoders; i++) {
+		outputs[i] = create_output(i);
+		if (!outputs[i] || !obs_output_start(outputs[i])) {
+			fprintf(stderr, "could not start output %zu: %s\n", i,
+				outputs[i] ? obs_output_get_last_error(outputs[i]) : "not created");
+			goto out;
+		}
+	}
+
+	os_sleep_ms(WARMUP_SECONDS * 1000);
+
+	video_t *video = obs_get_video();
+	uint32_t start_total = obs_get_total_frames();
+	uint32_t start_lagged = obs_get_lagged_frames();
+	uint32_t start_vio_total = video_output_get_total_frames(video);
+	uint32_t start_vio_skipped = video_output_get_skipped_frames(video);
+	struct obs_video_pacing_stats start_pacing, end_pacing;
+	obs_get_video_pacing_stats(video, &start_pacing);
+	uint64_t max_buffering = 0;
+#ifdef __linux__
+	thread_times_t start_threads, end_threads;
+	da_init(start_threads);
+	da_init(end_threads);
+	get_thread_times(&start_threads);
+#endif
+	collect_stages(hists, -1);
+	os_cpu_usage_info_t *cpu = os_cpu_usage_info_start();
+	uint64_t start_ns = os_gettime_ns();
+
+	for (unsigned int i = 0; i < seconds * 10; i++) {
+		uint64_t buffering = obs_get_audio_buffering_latency();
+		if (buffering > max_buffering)
+			max_buffering = buffering;
+		os_sleep_ms(100);
+	}
+
+	uint64_t duration_ns = os_gettime_ns() - start_ns;
+	double cpu_usage = os_cpu_usage_info_query(cpu);
+	collect_stages(hists, 1);
+	obs_get_video_pacing_stats(video, &end_pacing);
+#ifdef __linux__
+	get_thread_times(&end_threads);
+#endif
+
+	obs_data_t *result = obs_data_create();
+	obs_data_t *config = obs_data_create();
+	obs_data_t *frames = obs_data_create();
+	obs_data_t *audio = obs_data_create();
+
+	obs_data_set_int(config, "sources", (long long)num_sources);
+	obs_data_set_int(config, "encoders", (long long)num_encoders);
+	obs_data_set_int(config, "seconds", seconds);
+	obs_data_set_int(config, "width", CANVAS_WIDTH);
+	obs_data_set_int(config, "height", CANVAS_HEIGHT);
+	obs_data_set_int(config, "fps", FPS);
+	obs_data_set_int(config, "logical_cores", os_get_logical_cores());
+	obs_data_set_obj(result, "config", config);
+
+	obs_data_set_int(frames, "rendered", obs_get_total_frames() - start_total);
+	obs_data_set_int(frames, "lagged", obs_get_lagged_frames() - start_lagged);
+	obs_data_set_int(frames, "output", video_output_get_total_frames(video) - start_vio_total);
+	obs_data_set_int(frames, "skipped", video_output_get_skipped_frames(video) - start_vio_skipped);
+	obs_data_set_int(frames, "draw_calls", obs_get_frame_draw_calls());
+
+	/* outputs count from their start, which includes the warmup */
+	obs_data_array_t *dropped = obs_data_array_create();
+	for (size_t i = 0; i < num_encoders; i++) {
+		obs_data_t *output = obs_data_create();
+		obs_data_set_string(output, "name", obs_output_get_name(outputs[i]));
+		obs_data_set_int(output, "total_frames", obs_output_get_total_frames(outputs[i]));
+		obs_data_set_int(output, "dropped_frames", obs_output_get_frames_dropped(outputs[i]));
+		obs_data_array_push_back(dropped, output);
+		obs_data_release(output);
+	}
+	obs_data_set_array(frames, "outputs", dropped);
+	obs_data_array_release(dropped);
+	obs_data_set_obj(result, "frames", frames);
+
+	obs_data_set_int(audio, "buffering_ms", (long long)(obs_get_audio_buffering_latency() / 1000000));
+	obs_data_set_int(audio, "max_buffering_ms", (long long)(max_buffering / 1000000));
+	obs_data_set_obj(result, "audio", audio);
+
+	obs_data_t *pacing = get_pacing_stats(&start_pacing, &end_pacing);
+	obs_data_set_obj(result, "pacing", pacing);
+	obs_data_release(pacing);
+
+	obs_data_array_t *stage_stats = get_stage_stats(hists);
+	obs_data_set_array(result, "stages", stage_stats);
+	obs_data_array_release(stage_stats);
+
+	obs_data_set_double(result, "cpu_percent", cpu_usage);
+#ifdef __linux__
+	obs_data_array_t *thread_stats = get_thread_stats(&start_threads, &end_threads, duration_ns);
+	obs_data_set_array(result, "threads", thread_stats);
+	obs_data_array_release(thread_stats);
+	da_free(start_threads);
+	da_free(end_threads);
+#else
+	UNUSED_PARAMETER(duration_ns);
+#endif
+
+	printf("%s\n", obs_data_get_json_pretty(result));
+
+	obs_data_release(audio);
+	obs_data_release(frames);
+	obs_data_release(config);
+	obs_data_release(result);
+	os_cpu_usage_info_destroy(cpu);
+	ret = EXIT_SUCCESS;
+
+out:
+	if (obs_initialized()) {
+		for (size_t i = 0; i < num_encoders; i++) {
+			if (outputs[i]) {
+				obs_output_stop(outputs[i]);
+				obs_output_release(outputs[i]);
+			}
+		}
+		obs_set_output_source(0, NULL);
+		obs_scene_release(scene);
+		for (size_t i = 0; i < sources.num; i++)
+			obs_source_release(sources.array[i]);
+		obs_shutdown();
+	}
+	da_free(sources);
+	for (size_t i = 0; i < NUM_STAGES; i++)
+		da_free(hists[i]);
+
+	profiler_stop();
+	profiler_free();
+	return ret;
+}
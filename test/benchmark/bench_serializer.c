@@ -0,0 +1,153 @@
+/*
+ * Buffered file serializer throughput benchmark.
+ *
+ * Simulates several recordings writing to the same disk at once, each with
+ * its own buffered file serializer, and reports sustained throughput and the
+ * CPU time spent outside of the producer threads (i.e. on the I/O threads).
+ *
+ * usage: bench_serializer <directory> [writers] [MiB per writer]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/buffered-file-serializer.h>
+
+#define MAX_WRITERS 16
+
+struct writer {
+	pthread_t thread;
+	struct dstr path;
+	uint32_t flags;
+	size_t total_size;
+	uint64_t cpu_ns;
+	bool success;
+};
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t process_cpu_ns(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ULL +
+	       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+static void *writer_thread(void *data)
+{
+	struct writer *w = data;
+	struct serializer s;
+	uint64_t start = thread_cpu_ns();
+
+	if (!buffered_file_serializer_init_ex(&s, w->path.array, 0, 0, w->flags))
+		return NULL;
+
+	/* Packet sizes roughly like a high bitrate video track with the
+	 * occasional keyframe, plus an mdat size fixup every 64 MiB. */
+	uint8_t *packet = bzalloc(2 * 1048576);
+	size_t written = 0;
+	size_t last_fixup = 0;
+	uint32_t seed = 1;
+
+	while (written < w->total_size) {
+		seed = seed * 1103515245 + 12345;
+		size_t size = (seed >> 16) % 4 ? 60000 + (seed >> 8) % 100000 : 1048576 + (seed >> 8) % 524288;
+
+		if (s_write(&s, packet, size) != size)
+			goto fail;
+		written += size;
+
+		if (written - last_fixup >= 64 * 1048576) {
+			int64_t pos = serializer_get_pos(&s);
+			serializer_seek(&s, (int64_t)last_fixup, SERIALIZE_SEEK_START);
+			s_wb32(&s, (uint32_t)(written - last_fixup));
+			serializer_seek(&s, pos, SERIALIZE_SEEK_START);
+			last_fixup = written;
+		}
+	}
+
+	w->success = true;
+
+fail:
+	w->cpu_ns = thread_cpu_ns() - start;
+	buffered_file_serializer_free(&s);
+	bfree(packet);
+	return NULL;
+}
+
+static void run(const char *name, const char *dir, size_t count, size_t size_mib, uint32_t flags)
+{
+	struct writer writers[MAX_WRITERS] = {0};
+	uint64_t producer_cpu_ns = 0;
+	bool success = true;
+
+	uint64_t cpu_start = process_cpu_ns();
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = 0; i < count; i++) {
+		struct writer *w = &writers[i];
+		dstr_printf(&w->path, "%s/bench_serializer_%zu.bin", dir, i);
+		w->flags = flags;
+		w->total_size = size_mib * 1048576;
+		pthread_create(&w->thread, NULL, writer_thread, w);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		pthread_join(writers[i].thread, NULL);
+		producer_cpu_ns += writers[i].cpu_ns;
+		success = success && writers[i].success;
+	}
+
+	/* buffered_file_serializer_free() waits for all data to be written */
+	uint64_t elapsed = os_gettime_ns() - start;
+	uint64_t io_cpu_ns = process_cpu_ns() - cpu_start - producer_cpu_ns;
+
+	for (size_t i = 0; i < count; i++) {
+		os_unlink(writers[i].path.array);
+		dstr_free(&writers[i].path);
+	}
+
+	double mib = (double)(count * size_mib);
+	double seconds = (double)elapsed / 1e9;
+
+	printf("%-16s %s %8.1f MiB/s  %7.3f s wall  %7.3f s I/O thread CPU  (%.2f ms/MiB)\n", name,
+	       success ? "ok  " : "FAIL", mib / seconds, seconds, (double)io_cpu_ns / 1e9,
+	       (double)io_cpu_ns / 1e6 / mib);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printf("usage: %s <directory> [writers] [MiB per writer]\n", argv[0]);
+		return 1;
+	}
+
+	const char *dir = argv[1];
+	size_t count = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+	size_t size_mib = argc > 3 ? strtoul(argv[3], NULL, 10) : 1024;
+
+	if (!count || count > MAX_WRITERS)
+		count = 4;
+
+	printf("%zu writers, %zu MiB each\n", count, size_mib);
+
+	run("stdio", dir, count, size_mib, 0);
+	run("io_uring", dir, count, size_mib, BUFFERED_FILE_SERIALIZER_IO_URING);
+	run("io_uring+direct", dir, count, size_mib,
+	    BUFFERED_FILE_SERIALIZER_IO_URING | BUFFERED_FILE_SERIALIZER_DIRECT_IO);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * CPU video scaler benchmark.
+ *
+ * Runs video_scaler_scale() for every pair of the common source and output
+ * formats and prints the average time per frame.  Build against FFmpeg 5.0
+ * or newer and older versions to compare sliced scaling with the single
+ * threaded path.
+ *
+ * usage: bench_video_scaler [frames] [src width] [src height] [dst width] [dst height]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <media-io/video-frame.h>
+#include <media-io/video-scaler.h>
+#include <util/platform.h>
+
+static const enum video_format src_formats[] = {
+	VIDEO_FORMAT_I420, VIDEO_FORMAT_NV12, VIDEO_FORMAT_YUY2, VIDEO_FORMAT_UYVY, VIDEO_FORMAT_I422,
+	VIDEO_FORMAT_I444, VIDEO_FORMAT_RGBA, VIDEO_FORMAT_BGRA, VIDEO_FORMAT_I010, VIDEO_FORMAT_P010,
+};
+
+static const enum video_format dst_formats[] = {
+	VIDEO_FORMAT_NV12, VIDEO_FORMAT_I420, VIDEO_FORMAT_I444, VIDEO_FORMAT_BGRA, VIDEO_FORMAT_P010,
+};
+
+#define NUM_SRC_FORMATS (sizeof(src_formats) / sizeof(src_formats[0]))
+#define NUM_DST_FORMATS (sizeof(dst_formats) / sizeof(dst_formats[0]))
+
+static double run(const struct video_scale_info *dst_info, const struct video_scale_info *src_info,
+		  unsigned int frames)
+{
+	struct video_frame src = {0};
+	struct video_frame dst = {0};
+	video_scaler_t *scaler = NULL;
+	double ms = -1.0;
+
+	if (video_scaler_create(&scaler, dst_info, src_info, VIDEO_SCALE_BICUBIC) != VIDEO_SCALER_SUCCESS)
+		return ms;
+
+	video_frame_init(&src, src_info->format, src_info->width, src_info->height);
+	video_frame_init(&dst, dst_info->format, dst_info->width, dst_info->height);
+
+	/* the first frame pays for the lazy setup inside swscale */
+	if (!video_scaler_scale(scaler, dst.data, dst.linesize, (const uint8_t *const *)src.data, src.linesize))
+		goto out;
+
+	uint64_t start = os_gettime_ns();
+	for (unsigned int i = 0; i < frames; i++)
+		video_scaler_scale(scaler, dst.data, dst.linesize, (const uint8_t *const *)src.data, src.linesize);
+	ms = (double)(os_gettime_ns() - start) / 1000000.0 / (double)frames;
+
+out:
+	video_frame_free(&src);
+	video_frame_free(&dst);
+	video_scaler_destroy(scaler);
+	return ms;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int frames = argc > 1 ? (unsigned int)strtoul(argv[1], NULL, 10) : 30;
+	struct video_scale_info src_info = {
+		.width = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 3840,
+		.height = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 2160,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+	};
+	struct video_scale_info dst_info = {
+		.width = argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 10) : 1920,
+		.height = argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 1080,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+	};
+
+	if (!frames || !src_info.width || !src_info.height || !dst_info.width || !dst_info.height) {
+		fprintf(stderr, "usage: %s [frames] [src width] [src height] [dst width] [dst height]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%ux%u -> %ux%u bicubic, %u frames per pair, %d logical cores\n", src_info.width, src_info.height,
+	       dst_info.width, dst_info.height, frames, os_get_logical_cores());
+
+	for (size_t i = 0; i < NUM_SRC_FORMATS; i++) {
+		for (size_t j = 0; j < NUM_DST_FORMATS; j++) {
+			src_info.format = src_formats[i];
+			dst_info.format = dst_formats[j];
+
+			double ms = run(&dst_info, &src_info, frames);
+			if (ms < 0.0)
+				printf("%-4s -> %-4s  failed\n", get_video_format_name(src_info.format),
+				       get_video_format_name(dst_info.format));
+			else
+				printf("%-4s -> %-4s  %8.3f ms per frame\n", get_video_format_name(src_info.format),
+				       get_video_format_name(dst_info.format), ms);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
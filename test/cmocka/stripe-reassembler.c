@@ -0,0 +1,139 @@
+#include <string.h>
+#include <util/bmem.h>
+
+#include "stripe-reassembler.h"
+
+static inline uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)get_be16(p) << 16 | get_be16(p + 2);
+}
+
+static inline uint64_t get_be64(const uint8_t *p)
+{
+	return (uint64_t)get_be32(p) << 32 | get_be32(p + 4);
+}
+
+void stripe_reassembler_init(struct stripe_reassembler *r, stripe_output_t output, void *param)
+{
+	memset(r, 0, sizeof(*r));
+	r->output = output;
+	r->param = param;
+}
+
+void stripe_reassembler_free(struct stripe_reassembler *r)
+{
+	for (size_t i = 0; i < STRIPE_MAX_CONNECTIONS; i++)
+		da_free(r->connections[i].buf);
+	for (size_t i = 0; i < r->pending.num; i++)
+		bfree(r->pending.array[i].data);
+	da_free(r->pending);
+	dstr_free(&r->path);
+}
+
+/* returns the size of the hello, 0 if incomplete or -1 if invalid */
+static ptrdiff_t parse_hello(struct stripe_reassembler *r, const uint8_t *data, size_t size)
+{
+	if (size < STRIPE_HELLO_SIZE)
+		return 0;
+
+	if (memcmp(data, STRIPE_MAGIC, STRIPE_MAGIC_SIZE) != 0 || data[STRIPE_MAGIC_SIZE] != STRIPE_VERSION)
+		return -1;
+
+	size_t count = data[STRIPE_MAGIC_SIZE + 2];
+	uint64_t session = get_be64(data + STRIPE_MAGIC_SIZE + 3);
+	size_t path_size = get_be16(data + STRIPE_MAGIC_SIZE + 11);
+
+	if (size < STRIPE_HELLO_SIZE + path_size)
+		return 0;
+	if (!count || count > STRIPE_MAX_CONNECTIONS || data[STRIPE_MAGIC_SIZE + 1] >= count)
+		return -1;
+
+	if (!r->count) {
+		r->count = count;
+		r->session = session;
+		/* not dstr_ncopy, that reads one byte past the (unterminated) path */
+		dstr_ncat(&r->path, (const char *)data + STRIPE_HELLO_SIZE, path_size);
+	} else if (r->count != count || r->session != session) {
+		return -1;
+	}
+
+	return (ptrdiff_t)(STRIPE_HELLO_SIZE + path_size);
+}
+
+static void flush_pending(struct stripe_reassembler *r)
+{
+	bool found = true;
+
+	while (found) {
+		found = false;
+		for (size_t i = 0; i < r->pending.num; i++) {
+			struct stripe_message *msg = &r->pending.array[i];
+			if (msg->sequence != r->next_sequence)
+				continue;
+
+			r->output(r->param, msg->data, msg->size);
+			r->next_sequence++;
+			bfree(msg->data);
+			da_erase(r->pending, i);
+			found = true;
+			break;
+		}
+	}
+}
+
+static void add_message(struct stripe_reassembler *r, uint32_t sequence, const uint8_t *data, size_t size)
+{
+	if (sequence == r->next_sequence) {
+		r->output(r->param, data, size);
+		r->next_sequence++;
+		flush_pending(r);
+	} else {
+		struct stripe_message msg = {sequence, bmemdup(data, size), size};
+		da_push_back(r->pending, &msg);
+	}
+}
+
+bool stripe_reassembler_push(struct stripe_reassembler *r, size_t conn, const uint8_t *data, size_t size)
+{
+	struct stripe_connection *c;
+	size_t pos = 0;
+
+	if (conn >= STRIPE_MAX_CONNECTIONS)
+		return false;
+
+	c = &r->connections[conn];
+	da_push_back_array(c->buf, data, size);
+
+	if (!c->got_hello) {
+		ptrdiff_t hello_size = parse_hello(r, c->buf.array, c->buf.num);
+		if (hello_size < 0)
+			return false;
+		if (!hello_size)
+			return true;
+
+		pos = (size_t)hello_size;
+		c->got_hello = true;
+	}
+
+	while (c->buf.num - pos >= STRIPE_MESSAGE_HEADER_SIZE) {
+		const uint8_t *header = c->buf.array + pos;
+		uint32_t sequence = get_be32(header);
+		size_t msg_size = get_be32(header + 4);
+
+		if (c->buf.num - pos - STRIPE_MESSAGE_HEADER_SIZE < msg_size)
+			break;
+
+		add_message(r, sequence, header + STRIPE_MESSAGE_HEADER_SIZE, msg_size);
+		pos += STRIPE_MESSAGE_HEADER_SIZE + msg_size;
+		c->messages++;
+	}
+
+	if (pos)
+		da_erase_range(c->buf, 0, pos);
+	return true;
+}
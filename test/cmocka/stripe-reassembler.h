@@ -0,0 +1,48 @@
+#pragma once
+
+#include <util/darray.h>
+#include <util/dstr.h>
+
+#include "rtmp-stripe.h"
+
+/*
+ * Reference receiver for striped FLV uploads (see rtmp-stripe.h).
+ *
+ * Data read from each connection of a session is pushed in as it arrives, in
+ * any order across connections.  The restored FLV stream is passed to the
+ * output callback in sequence order.
+ */
+
+typedef void (*stripe_output_t)(void *param, const uint8_t *data, size_t size);
+
+struct stripe_connection {
+	DARRAY(uint8_t) buf;
+	bool got_hello;
+	size_t messages;
+};
+
+struct stripe_message {
+	uint32_t sequence;
+	uint8_t *data;
+	size_t size;
+};
+
+struct stripe_reassembler {
+	struct stripe_connection connections[STRIPE_MAX_CONNECTIONS];
+	size_t count;
+	uint64_t session;
+	struct dstr path;
+
+	uint32_t next_sequence;
+	DARRAY(struct stripe_message) pending;
+
+	stripe_output_t output;
+	void *param;
+};
+
+void stripe_reassembler_init(struct stripe_reassembler *r, stripe_output_t output, void *param);
+void stripe_reassembler_free(struct stripe_reassembler *r);
+
+/* conn is the receiver's own index for the connection, returns false if the
+ * data doesn't follow the protocol */
+bool stripe_reassembler_push(struct stripe_reassembler *r, size_t conn, const uint8_t *data, size_t size);
@@ -0,0 +1,128 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <media-io/audio-io.h>
+#include <util/threading.h>
+
+#define SAMPLE_RATE 48000
+#define EXTRA_AT 5
+#define CALLS 10
+
+static struct {
+	audio_t *audio;
+	volatile bool started;
+	size_t calls;
+
+	uint64_t starts[CALLS];
+	uint64_t ends[CALLS];
+	uint64_t timestamps[CALLS];
+	float values[CALLS];
+	volatile long outputs;
+	os_sem_t *done;
+} test;
+
+static bool input_callback(void *param, uint64_t start_ts, uint64_t end_ts, uint64_t *out_ts, uint32_t mixers,
+			   struct audio_output_data *mixes)
+{
+	size_t call = test.calls;
+
+	*out_ts = start_ts;
+
+	if (!os_atomic_load_bool(&test.started) || call >= CALLS)
+		return true;
+
+	test.starts[call] = start_ts;
+	test.ends[call] = end_ts;
+	test.calls++;
+
+	/* the content of the tick, to check that each one gets output */
+	mixes[0].data[0][0] = (float)call / 1000.0f;
+
+	if (call == EXTRA_AT)
+		audio_output_request_extra_tick(test.audio);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mixers);
+	return true;
+}
+
+static void output_callback(void *param, size_t mix_idx, struct audio_data *data)
+{
+	long idx = os_atomic_load_long(&test.outputs);
+
+	if (!os_atomic_load_bool(&test.started) || idx >= CALLS)
+		return;
+
+	test.timestamps[idx] = data->timestamp;
+	test.values[idx] = ((float *)data->data[0])[0];
+
+	if (os_atomic_inc_long(&test.outputs) == CALLS)
+		os_sem_post(test.done);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mix_idx);
+}
+
+static void extra_tick_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_output_info info = {
+		.name = "test",
+		.samples_per_sec = SAMPLE_RATE,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.speakers = SPEAKERS_STEREO,
+		.input_callback = input_callback,
+	};
+	audio_t *audio;
+
+	assert_int_equal(os_sem_init(&test.done, 0), 0);
+	assert_int_equal(audio_output_open(&audio, &info), AUDIO_OUTPUT_SUCCESS);
+	test.audio = audio;
+	assert_true(audio_output_connect(audio, 0, NULL, output_callback, NULL));
+	os_atomic_set_bool(&test.started, true);
+
+	assert_int_equal(os_sem_wait(test.done), 0);
+
+	audio_output_disconnect(audio, 0, output_callback, NULL);
+	audio_output_close(audio);
+	os_sem_destroy(test.done);
+
+	for (size_t i = 0; i < CALLS; i++) {
+		/* every call is output once, in order */
+		assert_int_equal((int)(test.values[i] * 1000.0f + 0.5f), (int)i);
+		assert_true(test.timestamps[i] == test.starts[i]);
+
+		if (!i)
+			continue;
+
+		if (i == EXTRA_AT + 1) {
+			/* the extra call covers the same period as the one that
+			 * asked for it */
+			assert_true(test.starts[i] == test.starts[i - 1]);
+			assert_true(test.ends[i] == test.ends[i - 1]);
+		} else {
+			/* and every other call moves on to the next period, so
+			 * the request only applies once */
+			assert_true(test.starts[i] == test.ends[i - 1]);
+		}
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(extra_tick_test),
+	};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return 1;
+
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+
+	obs_shutdown();
+	return ret;
+}
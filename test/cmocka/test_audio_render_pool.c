@@ -0,0 +1,160 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+
+#include "obs-audio-render-pool.h"
+
+#define SOURCES 37
+#define MIXES 6
+#define CHANNELS 2
+#define FRAMES 1024
+#define TICKS 200
+#define THREADS 3
+#define MIN_PARALLEL 4
+
+/* stands in for a leaf source, rendering only touches its own buffers */
+struct test_source {
+	float input[CHANNELS][FRAMES];
+	float output[MIXES][CHANNELS][FRAMES];
+	float volume;
+	uint32_t mixers;
+	volatile long renders;
+	pthread_t thread;
+};
+
+static struct test_source sources[SOURCES];
+static float serial_mix[MIXES][CHANNELS][FRAMES];
+static float parallel_mix[MIXES][CHANNELS][FRAMES];
+
+static void render_source(void *param, size_t idx)
+{
+	struct test_source *source = (struct test_source *)param + idx;
+
+	for (size_t mix = 0; mix < MIXES; mix++) {
+		if ((source->mixers & (1 << mix)) == 0) {
+			memset(source->output[mix], 0, sizeof(source->output[mix]));
+			continue;
+		}
+
+		for (size_t ch = 0; ch < CHANNELS; ch++) {
+			for (size_t i = 0; i < FRAMES; i++)
+				source->output[mix][ch][i] = source->input[ch][i] * source->volume;
+		}
+	}
+
+	source->thread = pthread_self();
+	os_atomic_inc_long(&source->renders);
+}
+
+static void fill_sources(uint32_t tick, size_t count)
+{
+	uint32_t seed = tick * 2654435761u + 1;
+
+	for (size_t s = 0; s < count; s++) {
+		struct test_source *source = &sources[s];
+
+		for (size_t ch = 0; ch < CHANNELS; ch++) {
+			for (size_t i = 0; i < FRAMES; i++) {
+				seed = seed * 1664525u + 1013904223u;
+				source->input[ch][i] = (float)(seed >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+			}
+		}
+
+		source->volume = 0.25f + 0.5f * (float)((tick + s) % 7) / 7.0f;
+		source->mixers = (uint32_t)(tick + s) % (1 << MIXES) | 1;
+		source->renders = 0;
+	}
+}
+
+/* mixes the rendered sources in a fixed order, like mix_audio */
+static void render_tick(struct audio_render_pool *pool, uint32_t tick, size_t count,
+			float mixes[MIXES][CHANNELS][FRAMES])
+{
+	fill_sources(tick, count);
+
+	if (pool) {
+		audio_render_pool_run(pool, count, MIN_PARALLEL, render_source, sources);
+	} else {
+		for (size_t s = 0; s < count; s++)
+			render_source(sources, s);
+	}
+
+	memset(mixes, 0, sizeof(float) * MIXES * CHANNELS * FRAMES);
+	for (size_t s = 0; s < count; s++) {
+		assert_int_equal(sources[s].renders, 1);
+
+		for (size_t mix = 0; mix < MIXES; mix++) {
+			for (size_t ch = 0; ch < CHANNELS; ch++) {
+				for (size_t i = 0; i < FRAMES; i++)
+					mixes[mix][ch][i] += sources[s].output[mix][ch][i];
+			}
+		}
+	}
+}
+
+static void serial_parallel_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_render_pool pool;
+	assert_true(audio_render_pool_init(&pool, THREADS));
+
+	for (uint32_t tick = 0; tick < TICKS; tick++) {
+		render_tick(NULL, tick, SOURCES, serial_mix);
+		render_tick(&pool, tick, SOURCES, parallel_mix);
+		assert_memory_equal(serial_mix, parallel_mix, sizeof(serial_mix));
+	}
+
+	audio_render_pool_free(&pool);
+}
+
+static void few_sources_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_render_pool pool;
+	pthread_t self = pthread_self();
+
+	assert_true(audio_render_pool_init(&pool, THREADS));
+
+	/* not worth waking the workers for, everything runs on the caller */
+	for (size_t count = 0; count < MIN_PARALLEL; count++) {
+		render_tick(NULL, (uint32_t)count, count, serial_mix);
+		render_tick(&pool, (uint32_t)count, count, parallel_mix);
+		assert_memory_equal(serial_mix, parallel_mix, sizeof(serial_mix));
+
+		for (size_t s = 0; s < count; s++)
+			assert_true(pthread_equal(sources[s].thread, self));
+	}
+
+	audio_render_pool_free(&pool);
+}
+
+static void no_threads_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct audio_render_pool pool;
+	assert_true(audio_render_pool_init(&pool, 0));
+	assert_int_equal(audio_render_pool_threads(&pool), 0);
+
+	render_tick(NULL, 1, SOURCES, serial_mix);
+	render_tick(&pool, 1, SOURCES, parallel_mix);
+	assert_memory_equal(serial_mix, parallel_mix, sizeof(serial_mix));
+
+	audio_render_pool_free(&pool);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(serial_parallel_test),
+		cmocka_unit_test(few_sources_test),
+		cmocka_unit_test(no_threads_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
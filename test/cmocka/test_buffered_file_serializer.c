@@ -0,0 +1,142 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/buffered-file-serializer.h>
+
+#define TEST_FILE "test_buffered_file_serializer.bin"
+#define TEST_SIZE (3 * 1048576 + 12345)
+
+static uint8_t pattern(size_t pos)
+{
+	return (uint8_t)((pos * 31) ^ (pos >> 9));
+}
+
+static volatile long released;
+
+static void release_piece(void *param)
+{
+	UNUSED_PARAMETER(param);
+	os_atomic_inc_long(&released);
+}
+
+/* Mimics what mp4-mux does: write a placeholder header, a large payload in
+ * odd-sized pieces, then seek back to patch the header and return to the
+ * end to append more data. */
+static void write_and_verify(uint32_t flags, bool use_refs)
+{
+	struct serializer s;
+	uint8_t *data = bmalloc(TEST_SIZE);
+
+	for (size_t i = 0; i < TEST_SIZE; i++)
+		data[i] = pattern(i);
+
+	assert_true(buffered_file_serializer_init_ex(&s, TEST_FILE, 0, 65536, flags));
+
+	/* don't let an io_uring test pass on the stdio fallback */
+	if (!(flags & BUFFERED_FILE_SERIALIZER_IO_URING)) {
+		assert_false(buffered_file_serializer_io_uring_active(&s));
+	} else if (!buffered_file_serializer_io_uring_active(&s)) {
+		buffered_file_serializer_free(&s);
+		os_unlink(TEST_FILE);
+		bfree(data);
+		skip();
+	}
+
+	s_wb32(&s, 0);
+	s_write(&s, "mdat", 4);
+
+	size_t pos = 0;
+	size_t piece = 1;
+	long pieces = 0;
+	released = 0;
+
+	while (pos < TEST_SIZE) {
+		size_t size = piece < TEST_SIZE - pos ? piece : TEST_SIZE - pos;
+		if (use_refs)
+			buffered_file_serializer_write_ref(&s, data + pos, size, release_piece, NULL);
+		else
+			s_write(&s, data + pos, size);
+		pos += size;
+		pieces++;
+		piece = (piece * 7 + 13) % 70000;
+	}
+
+	int64_t end = serializer_get_pos(&s);
+	assert_int_equal(end, TEST_SIZE + 8);
+
+	serializer_seek(&s, 0, SERIALIZE_SEEK_START);
+	s_wb32(&s, (uint32_t)end);
+	serializer_seek(&s, end, SERIALIZE_SEEK_START);
+	s_write(&s, "moov", 4);
+
+	buffered_file_serializer_free(&s);
+
+	if (use_refs)
+		assert_int_equal(os_atomic_load_long(&released), pieces);
+
+	FILE *f = os_fopen(TEST_FILE, "rb");
+	assert_non_null(f);
+
+	uint8_t *result = bmalloc(TEST_SIZE + 12);
+	assert_int_equal(fread(result, 1, TEST_SIZE + 12, f), TEST_SIZE + 12);
+	assert_int_equal(fgetc(f), EOF);
+	fclose(f);
+
+	uint8_t header[8] = {0};
+	header[0] = (uint8_t)(end >> 24);
+	header[1] = (uint8_t)(end >> 16);
+	header[2] = (uint8_t)(end >> 8);
+	header[3] = (uint8_t)end;
+	memcpy(header + 4, "mdat", 4);
+
+	assert_memory_equal(result, header, 8);
+	assert_memory_equal(result + 8, data, TEST_SIZE);
+	assert_memory_equal(result + 8 + TEST_SIZE, "moov", 4);
+
+	os_unlink(TEST_FILE);
+	bfree(result);
+	bfree(data);
+}
+
+static void stdio_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	write_and_verify(0, false);
+}
+
+static void write_ref_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	write_and_verify(0, true);
+}
+
+static void io_uring_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	write_and_verify(BUFFERED_FILE_SERIALIZER_IO_URING, true);
+}
+
+static void io_uring_direct_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	write_and_verify(BUFFERED_FILE_SERIALIZER_IO_URING | BUFFERED_FILE_SERIALIZER_DIRECT_IO, false);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(stdio_test),
+		cmocka_unit_test(write_ref_test),
+		cmocka_unit_test(io_uring_test),
+		cmocka_unit_test(io_uring_direct_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,100 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/c99defs.h>
+
+#include "bw-estimator.h"
+
+#define STEP_NS 50000000ULL
+
+struct link {
+	struct bw_estimator bwe;
+	uint64_t ts;
+	uint64_t delivered;
+};
+
+static void run_link(struct link *link, long kbps, uint32_t rtt_us, bool app_limited, uint64_t ms)
+{
+	for (uint64_t t = 0; t < ms * 1000000; t += STEP_NS) {
+		link->ts += STEP_NS;
+		link->delivered += (uint64_t)kbps * 1000 / 8 * STEP_NS / 1000000000;
+		bwe_add_sample(&link->bwe, link->ts, link->delivered, rtt_us, app_limited);
+	}
+}
+
+static void init_link(struct link *link)
+{
+	bwe_init(&link->bwe);
+	link->ts = 1000000000;
+	link->delivered = 0;
+	bwe_add_sample(&link->bwe, link->ts, 0, 0, false);
+}
+
+static void saturated_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct link link;
+	init_link(&link);
+
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 0);
+
+	run_link(&link, 5000, 20000, false, 1000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 5000);
+	assert_int_equal(link.bwe.min_rtt_us, 20000);
+	assert_int_equal(bwe_queue_delay_us(&link.bwe), 0);
+
+	/* a slower link only shows once the faster samples leave the window */
+	run_link(&link, 3000, 20000, false, 5000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 5000);
+	run_link(&link, 3000, 20000, false, 6000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 3000);
+}
+
+static void app_limited_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct link link;
+	init_link(&link);
+
+	run_link(&link, 5000, 20000, false, 1000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 5000);
+
+	/* a static scene doesn't mean the link got slower */
+	run_link(&link, 1000, 20000, true, 20000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 5000);
+
+	/* but can show that it got faster */
+	run_link(&link, 6000, 20000, true, 1000);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 6000);
+}
+
+static void congested_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct link link;
+	init_link(&link);
+
+	run_link(&link, 5000, 20000, false, 1000);
+	run_link(&link, 2000, 150000, false, 250);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 5000);
+	assert_int_equal(bwe_queue_delay_us(&link.bwe), 130000);
+
+	bwe_congested(&link.bwe);
+	assert_int_equal(bwe_bandwidth_kbps(&link.bwe), 2000);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(saturated_test),
+		cmocka_unit_test(app_limited_test),
+		cmocka_unit_test(congested_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
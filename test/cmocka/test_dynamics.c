@@ -0,0 +1,184 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+
+#include <util/bmem.h>
+#include <media-io/audio-math.h>
+
+#include "dynamics.h"
+
+#define SAMPLE_RATE 48000
+#define FRAMES 480
+#define CHANNELS 2
+#define BLOCKS 200
+
+static float test_signal(size_t c, size_t i)
+{
+	/* a tone whose level sweeps from -90 dB up to about +6 dB */
+	const float t = (float)i / SAMPLE_RATE;
+	const float level = db_to_mul(-90.0f + 96.0f * (float)i / (FRAMES * BLOCKS));
+	return level * sinf(6.2831853f * (220.0f + 110.0f * (float)c) * t);
+}
+
+static void db_conversion_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float src[1000], db[1000], mul[1000];
+
+	for (size_t i = 0; i < 1000; i++)
+		src[i] = powf(10.0f, -9.0f + 11.0f * (float)i / 1000.0f);
+
+	dyn_mul_to_db_buf(db, src, 1000);
+	for (size_t i = 0; i < 1000; i++) {
+		assert_true(fabsf(db[i] - mul_to_db(src[i])) < DYN_DB_MAX_ERROR);
+		assert_true(fabsf(dyn_mul_to_db(src[i]) - mul_to_db(src[i])) < DYN_DB_MAX_ERROR);
+	}
+
+	for (size_t i = 0; i < 1000; i++)
+		src[i] = -150.0f + 200.0f * (float)i / 1000.0f;
+
+	dyn_db_to_mul_buf(mul, src, 1000);
+	for (size_t i = 0; i < 1000; i++) {
+		const float ref = db_to_mul(src[i]);
+		assert_true(fabsf(mul[i] - ref) <= ref * DYN_MUL_MAX_REL_ERROR);
+		assert_true(fabsf(dyn_db_to_mul(src[i]) - ref) <= ref * DYN_MUL_MAX_REL_ERROR);
+	}
+
+	/* silence must stay finite */
+	src[0] = 0.0f;
+	dyn_mul_to_db_buf(db, src, 1);
+	assert_true(isfinite(db[0]) && db[0] < -500.0f);
+}
+
+/* the compressor/limiter processing as it was before the shared core */
+static void reference_compress(float **samples, float *env_state, float *env_buf, float attack_gain,
+			       float release_gain, float threshold, float slope, float output_gain)
+{
+	memset(env_buf, 0, FRAMES * sizeof(float));
+	for (size_t c = 0; c < CHANNELS; c++) {
+		float env = *env_state;
+		for (size_t i = 0; i < FRAMES; i++) {
+			const float env_in = fabsf(samples[c][i]);
+			if (env < env_in)
+				env = env_in + attack_gain * (env - env_in);
+			else
+				env = env_in + release_gain * (env - env_in);
+			env_buf[i] = fmaxf(env_buf[i], env);
+		}
+	}
+	*env_state = env_buf[FRAMES - 1];
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		float gain = slope * (threshold - mul_to_db(env_buf[i]));
+		gain = db_to_mul(fminf(0, gain));
+		for (size_t c = 0; c < CHANNELS; c++)
+			samples[c][i] *= gain * output_gain;
+	}
+}
+
+static void compress_test(float ratio, float threshold, float output_gain_db)
+{
+	const float attack_gain = expf(-1.0f / (SAMPLE_RATE * 0.006f));
+	const float release_gain = expf(-1.0f / (SAMPLE_RATE * 0.060f));
+	const float slope = 1.0f - 1.0f / ratio;
+	const float output_gain = db_to_mul(output_gain_db);
+
+	struct dyn_gain_table *gt = bzalloc(sizeof(*gt));
+	dyn_gain_table_init(gt, threshold, slope, output_gain);
+
+	float ref[CHANNELS][FRAMES], out[CHANNELS][FRAMES];
+	float *ref_ptrs[CHANNELS] = {ref[0], ref[1]};
+	float *out_ptrs[CHANNELS] = {out[0], out[1]};
+	float env_buf[FRAMES];
+	float ref_env = 0.0f, env = 0.0f;
+	float max_err_db = 0.0f;
+
+	for (size_t b = 0; b < BLOCKS; b++) {
+		for (size_t c = 0; c < CHANNELS; c++)
+			for (size_t i = 0; i < FRAMES; i++)
+				ref[c][i] = out[c][i] = test_signal(c, b * FRAMES + i);
+
+		reference_compress(ref_ptrs, &ref_env, env_buf, attack_gain, release_gain, threshold, slope,
+				   output_gain);
+
+		memset(env_buf, 0, sizeof(env_buf));
+		dyn_envelope_follow(env_buf, out_ptrs, CHANNELS, FRAMES, env, attack_gain, release_gain);
+		env = env_buf[FRAMES - 1];
+		dyn_gain_table_apply(gt, env_buf, env_buf, FRAMES);
+		dyn_apply_gain(out_ptrs, CHANNELS, env_buf, FRAMES);
+
+		assert_true(env == ref_env);
+
+		for (size_t c = 0; c < CHANNELS; c++) {
+			for (size_t i = 0; i < FRAMES; i++) {
+				if (fabsf(ref[c][i]) < 1e-6f)
+					continue;
+				max_err_db = fmaxf(max_err_db, fabsf(mul_to_db(out[c][i] / ref[c][i])));
+			}
+		}
+	}
+
+	/* the table interpolates, so it is held to a slightly looser bound */
+	assert_true(max_err_db < 0.001f);
+	bfree(gt);
+}
+
+static void compressor_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	compress_test(10.0f, -18.0f, 0.0f);
+	compress_test(32.0f, -60.0f, 32.0f);
+	compress_test(1.0f, 0.0f, -6.0f);
+}
+
+static void limiter_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	/* the limiter is a compressor with an infinite ratio */
+	compress_test(INFINITY, -6.0f, 0.0f);
+	compress_test(INFINITY, -60.0f, 0.0f);
+}
+
+static void peak_apply_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	float a[FRAMES + 3], b[FRAMES + 3], peak[FRAMES + 3], gain[FRAMES + 3];
+	float *ptrs[3] = {a, NULL, b};
+
+	for (size_t i = 0; i < FRAMES + 3; i++) {
+		a[i] = test_signal(0, i * 100);
+		b[i] = -test_signal(1, i * 100);
+		gain[i] = (float)i / (FRAMES + 3);
+	}
+
+	dyn_peak_channels(peak, ptrs, 3, FRAMES + 3);
+	for (size_t i = 0; i < FRAMES + 3; i++)
+		assert_true(peak[i] == fmaxf(fabsf(a[i]), fabsf(b[i])));
+
+	float a_ref[FRAMES + 3], b_ref[FRAMES + 3];
+	for (size_t i = 0; i < FRAMES + 3; i++) {
+		a_ref[i] = a[i] * gain[i];
+		b_ref[i] = b[i] * gain[i];
+	}
+
+	dyn_apply_gain(ptrs, 3, gain, FRAMES + 3);
+	assert_memory_equal(a, a_ref, sizeof(a));
+	assert_memory_equal(b, b_ref, sizeof(b));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(db_conversion_test),
+		cmocka_unit_test(compressor_test),
+		cmocka_unit_test(limiter_test),
+		cmocka_unit_test(peak_apply_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,85 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <util/c99defs.h>
+#include <rnnoise.h>
+
+#define FRAME_SIZE 480
+#define CHANNELS 6
+#define FRAMES 300
+
+static void make_frame(float *out, size_t channel, size_t frame, uint32_t *seed)
+{
+	for (size_t i = 0; i < FRAME_SIZE; i++) {
+		const size_t n = frame * FRAME_SIZE + i;
+		*seed = *seed * 1103515245 + 12345;
+		const float noise = (float)((*seed >> 9) & 0xFFFF) / 65536.0f - 0.5f;
+		const float voice = (frame % 100) < 60 ? sinf(0.031f * (float)n * (float)(channel + 1)) : 0.0f;
+		out[i] = 0.25f * voice + 0.06f * noise;
+	}
+}
+
+/* Batched, scaled processing must match per-channel processing of the
+ * pre-scaled signal within a small tolerance. */
+static void batch_matches_single_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	DenoiseState *single[CHANNELS];
+	DenoiseState *batch[CHANNELS];
+	float ref[CHANNELS][FRAME_SIZE];
+	float buf[CHANNELS][FRAME_SIZE];
+	float *ptrs[CHANNELS];
+	float vad[CHANNELS];
+	uint32_t seed = 1;
+	double err = 0.0, sig = 0.0;
+
+	for (size_t c = 0; c < CHANNELS; c++) {
+		single[c] = rnnoise_create(NULL);
+		batch[c] = rnnoise_create(NULL);
+		ptrs[c] = buf[c];
+	}
+
+	for (size_t f = 0; f < FRAMES; f++) {
+		for (size_t c = 0; c < CHANNELS; c++) {
+			make_frame(buf[c], c, f, &seed);
+			for (size_t i = 0; i < FRAME_SIZE; i++)
+				ref[c][i] = buf[c][i] * 32768.0f;
+			rnnoise_process_frame(single[c], ref[c], ref[c]);
+		}
+
+		rnnoise_process_frames(batch, CHANNELS, ptrs, (const float **)ptrs, 32768.0f, 1.0f / 32768.0f, vad);
+
+		for (size_t c = 0; c < CHANNELS; c++) {
+			assert_true(vad[c] >= 0.0f && vad[c] <= 1.0f);
+			for (size_t i = 0; i < FRAME_SIZE; i++) {
+				const double r = ref[c][i] / 32768.0;
+				err += (buf[c][i] - r) * (buf[c][i] - r);
+				sig += r * r;
+			}
+		}
+	}
+
+	/* identical apart from rounding, so well over 100 dB apart */
+	assert_true(sig > 0.0);
+	assert_true(10.0 * log10(sig / fmax(err, 1e-30)) > 100.0);
+
+	for (size_t c = 0; c < CHANNELS; c++) {
+		rnnoise_destroy(single[c]);
+		rnnoise_destroy(batch[c]);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(batch_matches_single_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
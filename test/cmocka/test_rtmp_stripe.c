@@ -0,0 +1,235 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <util/threading.h>
+
+#include "stripe-reassembler.h"
+
+#define CONNECTIONS 4
+#define MESSAGES 2000
+#define MAX_MESSAGE_SIZE 65536
+
+static size_t message_size(size_t i)
+{
+	return 1 + (i * 7919) % MAX_MESSAGE_SIZE;
+}
+
+static void fill_message(uint8_t *data, size_t i)
+{
+	for (size_t j = 0; j < message_size(i); j++)
+		data[j] = (uint8_t)(i * 31 + j);
+}
+
+static void *sender_thread(void *data)
+{
+	unsigned int port = *(unsigned int *)data;
+	struct stripe_sender stripe;
+	uint8_t *msg = bmalloc(MAX_MESSAGE_SIZE);
+
+	if (stripe_connect(&stripe, "127.0.0.1", port, "live/key", CONNECTIONS, NULL, 0)) {
+		for (size_t i = 0; i < MESSAGES; i++) {
+			fill_message(msg, i);
+			if (stripe_write(&stripe, msg, message_size(i)) < 0)
+				break;
+		}
+		stripe_close(&stripe);
+	}
+
+	bfree(msg);
+	return NULL;
+}
+
+static void append_output(void *param, const uint8_t *data, size_t size)
+{
+	DARRAY(uint8_t) *output = param;
+	da_push_back_array(*output, data, size);
+}
+
+static unsigned int listen_loopback(int *listener)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_size = sizeof(addr);
+
+	*listener = socket(AF_INET, SOCK_STREAM, 0);
+	assert_true(*listener >= 0);
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	assert_int_equal(bind(*listener, (struct sockaddr *)&addr, sizeof(addr)), 0);
+	assert_int_equal(listen(*listener, CONNECTIONS), 0);
+	assert_int_equal(getsockname(*listener, (struct sockaddr *)&addr, &addr_size), 0);
+
+	return ntohs(addr.sin_port);
+}
+
+static void loopback_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct pollfd fds[CONNECTIONS];
+	struct stripe_reassembler r;
+	DARRAY(uint8_t) output;
+	DARRAY(uint8_t) expected;
+	uint8_t *buf = bmalloc(MAX_MESSAGE_SIZE);
+	size_t open_connections = CONNECTIONS;
+	unsigned int port;
+	pthread_t thread;
+
+	da_init(output);
+	da_init(expected);
+	stripe_reassembler_init(&r, append_output, &output);
+
+	int listener;
+
+	port = listen_loopback(&listener);
+	assert_int_equal(pthread_create(&thread, NULL, sender_thread, &port), 0);
+
+	for (size_t i = 0; i < CONNECTIONS; i++) {
+		fds[i].fd = accept(listener, NULL, NULL);
+		fds[i].events = POLLIN;
+		assert_true(fds[i].fd >= 0);
+	}
+
+	while (open_connections) {
+		assert_true(poll(fds, CONNECTIONS, 10000) > 0);
+
+		for (size_t i = 0; i < CONNECTIONS; i++) {
+			if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP)))
+				continue;
+
+			ssize_t ret = recv(fds[i].fd, buf, MAX_MESSAGE_SIZE, 0);
+			if (ret <= 0) {
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				open_connections--;
+				continue;
+			}
+
+			assert_true(stripe_reassembler_push(&r, i, buf, (size_t)ret));
+		}
+	}
+
+	pthread_join(thread, NULL);
+	close(listener);
+
+	for (size_t i = 0; i < MESSAGES; i++) {
+		fill_message(buf, i);
+		da_push_back_array(expected, buf, message_size(i));
+	}
+
+	assert_string_equal(r.path.array, "live/key");
+	assert_int_equal(r.count, CONNECTIONS);
+	assert_int_equal(r.next_sequence, MESSAGES);
+	assert_int_equal(r.pending.num, 0);
+	for (size_t i = 0; i < CONNECTIONS; i++)
+		assert_true(r.connections[i].messages > 0);
+
+	assert_int_equal(output.num, expected.num);
+	assert_memory_equal(output.array, expected.array, expected.num);
+
+	stripe_reassembler_free(&r);
+	da_free(output);
+	da_free(expected);
+	bfree(buf);
+}
+
+static void bind_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct sockaddr_in local = {0};
+	struct sockaddr_in peer = {0};
+	struct sockaddr_in6 local6 = {0};
+	socklen_t addr_size = sizeof(local);
+	struct stripe_sender stripe;
+	int listener;
+	unsigned int port = listen_loopback(&listener);
+
+	/* the bind address normally has no port, one is set here so the
+	 * server side can tell that the bind happened */
+	int reserved;
+	listen_loopback(&reserved);
+	assert_int_equal(getsockname(reserved, (struct sockaddr *)&local, &addr_size), 0);
+	close(reserved);
+
+	assert_true(stripe_connect(&stripe, "127.0.0.1", port, "live/key", 1, (struct sockaddr *)&local,
+				   sizeof(local)));
+
+	int fd = accept(listener, (struct sockaddr *)&peer, &addr_size);
+	assert_true(fd >= 0);
+	assert_int_equal(peer.sin_port, local.sin_port);
+	close(fd);
+	stripe_close(&stripe);
+
+	/* nothing to connect to from an address of the other family */
+	local6.sin6_family = AF_INET6;
+	local6.sin6_addr = in6addr_loopback;
+	assert_false(stripe_connect(&stripe, "127.0.0.1", port, "live/key", 1, (struct sockaddr *)&local6,
+				    sizeof(local6)));
+	assert_false(stripe_active(&stripe));
+
+	close(listener);
+}
+
+static void out_of_order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t hello[STRIPE_HELLO_SIZE + 1] = STRIPE_MAGIC;
+	uint8_t msgs[3][STRIPE_MESSAGE_HEADER_SIZE + 1] = {
+		{0, 0, 0, 2, 0, 0, 0, 1, 'c'},
+		{0, 0, 0, 0, 0, 0, 0, 1, 'a'},
+		{0, 0, 0, 1, 0, 0, 0, 1, 'b'},
+	};
+	struct stripe_reassembler r;
+	DARRAY(uint8_t) output;
+
+	da_init(output);
+	stripe_reassembler_init(&r, append_output, &output);
+
+	hello[STRIPE_MAGIC_SIZE] = STRIPE_VERSION;
+	hello[STRIPE_MAGIC_SIZE + 2] = 2;
+	hello[STRIPE_MAGIC_SIZE + 12] = 1;
+	hello[STRIPE_HELLO_SIZE] = 'x';
+
+	/* split the hello to check that partial data is kept */
+	assert_true(stripe_reassembler_push(&r, 0, hello, 5));
+	assert_true(stripe_reassembler_push(&r, 0, hello + 5, sizeof(hello) - 5));
+	hello[STRIPE_MAGIC_SIZE + 1] = 1;
+	assert_true(stripe_reassembler_push(&r, 1, hello, sizeof(hello)));
+
+	assert_true(stripe_reassembler_push(&r, 1, msgs[0], sizeof(msgs[0])));
+	assert_int_equal(output.num, 0);
+	assert_true(stripe_reassembler_push(&r, 0, msgs[1], sizeof(msgs[1])));
+	assert_int_equal(output.num, 1);
+	assert_true(stripe_reassembler_push(&r, 0, msgs[2], sizeof(msgs[2])));
+	assert_int_equal(output.num, 3);
+	assert_memory_equal(output.array, "abc", 3);
+
+	/* a connection from another session is rejected */
+	hello[STRIPE_MAGIC_SIZE + 3] = 1;
+	assert_false(stripe_reassembler_push(&r, 2, hello, sizeof(hello)));
+
+	stripe_reassembler_free(&r);
+	da_free(output);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(loopback_test),
+		cmocka_unit_test(bind_test),
+		cmocka_unit_test(out_of_order_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}